@@ -1,8 +1,10 @@
 #ifndef __ACTION_QUEUE_H__
 #define __ACTION_QUEUE_H__
 
+#include <vector>
 #include <memory>
 #include <cassert>
+#include <algorithm>
 #include <iostream>
 #include "cocos2d.h"
 
@@ -10,14 +12,30 @@
 #define DEFAULT_BEARING -1.0f
 #define DEFAULT_TARGET_X -1.0f
 #define DEFAULT_TARGET_Y -1.0f
+/** The index of no action */
+#define NO_ACTION -1
 
 using namespace std;
 using namespace cocos2d;
 
-/** Linked list of ActionNodes. Manipulated by the AI Controller. */
+/**
+ * Action program of a moving object. Manipulated by the AI Controller.
+ *
+ * The actions are stored contiguously. The first part of the array is the
+ * program: the actions pushed onto the queue, in order. The cursor walks
+ * the program, and when it runs off the end it either jumps back to the
+ * cycle start or leaves the queue empty. Forced actions are stored after
+ * the program and run before it; when they are done the cursor resumes at
+ * the head of the default cycle.
+ *
+ * Advancing, resetting and cycling only move indices. Actions that can no
+ * longer be reached are compacted away when new ones are pushed, so a mover
+ * that is fed one action at a time reuses the same storage every frame.
+ */
 
 template <class T>
 class OurMovingObject;
+class LevelInstance;
 
 template <class T>
 class ActionQueue : public Ref {
@@ -25,7 +43,7 @@ class ActionQueue : public Ref {
 	CC_DISALLOW_COPY_AND_ASSIGN(ActionQueue<T>);
 
 private:
-	class ActionNode;
+	class Action;
 
 public:
 
@@ -35,8 +53,10 @@ public:
 
 	friend class OurMovingObject<T>;
 	friend class GameController;
-	
-	ActionQueue<T>() : _head(nullptr), _tail(nullptr), _initialHead(nullptr) {}
+	friend class Trajectory;
+	friend class LevelInstance;
+
+	ActionQueue<T>() : _programEnd(0), _cursor(NO_ACTION), _cycleStart(NO_ACTION), _initial(NO_ACTION) {}
 
 	static ActionQueue<T> * create() {
 		ActionQueue<T>* q = new (std::nothrow) ActionQueue<T>();
@@ -48,7 +68,7 @@ public:
 		return nullptr;
 	}
 
-	static ActionQueue<T> * create(ActionNode& action) {
+	static ActionQueue<T> * create(Action& action) {
 		ActionQueue<T>* q = new (std::nothrow) ActionQueue<T>();
 		if (q && q->initialize(action)) {
 			q->autorelease();
@@ -58,17 +78,7 @@ public:
 		return nullptr;
 	}
 
-	static ActionQueue<T> * create(shared_ptr<ActionNode> actionPtr) {
-		ActionQueue<T>* q = new (std::nothrow) ActionQueue<T>();
-		if (q && q->initialize(actionPtr)) {
-			q->autorelease();
-			return q;
-		}
-		CC_SAFE_DELETE(q);
-		return nullptr;
-	}
-
-	/** Creates a copy of queue with new copies of all action nodes */
+	/** Creates a copy of queue with new copies of all actions */
 	static ActionQueue<T> * create(ActionQueue<T>& queue) {
 		ActionQueue<T>* q = new (std::nothrow) ActionQueue<T>();
 		if (q && q->init(queue)) {
@@ -79,281 +89,395 @@ public:
 		return nullptr;
 	}
 
-	/** Returns whether the queue is empty by checking if _head is nullptr. */
-	bool isEmpty() {
-		return _head == nullptr;
+	/** Returns whether the queue is empty. */
+	bool isEmpty() const {
+		return _cursor == NO_ACTION;
+	}
+
+	/** Returns whether the program jumps back to a cycle start when it ends. */
+	bool isCycling() const {
+		return _cycleStart != NO_ACTION;
 	}
 
 	/**
-	* Moves the head to the next ActionNode, and the tail to the head
-	* if and only if tail has a neighbor. Ownership of the original head
-	* is transferred to the caller.
+	* Returns the first index at which the programs of two queues differ.
 	*
-	* @friendof ActionNode
-	* @release	The original head of the queue.
-	* @return	The original head of the queue.
+	* Each action is compared field for field. Forced actions and the cursor
+	* are not compared, so this is for queues that have not yet run.
+	*
+	* @return the first index whose actions differ, the program size if only
+	*		  the cycle starts differ, or NO_ACTION if the programs match
 	*/
-	shared_ptr<ActionNode> next() {
-		if (_head == nullptr) {
-			return _head;
+	int firstDifference(const ActionQueue<T>& other) const {
+		int count = std::min(_programEnd, other._programEnd);
+		for (int ii = 0; ii < count; ii++) {
+			const Action& a = _actions[ii];
+			const Action& b = other._actions[ii];
+			if (a._type != b._type || a._length != b._length || a._counter != b._counter ||
+				a._bearing != b._bearing || a._target != b._target) {
+				return ii;
+			}
 		}
-		else {
-			// To make sure we retain _head during the shift
-			shared_ptr<ActionNode> action(_head);
+		if (_programEnd != other._programEnd || _cycleStart != other._cycleStart) {
+			return count;
+		}
+		return NO_ACTION;
+	}
+
+	/** Returns the current action. The queue must not be empty. */
+	Action& front() {
+		assert(!isEmpty());
+		return _actions[_cursor];
+	}
+
+	/**
+	* Moves the cursor to the next action. At the end of the forced actions
+	* the cursor returns to the head of the default cycle, and at the end of
+	* the program it jumps to the cycle start, if there is one.
+	*/
+	void next() {
+		if (_cursor == NO_ACTION) {
+			return;
+		}
+		int popped = _cursor++;
+		if (popped >= _programEnd) {
+			if (_cursor == (int)_actions.size()) {
+				_actions.erase(_actions.begin() + _programEnd, _actions.end());
+				_cursor = _initial;
+			}
+		}
+		else if (_cursor == _programEnd) {
+			_cursor = _cycleStart;
+		}
+		// The head of the default cycle follows the cursor until it reaches the cycle
+		if (popped == _initial && popped != _cycleStart) {
+			_initial = _cursor;
+		}
+	}
 
-			// make the head of the default cycle the tail
-			if (tailLinksTo(_head)) {
-				bumpTail();
+	/**
+	* Moves through the program as the given number of frames of act()
+	* would, without acting. This catches the queue up with a mover that
+	* was moved along its compiled trajectory instead.
+	*/
+	void skip(int frames) {
+		while (frames > 0 && !isEmpty()) {
+			while (!isEmpty() && front()._counter <= 0) {
+				if (isCycling()) {
+					front()._counter = front()._length;
+				}
+				next();
 			}
-			// set _tail to null if _head was the only element and did
-			// not point to itself
-			else if (_tail == _head) {
-				_tail = nullptr;
+			if (isEmpty()) {
+				return;
 			}
-			return bumpHead();
+			int run = std::min(frames, front()._counter);
+			front()._counter -= run;
+			frames -= run;
 		}
 	}
 
-	/** Pushes a series of actions onto the queue. */
+	/**
+	* Pushes a series of actions onto the end of the program. If actions
+	* cycles, the queue takes over its cycle; otherwise the queue stops
+	* cycling, as with push.
+	*/
 	void concat(const ActionQueue<T>& actions) {
-		if (_head == nullptr) {
+		if (isEmpty()) {
 			reinitialize(actions);
+			return;
 		}
-		else {
-			if (actions.tailHasNext()) {
-				_initialHead = actions._head;
-			}
-			setTailNext(actions._head);
-			_tail = actions._tail;
+		vector<Action> pending;
+		int cycle = appendPending(actions, pending);
+		int end = _programEnd;
+		insertProgram(pending);
+		_cycleStart = cycle == NO_ACTION ? NO_ACTION : end + cycle;
+		if (_cycleStart != NO_ACTION) {
+			_initial = _cycleStart;
 		}
 	}
 
-	/** Pushes a copy of an action onto the queue. The copy does not
-	* preserve the _next attribute, it sets it to nullptr. */
-	void pushCopy(ActionNode action) {
-		pushNode(make_shared<ActionNode>(action));
+	/** Pushes a copy of an action onto the queue. */
+	void pushCopy(const Action& action) {
+		pushAction(action);
 	}
 
-	/** Constructs a new ActionNode with the given arguments and pushes it
+	/** Constructs a new Action with the given arguments and pushes it
 	* onto the queue. */
 	void push(ActionType type, Vec2 target) {
-		pushNode(make_shared<ActionNode>(type, target));
+		pushAction(Action(type, target));
 	}
 
-	/** Constructs a new ActionNode with the given arguments and pushes it
+	/** Constructs a new Action with the given arguments and pushes it
 	* onto the queue. */
 	void push(float bearing, ActionType type, Vec2 target) {
-		pushNode(make_shared<ActionNode>(bearing, type, target));
+		pushAction(Action(bearing, type, target));
 	}
 
-	/** Constructs a new ActionNode with the given arguments and pushes it
+	/** Constructs a new Action with the given arguments and pushes it
 	* onto the queue. */
 	void push(ActionType type, int length, int counter, Vec2 target) {
-		pushNode(make_shared<ActionNode>(type, length, counter, target));
+		pushAction(Action(type, length, counter, target));
 	}
 
-	/** Constructs a new ActionNode with the given arguments and pushes it
+	/** Constructs a new Action with the given arguments and pushes it
 	* onto the queue. */
 	void push(ActionType type, int length, Vec2 target) {
-		pushNode(make_shared<ActionNode>(type, length, target));
+		pushAction(Action(type, length, target));
 	}
 
-	/** Constructs a new ActionNode with the given arguments and pushes it
+	/** Constructs a new Action with the given arguments and pushes it
 	* onto the queue. */
 	void push(ActionType type, int length, int counter) {
-		pushNode(make_shared<ActionNode>(type, length, counter));
+		pushAction(Action(type, length, counter));
 	}
 
-	/** Constructs a new ActionNode with the given arguments and pushes it
+	/** Constructs a new Action with the given arguments and pushes it
 	* onto the queue. */
 	void push(float bearing, ActionType type, int length, int counter, Vec2 target) {
-		pushNode(make_shared<ActionNode>(bearing, type, length, counter, target));
+		pushAction(Action(bearing, type, length, counter, target));
 	}
 
-	/** Constructs a new ActionNode with the given arguments and pushes it
+	/** Constructs a new Action with the given arguments and pushes it
 	* onto the queue. */
 	void push(float bearing, ActionType type, int length, Vec2 target) {
-		pushNode(make_shared<ActionNode>(bearing, type, length, target));
+		pushAction(Action(bearing, type, length, target));
 	}
 
-	/** Constructs a new ActionNode with the given arguments and pushes it
+	/** Constructs a new Action with the given arguments and pushes it
 	* onto the queue. */
 	void push(ActionType type, int length) {
-		pushNode(make_shared<ActionNode>(type, length));
+		pushAction(Action(type, length));
 	}
 
-	/** Constructs a new ActionNode with the given arguments and pushes it
+	/** Constructs a new Action with the given arguments and pushes it
 	* onto the queue. */
 	void push(float bearing, ActionType type, int length) {
-		pushNode(make_shared<ActionNode>(bearing, type, length));
+		pushAction(Action(bearing, type, length));
 	}
 
-	/** Constructs a new ActionNode with the given arguments and pushes it
+	/** Constructs a new Action with the given arguments and pushes it
 	* onto the queue. */
 	void push(float bearing, ActionType type, int length, int counter) {
-		pushNode(make_shared<ActionNode>(bearing, type, length, counter));
+		pushAction(Action(bearing, type, length, counter));
 	}
 
-	/** Pushes the given node onto the queue. */
-	void pushNode(shared_ptr<ActionNode> action) {
+	/**
+	* Pushes the given action onto the end of the program. A cycling queue
+	* stops cycling: the pushed action runs once the cursor reaches the end
+	* of the program, and the queue is empty after it.
+	*/
+	void pushAction(const Action& action) {
 		if (isEmpty()) {
 			initialize(action);
+			return;
 		}
-		else {
-			setTailNext(action);
-			bumpTail();
+		compact();
+		_actions.insert(_actions.begin() + _programEnd, action);
+		if (_cursor >= _programEnd) {
+			_cursor++;
+		}
+		if (_initial == NO_ACTION) {
+			_initial = _programEnd;
 		}
+		_programEnd++;
+		_cycleStart = NO_ACTION;
 	}
 
-	/** Reinitializes the queue from the queue supplied. */
+	/** Reinitializes the queue as a copy of the queue supplied. */
 	void reinitialize(const ActionQueue<T>& actions) {
-		_head = actions._head;
-		_tail = actions._tail;
-		_initialHead = actions._initialHead;
+		_actions = actions._actions;
+		_programEnd = actions._programEnd;
+		_cursor = actions._cursor;
+		_cycleStart = actions._cycleStart;
+		_initial = actions._initial;
 	}
 
 	/** For use by the AI controller. Pushes a series of actions
-	* to the front of the queue. Does not link _tail back to the new head even
-	* if the list is cyclic, as that is not desired behavior. We want the
-	* default cycle (if one exists) to continue in the same way after the
-	* inserted actions are executed. If there are other actions to be
-	* executed before the default cycle, they are purged.
+	* to the front of the queue. Does not link the program back to the
+	* new actions even if the queue is cyclic, as that is not desired
+	* behavior. We want the default cycle (if one exists) to continue in the
+	* same way after the inserted actions are executed. If there are other
+	* actions to be executed before the default cycle, they are purged.
+	*
+	* If queue is itself cyclic, it replaces this queue entirely.
 	*
 	* @param fromBeginning	Whether the queue should return to the initial head
 	*						after finishing the forced section or continue from
 	*						where it left off.
 	*/
 	void force(const ActionQueue<T>& queue, bool fromBeginning) {
-		ActionQueue<T> actions;
-		actions.init(queue);
-		if (_head == nullptr) { // This queue is empty
-			reinitialize(actions);
+		vector<Action> pending;
+		int cycle = appendPending(queue, pending);
+		if (isEmpty() || cycle != NO_ACTION) {
+			clear();
+			_actions.swap(pending);
+			if (!_actions.empty()) {
+				_programEnd = (int)_actions.size();
+				_cursor = _initial = 0;
+				_cycleStart = cycle;
+			}
+			return;
 		}
-		else if (actions.tailHasNext()) { // actions is cyclic
 
-			// Retain _initialHead to check for circular references. Wrap a copy in
-			// a new action queue in order to manipulate _next without declaring an
-			// additional friend function or changing _next's access specifier,
-			// through the setTailNext() function which is a friend of ActionNode.
-			ActionQueue<T> temp;
-			temp.pushNode(_initialHead);
-
-			reinitialize(actions);
-			int useCount = temp._head.use_count();
-			if (useCount > 3) {
-				// There is a cycle.
-				// Make sure the implementation is correct and the manager object
-				// for the original _initialHead is only being pointed to by temp
-				// and the ActionNode at the end of the cycle.
-				assert(useCount == 4);
-
-				// Point _next elsewhere. Since no two different queues can
-				// have the same ActionNode instance, all descendants of temp's
-				// ActionNode will be destroyed. temp's ActionNode will then be
-				// destroyed itself when temp goes out of scope.
-				temp.setTailNext(nullptr);
+		if (_cursor < _programEnd) {
+			if (!fromBeginning) {  // Do not replace already forced actions
+				_initial = _cursor;
 			}
+			_actions.erase(_actions.begin() + _programEnd, _actions.end());
+		}
+		else if (fromBeginning) {
+			_actions.erase(_actions.begin() + _programEnd, _actions.end());
 		}
 		else {
-			if (!fromBeginning) {  // Do not replace already forced actions
-				_initialHead = _head;
-			}
-			actions.setTailNext(_initialHead);
-			_head = actions._head;
-			if (_tail == nullptr) _tail = actions._tail;
+			// Keep the rest of the earlier forced actions after the new ones
+			_actions.erase(_actions.begin() + _programEnd, _actions.begin() + _cursor);
 		}
+		_actions.insert(_actions.begin() + _programEnd, pending.begin(), pending.end());
+		_cursor = _programEnd < (int)_actions.size() ? _programEnd : _initial;
 	}
 
-	/** Returns to the default action pattern. */
+	/** Returns to the default action pattern, dropping any forced actions. */
 	void reset() {
-		_head = _initialHead;
-		resetTail();
+		_actions.erase(_actions.begin() + _programEnd, _actions.end());
+		_cursor = _initial;
+	}
+
+	/**
+	* Replaces the contents of this queue with a copy of another. The
+	* existing storage is reused, so this does not allocate once the queue
+	* has held a program of the same size.
+	*/
+	void assign(const ActionQueue<T>& queue) {
+		reinitialize(queue);
 	}
 
-	/** Sets whether the queue cycles back around or not. */
+	/** Empties the queue, keeping its storage. */
+	void clear() {
+		_actions.clear();
+		_programEnd = 0;
+		_cursor = _cycleStart = _initial = NO_ACTION;
+	}
+
+	/** Sets whether the queue cycles back around or not. A cycle starts
+	* at the current action of the program. */
 	void setCycling(bool cycle) {
-		if (cycle) {
-			setTailNext(_head);
+		if (!cycle) {
+			_cycleStart = NO_ACTION;
 		}
-		else {
-			setTailNext(nullptr);
+		else if (!isEmpty()) {
+			_cycleStart = _initial = (_cursor < _programEnd ? _cursor : _initial);
 		}
 	}
 
-private:
+	/**
+	* Makes the program cycle from the given pending action. The actions
+	* before it run once, and the rest repeat forever.
+	*
+	* @param offset	The position of the cycle start, counting from the
+	*				current action of the program
+	*/
+	void setCycleStart(int offset) {
+		int start = (_cursor < _programEnd ? _cursor : _initial) + offset;
+		if (isEmpty() || start < 0 || start >= _programEnd) {
+			return;
+		}
+		_cycleStart = start;
+		if (_initial == NO_ACTION || _initial > start) {
+			_initial = start;
+		}
+	}
 
-	shared_ptr<ActionNode> _head;
-	shared_ptr<ActionNode> _tail;
+private:
 
-	// The head of the default cycle
-	shared_ptr<ActionNode> _initialHead;
+	/** The program, followed by any forced actions */
+	vector<Action> _actions;
+	/** The number of actions in the program; forced actions start here */
+	int _programEnd;
+	/** The index of the current action, or NO_ACTION if the queue is empty */
+	int _cursor;
+	/** The program index the cursor returns to at the end, or NO_ACTION */
+	int _cycleStart;
+	/** The head of the default cycle, where reset() and forced actions return to */
+	int _initial;
 
-	/** Sets tail of queue to the correct node */
-	void resetTail() {
-		assert(_head == _initialHead);
-		if (_tail != nullptr) { // If _tail == nullptr, _head must be nullptr
-			_tail = _head;
+	/**
+	* Drops the actions before every index still in use, once they make up
+	* at least half of the program. Erasing keeps the capacity, so a queue
+	* that is pushed and drained at the same rate never reallocates.
+	*/
+	void compact() {
+		int first = _programEnd;
+		if (_cursor != NO_ACTION && _cursor < first) first = _cursor;
+		if (_initial != NO_ACTION && _initial < first) first = _initial;
+		if (_cycleStart != NO_ACTION && _cycleStart < first) first = _cycleStart;
+		if (first == 0 || first * 2 < _programEnd) {
+			return;
+		}
+		_actions.erase(_actions.begin(), _actions.begin() + first);
+		_programEnd -= first;
+		if (_cursor != NO_ACTION) _cursor -= first;
+		if (_initial != NO_ACTION) _initial -= first;
+		if (_cycleStart != NO_ACTION) _cycleStart -= first;
+	}
+
+	/** Inserts actions at the end of the program, before any forced actions. */
+	void insertProgram(const vector<Action>& actions) {
+		compact();
+		_actions.insert(_actions.begin() + _programEnd, actions.begin(), actions.end());
+		if (_cursor >= _programEnd) {
+			_cursor += (int)actions.size();
+		}
+		if (_initial == NO_ACTION && !actions.empty()) {
+			_initial = _programEnd;
 		}
-		while (tailHasNext() && !tailLinksTo(_head)) bumpTail();
+		_programEnd += (int)actions.size();
 	}
 
 	/**
-	* Checks if _tail->_next is _head.
+	* Appends the actions still to run in a queue to out, in the order they
+	* will run. The rest of the current pass through a cycle is written out
+	* in full before the cycle itself.
 	*
-	* @friendof ActionNode
+	* @return the index in out where the cycle starts, or NO_ACTION
 	*/
-	bool tailLinksTo(shared_ptr<ActionNode> action) {
-		return _tail != nullptr &&_tail->getNext() == action;
+	static int appendPending(const ActionQueue<T>& queue, vector<Action>& out) {
+		int current = queue._cursor;
+		if (current == NO_ACTION) {
+			return NO_ACTION;
+		}
+		if (current >= queue._programEnd) {
+			out.insert(out.end(), queue._actions.begin() + current, queue._actions.end());
+			current = queue._initial;
+			if (current == NO_ACTION) {
+				return NO_ACTION;
+			}
+		}
+		int base = (int)out.size();
+		out.insert(out.end(), queue._actions.begin() + current, queue._actions.begin() + queue._programEnd);
+		if (queue._cycleStart == NO_ACTION) {
+			return NO_ACTION;
+		}
+		if (current <= queue._cycleStart) {
+			return base + (queue._cycleStart - current);
+		}
+		int start = (int)out.size();
+		out.insert(out.end(), queue._actions.begin() + queue._cycleStart, queue._actions.begin() + queue._programEnd);
+		for (size_t ii = start; ii < out.size(); ii++) {
+			out[ii]._counter = out[ii]._length;
+		}
+		return start;
 	}
 
 	// INITIALIZATION
 
 	bool init() {
-		_head = nullptr;
-		_tail = nullptr;
-		_initialHead = nullptr;
+		clear();
 		return true;
 	}
 
 	bool init(const ActionQueue<T>& actions) {
-		assert((actions._initialHead == nullptr) == (actions._head == nullptr));
-		if (init()) {
-			shared_ptr<ActionNode> current = actions._head;
-			bool initialHeadSet = false;
-			while (current != nullptr) {
-				if (!initialHeadSet) {
-					pushCopy(*current);
-					if (current == actions._initialHead) {
-						_initialHead = _tail;
-						initialHeadSet = true;
-					}
-				}
-				else if (current == actions._initialHead) {
-					setTailNext(_initialHead);
-					return true;
-				}
-				else {
-					pushCopy(*current);
-				}
-				current = current->getNext();
-			}
-			return true;
-		}
-		return false;
-	}
-
-	/** Empties the queue and reinitializes it with the supplied action.
-	*
-	* @param	actionPtr	Points to the action to reinitialize the queue with
-	*/
-	bool initialize(shared_ptr<ActionNode> actionPtr) {
-		// Initialize the shared pointers
-		_head = shared_ptr<ActionNode>(actionPtr);  // copies actionPtr
-		_tail = shared_ptr<ActionNode>(actionPtr);  // copies actionPtr
-		_initialHead = shared_ptr<ActionNode>(actionPtr);  // copies actionPtr
-		//
-		// Correct the tail
-		resetTail();
+		reinitialize(actions);
 		return true;
 	}
 
@@ -361,75 +485,18 @@ private:
 	*
 	* @param	action		The action to reinitialize the queue with
 	*/
-	bool initialize(ActionNode& action) {
-		// Initialize the shared pointers
-		_head = make_shared<ActionNode>(action);
-		_tail = shared_ptr<ActionNode>(_head);  // copies _head
-		_initialHead = shared_ptr<ActionNode>(_head);  // copies _head
-		//
-		// Correct the tail
-		resetTail();
+	bool initialize(const Action& action) {
+		clear();
+		_actions.push_back(action);
+		_programEnd = 1;
+		_cursor = _initial = 0;
 		return true;
 	}
 
-	/**
-	* Bump the head forward by 1 and return the original head.
-	* Useful when calling next().
-	*
-	* @friendof	ActionNode
-	* @return	the first element in the queue
-	*/
-	shared_ptr<ActionNode> bumpHead() {
-		shared_ptr<ActionNode> action(_head);
-		_head = _head->getNext();
-		// Reset initialHead if about to be popped from the queue
-		if (_initialHead == action && !tailLinksTo(action)) {
-			_initialHead = _head;
-		}
-		return action;
-	}
-
-	/**
-	* Bump the tail forward by 1. Useful when calling next() on a cyclic queue
-	* and repointing the tail to the proper ActionNode using resetTail().
-	*
-	* @friendof ActionNode
-	*/
-	void bumpTail() { _tail = _tail->getNext(); }
+	class Action {
 
-	/**
-	* Sets _tail->_next for cycling purposes.
-	*
-	* @friendof ActionNode
-	*/
-	void setTailNext(shared_ptr<ActionNode> next) { 
-		if (_tail != nullptr) {
-			_tail->_next = next;
-		}
-		else {
-			initialize(next);
-		}
-	}
-
-	/** Returns whether _tail points to another ActionNode. */
-	const bool tailHasNext() const {
-		if (_tail != nullptr && _tail->getNext() != nullptr) {
-			/* cout << (_tail->_next == _head) << endl;
-			cout << (_tail->_next == _initialHead) << endl; */
-			//assert(_tail->_next == _initialHead);  TODO uncomment
-			return true;
-		}
-		return false;
-	}
-
-	class ActionNode {
-
-	private:
-		shared_ptr<ActionNode> _next;
 	public:
 
-		friend void ActionQueue<T>::setTailNext(shared_ptr<ActionNode> next);
-
 		/** The type of the action */
 		ActionType _type;
 
@@ -451,75 +518,35 @@ private:
 
 		// CONSTRUCTORS
 
-		ActionNode(ActionType type, Vec2 target) : _length(DEFAULT_ACTION_LENGTH), _counter(
-			DEFAULT_ACTION_LENGTH), _type(type), _next(nullptr
-				), _bearing(DEFAULT_BEARING), _target(target) {}
+		Action(ActionType type, Vec2 target) : _type(type), _length(DEFAULT_ACTION_LENGTH),
+			_counter(DEFAULT_ACTION_LENGTH), _bearing(DEFAULT_BEARING), _target(target) {}
 
-		ActionNode(float bearing, ActionType type, Vec2 target) : _length(DEFAULT_ACTION_LENGTH), _counter(
-			DEFAULT_ACTION_LENGTH), _type(type), _next(nullptr
-				), _bearing(bearing), _target(target) {}
+		Action(float bearing, ActionType type, Vec2 target) : _type(type), _length(DEFAULT_ACTION_LENGTH),
+			_counter(DEFAULT_ACTION_LENGTH), _bearing(bearing), _target(target) {}
 
-		ActionNode(ActionType type, int length, int counter, Vec2 target) : _type(type
-			), _length(length), _counter(counter), _next(nullptr), _bearing(
-				DEFAULT_BEARING), _target(target) {}
+		Action(ActionType type, int length, int counter, Vec2 target) : _type(type),
+			_length(length), _counter(counter), _bearing(DEFAULT_BEARING), _target(target) {}
 
-		ActionNode(ActionType type, int length, Vec2 target) : _type(type
-			), _length(length), _counter(length), _next(nullptr), _bearing(
-				DEFAULT_BEARING), _target(target) {}
+		Action(ActionType type, int length, Vec2 target) : _type(type),
+			_length(length), _counter(length), _bearing(DEFAULT_BEARING), _target(target) {}
 
-		ActionNode(ActionType type, int length, int counter) : _type(type
-			), _length(length), _counter(counter), _next(nullptr), _bearing(
-				DEFAULT_BEARING) {
-			_target.x = DEFAULT_TARGET_X;
-			_target.y = DEFAULT_TARGET_Y;
-		}
-
-		ActionNode(float bearing, ActionType type, int length, Vec2 target) : _counter(length
-			), _type(type), _length(length), _next(nullptr), _bearing(bearing),
-			_target(target) {}
+		Action(ActionType type, int length, int counter) : _type(type), _length(length),
+			_counter(counter), _bearing(DEFAULT_BEARING), _target(DEFAULT_TARGET_X, DEFAULT_TARGET_Y) {}
 
-		ActionNode(ActionType type, int length) : _counter(length), _type(
-			type), _length(length), _next(nullptr), _bearing(DEFAULT_BEARING) {
-			_target.x = DEFAULT_TARGET_X;
-			_target.y = DEFAULT_TARGET_Y;
-		}
+		Action(float bearing, ActionType type, int length, Vec2 target) : _type(type),
+			_length(length), _counter(length), _bearing(bearing), _target(target) {}
 
-		ActionNode(float bearing, ActionType type, int length) : _counter(length
-			), _type(type), _length(length), _next(nullptr), _bearing(bearing) {
-			_target.x = DEFAULT_TARGET_X;
-			_target.y = DEFAULT_TARGET_Y;
-		}
+		Action(ActionType type, int length) : _type(type), _length(length),
+			_counter(length), _bearing(DEFAULT_BEARING), _target(DEFAULT_TARGET_X, DEFAULT_TARGET_Y) {}
 
-		ActionNode(float bearing, ActionType type, int length, int counter) :
-			_counter(counter), _type(type), _length(length), _next(nullptr
-				), _bearing(bearing) {
-			_target.x = DEFAULT_TARGET_X;
-			_target.y = DEFAULT_TARGET_Y;
-		}
+		Action(float bearing, ActionType type, int length) : _type(type), _length(length),
+			_counter(length), _bearing(bearing), _target(DEFAULT_TARGET_X, DEFAULT_TARGET_Y) {}
 
-		ActionNode(float bearing, ActionType type, int length, int counter, Vec2 target) :
-			_counter(counter), _type(type), _length(length), _next(nullptr
-				), _bearing(bearing), _target(target) {}
-
-		ActionNode(const ActionNode& action) : _counter(action._counter
-			), _type(action._type), _length(action._length), _next(nullptr
-				), _bearing(action._bearing), _target(action._target) {}
-
-
-		~ActionNode() {
-			//_type = NULL;
-			_length = NULL;
-			_counter = NULL;
-			_bearing = NULL;
-			_target.x = NULL;
-			_target.y = NULL;
-			// Do not delete _next, set it to nullptr instead.
-			// This is what shared_ptrs are for - the object pointed to will be
-			// destroyed automatically if there is nothing pointing to it.
-			_next = nullptr;  // THIS SHOULD COME LAST FOR TAIL RECURSION.
-		}
+		Action(float bearing, ActionType type, int length, int counter) : _type(type),
+			_length(length), _counter(counter), _bearing(bearing), _target(DEFAULT_TARGET_X, DEFAULT_TARGET_Y) {}
 
-		const shared_ptr<ActionNode> getNext() const { return _next; }
+		Action(float bearing, ActionType type, int length, int counter, Vec2 target) : _type(type),
+			_length(length), _counter(counter), _bearing(bearing), _target(target) {}
 	};
 
 };
@@ -1,3 +1,5 @@
+#include <math.h>
+#include <algorithm>
 #include "C_AI.h"
 #include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Common/b2Math.h>
@@ -7,14 +9,50 @@
 
 bool AIController::init(LevelInstance * level) {
 	// Create the world
+	_level = level;
 	_caster = level->_casterPos.object;
-	_pedMovers = level->_pedestrians;
+	_pedMovers = &(level->_movers.pedestrians);
 	_avatar = level->_playerPos.object;
+
+	// The caster is the agent after the last pedestrian
+	_paths.init(&(level->_navMesh), _pedMovers->size() + 1);
+	_flow.init(level->_size);
+	for (LevelInstance::StaticObjectMetadata &data : level->_staticObjects) {
+		_flow.addBox(data.object->getPosition(), data.object->getDimension(), NAV_AGENT_RADIUS);
+	}
+	_avatarFlow = _flow.addTarget();
+	if (!_jobs.isActive()) {
+		_jobs.init();
+	}
+	if (_pedPath == nullptr) {
+		_pedPath = ActionQueue<Pedestrian>::create();
+		_pedPath->retain();
+	}
+	if (_casterPath == nullptr) {
+		_casterPath = ActionQueue<Caster>::create();
+		_casterPath->retain();
+	}
+	reset();
 	_active = true;
 	return true;
 }
 
 AIController::AIController() :
+	_level(nullptr),
+	_pedMovers(nullptr),
+	_frame(0),
+	_avatarFlow(0),
+	_chasers(0),
+	_crowded(false),
+	_flowFront(-1),
+	_sightings(0),
+	_parallel(true),
+	_crossCheck(false),
+	_crossChecked(0),
+	_mismatches(0),
+	_pedPath(nullptr),
+	_casterPath(nullptr),
+	_casterCooldown(0),
 	_caster(nullptr),
 	_avatar(nullptr),
 	_chasing(false),
@@ -29,49 +67,336 @@ AIController::~AIController() {
 
 
 void AIController::dispose() {
+	_paths.dispose();
+	_flow.dispose();
+	_jobs.dispose();
+	if (_pedPath != nullptr) {
+		_pedPath->release();
+		_pedPath = nullptr;
+	}
+	if (_casterPath != nullptr) {
+		_casterPath->release();
+		_casterPath = nullptr;
+	}
 	if (_caster != nullptr) {
 		_caster = nullptr;
 	}
 }
 
 
+/**
+* Updates the state of every pedestrian near the character or already alerted.
+*
+* Only the pedestrians the spatial index returns within the lose radius and
+* the ones already chasing or searching are visited, so patrolling
+* pedestrians far from the character cost nothing. A pedestrian starts
+* chasing inside the sight radius and stops only outside the larger lose
+* radius, so it does not flicker at the boundary. Patrolling pedestrians
+* are left to their action queues.
+*
+* Every gathered pedestrian gets a vision check each update: the lines from
+* all of them to the character are tested against the building footprints
+* in one batch, before the read phase, so the phases only read the result.
+*
+* Paths finished by the worker since the last update are handed out first,
+* so a request made this frame is answered on a later one.
+*
+* The pedestrians are handled in two phases. The read phase decides for
+* every gathered pedestrian from the state left by the last update, in
+* parallel chunks once there are enough of them. The commit phase then
+* applies the decisions to the pedestrians and their bodies one by one, in
+* gathering order, so the outcome does not depend on the number of threads.
+*/
 void AIController::update() {
 	// Update pedestrians
 	if (_active) {
-		for (LevelInstance::PedestrianMetadata ped : _pedMovers)
-			updatePed(ped.object);
+		_frame++;
+		_level->updateMoverIndex();
+		const MoverGrid& index = _level->_pedestrianIndex;
+		Vec2 avatar = _avatar->getPosition();
+		b2Vec2 avaPos(avatar.x, avatar.y);
+
+		// Crowding is judged on the last update, so it holds for the whole pass
+		_crowded = _chasers >= PEDESTRIAN_CROWD_SIZE;
+		deliverPaths();
+		if (_chasers > 0) {
+			_flow.setTarget(_avatarFlow, avaPos);
+		}
+		_flow.update();
+
+		_flowFront = _crowded ? _flow.getFront(_avatarFlow) : -1;
+
+		// Gather the alerted pedestrians, then the patrolling ones nearby
+		_work.assign(_alerted.begin(), _alerted.end());
+		_nearby.clear();
+		index.query(avaPos, PEDESTRIAN_LOSE_RADIUS, _nearby);
+		for (int ped : _nearby) {
+			_lastSeen[ped] = _frame;
+			if (_pedStates[ped] == PATROL) {
+				_work.push_back(ped);
+			}
+		}
+
+		// Vision checks for the whole list at once
+		int count = (int)_work.size();
+		_sightLines.resize(count);
+		_sightBits.resize((count + 31) / 32);
+		for (int ii = 0; ii < count; ii++) {
+			_sightLines[ii].from = _level->_pedestrianIndex.getPosition(_work[ii]);
+			_sightLines[ii].to = avaPos;
+		}
+		_level->_occluders.test(_sightLines.data(), count, _sightBits.data());
+
+		// Read phase: each decision only depends on its own pedestrian
+		_decisions.resize(count);
+		auto decideRange = [this, &avaPos](int begin, int end) {
+			for (int ii = begin; ii < end; ii++) {
+				decide(_work[ii], OccluderBVH::isSet(_sightBits.data(), ii), avaPos, _decisions[ii]);
+			}
+		};
+		bool parallel = _parallel && _jobs.isActive() && count >= AI_PARALLEL_THRESHOLD;
+		if (parallel) {
+			_jobs.run(count, AI_CHUNK_SIZE, decideRange);
+		}
+		else {
+			decideRange(0, count);
+		}
+		if (parallel && _crossCheck) {
+			_checkDecisions.resize(count);
+			for (int ii = 0; ii < count; ii++) {
+				decide(_work[ii], OccluderBVH::isSet(_sightBits.data(), ii), avaPos, _checkDecisions[ii]);
+				const PedDecision& a = _decisions[ii];
+				const PedDecision& b = _checkDecisions[ii];
+				if (a.state != b.state || a.steer != b.steer || a.replan != b.replan ||
+					a.velocity.x != b.velocity.x || a.velocity.y != b.velocity.y) {
+					_mismatches++;
+				}
+			}
+			_crossChecked += count;
+		}
+
+		// Commit phase: apply the decisions in a fixed order
+		_chasing = false;
+		_chasers = 0;
+		_sightings = 0;
+		_alerted.clear();
+		for (int ii = 0; ii < count; ii++) {
+			commit(_work[ii], _decisions[ii], avaPos);
+			if (_decisions[ii].state != PATROL) {
+				_alerted.push_back(_work[ii]);
+			}
+		}
 		updateCaster();
 	}
 }
 
-void AIController::updatePed(OurMovingObject<Pedestrian>* ped) {
-	Vec2 movVec = Vec2(_avatar->getHorizontalMovement(), _avatar->getVerticalMovement());
-	Vec2 avaPos = _avatar->getPosition();
-	Vec2 diff = avaPos - (ped->getPosition());
-	int speed = 2;
-	if (diff.getLength() < 10) {
-		_chasing = true;
-		diff.normalize();
-		ped->setHorizontalMovement(diff.x*speed);
-		ped->setVerticalMovement(diff.y*speed);
+void AIController::setPedState(int index, PedestrianState state) {
+	_pedStates[index] = state;
+	_pedMovers->setSteered(index, state != PATROL);
+
+	if (state == CHASE) {
+		_nextPlan[index] = _frame;
+	}
+	else if (state == SEARCH) {
+		// Drop the path, so the queue resumes the patrol where it left it
+		_paths.cancel(index);
+		ActionQueue<Pedestrian>* queue = _pedMovers->get(index)->_actionQueue;
+		if (_level->_pedestrians[index].actions->isEmpty()) {
+			queue->clear();
+		}
+		else {
+			queue->reset();
+		}
+
+		OurMovingObject<Pedestrian>* ped = _pedMovers->get(index);
+		ped->setHorizontalMovement(0.0f);
+		ped->setVerticalMovement(0.0f);
 		ped->applyForce();
+		_searchFrames[index] = PEDESTRIAN_SEARCH_FRAMES;
+	}
+}
+
+void AIController::decide(int index, bool hidden, const b2Vec2& avaPos, PedDecision& out) const {
+	const b2Vec2& pos = _level->_pedestrianIndex.getPosition(index);
+	PedestrianState state = _pedStates[index];
+	bool seen = _lastSeen[index] == _frame;
+	bool sighted = seen && !hidden
+		&& (pos - avaPos).LengthSquared() <= PEDESTRIAN_SIGHT_RADIUS * PEDESTRIAN_SIGHT_RADIUS;
+
+	out.steer = STEER_NONE;
+	out.replan = false;
+	out.velocity.SetZero();
+	if (state == CHASE) {
+		out.state = seen ? CHASE : SEARCH;
+	}
+	else if (sighted) {
+		out.state = CHASE;
+	}
+	else if (state == SEARCH) {
+		out.state = _searchFrames[index] > 1 ? SEARCH : PATROL;
 	}
 	else {
-		_chasing = false;
-		ped->_actionQueue->push(Pedestrian::ActionType::STAND, 1);
+		out.state = PATROL;
+	}
+	if (out.state != CHASE) {
+		return;
 	}
+
+	if (_flowFront >= 0) {
+		b2Vec2 dir = _flow.sample(_avatarFlow, _flowFront, pos);
+		if (dir.LengthSquared() > 0.0f) {
+			out.steer = STEER_FLOW;
+			out.velocity.Set(dir.x * PEDESTRIAN_CHASE_SPEED, dir.y * PEDESTRIAN_CHASE_SPEED);
+			return;
+		}
+	}
+
+	// A pedestrian starting to chase is steered and plans at once
+	bool starting = state != CHASE;
+	unsigned int nextPlan = starting ? _frame : _nextPlan[index];
+	out.replan = _paths.isActive() && _frame >= nextPlan && !_paths.isPending(index);
+	if (!starting && !_pedMovers->isSteered(index)) {
+		out.steer = STEER_PATH;
+		return;
+	}
+	b2Vec2 diff = avaPos - pos;
+	diff.Normalize();
+	out.steer = STEER_DIRECT;
+	out.velocity.Set(diff.x * PEDESTRIAN_CHASE_SPEED, diff.y * PEDESTRIAN_CHASE_SPEED);
+}
+
+void AIController::commit(int index, const PedDecision& decision, const b2Vec2& avaPos) {
+	if (decision.state != _pedStates[index]) {
+		if (decision.state == CHASE) {
+			_sightings++;
+		}
+		setPedState(index, decision.state);
+	}
+	else if (decision.state == SEARCH) {
+		_searchFrames[index]--;
+	}
+	if (decision.state != CHASE) {
+		return;
+	}
+	_chasing = true;
+	_chasers++;
+
+	if (decision.steer == STEER_FLOW && !_pedMovers->isSteered(index)) {
+		_paths.cancel(index);
+		_pedMovers->setSteered(index, true);
+	}
+	if (decision.replan) {
+		_paths.request(index, _level->_pedestrianIndex.getPosition(index), avaPos);
+		_nextPlan[index] = _frame + PEDESTRIAN_REPLAN_FRAMES;
+	}
+	if (decision.steer == STEER_FLOW || decision.steer == STEER_DIRECT) {
+		OurMovingObject<Pedestrian>* ped = _pedMovers->get(index);
+		ped->setHorizontalMovement(decision.velocity.x);
+		ped->setVerticalMovement(decision.velocity.y);
+		ped->applyForce();
+	}
+}
+
+void AIController::deliverPaths() {
+	_paths.poll(_pathResults);
+	int casterAgent = _pedMovers->size();
+	for (PathResult& result : _pathResults) {
+		if (result.agent == casterAgent) {
+			if (result.found && !result.points.empty()) {
+				Vec2 pos = _caster->getPosition();
+				writePath<Caster>(_casterPath, b2Vec2(pos.x, pos.y), result.points,
+					Caster::WALK, Caster::STAND, CASTER_SPEED, 1);
+				_caster->_actionQueue->force(*_casterPath, true);
+			}
+			continue;
+		}
+
+		// A pedestrian may have lost the character, or joined a crowd, while its path was found
+		int ped = result.agent;
+		if (_pedStates[ped] != CHASE || _crowded) {
+			continue;
+		}
+		if (!result.found || result.points.empty()) {
+			_pedMovers->setSteered(ped, true);
+			continue;
+		}
+		// Wait at the end of the path for the next one, rather than patrol
+		writePath<Pedestrian>(_pedPath, _level->_pedestrianIndex.getPosition(ped), result.points,
+			Pedestrian::WALK_SLOW, Pedestrian::STAND, PEDESTRIAN_SPEED, PEDESTRIAN_REPLAN_FRAMES);
+		ActionQueue<Pedestrian>* queue = _pedMovers->get(ped)->_actionQueue;
+		queue->reset();
+		queue->force(*_pedPath, false);
+		_pedMovers->setSteered(ped, false);
+	}
+}
+
+template <class T>
+void AIController::writePath(ActionQueue<T>* queue, const b2Vec2& start, const vector<b2Vec2>& path,
+	typename T::ActionType walk, typename T::ActionType stop, float speed, int stopFrames) {
+	queue->clear();
+	b2Vec2 from = start;
+	for (const b2Vec2& to : path) {
+		b2Vec2 leg = to - from;
+		float length = leg.Length();
+		if (length > b2_linearSlop) {
+			// The act methods walk opposite to the body angle
+			int frames = std::max(1, (int)ceilf(length / (speed * PATH_FRAME_TIME)));
+			queue->push(atan2f(leg.y, leg.x) + (float)M_PI, walk, frames);
+		}
+		from = to;
+	}
+	queue->push(stop, stopFrames);
 }
 
 void AIController::updateCaster() {
+	if (_caster == nullptr) {
+		return;
+	}
+	if (_casterCooldown > 0) {
+		_casterCooldown--;
+	}
 
+	int agent = _pedMovers->size();
+	Vec2 caster = _caster->getPosition();
+	Vec2 away = caster - _avatar->getPosition();
+	float distance = away.length();
+	if (_casterCooldown == 0 && _paths.isActive() && _caster->_actionQueue->isEmpty()
+		&& !_paths.isPending(agent) && distance > 0.0f && distance <= CASTER_ALERT_RADIUS) {
+		Vec2 goal = caster + away * (CASTER_RETREAT_DISTANCE / distance);
+		goal.x = clampf(goal.x, 0.0f, _level->_size.width);
+		goal.y = clampf(goal.y, 0.0f, _level->_size.height);
+		_paths.request(agent, b2Vec2(caster.x, caster.y), b2Vec2(goal.x, goal.y));
+		_casterCooldown = CASTER_RETREAT_COOLDOWN;
+	}
 }
 
 
+/**
+* Puts every pedestrian and the caster back in their starting state.
+*
+* The level, the path worker, the flow field and the helper threads are all
+* kept, so a level restart allocates nothing. Path searches still waiting
+* are dropped, and any in progress are ignored when they finish.
+*/
 void AIController::reset() {
-	_active = false;
-	_avatar = nullptr;
-	_caster = nullptr;
-	_pedMovers.clear();
+	if (_pedMovers == nullptr) {
+		return;
+	}
+	int count = _pedMovers->size();
+	_pedStates.assign(count, PATROL);
+	_searchFrames.assign(count, 0);
+	_lastSeen.assign(count, 0);
+	_alerted.clear();
+	_nextPlan.assign(count, 0);
+	_frame = 0;
+	_casterCooldown = 0;
+	_pedMovers->releaseSteering();
+	_paths.clear();
+	_chasing = false;
+	_chasers = 0;
+	_crowded = false;
+	_flowFront = -1;
+	_sightings = 0;
 }
 
 
@@ -6,18 +6,140 @@
 #include <M_Pedestrian.h>
 #include <M_MovingObject.h>
 #include "M_LevelInstance.h"
+#include "PathQueue.h"
+#include "FlowField.h"
+#include "ParallelFor.h"
+
+/** Distance at which a patrolling pedestrian notices the character in plain view */
+#define PEDESTRIAN_SIGHT_RADIUS 10.0f
+/** Distance beyond which a chasing pedestrian loses the character */
+#define PEDESTRIAN_LOSE_RADIUS 12.0f
+/** Speed of a pedestrian steered straight at the character, in Box2D units per second */
+#define PEDESTRIAN_CHASE_SPEED 2.0f
+/** Frames a pedestrian waits where it lost the character before patrolling again */
+#define PEDESTRIAN_SEARCH_FRAMES 60
+/** Frames between two path requests of a chasing pedestrian */
+#define PEDESTRIAN_REPLAN_FRAMES 20
+/** Chasing pedestrians at which they share a flow field instead of planning paths */
+#define PEDESTRIAN_CROWD_SIZE 4
+/** Distance at which the caster starts to back away from the character */
+#define CASTER_ALERT_RADIUS 6.0f
+/** How far past its position the caster tries to back away, in Box2D units */
+#define CASTER_RETREAT_DISTANCE 5.0f
+/** Frames the caster waits after a retreat before it can retreat again */
+#define CASTER_RETREAT_COOLDOWN 180
+/** The duration of one update, which turns path lengths into action lengths */
+#define PATH_FRAME_TIME (1.0f / 60.0f)
+/** Pedestrians to decide for at which the decisions are made in parallel */
+#define AI_PARALLEL_THRESHOLD 64
+/** Pedestrians in one chunk of the parallel decisions */
+#define AI_CHUNK_SIZE 32
 
 
 using namespace cocos2d;
 
 class AIController {
 	friend class GameController;
+	friend class SimulationController;
+
+	/** What a pedestrian is doing about the character */
+	enum PedestrianState : unsigned char {
+		/** Following its action queue */
+		PATROL,
+		/** Running at the character */
+		CHASE,
+		/** Standing where it lost the character */
+		SEARCH
+	};
+
+	/** How a chasing pedestrian moves this frame */
+	enum SteerMode : unsigned char {
+		/** Not chasing */
+		STEER_NONE,
+		/** Along the shared flow field */
+		STEER_FLOW,
+		/** Along the path in its action queue */
+		STEER_PATH,
+		/** Straight at the character */
+		STEER_DIRECT
+	};
+
+	/** What the read phase decided for one pedestrian */
+	struct PedDecision {
+		/** The state after this frame */
+		PedestrianState state;
+		/** How the pedestrian moves, if it chases */
+		SteerMode steer;
+		/** Whether to ask for a new path */
+		bool replan;
+		/** The velocity to set, for STEER_FLOW and STEER_DIRECT */
+		b2Vec2 velocity;
+	};
 
 	bool _active;
 
 	bool _chasing;
 
-	vector<LevelInstance::MovingObjectMetadata<Pedestrian>> _pedMovers;
+	/** The level being controlled */
+	LevelInstance* _level;
+	/** The pedestrians of the level, owned by its mover registry */
+	MoverArray<Pedestrian>* _pedMovers;
+	/** The state of each pedestrian, by registry index */
+	vector<PedestrianState> _pedStates;
+	/** Frames left in the SEARCH state, by registry index */
+	vector<int> _searchFrames;
+	/** The frame each pedestrian was last within the lose radius */
+	vector<unsigned int> _lastSeen;
+	/** The pedestrians not in the PATROL state */
+	vector<int> _alerted;
+	/** Scratch list of the pedestrians near the character */
+	vector<int> _nearby;
+	/** The number of updates so far */
+	unsigned int _frame;
+	/** The frame of the next path request, by registry index */
+	vector<unsigned int> _nextPlan;
+	/** Path searches, one agent per pedestrian and one for the caster */
+	PathQueue _paths;
+	/** Steering toward the character, shared by a crowd of chasers */
+	FlowField _flow;
+	/** The flow field target following the character */
+	int _avatarFlow;
+	/** The number of pedestrians chasing at the last update */
+	int _chasers;
+	/** Whether enough pedestrians were chasing to steer them by _flow */
+	bool _crowded;
+	/** The flow field buffer latched for this update, or -1 if not steering by it */
+	int _flowFront;
+	/** The pedestrians to decide for this update: the alerted, then the ones nearby */
+	vector<int> _work;
+	/** The decision for each entry of _work */
+	vector<PedDecision> _decisions;
+	/** The line from each entry of _work to the character */
+	vector<SightLine> _sightLines;
+	/** One bit for each entry of _work, set if a building hides the character */
+	vector<uint32_t> _sightBits;
+	/** The pedestrians that started chasing at the last update */
+	int _sightings;
+	/** Helper threads for the read phase */
+	ParallelFor _jobs;
+	/** Whether large read phases run on the helper threads */
+	bool _parallel;
+	/** Whether each parallel read phase is run again serially and compared */
+	bool _crossCheck;
+	/** The serial decisions of the last cross-checked read phase */
+	vector<PedDecision> _checkDecisions;
+	/** The number of parallel decisions compared with serial ones so far */
+	unsigned long _crossChecked;
+	/** The number of compared decisions that differed */
+	unsigned long _mismatches;
+	/** Scratch list of the paths delivered this update */
+	vector<PathResult> _pathResults;
+	/** Scratch queue the pedestrian paths are written to before forcing */
+	ActionQueue<Pedestrian>* _pedPath;
+	/** Scratch queue the caster paths are written to before forcing */
+	ActionQueue<Caster>* _casterPath;
+	/** Frames left before the caster may retreat again */
+	int _casterCooldown;
 	OurMovingObject<Caster>* _caster;
 	Shadow* _avatar;
 	
@@ -47,11 +169,74 @@ class AIController {
 	bool init(LevelInstance*);
 
 	void stop();
+
+	/**
+	* Puts every pedestrian and the caster back in their starting state.
+	*
+	* The level and the worker threads are kept, so this allocates nothing.
+	*/
 	void reset();
 	void update();
 
-	void updatePed(OurMovingObject<Pedestrian>*);
+	/** Moves a pedestrian into a new state, steering it or releasing it to its queue */
+	void setPedState(int index, PedestrianState state);
+
+	/**
+	* Decides what a pedestrian does this frame, without changing anything.
+	*
+	* A pedestrian only notices the character within the sight radius and
+	* when no building is in the way, as given by the hidden flag; once
+	* chasing, it follows the character around corners until the lose radius.
+	*
+	* A chasing pedestrian samples the shared flow field when in a crowd.
+	* Otherwise it follows the last path it got through its action queue,
+	* asking for a new one every few frames, and until the first path
+	* arrives, or if none can be found, it is steered straight at the
+	* character. This only reads state left by the last commit, so it may
+	* run on any thread.
+	*/
+	void decide(int index, bool hidden, const b2Vec2& avaPos, PedDecision& out) const;
+
+	/** Applies a decision to a pedestrian and its body. Game thread only. */
+	void commit(int index, const PedDecision& decision, const b2Vec2& avaPos);
+
+	/**
+	* Sets whether large read phases run on the helper threads.
+	*
+	* Both ways make the same decisions, so this only changes the speed.
+	*/
+	void setParallel(bool value) { _parallel = value; }
+
+	/**
+	* Sets whether each parallel read phase is run again serially and compared.
+	*
+	* The parallel decisions are the ones committed. This doubles the cost of
+	* the read phase, so it is only for checking that the two ways agree.
+	*/
+	void setCrossCheck(bool value) { _crossCheck = value; }
+
+	/** Hands every finished path to its mover's action queue */
+	void deliverPaths();
+
+	/**
+	* Writes a path as a series of walking actions into queue.
+	*
+	* @param  queue  The queue to clear and fill
+	* @param  start  The position of the mover
+	* @param  path   The waypoints after the start
+	* @param  walk   The action that walks along the current bearing
+	* @param  stop   The action that stands still at the end
+	* @param  speed  The walking speed of the action, in Box2D units per second
+	* @param  stopFrames  The length of the stop action
+	*/
+	template <class T>
+	static void writePath(ActionQueue<T>* queue, const b2Vec2& start, const vector<b2Vec2>& path,
+		typename T::ActionType walk, typename T::ActionType stop, float speed, int stopFrames);
+
+	/** Returns the number of pedestrians that started chasing at the last update */
+	int getSightings() const { return _sightings; }
 
+	/** Backs the caster away along the navmesh when the character gets close; the caster acts in the physics step */
 	void updateCaster();
 	
 
@@ -25,16 +25,12 @@
 #include "M_MovingObject.h"
 #include "ActionQueue.h"
 #include "C_Physics.h"
+#include "LevelBuilder.h"
 
 
 using namespace cocos2d;
 using namespace std;
 
-#pragma mark -
-#pragma mark Level Geography
-
-#define WALL_THICKNESS 0.08f
-
 #pragma mark -
 #pragma mark Physics Constants
 /** The density for most physics objects */
@@ -63,21 +59,12 @@ using namespace std;
 #pragma mark -
 #pragma mark Asset Constants
 
-/** Seconds before death due to exposure */
-#define EXPOSURE_LIMIT 5.0f
-/** Ratio of exposure cooldown speed to exposure increase speed */
-#define EXPOSURE_COOLDOWN_RATIO 0.5f
 /** Scale of exposure HUD */
 #define EXPOSURE_SCALE 1.0f
 /** Exposure bar positioning constants */
 #define EXPOSURE_X_POS 0.7f
 #define EXPOSURE_Y_POS 0.9f
 
-/** How close the character has to be to the target location to stop moving, in Box2D coordinates, squared */
-#define TARGET_REACH_EPSILON_SQUARED 0.005f
-/** How close the character has to be to a shadow to latch onto it, in Box2D coordinates, squared */
-#define LATCH_LIMIT_SQUARED 5.25f
-
 /** The relative background images folder path */
 #define BACKGROUNDS_FOLDER "textures/backgrounds/"
 /** The key for the (temporary) background image */
@@ -114,6 +101,8 @@ using namespace std;
 #define PEW_EFFECT      "pew"
 /** The sound effect for a bullet collision */
 #define POP_EFFECT      "pop"
+/** The sound effect for a pedestrian spotting the character */
+#define SIGHTED_EFFECT  "sighted"
 /** The volume for the music */
 #define MUSIC_VOLUME    0.7f
 /** The volume for sound effects */
@@ -131,14 +120,6 @@ using namespace std;
 #define EXPOSURE_FRAME_Z 15
 #define BACK_BUTTON_Z 16
 #define RESUME_BUTTON_Z 17
-#define CASTER_Z 11
-#define PLAYER_Z 7
-#define BUILDING_OBJECT_Z 9
-#define BUILDING_SHADOW_Z 5
-#define PEDESTRIAN_OBJECT_Z 8
-#define PEDESTRIAN_SHADOW_Z 4
-#define CAR_OBJECT_Z 10
-#define CAR_SHADOW_Z 6
 
 const b2Filter GameController::characterFilter = b2Filter(CHARACTER_BIT, OBJECT_BIT, 0);
 const b2Filter GameController::objectFilter = b2Filter(OBJECT_BIT, CHARACTER_BIT, 1);
@@ -146,7 +127,8 @@ const b2Filter GameController::casterFilter = b2Filter(CASTER_BIT, CHARACTER_SEN
 const b2Filter GameController::shadowFilter = b2Filter(SHADOW_BIT, CHARACTER_SENSOR_BIT | LATCH_BIT, -1);
 const b2Filter GameController::characterSensorFilter = b2Filter(CHARACTER_SENSOR_BIT, SHADOW_BIT | CASTER_BIT | PEDESTRIAN_BIT, -2);
 const b2Filter GameController::pedestrianFilter = b2Filter(PEDESTRIAN_BIT, CHARACTER_SENSOR_BIT | OBJECT_BIT, 1);
-const b2Filter GameController::latchFilter = b2Filter(LATCH_BIT, SHADOW_BIT, -3);
+const b2Filter GameController::staticShadowFilter = b2Filter(STATIC_SHADOW_BIT, LATCH_BIT, -1);
+const b2Filter GameController::latchFilter = b2Filter(LATCH_BIT, SHADOW_BIT | STATIC_SHADOW_BIT, -3);
 const b2Filter GameController::carFilter = b2Filter(CAR_BIT, 0, 1);
 
 #pragma mark -
@@ -156,11 +138,13 @@ GameController::GameController() :
 	_rootnode(nullptr),
 	_worldnode(nullptr),
 	_level(nullptr),
+	_assets(nullptr),
 	_gameroot(nullptr),
 	_backgroundnode(nullptr),
 	_debugnode(nullptr),
 	_winnode(nullptr),
 	_timernode(nullptr),
+	_profilenode(nullptr),
 	_exposurebar(nullptr),
 	_indicator(nullptr),
 	_exposureframe(nullptr),
@@ -171,8 +155,13 @@ GameController::GameController() :
 	_failed(false),
 	_back(false),
 	_countdown(-1),
+	_renderBegin(nullptr),
+	_renderEnd(nullptr),
+	_overlayFrames(0),
 	_levelKey(nullptr),
-	_levelPath(nullptr)
+	_levelPath(nullptr),
+	_preloaded(false),
+	_unloadPending(false)
 {}
 
 GameController* GameController::create(const char * levelkey, const char * levelpath)
@@ -243,7 +232,7 @@ void GameController::initialize(RootLayer* root) {
 	_losenode->setVisible(false);
 
 	_backgroundnode = PolygonNode::createWithTexture(
-		_assets->get<Texture2D>(BACKGROUND_IMAGE + _level->_name));
+		_assets->get<Texture2D>(_backgroundKey));
 	_backgroundnode->setAnchorPoint(Vec2(0, 0));
 	_backgroundnode->setPosition(0, 0);
 	_backgroundnode->setScale((_level->_size.width * BOX2D_SCALE) / _backgroundnode->getContentSize().width,
@@ -350,6 +339,23 @@ void GameController::initialize(RootLayer* root) {
 	});
 	_nextLevelButton->setVisible(false);
 
+	_profilenode = Label::createWithSystemFont("", "Courier", 14);
+	_profilenode->setAnchorPoint(Vec2(0.0f, 1.0f));
+	_profilenode->setPosition(10.0f, dimen.height - 10.0f);
+	_profilenode->setVisible(false);
+
+	// Rendering happens after the scheduler update, so it is timed from the director events
+	EventDispatcher* dispatcher = Director::getInstance()->getEventDispatcher();
+	_renderBegin = dispatcher->addCustomEventListener(Director::EVENT_AFTER_UPDATE, [this](EventCustom*) {
+		_renderStart = current_time();
+	});
+	_renderEnd = dispatcher->addCustomEventListener(Director::EVENT_AFTER_DRAW, [this](EventCustom*) {
+		if (_profiler.inFrame()) {
+			_profiler.record(FrameProfiler::RENDER, _renderStart, current_time());
+			_profiler.endFrame();
+		}
+	});
+
     // Add everything to the root and retain
 	_gameroot->addChild(_backgroundnode, 1);
 	_gameroot->addChild(_worldnode,2);
@@ -364,16 +370,34 @@ void GameController::initialize(RootLayer* root) {
 	_gameroot->addChild(_resumeButton, RESUME_BUTTON_Z);
 	_gameroot->addChild(_nextLevelButton, RESUME_BUTTON_Z);
 	_gameroot->addChild(_indicator, INDICATOR_Z);
+	_gameroot->addChild(_profilenode, DEBUG_Z);
     _rootnode = root;
 	_rootnode->addChild(_gameroot, 0);
     _rootnode->retain();
 
     // Now populate the physics objects
     populate();
+	// One frame of the mover and caster actions per physics step, as the parked movers and paths assume
+	_physics._world->beforeStep = [this] {
+		if (!_profiler.isEnabled()) {
+			_level->_movers.act();
+			_level->_casterPos.object->act();
+			return;
+		}
+		// The actions are a phase of their own, not part of the step
+		timestamp_t start = current_time();
+		_level->_movers.act();
+		_level->_casterPos.object->act();
+		timestamp_t end = current_time();
+		_profiler.record(FrameProfiler::MOVERS, start, end);
+		_profiler.discount(FrameProfiler::PHYSICS, start, end);
+	};
+	_snapshot.capture(_physics._world);
 	_worldnode->runAction(Follow::create(_level->_playerPos.object->getSceneNode())); // TODO change when lazy camera implemented
 	_debugnode->runAction(Follow::create(_level->_playerPos.object->getSceneNode())); // TODO change when lazy camera implemented
 	_backgroundnode->runAction(Follow::create(_level->_playerPos.object->getSceneNode()));
 	_ai.init(_level);
+	_planner.init(_level);
 	setDebug(false);
 	setComplete(false);
 	setFailure(false);
@@ -407,16 +431,28 @@ void GameController::dispose() {
 }
 
 void GameController::deinitialize() {
+	if (_profiler.isEnabled()) {
+		exportProfile();
+		_profiler.setEnabled(false);
+	}
+	EventDispatcher* dispatcher = Director::getInstance()->getEventDispatcher();
+	dispatcher->removeEventListener(_renderBegin);
+	dispatcher->removeEventListener(_renderEnd);
+	_renderBegin = nullptr;
+	_renderEnd = nullptr;
 	_input.setZero();
 	_input.stop();
 	_level->release();
+	_snapshot.clear();
 	_physics.dispose();
 	_ai.dispose();
+	_planner.dispose();
 	_level = nullptr;
 	_worldnode = nullptr;
 	_debugnode = nullptr;
 	_winnode = nullptr;
 	_timernode = nullptr;
+	_profilenode = nullptr;
 	_indicator = nullptr;
 	_exposurebar = nullptr;
 	_exposureframe = nullptr;
@@ -432,55 +468,16 @@ void GameController::deinitialize() {
 	_back = false;
 }
 
-void GameController::addWalls() {
-	BoxObstacle* wallobj = BoxObstacle::create(Vec2(WALL_THICKNESS * 0.5f, _level->_size.height * 0.5f), Size(WALL_THICKNESS, _level->_size.height), &objectFilter);
-	wallobj->setBodyType(b2_staticBody);
-	wallobj->setDensity(BASIC_DENSITY);
-	wallobj->setFriction(BASIC_FRICTION);
-	wallobj->setRestitution(BASIC_RESTITUTION);
-	wallobj->setDrawScale(BOX2D_SCALE, BOX2D_SCALE);
-	wallobj->setSceneNode(Node::create());
-	wallobj->setDebugNode(newDebugNode());
-	addObstacle(wallobj, 1);
-	wallobj = BoxObstacle::create(Vec2(_level->_size.width - WALL_THICKNESS * 0.5f, _level->_size.height * 0.5f), Size(WALL_THICKNESS, _level->_size.height), &objectFilter);
-	wallobj->setBodyType(b2_staticBody);
-	wallobj->setDensity(BASIC_DENSITY);
-	wallobj->setFriction(BASIC_FRICTION);
-	wallobj->setRestitution(BASIC_RESTITUTION);
-	wallobj->setDrawScale(BOX2D_SCALE, BOX2D_SCALE);
-	wallobj->setSceneNode(Node::create());
-	wallobj->setDebugNode(newDebugNode());
-	addObstacle(wallobj, 1);
-	wallobj = BoxObstacle::create(Vec2(_level->_size.width * 0.5f, WALL_THICKNESS * 0.5f), Size(_level->_size.width - WALL_THICKNESS * 2, WALL_THICKNESS), &objectFilter);
-	wallobj->setBodyType(b2_staticBody);
-	wallobj->setDensity(BASIC_DENSITY);
-	wallobj->setFriction(BASIC_FRICTION);
-	wallobj->setRestitution(BASIC_RESTITUTION);
-	wallobj->setDrawScale(BOX2D_SCALE, BOX2D_SCALE);
-	wallobj->setSceneNode(Node::create());
-	wallobj->setDebugNode(newDebugNode());
-	addObstacle(wallobj, 1);
-	wallobj = BoxObstacle::create(Vec2(_level->_size.width * 0.5f, _level->_size.height - WALL_THICKNESS * 0.5f), Size(_level->_size.width - WALL_THICKNESS * 2, WALL_THICKNESS), &objectFilter);
-	wallobj->setBodyType(b2_staticBody);
-	wallobj->setDensity(BASIC_DENSITY);
-	wallobj->setFriction(BASIC_FRICTION);
-	wallobj->setRestitution(BASIC_RESTITUTION);
-	wallobj->setDrawScale(BOX2D_SCALE, BOX2D_SCALE);
-	wallobj->setSceneNode(Node::create());
-	wallobj->setDebugNode(newDebugNode());
-	addObstacle(wallobj, 1);
-}
-
 #pragma mark -
 #pragma mark Level Creation
 /**
  * Lays out the game geography.
  *
- * This method is really, really long.  In practice, you would replace this
- * with your serialization loader, which would process a level file.
+ * The bodies are created by LevelBuilder, exactly as in SimulationController.
+ * This method only gives each obstacle its sprite, which the builder then
+ * sizes the body from, and adds the scene and debug nodes.
  */
 void GameController::populate() {
-	addWalls();
 	Vec2 scale(BOX2D_SCALE, BOX2D_SCALE);
 
 	// We need to know the content scale for resolution independence
@@ -488,11 +485,12 @@ void GameController::populate() {
 	// This was set as the design resolution in AppDelegate
 	// To convert from design resolution to real, divide positions by cscale
 	float cscale = Director::getInstance()->getContentScaleFactor();
+	// Sprites may share atlas pages, so each node takes the region that is its image
+	TextureLoader* tloader = (TextureLoader*)_assets->access<Texture2D>();
 	AnimationNode* animNodePtr;
 	_winAnimation = AnimationNode::create();
 	_loseAnimation = AnimationNode::create();
 	PolygonNode* polyNodePtr;
-	PolygonNode* polyNodePtr1;
 
 #pragma mark : Animations
 	_winAnimation->initWithFilmstrip(_assets->get<Texture2D>(WIN_TEXTURE), END_ROWS, END_COLS);
@@ -509,58 +507,24 @@ void GameController::populate() {
 
 #pragma mark : Goal door
 	animNodePtr = (AnimationNode*)(_level->_casterPos.object->getObject()->getSceneNode());
-	animNodePtr->initWithFilmstrip(_assets->get<Texture2D>(GOAL_TEXTURE), CASTER_ROWS, CASTER_COLS);
+	animNodePtr->initWithFilmstrip(_assets->get<Texture2D>(GOAL_TEXTURE), tloader->getRegion(GOAL_TEXTURE), CASTER_ROWS, CASTER_COLS);
 	animNodePtr->setScale(cscale / CASTER_SCALE_DOWN);
-	_level->_casterPos.object->getObject()->init(_level->_casterPos.position,
-		Size((animNodePtr->getContentSize().width * cscale) / (CASTER_SCALE_DOWN * scale.x),
-			(animNodePtr->getContentSize().height * cscale) / (CASTER_SCALE_DOWN * scale.y)),
-			&casterFilter);
-	_level->_casterPos.object->getObject()->setDrawScale(scale);
-	_level->_casterPos.object->getObject()->positionSceneNode();
-	_level->_casterPos.object->getObject()->resetSceneNode();
-	_level->_casterPos.object->getObject()->setDebugNode(newDebugNode());
-    addObstacle(_level->_casterPos.object->getObject(), CASTER_Z);
 
 #pragma mark : Dude
 	animNodePtr = ((AnimationNode*)(_level->_playerPos.object->getSceneNode()));
-	animNodePtr->initWithFilmstrip(_assets->get<Texture2D>(DUDE_TEXTURE), PLAYER_ROWS, PLAYER_COLS);
+	animNodePtr->initWithFilmstrip(_assets->get<Texture2D>(DUDE_TEXTURE), tloader->getRegion(DUDE_TEXTURE), PLAYER_ROWS, PLAYER_COLS);
 	animNodePtr->setScale(cscale / DUDE_SCALE);
-	_level->_playerPos.object->init(_level->_playerPos.position, scale * DUDE_SCALE, &characterFilter, &characterSensorFilter);
-	_level->_playerPos.object->setDrawScale(scale);
-	_level->_playerPos.object->positionSceneNode();
-	_level->_playerPos.object->resetSceneNode();
-	_level->_playerPos.object->getSceneNode()->setVisible(true);
-	_level->_playerPos.object->setDebugNode(newDebugNode());
-    addObstacle(_level->_playerPos.object, PLAYER_Z); // Put this at the very front
-
+	animNodePtr->setVisible(true);
 
 #pragma mark : Buildings
-	for (LevelInstance::StaticObjectMetadata d : _level->_staticObjects) {
-		polyNodePtr1 = (PolygonNode*)(d.object->getSceneNode());
-		polyNodePtr1->initWithTexture(_assets->get<Texture2D>(d.type + OBJECT_TAG));
-		polyNodePtr1->setScale(cscale);
+	for (LevelInstance::StaticObjectMetadata &d : _level->_staticObjects) {
+		polyNodePtr = (PolygonNode*)(d.object->getSceneNode());
+		polyNodePtr->initWithRegion(_assets->get<Texture2D>(d.type + OBJECT_TAG), tloader->getRegion(d.type + OBJECT_TAG));
+		polyNodePtr->setScale(cscale);
 
 		polyNodePtr = (PolygonNode*)(d.shadow->getSceneNode());
-		polyNodePtr->initWithTexture(_assets->get<Texture2D>(d.type + SHADOW_TAG));
+		polyNodePtr->initWithRegion(_assets->get<Texture2D>(d.type + SHADOW_TAG), tloader->getRegion(d.type + SHADOW_TAG));
 		polyNodePtr->setScale(cscale);
-		
-		Vec2 offset = { polyNodePtr1->getContentSize().width * cscale / (scale.x * -5.0f), polyNodePtr1->getContentSize().height * cscale / (scale.y * 4.0f) };
-		d.object->init(d.position + offset, Size(polyNodePtr1->getContentSize().width * cscale / scale.x, polyNodePtr1->getContentSize().height * cscale / scale.y), &objectFilter); // Body
-		d.shadow->init(d.position, Size(polyNodePtr->getContentSize().width * cscale / scale.x, polyNodePtr->getContentSize().height * cscale / scale.y), &shadowFilter); // Shadoe
-
-		d.object->setDrawScale(scale);
-		d.object->positionSceneNode();
-		d.object->resetSceneNode();
-		d.shadow->setDrawScale(scale);
-		d.shadow->positionSceneNode();
-		d.shadow->resetSceneNode();
-		d.object->setDebugNode(newDebugNode());
-		d.shadow->setDebugNode(newDebugNode());
-		d.object->setBodyType(b2_staticBody);
-		addObstacle(d.object, BUILDING_OBJECT_Z);
-		addObstacle(d.shadow, BUILDING_SHADOW_Z);
-		d.shadow->getBody()->SetUserData(d.shadow);
-		
 	}
 
 #pragma mark : Movers
@@ -568,71 +532,46 @@ void GameController::populate() {
 	// Play the background music on a loop.
 	/*Sound* source = _assets->get<Sound>(GAME_MUSIC);
 	SoundEngine::getInstance()->playMusic(source, true, MUSIC_VOLUME); */
-	for (LevelInstance::PedestrianMetadata pd : _level->_pedestrians) {
+	for (LevelInstance::PedestrianMetadata &pd : _level->_pedestrians) {
 		animNodePtr = (AnimationNode*)(pd.object->getObject()->getSceneNode());
-		animNodePtr->initWithTexture(_assets->get<Texture2D>(PEDESTRIAN_TEXTURE));
+		animNodePtr->initWithRegion(_assets->get<Texture2D>(PEDESTRIAN_TEXTURE), tloader->getRegion(PEDESTRIAN_TEXTURE));
 		//animNodePtr->initWithFilmstrip(_assets->get<Texture2D>(PEDESTRIAN_TEXTURE), PEDESTRIAN_ROWS, PEDESTRIAN_COLS);   TODO uncomment when we have pedestrian filmstrip
 		animNodePtr->setScale(cscale / PEDESTRIAN_SCALE_DOWN);
-		pd.object->getObject()->init(pd.position, Size((animNodePtr->getContentSize().width * cscale)
-			/ (scale.x * PEDESTRIAN_SCALE_DOWN *2 ), (animNodePtr->getContentSize().height * cscale)
-			/ (scale.y * PEDESTRIAN_SCALE_DOWN*1.5)), &pedestrianFilter);
 
 		animNodePtr = (AnimationNode*)(pd.object->getShadow()->getSceneNode());
-		animNodePtr->initWithTexture(_assets->get<Texture2D>(PEDESTRIAN_SHADOW_TEXTURE));
+		animNodePtr->initWithRegion(_assets->get<Texture2D>(PEDESTRIAN_SHADOW_TEXTURE), tloader->getRegion(PEDESTRIAN_SHADOW_TEXTURE));
 		//animNodePtr->initWithFilmstrip(_assets->get<Texture2D>(PEDESTRIAN_SHADOW_TEXTURE), PEDESTRIAN_ROWS, PEDESTRIAN_COLS);   TODO uncomment when we have pedestrian filmstrip
 		animNodePtr->setScale(cscale / PEDESTRIAN_SCALE_DOWN);
-		pd.object->getShadow()->init(pd.position, Size((animNodePtr->getContentSize().width * cscale)
-			/ (scale.x * PEDESTRIAN_SCALE_DOWN), (animNodePtr->getContentSize().height * cscale)
-			/ (PEDESTRIAN_SCALE_DOWN * scale.y)), &shadowFilter);
-
-		pd.object->getObject()->setDrawScale(scale);
-		pd.object->getObject()->positionSceneNode();
-		pd.object->getObject()->resetSceneNode();
-		pd.object->getShadow()->setDrawScale(scale);
-		pd.object->getShadow()->positionSceneNode();
-		pd.object->getShadow()->resetSceneNode();
-		pd.object->getObject()->setDebugNode(newDebugNode());
-		pd.object->getShadow()->setDebugNode(newDebugNode());
-		addObstacle(pd.object->getObject(), PEDESTRIAN_OBJECT_Z);
-		pd.object->getObject()->getBody()->GetFixtureList()->SetUserData(pd.object);
-		addObstacle(pd.object->getShadow(), PEDESTRIAN_SHADOW_Z);
-		pd.object->getShadow()->getBody()->SetUserData(pd.object->getShadow());
 	}
 
-	for (LevelInstance::CarMetadata pd : _level->_cars) {
+	for (LevelInstance::CarMetadata &pd : _level->_cars) {
 		animNodePtr = (AnimationNode*)(pd.object->getObject()->getSceneNode());
-		Texture2D* cartex = _assets->get<Texture2D>(CAR_TEXTURE);
-		animNodePtr->initWithFilmstrip(cartex, CAR_ROWS, CAR_COLS);
+		animNodePtr->initWithFilmstrip(_assets->get<Texture2D>(CAR_TEXTURE), tloader->getRegion(CAR_TEXTURE), CAR_ROWS, CAR_COLS);
 		animNodePtr->setScale(cscale / CAR_SCALE_DOWN);
-		pd.object->getObject()->init(pd.position, Size((animNodePtr->getContentSize().width * cscale)
-			/ (scale.x * CAR_SCALE_DOWN), (animNodePtr->getContentSize().height * cscale)
-			/ (scale.y * CAR_SCALE_DOWN)), &shadowFilter);
-		pd.object->getObject()->setDrawScale(scale);
-		pd.object->getObject()->positionSceneNode();
-		pd.object->getObject()->resetSceneNode();
-		pd.object->getObject()->setDebugNode(newDebugNode());
-		addObstacle(pd.object->getObject(), CAR_OBJECT_Z);
-		pd.object->getObject()->getBody()->SetUserData(pd.object->getShadow()); // TODO get rid of this when car is actually made into a non-shadow
 
 		polyNodePtr = (PolygonNode*)(pd.object->getShadow()->getSceneNode());
-		polyNodePtr->initWithTexture(_assets->get<Texture2D>(CAR_SHADOW_TEXTURE));
+		polyNodePtr->initWithRegion(_assets->get<Texture2D>(CAR_SHADOW_TEXTURE), tloader->getRegion(CAR_SHADOW_TEXTURE));
 		polyNodePtr->setScale(cscale / CAR_SCALE_DOWN);
-		pd.object->getShadow()->init(pd.position, Size((polyNodePtr->getContentSize().width * cscale)
-			/ (scale.x * CAR_SCALE_DOWN), (polyNodePtr->getContentSize().height * cscale)
-			/ (scale.y * CAR_SCALE_DOWN)), &shadowFilter);
-		pd.object->getShadow()->setDrawScale(scale);
-		pd.object->getShadow()->positionSceneNode();
-		pd.object->getShadow()->resetSceneNode();
-		pd.object->getShadow()->setDebugNode(newDebugNode());
-		addObstacle(pd.object->getShadow(), CAR_SHADOW_Z);
-		pd.object->getShadow()->getBody()->SetUserData(pd.object->getShadow());
-        
 	}
-    
-    latchposition = WheelObstacle::create(Vec2(0.01f,0.01f), 0.0001f, &(PhysicsController::emptyFilter));
-	latchposition->setSensor(true);
-	addObstacle(latchposition, 7);
-    
+
+#pragma mark : Bodies
+	// A sprite is its region of an atlas page, or else the whole texture
+	LevelBuilder::FrameSizer frame = [=](const std::string& texture, int rows, int cols) {
+		Size size = tloader->getRegion(texture).size;
+		if (size.equals(Size::ZERO)) {
+			size = _assets->get<Texture2D>(texture)->getContentSize();
+		}
+		return Size(size.width * cscale / cols, size.height * cscale / rows);
+	};
+	latchposition = LevelBuilder::populate(_level, frame, [&](Obstacle* obj, int zOrder) {
+		obj->setDrawScale(scale);
+		if (obj->getSceneNode() != nullptr) {
+			obj->positionSceneNode();
+			obj->resetSceneNode();
+		}
+		obj->setDebugNode(newDebugNode());
+		addObstacle(obj, zOrder);
+	});
 }
 
 /**
@@ -664,14 +603,14 @@ void GameController::addObstacle(Obstacle* obj, int zOrder) {
 /**
  * Resets the status of the game so that we can play again.
  *
- * This method disposes of the world and creates a new one.
+ * Every body is restored in place from the snapshot taken when the level was
+ * populated, so no obstacle, fixture or scene node is recreated.
  */
 void GameController::reset() {
-	_physics.reset();
-	_ai.reset();
-    _worldnode->removeAllChildren();
-    _debugnode->removeAllChildren();
-    
+	_physics.restart();
+	_level->_movers.unparkAll();
+	_snapshot.restore();
+
 	_input.setZero();
 	_exposure = 0;
 	setPaused(false);
@@ -680,35 +619,26 @@ void GameController::reset() {
 	_nextLevel = false;
 	_back = false;
 
-	//_level.populateLevel(true) TODO uncomment this after dynamic level loading is implemented
-    populate();
-
-	// Reset the moving objects' action queues
-	_level->_casterPos.object->_actionQueue = ActionQueue<Caster>::create();
+	// Reset the moving objects' action queues, reusing their storage
+	_level->_casterPos.object->_actionQueue->clear();
 	for (LevelInstance::CarMetadata &car : _level->_cars) {
-		car.object->_actionQueue->release();
-		car.object->_actionQueue = ActionQueue<Car>::create(*(car.actions));
-		car.object->_actionQueue->retain();
+		car.object->_actionQueue->assign(*(car.actions));
 	}
 	for (LevelInstance::PedestrianMetadata &ped : _level->_pedestrians) {
-		ped.object->_actionQueue->release();
-		ped.object->_actionQueue = ActionQueue<Pedestrian>::create(*(ped.actions));
-		ped.object->_actionQueue->retain();
-		ped.object->getObject()->getSceneNode()->setVisible(true);
-		ped.object->getShadow()->getSceneNode()->setVisible(true);
+		ped.object->_actionQueue->assign(*(ped.actions));
 	}
 
-	_ai.init(_level);
-
-	_worldnode->runAction(Follow::create(_level->_playerPos.object->getSceneNode())); // TODO uncomment when lazy camera implemented
-	_debugnode->runAction(Follow::create(_level->_playerPos.object->getSceneNode())); // TODO uncomment when lazy camera implemented
+	_ai.reset();
 
 	_tryAgainButton->setVisible(false);
 	_backButton->setVisible(false);
 	_resumeButton->setVisible(false);
+	_nextLevelButton->setVisible(false);
 
 	_winAnimation->setVisible(false);
+	_winAnimation->setFrame(0);
 	_loseAnimation->setVisible(false);
+	_loseAnimation->setFrame(0);
 }
 
 /**
@@ -769,7 +699,11 @@ void GameController::setFailure(bool value) {
  * @param  delta    Number of seconds since last animation frame
  */
 void GameController::update(float dt) {
-	_input.update(dt);
+	_profiler.beginFrame();
+	{
+		PROFILE_SCOPE(_profiler, INPUT);
+		_input.update(dt);
+	}
 	if (!_back) {
 		// Process the toggled key commands
 		if (_input.didReset()) {
@@ -786,58 +720,55 @@ void GameController::update(float dt) {
 		if (!_paused) {
 			if (!_failed && !_complete) {
 				if (_input.didDebug()) { setDebug(!isDebug()); }
-				// Process the movement
-				if (!_input._screencoords) { // Tap position is raw, need to compute screen coordinates
-					_input._lasttap = _level->_playerPos.object->getPosition() + (_input._lasttap / (BOX2D_SCALE));
-					_input._screencoords = true;
-					_physics._latchedOnto = nullptr;
-				}
-				if (_input.didDoubleTap()) {
-					if ((_level->_playerPos.object->getPosition() - _input._lasttap).lengthSquared() <= LATCH_LIMIT_SQUARED) {
-						latchposition->getBody()->GetFixtureList()->SetFilterData(latchFilter);
-						latchposition->setPosition(_input._lasttap);
+				{
+					PROFILE_SCOPE(_profiler, INPUT);
+					// Process the movement
+					if (!_input._screencoords) { // Tap position is raw, need to compute screen coordinates
+						_input._lasttap = _level->_playerPos.object->getPosition() + (_input._lasttap / (BOX2D_SCALE));
+						_input._screencoords = true;
+						_physics._latchedOnto = nullptr;
 					}
-					else {
+					bool moving = _input.getHorizontal() * _input.getHorizontal() + _input.getVertical()
+						* _input.getVertical() >= DEADSPACE_SIZE * DEADSPACE_SIZE;
+					if (!_physics.steer(_level->_playerPos.object, latchposition, _input._lasttap, moving, _input.didDoubleTap())) {
 						_input._keyDoubleTap = false;
 					}
 				}
-				else {
-					latchposition->getBody()->GetFixtureList()->SetFilterData(PhysicsController::emptyFilter);
+				{
+					PROFILE_SCOPE(_profiler, MOVERS);
+					// The world node follows the character, so the view is centered on it
+					Vec2 focus = _level->_playerPos.object->getPosition();
+					Size view = _rootnode->getContentSize() / BOX2D_SCALE;
+					_lod.update(_level->_movers, b2Vec2(focus.x, focus.y),
+						Rect(focus.x - view.width * 0.5f, focus.y - view.height * 0.5f, view.width, view.height));
 				}
-				if (_physics._latchedOnto == nullptr) {
-					if (_input.getHorizontal() * _input.getHorizontal() + _input.getVertical()
-						* _input.getVertical() < DEADSPACE_SIZE * DEADSPACE_SIZE ||
-						(_level->_playerPos.object->getPosition() - _input._lasttap).lengthSquared() <= TARGET_REACH_EPSILON_SQUARED) {
-						_level->_playerPos.object->stopMovement();
-					}
-					else {
-						Vec2 movVec = _input._lasttap - _level->_playerPos.object->getPosition();
-						_level->_playerPos.object->changeVelocity(movVec.x, movVec.y);
-					}
+				{
+					PROFILE_SCOPE(_profiler, PHYSICS);
+					_physics.update(dt);
 				}
-				else {
-					_level->_playerPos.object->getBody()->SetLinearVelocity(_physics._latchedOnto->getBody()->GetLinearVelocity());
+				{
+					PROFILE_SCOPE(_profiler, AI);
+					_ai.update();
 				}
-				for (LevelInstance::CarMetadata car : _level->_cars)
-					car.object->act();
-				for (LevelInstance::PedestrianMetadata ped : _level->_pedestrians)
-					ped.object->act();
-
-				_physics.update(dt);
-				_ai.update();
-
-				if (_physics._justLatched) {
-					_level->_playerPos.object->setPosition(
-						_physics._latchedOnto->getPosition().x,
-						_physics._latchedOnto->getPosition().y);
-					_physics._justLatched = false;
+				if (_ai.getSightings() > 0) {
+					Sound* source = _assets->get<Sound>(SIGHTED_SOUND);
+					SoundEngine::getInstance()->playEffect(SIGHTED_EFFECT, source, false, EFFECT_VOLUME);
 				}
 
-				// Update the indicator direction
+				PROFILE_SCOPE(_profiler, SCENE);
+
+				_physics.snapToLatch(_level->_playerPos.object);
+
+				// Update the indicator direction, along the shadiest route once there is one
+				Vec2 player = _level->_playerPos.object->getPosition();
+				Vec2 target = _level->_casterPos.object->getObject()->getPosition();
+				_planner.update(b2Vec2(player.x, player.y), b2Vec2(target.x, target.y), _level->_movers);
+				b2Vec2 waypoint;
+				if (_planner.getWaypoint(b2Vec2(player.x, player.y), waypoint)) {
+					target.set(waypoint.x, waypoint.y);
+				}
 				// Subtract the found angle from 90 since getAngle returns angle with x-axis instead of y
-				_indicator->setRotation(90.0f - CC_RADIANS_TO_DEGREES(
-					(_level->_casterPos.object->getObject()->getPosition() -
-						_level->_playerPos.object->getPosition()).getAngle()));
+				_indicator->setRotation(90.0f - CC_RADIANS_TO_DEGREES((target - player).getAngle()));
 				_level->_playerPos.object->updateAnimation(_physics._latchedOnto == nullptr);
 			}
 
@@ -845,6 +776,7 @@ void GameController::update(float dt) {
 				if (!_complete && _physics._reachedCaster) setComplete(true);
 				if (!_complete && _physics._hasDied) setFailure(true);
 				if (!_complete) {
+					PROFILE_SCOPE(_profiler, EXPOSURE);
 					// Check for exposure or cover
 					_exposure += dt * (1.0f - ((1.0f + EXPOSURE_COOLDOWN_RATIO) * _level->_playerPos.object->getCoverRatio()));
 					if (_exposure < 0.0f) _exposure = 0.0f;
@@ -857,6 +789,11 @@ void GameController::update(float dt) {
 				}
 			}
 
+			if (_profiler.isEnabled() && ++_overlayFrames >= PROFILE_OVERLAY_PERIOD) {
+				_profilenode->setString(_profiler.getSummary());
+				_overlayFrames = 0;
+			}
+
 			// Reset the game if we win or lose.
 			if (_countdown > 0) {
 				if (_countdown % 8 == 0) {
@@ -892,6 +829,44 @@ void GameController::update(float dt) {
 }
 
 
+/**
+ * Sets whether debug mode is active.
+ *
+ * If true, all objects will display their physics bodies, and the frame
+ * profiler records every frame and shows its overlay. Leaving debug mode
+ * writes the recorded frames out with exportProfile().
+ *
+ * @param value whether debug mode is active.
+ */
+void GameController::setDebug(bool value) {
+	_debug = value;
+	_debugnode->setVisible(value);
+	_profilenode->setVisible(value);
+	if (_profiler.isEnabled() && !value) {
+		exportProfile();
+	}
+	_profiler.setEnabled(value);
+	_overlayFrames = PROFILE_OVERLAY_PERIOD;
+}
+
+/**
+ * Writes the frames recorded by the profiler to the writable directory,
+ * as CSV and as a Chrome trace (chrome://tracing).
+ */
+void GameController::exportProfile() {
+	if (_profiler.getFrameCount() == 0) {
+		return;
+	}
+	string path = FileUtils::getInstance()->getWritablePath();
+	if (_profiler.exportCSV(path + PROFILE_CSV_FILE) && _profiler.exportTrace(path + PROFILE_TRACE_FILE)) {
+		CCLOG("Wrote %d profiled frames to %s", _profiler.getFrameCount(), path.c_str());
+	}
+	else {
+		CCLOG("Failed to write the frame profile to %s", path.c_str());
+	}
+}
+
+
 #pragma mark -
 #pragma mark Post-Collision Processing
 /**
@@ -914,26 +889,51 @@ void GameController::applyPowerup(const Powerup& powerup) {
 /**
  * Preloads the assets needed for the game.
  */
-void GameController::preload() {
-	string levelName;
-	string backgroundPath = BACKGROUNDS_FOLDER;
+void GameController::preload(bool prefetch) {
 	_assets = AssetManager::getInstance()->getCurrent();
-	{
-		JSONReader reader;
-		reader.initWithFile(_levelPath);
-		if (!reader.startJSON()) {
-			CCASSERT(false, "Failed to load background image");
-			return;
-		}
-		levelName = reader.getString("name");
-		backgroundPath += levelName;
-		backgroundPath += '.';
-		backgroundPath += reader.getString("imageFormat");
-		reader.endJSON();
+	TextureLoader* tloader = (TextureLoader*)_assets->access<Texture2D>();
+	TextureLoader::Priority priority = prefetch ? TextureLoader::Priority::PREFETCH : TextureLoader::Priority::LEVEL;
+	// The level is wanted again, so it must not be dropped when it arrives
+	_unloadPending = false;
+	if (_preloaded) {
+		// A prefetched background may still be waiting behind other textures
+		tloader->prioritize(_backgroundPath, priority);
+		return;
+	}
+	string levelName, imageFormat;
+	if (!LevelInstance::readBackground(_levelPath, levelName, imageFormat)) {
+		CCASSERT(false, "Failed to load background image");
+		return;
 	}
-	((TextureLoader*)_assets->access<Texture2D>())->loadAsync(
-		BACKGROUND_IMAGE + levelName, backgroundPath);
+	_backgroundPath = BACKGROUNDS_FOLDER + levelName + "." + imageFormat;
+	_backgroundKey = BACKGROUND_IMAGE + levelName;
+	tloader->loadAsync(_backgroundKey, _backgroundPath, priority);
 	_assets->loadAsync<LevelInstance>(_levelKey, _levelPath);
+	_preloaded = true;
+}
+
+bool GameController::isLoaded() const {
+	return _preloaded && _assets->get<LevelInstance>(_levelKey) != nullptr &&
+		_assets->get<Texture2D>(_backgroundKey) != nullptr;
+}
+
+void GameController::unload() {
+	if (!_preloaded || _active) {
+		return;
+	}
+	// A loader cannot drop an asset in flight, so finish once it arrives or fails
+	if (!isLoaded() && !_assets->isComplete()) {
+		_unloadPending = true;
+		return;
+	}
+	_unloadPending = false;
+	if (_assets->get<LevelInstance>(_levelKey) != nullptr) {
+		_assets->unload<LevelInstance>(_levelKey);
+	}
+	if (_assets->get<Texture2D>(_backgroundKey) != nullptr) {
+		_assets->unload<Texture2D>(_backgroundKey);
+	}
+	_preloaded = false;
 }
 
 void GameController::setPaused(bool value) {
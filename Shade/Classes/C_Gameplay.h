@@ -34,6 +34,10 @@
 #include "C_AI.h"
 #include "C_Physics.h"
 #include "M_LevelInstance.h"
+#include "FrameProfiler.h"
+#include "LevelSnapshot.h"
+#include "MoverLOD.h"
+#include "ShadePlanner.h"
 #include <cornell.h>
 #include <cornell/CUWheelObstacle.h>
 
@@ -41,6 +45,25 @@
 
 /** Static object types file path */
 #define STATIC_OBJECTS "constants/static_objects.shadc"
+/** Sprite atlas table file path, written by ShadeAtlas; the sprites load on their own without it */
+#define ATLAS_TABLE "textures/atlas/sprites.shadt"
+
+/** Seconds before death due to exposure */
+#define EXPOSURE_LIMIT 5.0f
+/** Ratio of exposure cooldown speed to exposure increase speed */
+#define EXPOSURE_COOLDOWN_RATIO 0.5f
+/** The thickness of the walls around a level, in Box2D units */
+#define WALL_THICKNESS 0.08f
+/** How close the character has to be to the target location to stop moving, in Box2D coordinates, squared */
+#define TARGET_REACH_EPSILON_SQUARED 0.005f
+/** How close the character has to be to a shadow to latch onto it, in Box2D coordinates, squared */
+#define LATCH_LIMIT_SQUARED 5.25f
+/** The file the frame profile is written to, in the writable directory */
+#define PROFILE_CSV_FILE   "shade_profile.csv"
+/** The Chrome trace of the frame profile, in the writable directory */
+#define PROFILE_TRACE_FILE "shade_profile.json"
+/** The number of frames between refreshes of the profiler overlay */
+#define PROFILE_OVERLAY_PERIOD 15
 /** The key for the exposure bar texture in the asset manager */
 #define EXPOSURE_BAR	"ebar"
 /** The key for the exposure bar frame texture in the asset manager */
@@ -145,6 +168,10 @@ protected:
 	PhysicsController _physics;
 	/** Controller for running character AI operations */
 	AIController _ai;
+	/** Parks the movers far from the character and the screen */
+	MoverLOD _lod;
+	/** Plans the shadiest route to the caster, for the indicator */
+	ShadePlanner _planner;
     
     /** Reference to the root node of the scene graph */
     RootLayer* _rootnode;
@@ -167,6 +194,8 @@ protected:
 	AnimationNode* _loseAnimation;
 	/** Reference to the timer message label */
 	Label* _timernode;
+	/** Reference to the profiler overlay, shown in debug mode */
+	Label* _profilenode;
 	/** Reference to the variable exposure bar */
 	PolygonNode* _exposurebar;
 	/** Reference to the indicator arrow */
@@ -179,6 +208,14 @@ protected:
 	const char * _levelKey;
 	/** Path to the level file */
 	const char * _levelPath;
+	/** The key of the level background, once preload() has read it */
+	string _backgroundKey;
+	/** The image file of the level background, once preload() has read it */
+	string _backgroundPath;
+	/** Whether the level and its background are queued or loaded */
+	bool _preloaded;
+	/** Whether unload() was called while the level was still loading */
+	bool _unloadPending;
 	/** The resume button */
 	ui::Button* _resumeButton;
 	/** The back to menu button */
@@ -212,6 +249,19 @@ protected:
 	float _exposure;
     /** Countdown active for winning or losing */
     int _countdown;
+	/** The state of every body right after the level was populated */
+	LevelSnapshot _snapshot;
+
+	/** Per-phase timing of each frame, recorded in debug mode */
+	FrameProfiler _profiler;
+	/** Listener marking the start of rendering (after the scheduler update) */
+	EventListenerCustom* _renderBegin;
+	/** Listener marking the end of rendering, which closes the profiled frame */
+	EventListenerCustom* _renderEnd;
+	/** The time rendering of the current frame began */
+	timestamp_t _renderStart;
+	/** The number of frames since the profiler overlay was refreshed */
+	int _overlayFrames;
     WheelObstacle* latchposition;
     
     
@@ -220,9 +270,6 @@ protected:
      * Lays out the game geography.
      */
     void populate();
-
-	/** Adds in the invisible walls at the boundaries of the world */
-	void addWalls();
     
     /**
      * Immediately adds the object to the physics world
@@ -267,6 +314,8 @@ public:
 	static const b2Filter objectFilter;
 	/** The const collision filters for shadows */
 	static const b2Filter shadowFilter;
+	/** The const collision filters for shadows baked into the level's ShadowField */
+	static const b2Filter staticShadowFilter;
 	/** The const collision filters for the caster */
 	static const b2Filter casterFilter;
 	/** The const collision filters for the pedestrian */
@@ -322,11 +371,19 @@ public:
     /**
      * Sets whether debug mode is active.
      *
-     * If true, all objects will display their physics bodies.
+     * If true, all objects will display their physics bodies, and the frame
+     * profiler records every frame and shows its overlay. Leaving debug mode
+     * writes the recorded frames out with exportProfile().
      *
      * @param value whether debug mode is active.
      */
-    void setDebug(bool value) { _debug = value; _debugnode->setVisible(value); }
+    void setDebug(bool value);
+
+    /**
+     * Writes the frames recorded by the profiler to the writable directory,
+     * as CSV and as a Chrome trace (chrome://tracing).
+     */
+    void exportProfile();
     
     /**
      * Returns true if the level is completed.
@@ -389,8 +446,30 @@ public:
     
     /**
      * Preloads all of the assets necessary for this game world
+     *
+     * This only queues the level and its background.  If they are already
+     * queued, a prefetched background is moved up to the priority asked for.
+     *
+     * @param prefetch	Whether the level is only wanted later, so that it
+     *                  decodes behind everything else
      */
-    void preload();
+    void preload(bool prefetch = false);
+
+	/** Returns whether the level and its background are ready to initialize */
+	bool isLoaded() const;
+
+	/**
+	 * Unloads the level and its background, so that they are no longer resident.
+	 *
+	 * This does nothing while the level is active.  If either asset is still
+	 * loading, the unload is left pending, and unload() must be called again
+	 * once hasPendingUnload() is true and the assets have arrived.  A later
+	 * preload() cancels a pending unload, or queues the assets again.
+	 */
+	void unload();
+
+	/** Returns whether unload() was called while the level was still loading */
+	bool hasPendingUnload() const { return _unloadPending; }
 
 	/** Nullifies everything initialized via initialize(). */
 	void deinitialize();
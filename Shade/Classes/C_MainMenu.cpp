@@ -1,6 +1,7 @@
 #include <string>
 #include <cornell.h>
 #include "C_MainMenu.h"
+#include "MappedFile.h"
 
 using namespace cocos2d;
 using namespace std;
@@ -27,6 +28,10 @@ using namespace std;
 #define LEVEL_NINE_FILE "levels/level9.shadl"
 #define MENU_BACKGROUND_KEY "mbackground"
 #define TUTORIAL_BUTTON "tutbutt"
+/** The font of the loading message, loaded by PlatformRoot for its own loading screen */
+#define LOADING_FONT "felt"
+/** The message shown while a level loads */
+#define LOADING_MESSAGE "Loading..."
 
 MainMenuButton* MainMenuButton::create(GameController* gc) {
 	MainMenuButton* q = new (std::nothrow) MainMenuButton();
@@ -57,7 +62,10 @@ MainMenuController::MainMenuController() :
 	_rootnode(nullptr),
 	_worldnode(nullptr),
 	_active(false),
-	_activeController(nullptr)
+	_activeController(nullptr),
+	_loading(nullptr),
+	_loadingnode(nullptr),
+	_currController(-1)
 {
 }
 
@@ -83,6 +91,14 @@ bool MainMenuController::init(RootLayer* root) {
 	_worldnode->retain();
 	_rootnode->addChild(_worldnode, 0);
 
+	// Shown over whatever is on screen while a level loads
+	_loadingnode = Label::create();
+	_loadingnode->setTTFConfig(_assets->get<TTFont>(LOADING_FONT)->getTTF());
+	_loadingnode->setAnchorPoint(Vec2(0.5f, 0.5f));
+	_loadingnode->setPosition(center);
+	_loadingnode->setString(LOADING_MESSAGE);
+	_loadingnode->retain();
+
 	// Tutorial button
 	_tutButt->setScale(_backgroundnode->getScaleX() * 0.5f, _backgroundnode->getScaleY() * 0.5f);
 	_tutButt->setPosition(Vec2((_rootnode->getContentSize().width / 2.0f), (_rootnode->getContentSize().height * 0.93f)));
@@ -103,14 +119,9 @@ bool MainMenuController::init(RootLayer* root) {
 				button->setPosition(Vec2((dimen.width / 3.0f) + (dimen.width * j) / 6.0f, (dimen.height * 0.40f) + (dimen.width * (1 - i)) / 6.3f));
 				button->setTouchEnabled(true);
 				//Add event listener
-				button->addTouchEventListener([&](Ref* sender, ui::Widget::TouchEventType type) {
-					switch (type) {
-					case ui::Widget::TouchEventType::ENDED:
-						button = ((MainMenuButton*)sender);
-						_currController = button->index;
-						_activeController = button->getController();
-						_rootnode->removeAllChildren();
-						_activeController->initialize(_rootnode);
+				button->addTouchEventListener([this](Ref* sender, ui::Widget::TouchEventType type) {
+					if (type == ui::Widget::TouchEventType::ENDED && _loading == nullptr) {
+						startLevel(((MainMenuButton*)sender)->index);
 					}
 				});
 				_worldnode->addChild(button, 1);
@@ -123,26 +134,86 @@ bool MainMenuController::init(RootLayer* root) {
 }
 
 void MainMenuController::update(float dt) {
-	CCLOG("%d", _currController);
+	// Finish dropping the levels that were abandoned while still loading
+	for (int ii = -1; ii < (int)mainMenuButtons.size(); ii++) {
+		if (controllerAt(ii)->hasPendingUnload()) {
+			controllerAt(ii)->unload();
+		}
+	}
+	if (_loading != nullptr) {
+		if (_loading->isLoaded()) {
+			GameController* gc = _loading;
+			_loading = nullptr;
+			launch(gc);
+		}
+		else if (_assets->isComplete()) {
+			// Nothing is left in flight, so the level failed to load
+			CCLOG("Failed to load level %d", _currController);
+			_loading->unload();
+			_loading = nullptr;
+			_loadingnode->removeFromParent();
+			if (_worldnode->getParent() == nullptr) {
+				_rootnode->addChild(_worldnode, 0);
+			}
+		}
+		return;
+	}
 	if (_activeController != nullptr) {
+		int next = mainMenuButtons.size() - 1 == _currController ? _currController : _currController + 1;
 		if (!_activeController->isActive()) {
-			if (_activeController->nextLevel()) {
-				_currController = mainMenuButtons.size() - 1 == _currController ? _currController : _currController + 1;
-				_activeController = mainMenuButtons[_currController]->getController();
-				_rootnode->removeAllChildren();
-				_activeController->initialize(_rootnode);
-				return;
+			// Only the level being played and the next one stay resident
+			GameController* finished = _activeController;
+			_activeController = nullptr;
+			if (finished->nextLevel()) {
+				if (controllerAt(next) != finished) {
+					finished->unload();
+				}
+				startLevel(next);
 			}
 			else {
-				_activeController = nullptr;
+				finished->unload();
 				_rootnode->addChild(_worldnode, 0);
-				return;
 			}
+			return;
+		}
+		// The win screen is idle time, so the next level loads while it shows
+		if (_activeController->isComplete() && controllerAt(next) != _activeController) {
+			controllerAt(next)->preload(true);
 		}
 		_activeController->update(dt);
 	}
 }
 
+GameController* MainMenuController::controllerAt(int index) const {
+	return (index < 0 ? _tutButt : mainMenuButtons[index])->getController();
+}
+
+void MainMenuController::startLevel(int index) {
+	GameController* gc = controllerAt(index);
+	_currController = index;
+	// Drop any level that was prefetched but not chosen
+	for (int ii = -1; ii < (int)mainMenuButtons.size(); ii++) {
+		if (controllerAt(ii) != gc) {
+			controllerAt(ii)->unload();
+		}
+	}
+	if (gc->isLoaded()) {
+		launch(gc);
+		return;
+	}
+	gc->preload();
+	_loading = gc;
+	if (_loadingnode->getParent() == nullptr) {
+		_rootnode->addChild(_loadingnode, 2);
+	}
+}
+
+void MainMenuController::launch(GameController* gc) {
+	_activeController = gc;
+	_rootnode->removeAllChildren();
+	_activeController->initialize(_rootnode);
+}
+
 MainMenuController::~MainMenuController() {
 	dispose();
 }
@@ -155,6 +226,10 @@ void MainMenuController::dispose() {
 		_worldnode->release();
 		_worldnode = nullptr;
 	}
+	if (_loadingnode != nullptr) {
+		_loadingnode->release();
+		_loadingnode = nullptr;
+	}
 	if (_rootnode != nullptr) {
 		_rootnode->release();
 		_rootnode = nullptr;
@@ -162,6 +237,7 @@ void MainMenuController::dispose() {
 	if (_activeController != nullptr) {
 		_activeController = nullptr;
 	}
+	_loading = nullptr;
 	for (MainMenuButton* b : mainMenuButtons) {
 		b->dispose();
 		b->release();
@@ -171,21 +247,16 @@ void MainMenuController::dispose() {
 
 void MainMenuController::preload() {
 	// Tutorial button
+	// Levels are loaded when they are started, so only the controllers are made here
 	GameController* gc = GameController::create(TUTORIAL_KEY, TUTORIAL_FILE);
-	gc->preload();
 	_tutButt = MainMenuButton::create(gc);
 	_tutButt->index = -1;
 	_tutButt->loadTextures("textures/Tutorial/tutorial.png", "textures/Tutorial/tutorial.png");
 	_tutButt->setTouchEnabled(true);
 	//Add event listener
-	_tutButt->addTouchEventListener([&](Ref* sender, ui::Widget::TouchEventType type) {
-		switch (type) {
-		case ui::Widget::TouchEventType::ENDED:
-			_tutButt = ((MainMenuButton*)sender);
-			_currController = _tutButt->index;
-			_activeController = _tutButt->getController();
-			_rootnode->removeAllChildren();
-			_activeController->initialize(_rootnode);
+	_tutButt->addTouchEventListener([this](Ref* sender, ui::Widget::TouchEventType type) {
+		if (type == ui::Widget::TouchEventType::ENDED && _loading == nullptr) {
+			startLevel(((MainMenuButton*)sender)->index);
 		}
 	});
 	_tutButt->retain();
@@ -203,6 +274,8 @@ void MainMenuController::preload() {
 	// Load the textures (Autorelease objects)
 	_assets = AssetManager::getInstance()->getCurrent();
 	TextureLoader* tloader = (TextureLoader*)_assets->access<Texture2D>();
+	// Sprites packed into the atlas load their page instead, so a level draws in a few batches
+	tloader->loadAtlas(ATLAS_TABLE);
 	tloader->loadAsync(EXPOSURE_BAR, "textures/exposure_bar.png");
 	tloader->loadAsync(EXPOSURE_FRAME, "textures/exposure_bar_frame.png");
 	tloader->loadAsync(DUDE_TEXTURE, "textures/player_animation.png");
@@ -228,9 +301,9 @@ void MainMenuController::preload() {
 	_assets->loadAsync<Sound>(SIGHTED_SOUND, "sounds/sighted.mp3");
 	_assets->loadAsync<Sound>(RUN_SOUND, "sounds/run.mp3");
 
+	MappedFile file;
 	JSONReader reader;
-	reader.initWithFile(STATIC_OBJECTS);
-	if (!reader.startJSON()) {
+	if (!file.open(STATIC_OBJECTS) || !reader.startJSON((const char*)file.getBytes(), file.getSize())) {
 		CCASSERT(false, "Failed to load static objects");
 		return;
 	}
@@ -255,10 +328,9 @@ void MainMenuController::preload() {
 	tloader->loadAsync(MENU_BACKGROUND_KEY, "textures/menu/Level Background-01.png");
 }
 
-/** Helper to load gameplay controllers in preload */
+/** Helper to create gameplay controllers in preload, without loading their levels */
 void MainMenuController::loadGameController(const char * levelkey, const char * levelpath) {
 	GameController* gc = GameController::create(levelkey, levelpath);
-	gc->preload();
 	MainMenuButton* b = MainMenuButton::create(gc);
 	mainMenuButtons.push_back(b);
 	b->retain();
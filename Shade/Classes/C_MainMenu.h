@@ -44,9 +44,24 @@ public:
 
 class MainMenuController {
 private:
-	/** Helper to load gameplay controllers in preload */
+	/** Helper to create gameplay controllers in preload, without loading their levels */
 	void loadGameController(const char * levelkey, const char * levelpath);
 
+	/** Returns the gameplay controller of a button index, where -1 is the tutorial */
+	GameController* controllerAt(int index) const;
+
+	/**
+	* Starts the level of a button index, loading it first if it is not resident.
+	*
+	* While the level loads, a loading message is shown and the buttons are ignored.
+	*
+	* @param index	The button index, where -1 is the tutorial
+	*/
+	void startLevel(int index);
+
+	/** Hands the screen to a gameplay controller whose level is loaded */
+	void launch(GameController* gc);
+
 protected:
 	/** The scene manager for this game demo */
 	SceneManager* _assets;
@@ -62,6 +77,10 @@ protected:
 	MainMenuButton* _tutButt;
 	// Active Gamecomtroller
 	GameController * _activeController;
+	/** The gameplay controller waiting for its level to load, or nullptr */
+	GameController* _loading;
+	/** The message shown while a level loads */
+	Label* _loadingnode;
 
 	/** Whether or not this menu is still active */
 	bool _active;
@@ -5,8 +5,39 @@
 #include <Box2D/Collision/Shapes/b2EdgeShape.h>
 #include <Box2D/Dynamics/Joints/b2WeldJoint.h>
 #include <ShadowCount.h>
+#include "C_Gameplay.h"
 
 const b2Filter PhysicsController::emptyFilter = b2Filter(EMPTY_BIT, 0x00, -1);
+const b2Filter PhysicsController::deadShadowFilter = b2Filter(DEAD_SHADOW_BIT, 0x00, -1);
+
+/**
+* The category pairs that matter to gameplay, with their handlers.
+*
+* The categories are those of the filters in GameController. A killed
+* pedestrian's shadow switches to deadShadowFilter while it may still
+* overlap sensors, and Box2D then ends the contact with the new category,
+* so that category also releases a sensor. The killed pedestrian's body
+* switches to emptyFilter instead, as it never counted as shade.
+*/
+const PhysicsController::ContactRule PhysicsController::contactRules[] = {
+	{ SHADOW_BIT, CHARACTER_SENSOR_BIT, &PhysicsController::shadowSensorBegin, &PhysicsController::shadowSensorEnd },
+	{ DEAD_SHADOW_BIT, CHARACTER_SENSOR_BIT, nullptr, &PhysicsController::shadowSensorEnd },
+	{ LATCH_BIT, SHADOW_BIT, &PhysicsController::latchBegin, nullptr },
+	{ LATCH_BIT, STATIC_SHADOW_BIT, &PhysicsController::latchBegin, nullptr },
+	{ CASTER_BIT, CHARACTER_SENSOR_BIT, &PhysicsController::casterSensorBegin, nullptr },
+	{ PEDESTRIAN_BIT, CHARACTER_SENSOR_BIT, &PhysicsController::pedestrianSensorBegin, nullptr },
+	{ PEDESTRIAN_BIT, OBJECT_BIT, &PhysicsController::pedestrianKilledBegin, nullptr },
+	{ PEDESTRIAN_BIT, CAR_BIT, &PhysicsController::pedestrianKilledBegin, nullptr }
+};
+
+/** Returns the index of a character sensor fixture into its ShadowCounts */
+static inline int sensorIndex(b2Fixture* sensor) {
+	return (int)(intptr_t)(sensor->GetUserData());
+}
+
+ShadowCounts& PhysicsController::sensorCounts(b2Fixture* sensor) {
+	return ((Shadow*)(sensor->GetBody()->GetUserData()))->_shadowCounts;
+}
 
 bool PhysicsController::init(const Size& size) {
 	_reachedCaster = false;
@@ -16,6 +47,8 @@ bool PhysicsController::init(const Size& size) {
 	_world = WorldController::create(Rect(Vec2(0,0), size), Vec2(0.0f, 0.0f));
 	if (_world != nullptr) {
 		_world->retain();
+		// Simulate in fixed steps so that frame hitches do not change the outcome
+		_world->setFixedStep(true);
 		_world->activateCollisionCallbacks(true);
 		_world->onBeginContact = [this](b2Contact* contact) {
 			beginContact(contact);
@@ -34,6 +67,23 @@ PhysicsController::PhysicsController() :
 	_latchedOnto(nullptr),
 	_justLatched(false)
 {
+	// Expand the rules into both orderings of the dispatch table
+	ContactEntry none = { nullptr, nullptr, false };
+	for (int ii = 0; ii < CATEGORY_SLOTS; ii++) {
+		for (int jj = 0; jj < CATEGORY_SLOTS; jj++) {
+			_dispatch[ii][jj] = none;
+		}
+	}
+	for (const ContactRule& rule : contactRules) {
+		ContactEntry& forward = _dispatch[categorySlot(rule.first)][categorySlot(rule.second)];
+		forward.begin = rule.begin;
+		forward.end = rule.end;
+		forward.swap = false;
+		ContactEntry& backward = _dispatch[categorySlot(rule.second)][categorySlot(rule.first)];
+		backward.begin = rule.begin;
+		backward.end = rule.end;
+		backward.swap = true;
+	}
 }
 
 
@@ -75,71 +125,86 @@ void PhysicsController::update(float dt) {
 void PhysicsController::beginContact(b2Contact* contact) {
 	b2Fixture* fix1 = contact->GetFixtureA();
 	b2Fixture* fix2 = contact->GetFixtureB();
-	CCLOG("%x,%x", fix1->GetFilterData().categoryBits, fix2->GetFilterData().categoryBits);
-	if (fix1->GetFilterData().categoryBits == SHADOW_BIT && fix2->GetFilterData().categoryBits == CHARACTER_SENSOR_BIT)
-		((ShadowCount*)(fix2->GetUserData()))->inc();
-	if (fix2->GetFilterData().categoryBits == SHADOW_BIT && fix1->GetFilterData().categoryBits == CHARACTER_SENSOR_BIT)
-		((ShadowCount*)(fix1->GetUserData()))->inc();
-	
-	if (fix1->GetFilterData().categoryBits == LATCH_BIT) {
-		if (_latchedOnto != (Obstacle*)(fix2->GetBody()->GetUserData())) {
-			_latchedOnto = (Obstacle*)(fix2->GetBody()->GetUserData());
-			_justLatched = true; // reset to false by gamecontroller when latchedonto is fetched
-		}
+	const ContactEntry& entry = lookup(fix1, fix2);
+	if (entry.begin == nullptr) {
+		return;
 	}
-	if (fix2->GetFilterData().categoryBits == LATCH_BIT) {
-		if (_latchedOnto != (Obstacle*)(fix1->GetBody()->GetUserData())) {
-			_latchedOnto = (Obstacle*)(fix1->GetBody()->GetUserData());
-			_justLatched = true;
-		}
+	if (entry.swap) {
+		(this->*entry.begin)(fix2, fix1);
 	}
-        
-	// If we hit the caster, we are done
-	if ((fix1->GetFilterData().categoryBits == CASTER_BIT && fix2->GetFilterData().categoryBits == CHARACTER_SENSOR_BIT) ||
-		(fix2->GetFilterData().categoryBits == CASTER_BIT && fix1->GetFilterData().categoryBits == CHARACTER_SENSOR_BIT)) {
-		_reachedCaster = true;
-	}
-	if ((fix1->GetFilterData().categoryBits == PEDESTRIAN_BIT && fix2->GetFilterData().categoryBits == CHARACTER_SENSOR_BIT) ||
-		(fix2->GetFilterData().categoryBits == PEDESTRIAN_BIT && fix1->GetFilterData().categoryBits == CHARACTER_SENSOR_BIT)) {
-		_hasDied = true;
-	}
-	if (fix1->GetFilterData().categoryBits == PEDESTRIAN_BIT && (fix2->GetFilterData().categoryBits == OBJECT_BIT || fix2->GetFilterData().categoryBits == CAR_BIT)) {
-		
-		fix1->SetFilterData(emptyFilter);
-		((OurMovingObject<Pedestrian>*)(fix1->GetUserData()))->getShadow()->getBody()->GetFixtureList()->SetFilterData(emptyFilter);
-		((OurMovingObject<Pedestrian>*)(fix1->GetUserData()))->getObject()->getSceneNode()->setVisible(false);
-		((OurMovingObject<Pedestrian>*)(fix1->GetUserData()))->getShadow()->getSceneNode()->setVisible(false);
-	}
-	if (fix2->GetFilterData().categoryBits == PEDESTRIAN_BIT && (fix1->GetFilterData().categoryBits == OBJECT_BIT || fix1->GetFilterData().categoryBits == CAR_BIT)) {
-		//_world->removeObstacle(((OurMovingObject<Pedestrian>*)(fix2->GetUserData()))->getObject());
-		//_world->removeObstacle(((OurMovingObject<Pedestrian>*)(fix2->GetUserData()))->getShadow());
-		
-		fix2->SetFilterData(emptyFilter);
-		((OurMovingObject<Pedestrian>*)(fix2->GetUserData()))->getShadow()->getBody()->GetFixtureList()->SetFilterData(emptyFilter);
-		((OurMovingObject<Pedestrian>*)(fix2->GetUserData()))->getObject()->getSceneNode()->setVisible(false);
-		((OurMovingObject<Pedestrian>*)(fix2->GetUserData()))->getShadow()->getSceneNode()->setVisible(false);
+	else {
+		(this->*entry.begin)(fix1, fix2);
 	}
 }
 
 /**
-* Callback method for the start of a collision
+* Processes the end of a collision
 *
-* This method is called when two objects cease to touch.  The main use of this method
-* is to determine when the characer is NOT on the ground.  This is how we prevent
-* double jumping.
+* This method is called when two objects cease to touch.  It shares the
+* dispatch table with beginContact.
+*
+* @param  contact  The two bodies that collided
 */
 void PhysicsController::endContact(b2Contact* contact) {
 	b2Fixture* fix1 = contact->GetFixtureA();
 	b2Fixture* fix2 = contact->GetFixtureB();
-	ShadowCount* sc = nullptr;
-	if (fix1->GetFilterData().categoryBits == SHADOW_BIT) {
-		sc = (ShadowCount*)(fix2->GetUserData()); 
+	const ContactEntry& entry = lookup(fix1, fix2);
+	if (entry.end == nullptr) {
+		return;
 	}
-	if (fix2->GetFilterData().categoryBits == SHADOW_BIT) {
-		sc = (ShadowCount*)(fix1->GetUserData());
+	if (entry.swap) {
+		(this->*entry.end)(fix2, fix1);
+	}
+	else {
+		(this->*entry.end)(fix1, fix2);
+	}
+}
+
+void PhysicsController::shadowSensorBegin(b2Fixture* shadow, b2Fixture* sensor) {
+	CC_UNUSED_PARAM(shadow);
+	sensorCounts(sensor).inc(sensorIndex(sensor));
+}
+
+void PhysicsController::shadowSensorEnd(b2Fixture* shadow, b2Fixture* sensor) {
+	CC_UNUSED_PARAM(shadow);
+	// The single body sensor has no counter
+	if (((Shadow*)(sensor->GetBody()->GetUserData()))->hasSensorGrid()) {
+		sensorCounts(sensor).dec(sensorIndex(sensor));
+	}
+}
+
+void PhysicsController::latchBegin(b2Fixture* latch, b2Fixture* shadow) {
+	CC_UNUSED_PARAM(latch);
+	if (_latchedOnto != (Obstacle*)(shadow->GetBody()->GetUserData())) {
+		_latchedOnto = (Obstacle*)(shadow->GetBody()->GetUserData());
+		_justLatched = true; // reset to false by gamecontroller when latchedonto is fetched
+	}
+}
+
+void PhysicsController::casterSensorBegin(b2Fixture* caster, b2Fixture* sensor) {
+	CC_UNUSED_PARAM(caster);
+	CC_UNUSED_PARAM(sensor);
+	// If we hit the caster, we are done
+	_reachedCaster = true;
+}
+
+void PhysicsController::pedestrianSensorBegin(b2Fixture* pedestrian, b2Fixture* sensor) {
+	CC_UNUSED_PARAM(pedestrian);
+	CC_UNUSED_PARAM(sensor);
+	_hasDied = true;
+}
+
+void PhysicsController::pedestrianKilledBegin(b2Fixture* pedestrian, b2Fixture* killer) {
+	CC_UNUSED_PARAM(killer);
+	//_world->removeObstacle(((OurMovingObject<Pedestrian>*)(pedestrian->GetUserData()))->getObject());
+	//_world->removeObstacle(((OurMovingObject<Pedestrian>*)(pedestrian->GetUserData()))->getShadow());
+	OurMovingObject<Pedestrian>* ped = (OurMovingObject<Pedestrian>*)(pedestrian->GetUserData());
+	pedestrian->SetFilterData(emptyFilter);
+	ped->getShadow()->getBody()->GetFixtureList()->SetFilterData(deadShadowFilter);
+	if (ped->getObject()->getSceneNode() != nullptr) {
+		ped->getObject()->getSceneNode()->setVisible(false);
+		ped->getShadow()->getSceneNode()->setVisible(false);
 	}
-	if (sc != nullptr) sc->dec();
-	
 }
 
 void PhysicsController::reset() {
@@ -148,3 +213,44 @@ void PhysicsController::reset() {
 	_latchedOnto = nullptr;
     _hasDied = false;
 }
+
+void PhysicsController::restart() {
+	_world->resetAccumulator();
+	_reachedCaster = false;
+	_hasDied = false;
+	_latchedOnto = nullptr;
+	_justLatched = false;
+}
+
+bool PhysicsController::steer(Shadow* player, WheelObstacle* latch, const Vec2& target, bool moving, bool latching) {
+	bool dropped = latching && (player->getPosition() - target).lengthSquared() <= LATCH_LIMIT_SQUARED;
+	if (dropped) {
+		latch->getBody()->GetFixtureList()->SetFilterData(GameController::latchFilter);
+		latch->setPosition(target);
+	}
+	else {
+		latch->getBody()->GetFixtureList()->SetFilterData(emptyFilter);
+	}
+	if (_latchedOnto == nullptr) {
+		if (!moving || (player->getPosition() - target).lengthSquared() <= TARGET_REACH_EPSILON_SQUARED) {
+			player->stopMovement();
+		}
+		else {
+			Vec2 movVec = target - player->getPosition();
+			player->changeVelocity(movVec.x, movVec.y);
+		}
+	}
+	else {
+		player->getBody()->SetLinearVelocity(_latchedOnto->getBody()->GetLinearVelocity());
+	}
+	return dropped;
+}
+
+void PhysicsController::snapToLatch(Shadow* player) {
+	if (_justLatched) {
+		player->setPosition(_latchedOnto->getPosition().x, _latchedOnto->getPosition().y);
+		// A teleport, so there is nothing to interpolate from
+		player->storePreviousTransform();
+		_justLatched = false;
+	}
+}
@@ -6,8 +6,12 @@
 #include "M_LevelInstance.h"
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 
+/** The number of distinct category bits, i.e. the width of b2Filter::categoryBits */
+#define CATEGORY_SLOTS 16
+
 namespace cocos2d {
 	class WorldController;
+	class WheelObstacle;
 }
 
 using namespace cocos2d;
@@ -15,6 +19,7 @@ using namespace cocos2d;
 class PhysicsController {
 
 	friend class GameController;
+	friend class SimulationController;
 
 	/** Whether we have reached the caster */
 	bool _reachedCaster;
@@ -29,10 +34,75 @@ class PhysicsController {
 	/** The Box2D world */
 	WorldController* _world;
 
+	/**
+	* Handles a contact between two fixtures.
+	*
+	* The first fixture always has the first category of the rule the
+	* handler was registered for, whatever the order in the b2Contact.
+	*/
+	typedef void (PhysicsController::*ContactHandler)(b2Fixture* fix, b2Fixture* other);
+
+	/** The handlers for one (ordered) pair of categories */
+	struct ContactEntry {
+		/** Called from beginContact, or nullptr */
+		ContactHandler begin;
+		/** Called from endContact, or nullptr */
+		ContactHandler end;
+		/** Whether the fixtures must be swapped before calling the handler */
+		bool swap;
+	};
+
+	/** A pair of categories and the handlers to call when they touch */
+	struct ContactRule {
+		uint16 first;
+		uint16 second;
+		ContactHandler begin;
+		ContactHandler end;
+	};
+
+	/** Every category pair with a handler; all other contacts are ignored */
+	static const ContactRule contactRules[];
+
+	/** Dispatch table indexed by the slots of the two fixture categories */
+	ContactEntry _dispatch[CATEGORY_SLOTS][CATEGORY_SLOTS];
+
+	/** Returns the table slot of a single category bit */
+	static inline int categorySlot(uint16 bits) {
+		// Multiplying by a de Bruijn sequence puts a unique pattern in the top nibble
+		static const int slots[CATEGORY_SLOTS] = { 0, 1, 2, 5, 3, 9, 6, 11, 15, 4, 8, 10, 14, 7, 13, 12 };
+		return slots[((uint16)(bits * 0x09AF)) >> 12];
+	}
+
+	/** Returns the table entry for a pair of fixtures */
+	const ContactEntry& lookup(b2Fixture* fix1, b2Fixture* fix2) const {
+		return _dispatch[categorySlot(fix1->GetFilterData().categoryBits)]
+			[categorySlot(fix2->GetFilterData().categoryBits)];
+	}
+
+	/** Returns the shadow counters of the character owning a sensor fixture */
+	static ShadowCounts& sensorCounts(b2Fixture* sensor);
+
+#pragma mark -
+#pragma mark Contact Handlers
+	/** A shadow started to overlap a character sensor */
+	void shadowSensorBegin(b2Fixture* shadow, b2Fixture* sensor);
+	/** A shadow stopped overlapping a character sensor */
+	void shadowSensorEnd(b2Fixture* shadow, b2Fixture* sensor);
+	/** The latch marker landed on a shadow */
+	void latchBegin(b2Fixture* latch, b2Fixture* shadow);
+	/** The character reached the caster */
+	void casterSensorBegin(b2Fixture* caster, b2Fixture* sensor);
+	/** A pedestrian caught the character */
+	void pedestrianSensorBegin(b2Fixture* pedestrian, b2Fixture* sensor);
+	/** A pedestrian was run over by a car or walked into a building */
+	void pedestrianKilledBegin(b2Fixture* pedestrian, b2Fixture* killer);
+
 public:
 
 	/** A filter that doesn't collide with anything */
 	static const b2Filter emptyFilter;
+	/** The filter of a killed pedestrian's shadow, which collides with nothing new */
+	static const b2Filter deadShadowFilter;
 
 #pragma mark -
 #pragma mark Initialization
@@ -108,6 +178,38 @@ public:
 	*/
 	void reset();
 
+	/**
+	* Clears the gameplay flags and the latch, keeping the world.
+	*
+	* Use this when the bodies are restored in place from a snapshot.
+	*/
+	void restart();
+
+	/**
+	* Moves the character toward a target, or along with the shadow it rides.
+	*
+	* A double tap within reach of the character drops the latch marker on
+	* the target; otherwise the marker is switched off. Without a latched
+	* shadow, the character walks toward the target until it gets there,
+	* or stops if it is not moving.
+	*
+	* @param  player    The character
+	* @param  latch     The latch marker
+	* @param  target    The point to walk toward, in Box2D units
+	* @param  moving    Whether the character should walk at all
+	* @param  latching  Whether the target was double tapped
+	*
+	* @return true if the latch marker was dropped on the target
+	*/
+	bool steer(Shadow* player, WheelObstacle* latch, const Vec2& target, bool moving, bool latching);
+
+	/**
+	* Snaps the character onto the shadow it latched onto during the last step.
+	*
+	* This is a teleport, so the previous transform is stored as well.
+	*/
+	void snapToLatch(Shadow* player);
+
 	/**
 	* Executes the core gameplay loop of this world.
 	*
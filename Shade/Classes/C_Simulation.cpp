@@ -0,0 +1,302 @@
+#include <limits>
+#include <algorithm>
+#include <cornell/CUTimestamp.h>
+#include "C_Simulation.h"
+#include "C_Gameplay.h"
+#include "LevelBuilder.h"
+#include "MappedFile.h"
+
+// These must agree with the files loaded by MainMenuController::preload
+/** The character filmstrip file */
+#define DUDE_FILE "textures/player_animation.png"
+/** The caster filmstrip file */
+#define GOAL_FILE "textures/caster_animation.png"
+/** The pedestrian image file */
+#define PEDESTRIAN_FILE "textures/Pedestrian.png"
+/** The pedestrian shadow image file */
+#define PEDESTRIAN_SHADOW_FILE "textures/Pedestrian_S.png"
+/** The car filmstrip file */
+#define CAR_FILE "textures/car_animation.png"
+/** The car shadow image file */
+#define CAR_SHADOW_FILE "textures/Car1_S.png"
+/** The directory holding the static object images */
+#define STATIC_OBJECT_DIR "textures/static_objects/"
+
+#pragma mark -
+#pragma mark Allocation
+
+SimulationController::SimulationController() :
+	_level(nullptr),
+	_latch(nullptr),
+	_hasTarget(false),
+	_latching(false),
+	_tapped(false),
+	_exposure(0.0f),
+	_complete(false),
+	_failed(false),
+	_loadTime(0),
+	_populateTime(0)
+{
+	std::fill(_phaseTimes, _phaseTimes + FrameProfiler::PHASE_COUNT, 0L);
+}
+
+SimulationController::~SimulationController() {
+	dispose();
+}
+
+void SimulationController::dispose() {
+	_snapshot.clear();
+	_physics.dispose();
+	_ai.dispose();
+	_planner.dispose();
+	_latch = nullptr;
+	if (_level != nullptr) {
+		_level->release();
+		_level = nullptr;
+	}
+	_textureFiles.clear();
+	_imageSizes.clear();
+	_stepTimes.clear();
+	std::fill(_phaseTimes, _phaseTimes + FrameProfiler::PHASE_COUNT, 0L);
+	_loadTime = _populateTime = 0;
+}
+
+bool SimulationController::init(const std::string& levelFile, bool kinematic) {
+	if (!loadTextureFiles()) {
+		return false;
+	}
+
+	timestamp_t start = current_time();
+	_level = LevelInstance::create(levelFile);
+	if (_level == nullptr) {
+		return false;
+	}
+	_level->retain();
+	_level->setHeadless(true);
+	if (!_level->load()) {
+		return false;
+	}
+	timestamp_t loaded = current_time();
+	_loadTime = elapsed_micros(start, loaded);
+
+	if (!_physics.init(_level->_size)) {
+		return false;
+	}
+	populate();
+	_physics._world->beforeStep = [this] {
+		// The actions are a phase of their own, not part of the step
+		timestamp_t start = current_time();
+		_level->_movers.act();
+		_level->_casterPos.object->act();
+		long micros = elapsed_micros(start, current_time());
+		_phaseTimes[FrameProfiler::MOVERS] += micros;
+		_phaseTimes[FrameProfiler::PHYSICS] -= micros;
+	};
+	if (kinematic) {
+		_level->_movers.cars.makeKinematic();
+	}
+	_snapshot.capture(_physics._world);
+	_ai.init(_level);
+	_populateTime = elapsed_micros(loaded, current_time());
+
+	_exposure = 0.0f;
+	_complete = false;
+	_failed = false;
+	return true;
+}
+
+void SimulationController::reset() {
+	_physics.restart();
+	_level->_movers.unparkAll();
+	_snapshot.restore();
+	_level->_movers.cars.seek(0.0f);
+	_level->_casterPos.object->_actionQueue->clear();
+	for (LevelInstance::CarMetadata &car : _level->_cars) {
+		car.object->_actionQueue->assign(*(car.actions));
+	}
+	for (LevelInstance::PedestrianMetadata &ped : _level->_pedestrians) {
+		ped.object->_actionQueue->assign(*(ped.actions));
+	}
+	_ai.reset();
+
+	_latch->getBody()->GetFixtureList()->SetFilterData(PhysicsController::emptyFilter);
+	_hasTarget = _latching = _tapped = false;
+	_exposure = 0.0f;
+	_complete = false;
+	_failed = false;
+}
+
+bool SimulationController::loadTextureFiles() {
+	_textureFiles[GOAL_TEXTURE] = GOAL_FILE;
+	_textureFiles[DUDE_TEXTURE] = DUDE_FILE;
+	_textureFiles[PEDESTRIAN_TEXTURE] = PEDESTRIAN_FILE;
+	_textureFiles[PEDESTRIAN_SHADOW_TEXTURE] = PEDESTRIAN_SHADOW_FILE;
+	_textureFiles[CAR_TEXTURE] = CAR_FILE;
+	_textureFiles[CAR_SHADOW_TEXTURE] = CAR_SHADOW_FILE;
+
+	MappedFile file;
+	JSONReader reader;
+	if (!file.open(STATIC_OBJECTS) || !reader.startJSON((const char*)file.getBytes(), file.getSize())) {
+		CCLOG("Failed to load static objects");
+		return false;
+	}
+	int count = reader.startArray("types");
+	for (int index = 0; index < count; index++) {
+		reader.startObject();
+		string name = reader.getString("name");
+		string imageFormat = reader.getString("imageFormat");
+		string shadowImageFormat = reader.getString("shadowImageFormat");
+		if (shadowImageFormat == "") {
+			shadowImageFormat = imageFormat;
+		}
+		_textureFiles[name + OBJECT_TAG] = STATIC_OBJECT_DIR + name + "." + imageFormat;
+		_textureFiles[name + SHADOW_TAG] = STATIC_OBJECT_DIR + name + "_S." + shadowImageFormat;
+		reader.endObject();
+		reader.advance();
+	}
+	reader.endArray();
+	reader.endJSON();
+	return true;
+}
+
+Size SimulationController::frameSize(const std::string& file, int rows, int cols) {
+	auto it = _imageSizes.find(file);
+	if (it == _imageSizes.end()) {
+		Size size;
+		Image* image = new (std::nothrow) Image();
+		if (image != nullptr && image->initWithImageFile(file)) {
+			size = Size((float)image->getWidth(), (float)image->getHeight());
+		}
+		else {
+			CCLOG("Failed to read image %s", file.c_str());
+		}
+		CC_SAFE_RELEASE(image);
+		it = _imageSizes.insert(std::make_pair(file, size)).first;
+	}
+	return Size(it->second.width / cols, it->second.height / rows);
+}
+
+
+#pragma mark -
+#pragma mark Level Creation
+
+/**
+ * Creates every body of the level in the physics world.
+ *
+ * The bodies are created by LevelBuilder, exactly as in GameController,
+ * but sized from the pixel sizes of the texture files.
+ */
+void SimulationController::populate() {
+	LevelBuilder::FrameSizer frame = [this](const std::string& texture, int rows, int cols) {
+		auto it = _textureFiles.find(texture);
+		return (it == _textureFiles.end() ? Size::ZERO : frameSize(it->second, rows, cols));
+	};
+	_latch = LevelBuilder::populate(_level, frame, [this](Obstacle* obj, int zOrder) {
+		CC_UNUSED_PARAM(zOrder);
+		_physics._world->addObstacle(obj);
+	});
+}
+
+
+#pragma mark -
+#pragma mark Simulation
+
+void SimulationController::tap(const Vec2& target, bool twice) {
+	_target = target;
+	_hasTarget = true;
+	_latching = twice;
+	_tapped = true;
+}
+
+/**
+ * Moves the character by the last tap.
+ *
+ * This is the input handling of GameController::update, with taps
+ * already in Box2D units.
+ */
+void SimulationController::steer() {
+	if (_tapped) {
+		_physics._latchedOnto = nullptr;
+		_tapped = false;
+	}
+	if (!_physics.steer(_level->_playerPos.object, _latch, _target, _hasTarget, _latching)) {
+		_latching = false;
+	}
+}
+
+void SimulationController::update(float dt) {
+	timestamp_t start = current_time();
+	steer();
+	timestamp_t steered = current_time();
+
+	// Nothing is drawn, so only the distance to the character counts
+	Vec2 focus = _level->_playerPos.object->getPosition();
+	_lod.update(_level->_movers, b2Vec2(focus.x, focus.y), Rect::ZERO);
+	timestamp_t moved = current_time();
+
+	_physics.update(dt);
+	timestamp_t stepped = current_time();
+	_ai.update();
+	_physics.snapToLatch(_level->_playerPos.object);
+	timestamp_t decided = current_time();
+
+	if (!_complete && !_failed) {
+		if (_physics._reachedCaster) _complete = true;
+		if (_physics._hasDied) _failed = true;
+		_exposure += dt * (1.0f - ((1.0f + EXPOSURE_COOLDOWN_RATIO) * _level->_playerPos.object->getCoverRatio()));
+		if (_exposure < 0.0f) _exposure = 0.0f;
+		if (_exposure >= EXPOSURE_LIMIT) {
+			_exposure = EXPOSURE_LIMIT;
+			_failed = true;
+		}
+	}
+
+	timestamp_t end = current_time();
+	_phaseTimes[FrameProfiler::INPUT] += elapsed_micros(start, steered);
+	_phaseTimes[FrameProfiler::MOVERS] += elapsed_micros(steered, moved);
+	_phaseTimes[FrameProfiler::PHYSICS] += elapsed_micros(moved, stepped);
+	_phaseTimes[FrameProfiler::AI] += elapsed_micros(stepped, decided);
+	_phaseTimes[FrameProfiler::EXPOSURE] += elapsed_micros(decided, end);
+	_stepTimes.push_back(elapsed_micros(start, end));
+}
+
+SimulationStats SimulationController::getStats() const {
+	SimulationStats stats;
+	stats.load = _loadTime / 1000.0;
+	stats.populate = _populateTime / 1000.0;
+	if (_stepTimes.empty()) {
+		return stats;
+	}
+
+	std::vector<long> sorted(_stepTimes);
+	std::sort(sorted.begin(), sorted.end());
+	long total = 0;
+	for (long time : sorted) {
+		total += time;
+	}
+
+	stats.steps = (int)sorted.size();
+	stats.total = total / 1000.0;
+	stats.mean = stats.total / stats.steps;
+	stats.min = sorted.front() / 1000.0;
+	stats.max = sorted.back() / 1000.0;
+	stats.p50 = sorted[(sorted.size() - 1) / 2] / 1000.0;
+	stats.p95 = sorted[(sorted.size() - 1) * 95 / 100] / 1000.0;
+	stats.p99 = sorted[(sorted.size() - 1) * 99 / 100] / 1000.0;
+	for (int ii = 0; ii < FrameProfiler::PHASE_COUNT; ii++) {
+		stats.phases[ii] = _phaseTimes[ii] / 1000.0 / stats.steps;
+	}
+	return stats;
+}
+
+float SimulationController::planRoute(std::vector<b2Vec2>& route) {
+	if (!_planner.isActive() && !_planner.init(_level, false)) {
+		route.clear();
+		return std::numeric_limits<float>::infinity();
+	}
+	Vec2 player = _level->_playerPos.object->getPosition();
+	Vec2 caster = _level->_casterPos.object->getObject()->getPosition();
+	_planner.update(b2Vec2(player.x, player.y), b2Vec2(caster.x, caster.y), _level->_movers);
+	route = _planner.getRoute();
+	return _planner.getCost();
+}
@@ -0,0 +1,263 @@
+#ifndef __C_SIMULATION_H__
+#define __C_SIMULATION_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include "cocos2d.h"
+#include <cornell.h>
+#include "C_AI.h"
+#include "C_Physics.h"
+#include "M_LevelInstance.h"
+#include "LevelSnapshot.h"
+#include "MoverLOD.h"
+#include "FrameProfiler.h"
+#include "ShadePlanner.h"
+
+using namespace cocos2d;
+
+/** Load and step-time statistics of a headless run, in milliseconds */
+struct SimulationStats {
+	/** The number of steps measured */
+	int steps;
+	/** The total time of all steps */
+	double total;
+	/** The mean step time */
+	double mean;
+	/** The fastest step */
+	double min;
+	/** The slowest step */
+	double max;
+	/** The median step time */
+	double p50;
+	/** The 95th percentile step time */
+	double p95;
+	/** The 99th percentile step time */
+	double p99;
+	/** The mean time of each FrameProfiler phase per step; 0 for phases that do not run */
+	double phases[FrameProfiler::PHASE_COUNT];
+	/** The time to read the level file */
+	double load;
+	/** The time to create the bodies and bake the level data */
+	double populate;
+
+	SimulationStats() : steps(0), total(0), mean(0), min(0), max(0), p50(0), p95(0), p99(0), load(0), populate(0) {
+		for (int ii = 0; ii < FrameProfiler::PHASE_COUNT; ii++) {
+			phases[ii] = 0;
+		}
+	}
+};
+
+/**
+ * Runs the gameplay layer of a level with no scene graph, GL context or audio.
+ *
+ * This controller loads a level through LevelInstance in headless mode and
+ * populates the physics world through LevelBuilder, as GameController does,
+ * except that object sizes come from the pixel sizes of the texture files
+ * rather than from the textures themselves. Each update steps the movers, the physics and
+ * the AI exactly as a gameplay frame does, and records how long it took,
+ * both in total and for each phase, under the FrameProfiler phase names.
+ *
+ * The character only moves when told to by tap(), which stands in for the
+ * touch input, so without it the character stays at its starting position.
+ *
+ * The cars can instead run as kinematic bodies along their compiled
+ * trajectories, which skips their action queues and lets reset() jump them
+ * back to the start, but they are then no longer pushed by collisions.
+ *
+ * Like the other controllers, this class allocates nothing in its
+ * constructor, so it can be held by value.
+ */
+class SimulationController {
+protected:
+	/** The level being simulated */
+	LevelInstance* _level;
+	/** The physics controller, which owns the Box2D world */
+	PhysicsController _physics;
+	/** The AI controller for the pedestrians and caster */
+	AIController _ai;
+	/** Parks the movers far from the character, as in GameController */
+	MoverLOD _lod;
+	/** Plans the shadiest route to the caster, built by the first planRoute() */
+	ShadePlanner _planner;
+
+	/** The texture file of every sprite, by its texture key in GameController */
+	std::map<std::string, std::string> _textureFiles;
+	/** The pixel size of every texture file measured so far */
+	std::map<std::string, Size> _imageSizes;
+
+	/** The marker that latches onto a shadow, as in GameController */
+	WheelObstacle* _latch;
+	/** The point the character walks toward, in Box2D units */
+	Vec2 _target;
+	/** Whether there has been a tap since the level started */
+	bool _hasTarget;
+	/** Whether the last tap was a double tap */
+	bool _latching;
+	/** Whether a tap came in since the last update */
+	bool _tapped;
+
+	/** Exposure accumulated by the character, as in GameController */
+	float _exposure;
+	/** Whether the character reached the caster */
+	bool _complete;
+	/** Whether the character was caught or overexposed */
+	bool _failed;
+	/** The duration of every step so far, in microseconds */
+	std::vector<long> _stepTimes;
+	/** The total time of each phase over every step so far, in microseconds */
+	long _phaseTimes[FrameProfiler::PHASE_COUNT];
+	/** The time init() took to read the level file, in microseconds */
+	long _loadTime;
+	/** The time init() took to populate the level, in microseconds */
+	long _populateTime;
+	/** The state of every body right after the level was populated */
+	LevelSnapshot _snapshot;
+
+	/**
+	 * Returns the size of one animation frame of a texture file, in pixels.
+	 *
+	 * Only the image file is decoded; no texture is created.
+	 *
+	 * @param  file  The texture file, relative to the resource directory
+	 * @param  rows  The number of rows in the filmstrip
+	 * @param  cols  The number of columns in the filmstrip
+	 *
+	 * @return the size of one animation frame, in pixels
+	 */
+	Size frameSize(const std::string& file, int rows = 1, int cols = 1);
+
+	/** Reads the texture files of every sprite, including every static object type. */
+	bool loadTextureFiles();
+
+	/** Creates every body of the level in the physics world. */
+	void populate();
+
+	/** Moves the character by the last tap, as GameController does with its input. */
+	void steer();
+
+public:
+#pragma mark -
+#pragma mark Allocation
+	/**
+	 * Creates a new simulation with the default values.
+	 *
+	 * This constructor does not allocate any objects or start the controller.
+	 */
+	SimulationController();
+
+	/**
+	 * Disposes of all (non-static) resources allocated to this controller.
+	 */
+	~SimulationController();
+
+	/**
+	 * Disposes of all (non-static) resources allocated to this controller.
+	 */
+	void dispose();
+
+	/**
+	 * Loads the given level and populates its physics world.
+	 *
+	 * @param  levelFile  The level file, relative to the resource directory
+	 * @param  kinematic  Whether the cars run along compiled trajectories
+	 *
+	 * @return true if the level loaded and populated properly
+	 */
+	bool init(const std::string& levelFile, bool kinematic = false);
+
+	/**
+	 * Puts the level back in its starting state, as GameController::reset does.
+	 *
+	 * The step and phase times recorded so far are kept. Every body, worker
+	 * thread and action queue is reused, so no engine object is created and
+	 * simulations on other threads may reset at the same time.
+	 */
+	void reset();
+
+#pragma mark -
+#pragma mark Simulation
+	/**
+	 * Taps a point of the level, as a touch on the screen does.
+	 *
+	 * The character walks toward the point until it gets there, and any
+	 * shadow it was riding is let go. A double tap within reach of the
+	 * character also drops the latch marker on the point, and if that
+	 * lands on a shadow, the character rides the shadow from the next
+	 * update on. Unlike a touch, a tap is never lost in the dead zone at the
+	 * center of the screen, so tapping the character's own position is how
+	 * a caller stops it.
+	 *
+	 * @param  target  The point to walk toward, in Box2D units
+	 * @param  twice   Whether this is a double tap
+	 */
+	void tap(const Vec2& target, bool twice = false);
+
+	/** Returns whether the character is riding a shadow */
+	bool isLatched() const { return _physics._latchedOnto != nullptr; }
+
+	/** Returns whether the character was caught by a pedestrian */
+	bool isCaught() const { return _physics._hasDied; }
+
+	/**
+	 * Sets whether the AI decides for large crowds on helper threads.
+	 *
+	 * Both ways make the same decisions. Callers that run a simulation on
+	 * every core should turn this off, so the helpers do not compete with
+	 * the other simulations.
+	 */
+	void setParallel(bool value) { _ai.setParallel(value); }
+
+	/**
+	 * Runs one gameplay frame: the input, the movers, the physics step and the AI.
+	 *
+	 * @param  dt  Number of seconds to simulate
+	 */
+	void update(float dt);
+
+	/** Returns whether the character reached the caster */
+	bool isComplete() const { return _complete; }
+
+	/** Returns whether the character was caught or overexposed */
+	bool isFailed() const { return _failed; }
+
+	/** Returns the exposure accumulated by the character */
+	float getExposure() const { return _exposure; }
+
+	/** Returns the level being simulated */
+	LevelInstance* getLevel() const { return _level; }
+
+	/** Sets whether large AI read phases run on helper threads, or all serially */
+	void setParallelAI(bool value) { _ai.setParallel(value); }
+
+	/** Sets whether each parallel AI read phase is run again serially and compared */
+	void setCrossCheckAI(bool value) { _ai.setCrossCheck(value); }
+
+	/** Returns the number of parallel AI decisions compared with serial ones so far */
+	unsigned long getCrossChecked() const { return _ai._crossChecked; }
+
+	/** Returns the number of compared AI decisions that differed */
+	unsigned long getCrossMismatches() const { return _ai._mismatches; }
+
+	/** Returns whether the AI has helper threads for its read phase */
+	bool hasParallelAI() const { return _ai._jobs.isActive(); }
+
+	/** Returns the load time and the statistics of every step so far */
+	SimulationStats getStats() const;
+
+	/**
+	 * Returns the route to the caster that spends least time in the sun.
+	 *
+	 * This is the route the indicator follows in GameController. The first
+	 * call builds the planner, and each later call replans incrementally
+	 * from where the character and the mover shadows are now, in place, so
+	 * it is cheap enough for tests and bots to ask every few frames.
+	 *
+	 * @param  route  The turns of the route, from the character to the caster
+	 *
+	 * @return the cost of the route, or infinity if the caster cannot be reached
+	 */
+	float planRoute(std::vector<b2Vec2>& route);
+};
+
+#endif /* __C_SIMULATION_H__ */
@@ -0,0 +1,183 @@
+#include <math.h>
+#include <limits.h>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include "FlowField.h"
+
+/** The cost of a straight step between cells */
+#define FLOW_STEP_COST 10
+/** The cost of a diagonal step between cells */
+#define FLOW_DIAGONAL_COST 14
+
+/** The column offset of each direction code, counterclockwise from east */
+static const int FLOW_DX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+/** The row offset of each direction code, counterclockwise from east */
+static const int FLOW_DY[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+/** The unit vector of each direction code, and zero for FLOW_NONE */
+static const b2Vec2 FLOW_DIRECTIONS[9] = {
+	b2Vec2(1.0f, 0.0f), b2Vec2(0.70710678f, 0.70710678f),
+	b2Vec2(0.0f, 1.0f), b2Vec2(-0.70710678f, 0.70710678f),
+	b2Vec2(-1.0f, 0.0f), b2Vec2(-0.70710678f, -0.70710678f),
+	b2Vec2(0.0f, -1.0f), b2Vec2(0.70710678f, -0.70710678f),
+	b2Vec2(0.0f, 0.0f)
+};
+
+bool FlowField::init(const Size& size, float cellSize) {
+	dispose();
+	if (size.width <= 0.0f || size.height <= 0.0f || cellSize <= 0.0f) {
+		return false;
+	}
+	_cellSize = cellSize;
+	_cols = std::max(1, (int)ceilf(size.width / cellSize));
+	_rows = std::max(1, (int)ceilf(size.height / cellSize));
+	_blocked.assign(_cols * _rows, 0);
+	_workers = ThreadPool::create(FLOW_FIELD_THREADS);
+	_workers->retain();
+	return true;
+}
+
+void FlowField::addBox(const Vec2& center, const Size& size, float clearance) {
+	if (_blocked.empty()) {
+		return;
+	}
+	float halfw = size.width * 0.5f + clearance;
+	float halfh = size.height * 0.5f + clearance;
+	int col0 = std::max(0, (int)ceilf((center.x - halfw) / _cellSize - 0.5f));
+	int col1 = std::min(_cols - 1, (int)floorf((center.x + halfw) / _cellSize - 0.5f));
+	int row0 = std::max(0, (int)ceilf((center.y - halfh) / _cellSize - 0.5f));
+	int row1 = std::min(_rows - 1, (int)floorf((center.y + halfh) / _cellSize - 0.5f));
+	for (int row = row0; row <= row1; row++) {
+		std::fill(_blocked.begin() + row * _cols + col0, _blocked.begin() + row * _cols + col1 + 1, 1);
+	}
+}
+
+void FlowField::dispose() {
+	if (_workers != nullptr) {
+		// Joins the workers, so no field is written after this
+		_workers->stop();
+		_workers->release();
+		_workers = nullptr;
+	}
+	_targets.clear();
+	_blocked.clear();
+	_cols = _rows = 0;
+	_cellSize = 0.0f;
+}
+
+int FlowField::addTarget() {
+	Target* target = new Target();
+	target->dirs[0].assign(_blocked.size(), FLOW_NONE);
+	target->dirs[1].assign(_blocked.size(), FLOW_NONE);
+	_targets.push_back(std::unique_ptr<Target>(target));
+	return (int)_targets.size() - 1;
+}
+
+void FlowField::setTarget(int target, const b2Vec2& pos) {
+	if (_blocked.empty()) {
+		return;
+	}
+	Target* t = _targets[target].get();
+	t->wanted = cellOf(pos);
+	dispatch(t);
+}
+
+void FlowField::update() {
+	for (auto& target : _targets) {
+		dispatch(target.get());
+	}
+}
+
+void FlowField::dispatch(Target* target) {
+	if (_workers == nullptr || target->wanted < 0 || target->wanted == target->cell
+		|| target->busy.load(std::memory_order_acquire)) {
+		return;
+	}
+	int cell = target->wanted;
+	int front = target->front.load(std::memory_order_acquire);
+	int back = front < 0 ? 0 : 1 - front;
+	target->cell = cell;
+	target->busy.store(true, std::memory_order_release);
+	_workers->addTask([this, target, cell, back] { compute(target, cell, back); });
+}
+
+b2Vec2 FlowField::sample(int target, const b2Vec2& pos) const {
+	const Target* t = _targets[target].get();
+	int front = t->front.load(std::memory_order_acquire);
+	if (front < 0) {
+		return FLOW_DIRECTIONS[FLOW_NONE];
+	}
+	return FLOW_DIRECTIONS[t->dirs[front][cellOf(pos)]];
+}
+
+b2Vec2 FlowField::sample(int target, int front, const b2Vec2& pos) const {
+	return FLOW_DIRECTIONS[_targets[target]->dirs[front][cellOf(pos)]];
+}
+
+void FlowField::compute(Target* target, int cell, int back) {
+	// Integrate the cost to the target outward from its cell
+	std::vector<unsigned int>& cost = target->cost;
+	cost.assign(_blocked.size(), UINT_MAX);
+	typedef std::pair<unsigned int, int> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+	cost[cell] = 0;
+	open.push(Entry(0, cell));
+	while (!open.empty()) {
+		Entry top = open.top();
+		open.pop();
+		if (top.first != cost[top.second]) {
+			continue;
+		}
+		int col = top.second % _cols;
+		int row = top.second / _cols;
+		for (int dir = 0; dir < 8; dir++) {
+			int ncol = col + FLOW_DX[dir];
+			int nrow = row + FLOW_DY[dir];
+			if (ncol < 0 || ncol >= _cols || nrow < 0 || nrow >= _rows || _blocked[nrow * _cols + ncol]) {
+				continue;
+			}
+			// Do not cut the corner of a blocked cell
+			if ((dir & 1) && (_blocked[row * _cols + ncol] || _blocked[nrow * _cols + col])) {
+				continue;
+			}
+			int next = nrow * _cols + ncol;
+			unsigned int step = top.first + ((dir & 1) ? FLOW_DIAGONAL_COST : FLOW_STEP_COST);
+			if (step < cost[next]) {
+				cost[next] = step;
+				open.push(Entry(step, next));
+			}
+		}
+	}
+
+	// Point every cell at its cheapest legal neighbour, so a mover pushed
+	// into a blocked margin is led back out
+	std::vector<unsigned char>& dirs = target->dirs[back];
+	for (int row = 0; row < _rows; row++) {
+		for (int col = 0; col < _cols; col++) {
+			int here = row * _cols + col;
+			unsigned char best = FLOW_NONE;
+			unsigned int bestCost = cost[here];
+			if (here != cell) {
+				for (int dir = 0; dir < 8; dir++) {
+					int ncol = col + FLOW_DX[dir];
+					int nrow = row + FLOW_DY[dir];
+					if (ncol < 0 || ncol >= _cols || nrow < 0 || nrow >= _rows) {
+						continue;
+					}
+					if ((dir & 1) && (_blocked[row * _cols + ncol] || _blocked[nrow * _cols + col])) {
+						continue;
+					}
+					unsigned int c = cost[nrow * _cols + ncol];
+					if (c < bestCost) {
+						bestCost = c;
+						best = (unsigned char)dir;
+					}
+				}
+			}
+			dirs[here] = best;
+		}
+	}
+
+	target->front.store(back, std::memory_order_release);
+	target->busy.store(false, std::memory_order_release);
+}
@@ -0,0 +1,173 @@
+#ifndef __FLOW_FIELD_H__
+#define __FLOW_FIELD_H__
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cornell.h>
+#include <Box2D/Common/b2Math.h>
+
+/** The side of one flow field cell, in Box2D units */
+#define FLOW_FIELD_CELL 0.5f
+/** The number of worker threads computing flow fields */
+#define FLOW_FIELD_THREADS 2
+/** The direction code of a cell with no way to the target */
+#define FLOW_NONE 8
+
+using namespace cocos2d;
+
+/**
+ * Shared steering toward a few common targets over a walkable grid.
+ *
+ * The level is covered by a grid of cells, some of which are blocked by
+ * buildings. For each target the service keeps a direction field: every
+ * walkable cell points at the neighbouring cell that is one step closer
+ * to the target. Any number of movers heading for the same target can
+ * then steer by sampling the field at their position, in O(1), instead of
+ * each searching for a path.
+ *
+ * A field is recomputed only when its target moves into another cell. The
+ * search runs on a ThreadPool and each target is double-buffered: the
+ * worker fills the back field while movers sample the front one, and the
+ * two are swapped when the worker is done. So the game thread never waits
+ * on a search; until the new field is published, movers follow the last.
+ *
+ * Every method except the worker's must be called from the game thread.
+ */
+class FlowField {
+private:
+	/** The double-buffered field of one target */
+	struct Target {
+		/** The direction code of every cell, in each buffer */
+		std::vector<unsigned char> dirs[2];
+		/** The path cost of every cell to the target; the worker's scratch */
+		std::vector<unsigned int> cost;
+		/** The buffer movers sample, or -1 until the first field is done */
+		std::atomic<int> front;
+		/** Whether the worker is filling the back buffer */
+		std::atomic<bool> busy;
+		/** The target cell of the published or in-flight field */
+		int cell;
+		/** The target cell asked for last, or -1 */
+		int wanted;
+
+		Target() : front(-1), busy(false), cell(-1), wanted(-1) {}
+	};
+
+	/** The targets, by handle; heap-allocated since atomics cannot move */
+	std::vector<std::unique_ptr<Target>> _targets;
+	/** Non-zero for each blocked cell, row-major */
+	std::vector<unsigned char> _blocked;
+	/** The number of columns */
+	int _cols;
+	/** The number of rows */
+	int _rows;
+	/** The side of one cell, in Box2D units */
+	float _cellSize;
+	/** The workers computing the fields */
+	ThreadPool* _workers;
+
+	/** Returns the cell holding a point, clamped to the grid */
+	int cellOf(const b2Vec2& pos) const {
+		int col = (int)(pos.x / _cellSize);
+		int row = (int)(pos.y / _cellSize);
+		col = col < 0 ? 0 : (col >= _cols ? _cols - 1 : col);
+		row = row < 0 ? 0 : (row >= _rows ? _rows - 1 : row);
+		return row * _cols + col;
+	}
+
+	/** Starts a worker on a target if it is idle and behind its wanted cell */
+	void dispatch(Target* target);
+
+	/** Fills the back buffer of a target and publishes it. Runs on a worker. */
+	void compute(Target* target, int cell, int back);
+
+public:
+	FlowField() : _cols(0), _rows(0), _cellSize(0.0f), _workers(nullptr) {}
+
+	~FlowField() { dispose(); }
+
+	/**
+	 * Allocates an unblocked grid covering a level and starts the workers.
+	 *
+	 * @param  size      The level dimensions, in Box2D units
+	 * @param  cellSize  The side of one cell, in Box2D units
+	 *
+	 * @return true if the grid is non-empty
+	 */
+	bool init(const Size& size, float cellSize = FLOW_FIELD_CELL);
+
+	/**
+	 * Blocks every cell whose center lies within a box grown by a margin.
+	 *
+	 * All boxes must be added before the first target is set.
+	 *
+	 * @param  center     The center of the box, in Box2D units
+	 * @param  size       The dimensions of the box, in Box2D units
+	 * @param  clearance  The margin kept around the box, in Box2D units
+	 */
+	void addBox(const Vec2& center, const Size& size, float clearance);
+
+	/**
+	 * Stops the workers and releases every field.
+	 *
+	 * This blocks until any search in progress is done.
+	 */
+	void dispose();
+
+	/**
+	 * Adds a target with no field yet.
+	 *
+	 * @return the handle of the target
+	 */
+	int addTarget();
+
+	/**
+	 * Moves a target, recomputing its field if it changed cells.
+	 *
+	 * If the worker is still busy with the target's last field, the new
+	 * cell is remembered and searched once update() finds the worker done.
+	 *
+	 * @param  target  The handle of the target
+	 * @param  pos     The new position of the target, in Box2D units
+	 */
+	void setTarget(int target, const b2Vec2& pos);
+
+	/** Starts the searches that were waiting for a worker to finish. */
+	void update();
+
+	/** Returns whether a target has a field to sample */
+	bool isReady(int target) const { return _targets[target]->front.load(std::memory_order_acquire) >= 0; }
+
+	/**
+	 * Returns the direction toward a target from a point.
+	 *
+	 * The direction is a unit vector along one of the eight grid
+	 * directions, or zero if the target has no field yet, the point is in
+	 * the target cell, or the target cannot be reached from the point.
+	 *
+	 * @param  target  The handle of the target
+	 * @param  pos     The point to steer from, in Box2D units
+	 */
+	b2Vec2 sample(int target, const b2Vec2& pos) const;
+
+	/**
+	 * Returns the buffer a target's movers sample now, or -1 if none.
+	 *
+	 * A published buffer is not written again until the game thread starts
+	 * another search for the target, so a pass that samples a latched
+	 * buffer sees the same field throughout, from any thread.
+	 */
+	int getFront(int target) const { return _targets[target]->front.load(std::memory_order_acquire); }
+
+	/**
+	 * Returns the direction toward a target from a point, in a given buffer.
+	 *
+	 * @param  target  The handle of the target
+	 * @param  front   A buffer returned by getFront(), which must not be -1
+	 * @param  pos     The point to steer from, in Box2D units
+	 */
+	b2Vec2 sample(int target, int front, const b2Vec2& pos) const;
+};
+
+#endif /* __FLOW_FIELD_H__ */
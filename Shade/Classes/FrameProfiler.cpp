@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "FrameProfiler.h"
+
+/** Display names of the phases, indexed by FrameProfiler::Phase */
+static const char* PHASE_NAMES[FrameProfiler::PHASE_COUNT] = {
+	"input", "movers", "physics", "ai", "exposure", "scene", "render"
+};
+
+const char* FrameProfiler::phaseName(Phase phase) {
+	return PHASE_NAMES[phase];
+}
+
+void FrameProfiler::setEnabled(bool value) {
+	if (value && !_enabled) {
+		_epoch = current_time();
+		_published.store(0, std::memory_order_release);
+	}
+	_enabled = value;
+	_inFrame = false;
+}
+
+void FrameProfiler::beginFrame() {
+	if (!_enabled) {
+		return;
+	}
+	_frameStart = current_time();
+	_current.start = elapsed_micros(_epoch, _frameStart);
+	memset(_current.offset, 0, sizeof(_current.offset));
+	memset(_current.duration, 0, sizeof(_current.duration));
+	memset(_discount, 0, sizeof(_discount));
+	_inFrame = true;
+}
+
+void FrameProfiler::endFrame() {
+	if (!_inFrame) {
+		return;
+	}
+	unsigned int frame = _published.load(std::memory_order_relaxed);
+	_frames[frame % PROFILER_FRAMES] = _current;
+	_published.store(frame + 1, std::memory_order_release);
+	_inFrame = false;
+}
+
+void FrameProfiler::record(Phase phase, timestamp_t start, timestamp_t end) {
+	if (!_inFrame) {
+		return;
+	}
+	if (_current.duration[phase] == 0) {
+		_current.offset[phase] = elapsed_micros(_frameStart, start);
+	}
+	_current.duration[phase] += elapsed_micros(start, end) - _discount[phase];
+	_discount[phase] = 0;
+}
+
+void FrameProfiler::discount(Phase phase, timestamp_t start, timestamp_t end) {
+	if (_inFrame) {
+		_discount[phase] += elapsed_micros(start, end);
+	}
+}
+
+int FrameProfiler::getFrameCount() const {
+	unsigned int published = _published.load(std::memory_order_acquire);
+	return (int)std::min(published, (unsigned int)PROFILER_FRAMES);
+}
+
+bool FrameProfiler::getFrame(int ago, FrameRecord& frame) const {
+	unsigned int published = _published.load(std::memory_order_acquire);
+	if (ago < 0 || (unsigned int)ago >= published || ago >= PROFILER_FRAMES) {
+		return false;
+	}
+	unsigned int index = published - 1 - ago;
+	frame = _frames[index % PROFILER_FRAMES];
+
+	// The slot is reused by frame index + PROFILER_FRAMES; reject the copy
+	// if the writer may have reached it in the meantime
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return _published.load(std::memory_order_relaxed) - index < PROFILER_FRAMES;
+}
+
+int FrameProfiler::getAverages(int frames, double* means) const {
+	long totals[PHASE_COUNT] = { 0 };
+	FrameRecord frame;
+	int count = 0;
+	for (int ago = 0; ago < frames && getFrame(ago, frame); ago++) {
+		for (int ii = 0; ii < PHASE_COUNT; ii++) {
+			totals[ii] += frame.duration[ii];
+		}
+		count++;
+	}
+	for (int ii = 0; ii < PHASE_COUNT; ii++) {
+		means[ii] = count > 0 ? totals[ii] / (1000.0 * count) : 0.0;
+	}
+	return count;
+}
+
+std::string FrameProfiler::getSummary() const {
+	double means[PHASE_COUNT];
+	int count = getAverages(PROFILER_AVERAGE_FRAMES, means);
+	double total = 0.0;
+	std::string summary;
+	char line[64];
+	for (int ii = 0; ii < PHASE_COUNT; ii++) {
+		snprintf(line, sizeof(line), "%-9s %6.2f ms\n", PHASE_NAMES[ii], means[ii]);
+		summary += line;
+		total += means[ii];
+	}
+	snprintf(line, sizeof(line), "%-9s %6.2f ms (%d frames)", "total", total, count);
+	summary += line;
+	return summary;
+}
+
+bool FrameProfiler::exportCSV(const std::string& path) const {
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		return false;
+	}
+	fprintf(file, "frame,start_us");
+	for (int ii = 0; ii < PHASE_COUNT; ii++) {
+		fprintf(file, ",%s_us", PHASE_NAMES[ii]);
+	}
+	fprintf(file, "\n");
+
+	FrameRecord frame;
+	int count = getFrameCount();
+	for (int ago = count - 1; ago >= 0; ago--) {
+		if (!getFrame(ago, frame)) {
+			continue;
+		}
+		fprintf(file, "%d,%ld", count - 1 - ago, frame.start);
+		for (int ii = 0; ii < PHASE_COUNT; ii++) {
+			fprintf(file, ",%ld", frame.duration[ii]);
+		}
+		fprintf(file, "\n");
+	}
+	return fclose(file) == 0;
+}
+
+bool FrameProfiler::exportTrace(const std::string& path) const {
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		return false;
+	}
+
+	// Complete ("X") events; every phase nests inside its frame event
+	const char* format = "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%ld,\"dur\":%ld,\"pid\":1,\"tid\":1}";
+	const char* separator = "";
+	fprintf(file, "{\"traceEvents\":[");
+	FrameRecord frame;
+	for (int ago = getFrameCount() - 1; ago >= 0; ago--) {
+		if (!getFrame(ago, frame)) {
+			continue;
+		}
+		long end = 0;
+		for (int ii = 0; ii < PHASE_COUNT; ii++) {
+			end = std::max(end, frame.offset[ii] + frame.duration[ii]);
+		}
+		fprintf(file, format, separator, "frame", frame.start, end);
+		separator = ",";
+		for (int ii = 0; ii < PHASE_COUNT; ii++) {
+			if (frame.duration[ii] > 0) {
+				fprintf(file, format, separator, PHASE_NAMES[ii], frame.start + frame.offset[ii], frame.duration[ii]);
+			}
+		}
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	return fclose(file) == 0;
+}
@@ -0,0 +1,199 @@
+#ifndef __FRAME_PROFILER_H__
+#define __FRAME_PROFILER_H__
+
+#include <atomic>
+#include <string>
+#include <cornell/CUTimestamp.h>
+
+/** Set to 0 to compile every PROFILE_SCOPE out of the build */
+#ifndef SHADE_PROFILING
+#define SHADE_PROFILING 1
+#endif
+
+/** The number of frames kept in the ring buffer (must be a power of two) */
+#define PROFILER_FRAMES 512
+/** The number of frames averaged by the on-screen overlay */
+#define PROFILER_AVERAGE_FRAMES 60
+
+using namespace cocos2d;
+
+/**
+ * Per-phase timing of the gameplay frame.
+ *
+ * The game thread opens a frame with beginFrame(), times each phase with a
+ * ProfileScope, and publishes the frame with endFrame(). Published frames
+ * go into a fixed ring buffer indexed by an atomic frame counter, so there
+ * is no allocation or locking on the game thread. Readers on other threads
+ * copy a frame and then check the counter again; if the writer lapped them
+ * during the copy, the frame is reported as unavailable.
+ *
+ * When the profiler is disabled every scope reduces to a single branch, and
+ * with SHADE_PROFILING set to 0 the scopes are not compiled at all.
+ */
+class FrameProfiler {
+public:
+	/** The phases of a frame, in the order they run */
+	enum Phase {
+		INPUT,
+		MOVERS,
+		PHYSICS,
+		AI,
+		EXPOSURE,
+		SCENE,
+		RENDER,
+		PHASE_COUNT
+	};
+
+	/** The timing of one frame, in microseconds */
+	struct FrameRecord {
+		/** The start of the frame, relative to the profiler epoch */
+		long start;
+		/** The start of each phase, relative to the start of the frame */
+		long offset[PHASE_COUNT];
+		/** The duration of each phase; 0 if the phase did not run */
+		long duration[PHASE_COUNT];
+	};
+
+private:
+	/** The published frames; frame n lives at index n % PROFILER_FRAMES */
+	FrameRecord _frames[PROFILER_FRAMES];
+	/** The number of frames published so far */
+	std::atomic<unsigned int> _published;
+	/** The frame being recorded */
+	FrameRecord _current;
+	/** The time to take out of each phase when it is next recorded */
+	long _discount[PHASE_COUNT];
+	/** The time beginFrame() was last called */
+	timestamp_t _frameStart;
+	/** The time the profiler was enabled; all records are relative to it */
+	timestamp_t _epoch;
+	/** Whether frames are being recorded */
+	bool _enabled;
+	/** Whether a frame has begun and not yet ended */
+	bool _inFrame;
+
+public:
+	FrameProfiler() : _published(0), _enabled(false), _inFrame(false) {}
+
+	/** Returns the display name of a phase */
+	static const char* phaseName(Phase phase);
+
+	/** Returns whether frames are being recorded */
+	bool isEnabled() const { return _enabled; }
+
+	/**
+	 * Sets whether frames are being recorded.
+	 *
+	 * Enabling the profiler discards any previously recorded frames.
+	 *
+	 * @param  value  whether to record frames
+	 */
+	void setEnabled(bool value);
+
+	/** Opens a new frame. Any unfinished frame is discarded. */
+	void beginFrame();
+
+	/** Publishes the current frame, if there is one. */
+	void endFrame();
+
+	/** Returns whether a frame has begun and not yet ended */
+	bool inFrame() const { return _inFrame; }
+
+	/**
+	 * Adds a measured interval to a phase of the current frame.
+	 *
+	 * A phase measured more than once in a frame keeps its first start
+	 * and accumulates its duration.
+	 *
+	 * @param  phase  The phase measured
+	 * @param  start  The start of the interval
+	 * @param  end    The end of the interval
+	 */
+	void record(Phase phase, timestamp_t start, timestamp_t end);
+
+	/**
+	 * Takes an interval out of a phase whose scope is still open.
+	 *
+	 * This is for work that runs inside another phase, such as the mover
+	 * actions inside the physics step, and is recorded as its own phase.
+	 *
+	 * @param  phase  The enclosing phase
+	 * @param  start  The start of the interval
+	 * @param  end    The end of the interval
+	 */
+	void discount(Phase phase, timestamp_t start, timestamp_t end);
+
+	/** Returns the number of frames available to read */
+	int getFrameCount() const;
+
+	/**
+	 * Copies a published frame.
+	 *
+	 * @param  ago    How many frames back to read; 0 is the latest frame
+	 * @param  frame  The record to copy into
+	 *
+	 * @return false if the frame is not (or no longer) in the buffer
+	 */
+	bool getFrame(int ago, FrameRecord& frame) const;
+
+	/**
+	 * Computes the mean duration of each phase over the latest frames.
+	 *
+	 * @param  frames  The number of frames to average
+	 * @param  means   Receives PHASE_COUNT means, in milliseconds
+	 *
+	 * @return the number of frames actually averaged
+	 */
+	int getAverages(int frames, double* means) const;
+
+	/** Returns a multi-line summary of the latest frames for the overlay */
+	std::string getSummary() const;
+
+	/** Writes the buffered frames as CSV, one row per frame. */
+	bool exportCSV(const std::string& path) const;
+
+	/** Writes the buffered frames in the Chrome trace event format. */
+	bool exportTrace(const std::string& path) const;
+};
+
+/**
+ * Times the enclosing block as one phase of the current frame.
+ *
+ * If the profiler is disabled when the scope opens, nothing is measured.
+ */
+class ProfileScope {
+private:
+	/** The profiler to record to, or nullptr if disabled */
+	FrameProfiler* _profiler;
+	/** The phase being timed */
+	FrameProfiler::Phase _phase;
+	/** The time the scope opened */
+	timestamp_t _start;
+
+public:
+	ProfileScope(FrameProfiler& profiler, FrameProfiler::Phase phase) :
+		_profiler(profiler.isEnabled() ? &profiler : nullptr), _phase(phase) {
+		if (_profiler != nullptr) {
+			_start = current_time();
+		}
+	}
+
+	~ProfileScope() {
+		if (_profiler != nullptr) {
+			_profiler->record(_phase, _start, current_time());
+		}
+	}
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if SHADE_PROFILING
+/** Times the rest of the enclosing block as the given phase */
+#define PROFILE_SCOPE(profiler, phase) \
+	ProfileScope PROFILE_CONCAT(_profile_scope_, __LINE__)((profiler), FrameProfiler::phase)
+#else
+#define PROFILE_SCOPE(profiler, phase)
+#endif
+
+#endif /* __FRAME_PROFILER_H__ */
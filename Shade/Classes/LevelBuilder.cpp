@@ -0,0 +1,100 @@
+#include "LevelBuilder.h"
+#include "C_Gameplay.h"
+
+/** Adds the walls around the level */
+static void addWalls(LevelInstance* level, const LevelBuilder::ObstacleAdder& add) {
+	const Size& size = level->_size;
+	Rect walls[4] = {
+		Rect(0.0f, 0.0f, WALL_THICKNESS, size.height),
+		Rect(size.width - WALL_THICKNESS, 0.0f, WALL_THICKNESS, size.height),
+		Rect(WALL_THICKNESS, 0.0f, size.width - WALL_THICKNESS * 2, WALL_THICKNESS),
+		Rect(WALL_THICKNESS, size.height - WALL_THICKNESS, size.width - WALL_THICKNESS * 2, WALL_THICKNESS)
+	};
+	for (const Rect& wall : walls) {
+		BoxObstacle* wallobj = BoxObstacle::create(Vec2(wall.getMidX(), wall.getMidY()), wall.size, &GameController::objectFilter);
+		wallobj->setBodyType(b2_staticBody);
+		wallobj->setDensity(BASIC_DENSITY);
+		wallobj->setFriction(BASIC_FRICTION);
+		wallobj->setRestitution(BASIC_RESTITUTION);
+		add(wallobj, WALL_Z);
+	}
+}
+
+WheelObstacle* LevelBuilder::populate(LevelInstance* level, const FrameSizer& frame, const ObstacleAdder& add) {
+	addWalls(level, add);
+	Vec2 scale(BOX2D_SCALE, BOX2D_SCALE);
+	Size size;
+
+	// Goal door
+	BoxObstacle* caster = level->_casterPos.object->getObject();
+	size = frame(GOAL_TEXTURE, CASTER_ROWS, CASTER_COLS);
+	caster->init(level->_casterPos.position,
+		Size(size.width / (CASTER_SCALE_DOWN * scale.x), size.height / (CASTER_SCALE_DOWN * scale.y)),
+		&GameController::casterFilter);
+	add(caster, CASTER_Z);
+
+	// Dude
+	Shadow* player = level->_playerPos.object;
+	player->initWithFrame(level->_playerPos.position, frame(DUDE_TEXTURE, PLAYER_ROWS, PLAYER_COLS),
+		scale * DUDE_SCALE, &GameController::characterFilter, &GameController::characterSensorFilter);
+	add(player, PLAYER_Z);
+
+	// Buildings
+	for (LevelInstance::StaticObjectMetadata &d : level->_staticObjects) {
+		Size oframe = frame(d.type + OBJECT_TAG, 1, 1);
+		Size sframe = frame(d.type + SHADOW_TAG, 1, 1);
+		if (oframe.equals(Size::ZERO) || sframe.equals(Size::ZERO)) {
+			CCLOG("Unknown static object type %s", d.type.c_str());
+			continue;
+		}
+		Vec2 offset = { oframe.width / (scale.x * -5.0f), oframe.height / (scale.y * 4.0f) };
+		d.object->init(d.position + offset, Size(oframe.width / scale.x, oframe.height / scale.y), &GameController::objectFilter);
+		d.shadow->init(d.position, Size(sframe.width / scale.x, sframe.height / scale.y), &GameController::staticShadowFilter);
+		d.object->setBodyType(b2_staticBody);
+		d.shadow->setBodyType(b2_staticBody);
+		add(d.object, BUILDING_OBJECT_Z);
+		add(d.shadow, BUILDING_SHADOW_Z);
+		d.shadow->getBody()->SetUserData(d.shadow);
+	}
+
+	// Building shadows only touch the latch, cover comes from the baked field
+	level->bakeShadowField();
+	level->buildNavMesh();
+	level->buildOccluders();
+	player->setShadowField(&(level->_shadowField));
+
+	// Movers
+	for (LevelInstance::PedestrianMetadata &pd : level->_pedestrians) {
+		size = frame(PEDESTRIAN_TEXTURE, 1, 1);
+		pd.object->getObject()->init(pd.position, Size(size.width / (scale.x * PEDESTRIAN_SCALE_DOWN * 2),
+			size.height / (scale.y * PEDESTRIAN_SCALE_DOWN * 1.5)), &GameController::pedestrianFilter);
+		size = frame(PEDESTRIAN_SHADOW_TEXTURE, 1, 1);
+		pd.object->getShadow()->init(pd.position, Size(size.width / (scale.x * PEDESTRIAN_SCALE_DOWN),
+			size.height / (scale.y * PEDESTRIAN_SCALE_DOWN)), &GameController::shadowFilter);
+		add(pd.object->getObject(), PEDESTRIAN_OBJECT_Z);
+		pd.object->getObject()->getBody()->GetFixtureList()->SetUserData(pd.object);
+		add(pd.object->getShadow(), PEDESTRIAN_SHADOW_Z);
+		pd.object->getShadow()->getBody()->SetUserData(pd.object->getShadow());
+	}
+
+	for (LevelInstance::CarMetadata &pd : level->_cars) {
+		size = frame(CAR_TEXTURE, CAR_ROWS, CAR_COLS);
+		pd.object->getObject()->init(pd.position, Size(size.width / (scale.x * CAR_SCALE_DOWN),
+			size.height / (scale.y * CAR_SCALE_DOWN)), &GameController::shadowFilter);
+		add(pd.object->getObject(), CAR_OBJECT_Z);
+		pd.object->getObject()->getBody()->SetUserData(pd.object->getShadow()); // TODO get rid of this when car is actually made into a non-shadow
+		size = frame(CAR_SHADOW_TEXTURE, 1, 1);
+		pd.object->getShadow()->init(pd.position, Size(size.width / (scale.x * CAR_SCALE_DOWN),
+			size.height / (scale.y * CAR_SCALE_DOWN)), &GameController::shadowFilter);
+		add(pd.object->getShadow(), CAR_SHADOW_Z);
+		pd.object->getShadow()->getBody()->SetUserData(pd.object->getShadow());
+	}
+
+	WheelObstacle* latch = WheelObstacle::create(Vec2(0.01f, 0.01f), 0.0001f, &(PhysicsController::emptyFilter));
+	latch->setSensor(true);
+	add(latch, LATCH_Z);
+
+	// Every mover body exists now, so the registry can cache them
+	level->_movers.bindBodies();
+	return latch;
+}
@@ -0,0 +1,62 @@
+#ifndef __LEVEL_BUILDER_H__
+#define __LEVEL_BUILDER_H__
+
+#include <functional>
+#include <string>
+#include <cocos2d.h>
+#include <cornell.h>
+#include <cornell/CUWheelObstacle.h>
+#include <M_LevelInstance.h>
+
+/** Z-levels for the obstacle nodes */
+#define WALL_Z 1
+#define PEDESTRIAN_SHADOW_Z 4
+#define BUILDING_SHADOW_Z 5
+#define CAR_SHADOW_Z 6
+#define PLAYER_Z 7
+#define LATCH_Z 7
+#define PEDESTRIAN_OBJECT_Z 8
+#define BUILDING_OBJECT_Z 9
+#define CAR_OBJECT_Z 10
+#define CASTER_Z 11
+
+using namespace cocos2d;
+
+/**
+ * Creates every body of a level, for GameController and SimulationController.
+ *
+ * The bodies are sized from the sprites, but the builder never touches a
+ * texture or scene node. The caller reports the pixel size of each sprite
+ * and adds each obstacle to its world, along with any scene node, so the
+ * game and the headless simulation build exactly the same world.
+ */
+class LevelBuilder {
+public:
+	/**
+	 * Returns the size of one frame of a sprite, in pixels.
+	 *
+	 * The sprite is named by its texture key, as in GameController. A
+	 * zero size means the sprite is unknown, and its object is left out.
+	 */
+	typedef std::function<Size(const std::string& texture, int rows, int cols)> FrameSizer;
+
+	/** Adds an initialized obstacle to the world, drawn at the given z-level */
+	typedef std::function<void(Obstacle* obj, int zOrder)> ObstacleAdder;
+
+	/**
+	 * Creates the walls, caster, character, buildings and movers of a level.
+	 *
+	 * The obstacles of the level are initialized and passed to add() in
+	 * drawing order, and once the buildings exist the shadow field,
+	 * navigation mesh and occluders of the level are built.
+	 *
+	 * @param  level  The level, loaded but not populated
+	 * @param  frame  Reports the pixel size of a sprite
+	 * @param  add    Adds each obstacle to the world
+	 *
+	 * @return the latch marker, which has been added to the world
+	 */
+	static WheelObstacle* populate(LevelInstance* level, const FrameSizer& frame, const ObstacleAdder& add);
+};
+
+#endif /* __LEVEL_BUILDER_H__ */
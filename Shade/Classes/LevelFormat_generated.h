@@ -0,0 +1,211 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+#ifndef FLATBUFFERS_GENERATED_LEVELFORMAT_SHADELEVEL_H_
+#define FLATBUFFERS_GENERATED_LEVELFORMAT_SHADELEVEL_H_
+
+#include "flatbuffers/flatbuffers.h"
+
+
+namespace ShadeLevel {
+
+struct Point;
+struct Action;
+struct StaticObject;
+struct Mover;
+struct Level;
+
+MANUALLY_ALIGNED_STRUCT(4) Point {
+ private:
+  float x_;
+  float y_;
+
+ public:
+  Point(float x, float y)
+    : x_(flatbuffers::EndianScalar(x)), y_(flatbuffers::EndianScalar(y)) { }
+
+  float x() const { return flatbuffers::EndianScalar(x_); }
+  float y() const { return flatbuffers::EndianScalar(y_); }
+};
+STRUCT_END(Point, 8);
+
+MANUALLY_ALIGNED_STRUCT(4) Action {
+ private:
+  int32_t type_;
+  int32_t length_;
+  int32_t counter_;
+  float bearing_;
+  Point target_;
+
+ public:
+  Action(int32_t type, int32_t length, int32_t counter, float bearing, const Point &target)
+    : type_(flatbuffers::EndianScalar(type)), length_(flatbuffers::EndianScalar(length)), counter_(flatbuffers::EndianScalar(counter)), bearing_(flatbuffers::EndianScalar(bearing)), target_(target) { }
+
+  int32_t type() const { return flatbuffers::EndianScalar(type_); }
+  int32_t length() const { return flatbuffers::EndianScalar(length_); }
+  int32_t counter() const { return flatbuffers::EndianScalar(counter_); }
+  float bearing() const { return flatbuffers::EndianScalar(bearing_); }
+  const Point &target() const { return target_; }
+};
+STRUCT_END(Action, 24);
+
+MANUALLY_ALIGNED_STRUCT(4) StaticObject {
+ private:
+  Point position_;
+  int32_t type_;
+
+ public:
+  StaticObject(const Point &position, int32_t type)
+    : position_(position), type_(flatbuffers::EndianScalar(type)) { }
+
+  const Point &position() const { return position_; }
+  int32_t type() const { return flatbuffers::EndianScalar(type_); }
+};
+STRUCT_END(StaticObject, 12);
+
+struct Mover : private flatbuffers::Table {
+  const Point *position() const { return GetStruct<const Point *>(4); }
+  float heading() const { return GetField<float>(6, 0); }
+  int32_t cycleStart() const { return GetField<int32_t>(8, -1); }
+  const flatbuffers::Vector<const Action *> *actions() const { return GetPointer<const flatbuffers::Vector<const Action *> *>(10); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<Point>(verifier, 4 /* position */) &&
+           VerifyField<float>(verifier, 6 /* heading */) &&
+           VerifyField<int32_t>(verifier, 8 /* cycleStart */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 10 /* actions */) &&
+           verifier.Verify(actions()) &&
+           verifier.EndTable();
+  }
+};
+
+struct MoverBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_position(const Point *position) { fbb_.AddStruct(4, position); }
+  void add_heading(float heading) { fbb_.AddElement<float>(6, heading, 0); }
+  void add_cycleStart(int32_t cycleStart) { fbb_.AddElement<int32_t>(8, cycleStart, -1); }
+  void add_actions(flatbuffers::Offset<flatbuffers::Vector<const Action *>> actions) { fbb_.AddOffset(10, actions); }
+  MoverBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  MoverBuilder &operator=(const MoverBuilder &);
+  flatbuffers::Offset<Mover> Finish() {
+    auto o = flatbuffers::Offset<Mover>(fbb_.EndTable(start_, 4));
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Mover> CreateMover(flatbuffers::FlatBufferBuilder &_fbb,
+   const Point *position = 0,
+   float heading = 0,
+   int32_t cycleStart = -1,
+   flatbuffers::Offset<flatbuffers::Vector<const Action *>> actions = 0) {
+  MoverBuilder builder_(_fbb);
+  builder_.add_actions(actions);
+  builder_.add_cycleStart(cycleStart);
+  builder_.add_heading(heading);
+  builder_.add_position(position);
+  return builder_.Finish();
+}
+
+struct Level : private flatbuffers::Table {
+  int32_t version() const { return GetField<int32_t>(4, 0); }
+  int32_t index() const { return GetField<int32_t>(6, 0); }
+  const flatbuffers::String *name() const { return GetPointer<const flatbuffers::String *>(8); }
+  const Point *size() const { return GetStruct<const Point *>(10); }
+  const Point *player() const { return GetStruct<const Point *>(12); }
+  const Point *caster() const { return GetStruct<const Point *>(14); }
+  float casterHeading() const { return GetField<float>(16, 0); }
+  const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *types() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *>(18); }
+  const flatbuffers::Vector<const StaticObject *> *staticObjects() const { return GetPointer<const flatbuffers::Vector<const StaticObject *> *>(20); }
+  const flatbuffers::Vector<flatbuffers::Offset<Mover>> *pedestrians() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Mover>> *>(22); }
+  const flatbuffers::Vector<flatbuffers::Offset<Mover>> *cars() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Mover>> *>(24); }
+  const flatbuffers::String *imageFormat() const { return GetPointer<const flatbuffers::String *>(26); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int32_t>(verifier, 4 /* version */) &&
+           VerifyField<int32_t>(verifier, 6 /* index */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 8 /* name */) &&
+           verifier.Verify(name()) &&
+           VerifyField<Point>(verifier, 10 /* size */) &&
+           VerifyField<Point>(verifier, 12 /* player */) &&
+           VerifyField<Point>(verifier, 14 /* caster */) &&
+           VerifyField<float>(verifier, 16 /* casterHeading */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 18 /* types */) &&
+           verifier.Verify(types()) &&
+           verifier.VerifyVectorOfStrings(types()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 20 /* staticObjects */) &&
+           verifier.Verify(staticObjects()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 22 /* pedestrians */) &&
+           verifier.Verify(pedestrians()) &&
+           verifier.VerifyVectorOfTables(pedestrians()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 24 /* cars */) &&
+           verifier.Verify(cars()) &&
+           verifier.VerifyVectorOfTables(cars()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 26 /* imageFormat */) &&
+           verifier.Verify(imageFormat()) &&
+           verifier.EndTable();
+  }
+};
+
+struct LevelBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_version(int32_t version) { fbb_.AddElement<int32_t>(4, version, 0); }
+  void add_index(int32_t index) { fbb_.AddElement<int32_t>(6, index, 0); }
+  void add_name(flatbuffers::Offset<flatbuffers::String> name) { fbb_.AddOffset(8, name); }
+  void add_size(const Point *size) { fbb_.AddStruct(10, size); }
+  void add_player(const Point *player) { fbb_.AddStruct(12, player); }
+  void add_caster(const Point *caster) { fbb_.AddStruct(14, caster); }
+  void add_casterHeading(float casterHeading) { fbb_.AddElement<float>(16, casterHeading, 0); }
+  void add_types(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>> types) { fbb_.AddOffset(18, types); }
+  void add_staticObjects(flatbuffers::Offset<flatbuffers::Vector<const StaticObject *>> staticObjects) { fbb_.AddOffset(20, staticObjects); }
+  void add_pedestrians(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Mover>>> pedestrians) { fbb_.AddOffset(22, pedestrians); }
+  void add_cars(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Mover>>> cars) { fbb_.AddOffset(24, cars); }
+  void add_imageFormat(flatbuffers::Offset<flatbuffers::String> imageFormat) { fbb_.AddOffset(26, imageFormat); }
+  LevelBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  LevelBuilder &operator=(const LevelBuilder &);
+  flatbuffers::Offset<Level> Finish() {
+    auto o = flatbuffers::Offset<Level>(fbb_.EndTable(start_, 12));
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Level> CreateLevel(flatbuffers::FlatBufferBuilder &_fbb,
+   int32_t version = 0,
+   int32_t index = 0,
+   flatbuffers::Offset<flatbuffers::String> name = 0,
+   const Point *size = 0,
+   const Point *player = 0,
+   const Point *caster = 0,
+   float casterHeading = 0,
+   flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>> types = 0,
+   flatbuffers::Offset<flatbuffers::Vector<const StaticObject *>> staticObjects = 0,
+   flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Mover>>> pedestrians = 0,
+   flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Mover>>> cars = 0,
+   flatbuffers::Offset<flatbuffers::String> imageFormat = 0) {
+  LevelBuilder builder_(_fbb);
+  builder_.add_imageFormat(imageFormat);
+  builder_.add_cars(cars);
+  builder_.add_pedestrians(pedestrians);
+  builder_.add_staticObjects(staticObjects);
+  builder_.add_types(types);
+  builder_.add_casterHeading(casterHeading);
+  builder_.add_caster(caster);
+  builder_.add_player(player);
+  builder_.add_size(size);
+  builder_.add_name(name);
+  builder_.add_index(index);
+  builder_.add_version(version);
+  return builder_.Finish();
+}
+
+inline const Level *GetLevel(const void *buf) { return flatbuffers::GetRoot<Level>(buf); }
+
+inline bool VerifyLevelBuffer(flatbuffers::Verifier &verifier) { return verifier.VerifyBuffer<Level>(); }
+
+inline void FinishLevelBuffer(flatbuffers::FlatBufferBuilder &fbb, flatbuffers::Offset<Level> root) { fbb.Finish(root, "SHDB"); }
+
+inline bool LevelBufferHasIdentifier(const void *buf) { return flatbuffers::BufferHasIdentifier(buf, "SHDB"); }
+
+}  // namespace ShadeLevel
+
+#endif  // FLATBUFFERS_GENERATED_LEVELFORMAT_SHADELEVEL_H_
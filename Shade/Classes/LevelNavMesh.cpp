@@ -0,0 +1,161 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "recast/Recast/Recast.h"
+#include "recast/Detour/DetourNavMeshBuilder.h"
+#include "recast/Detour/DetourAlloc.h"
+#include "LevelNavMesh.h"
+
+/** The height of one voxel of the build; the level is flat, so any will do */
+#define NAV_CELL_HEIGHT 0.2f
+/** The depth below and above the ground covered by the build, in Box2D units */
+#define NAV_GROUND_DEPTH 1.0f
+/** Regions smaller than this, in voxels, are dropped */
+#define NAV_MIN_REGION_AREA 8
+/** Regions smaller than this, in voxels, are merged into their neighbours */
+#define NAV_MERGE_REGION_AREA 20
+/** How far a simplified contour may stray from the voxel border, in voxels */
+#define NAV_MAX_CONTOUR_ERROR 1.3f
+/** The spacing of the detail mesh samples; Recast needs one even on flat ground */
+#define NAV_DETAIL_SAMPLE_DISTANCE (6.0f * NAV_CELL_SIZE)
+
+/** The intermediate Recast results of a build, released on every exit */
+struct NavBuild {
+	rcContext context;
+	rcHeightfield* solid;
+	rcCompactHeightfield* compact;
+	rcContourSet* contours;
+	rcPolyMesh* mesh;
+	rcPolyMeshDetail* detail;
+
+	NavBuild() : context(false), solid(nullptr), compact(nullptr), contours(nullptr),
+		mesh(nullptr), detail(nullptr) {}
+
+	~NavBuild() {
+		rcFreeHeightField(solid);
+		rcFreeCompactHeightfield(compact);
+		rcFreeContourSet(contours);
+		rcFreePolyMesh(mesh);
+		rcFreePolyMeshDetail(detail);
+	}
+};
+
+void LevelNavMesh::addBox(const Vec2& center, const Size& size) {
+	_obstacles.push_back(center.x - size.width * 0.5f);
+	_obstacles.push_back(center.y - size.height * 0.5f);
+	_obstacles.push_back(center.x + size.width * 0.5f);
+	_obstacles.push_back(center.y + size.height * 0.5f);
+}
+
+bool LevelNavMesh::build(const Size& size, float radius) {
+	if (_navMesh != nullptr) {
+		dtFreeNavMesh(_navMesh);
+		_navMesh = nullptr;
+	}
+	if (size.width <= 0.0f || size.height <= 0.0f) {
+		return false;
+	}
+	_size = size;
+
+	const float bmin[3] = { 0.0f, -NAV_GROUND_DEPTH, 0.0f };
+	const float bmax[3] = { size.width, NAV_GROUND_DEPTH, size.height };
+	int width = 0;
+	int height = 0;
+	rcCalcGridSize(bmin, bmax, NAV_CELL_SIZE, &width, &height);
+	const int walkableHeight = 2;
+	const int walkableClimb = 1;
+	const int walkableRadius = (int)ceilf(radius / NAV_CELL_SIZE);
+
+	// Rasterize the ground as two upward-facing triangles
+	NavBuild nav;
+	nav.solid = rcAllocHeightfield();
+	if (nav.solid == nullptr || !rcCreateHeightfield(&nav.context, *nav.solid, width, height, bmin, bmax, NAV_CELL_SIZE, NAV_CELL_HEIGHT)) {
+		return false;
+	}
+	const float ground[12] = {
+		0.0f, 0.0f, 0.0f,
+		size.width, 0.0f, 0.0f,
+		size.width, 0.0f, size.height,
+		0.0f, 0.0f, size.height
+	};
+	const int tris[6] = { 0, 3, 2, 0, 2, 1 };
+	const unsigned char areas[2] = { RC_WALKABLE_AREA, RC_WALKABLE_AREA };
+	rcRasterizeTriangles(&nav.context, ground, 4, tris, areas, 2, *nav.solid, walkableClimb);
+
+	nav.compact = rcAllocCompactHeightfield();
+	if (nav.compact == nullptr || !rcBuildCompactHeightfield(&nav.context, walkableHeight, walkableClimb, *nav.solid, *nav.compact)) {
+		return false;
+	}
+
+	// Cut out the buildings, then grow the cut-outs by the agent radius
+	for (size_t ii = 0; ii + 3 < _obstacles.size(); ii += 4) {
+		const float omin[3] = { _obstacles[ii], -NAV_GROUND_DEPTH, _obstacles[ii + 1] };
+		const float omax[3] = { _obstacles[ii + 2], NAV_GROUND_DEPTH, _obstacles[ii + 3] };
+		rcMarkBoxArea(&nav.context, omin, omax, RC_NULL_AREA, *nav.compact);
+	}
+	if (!rcErodeWalkableArea(&nav.context, walkableRadius, *nav.compact)
+		|| !rcBuildDistanceField(&nav.context, *nav.compact)
+		|| !rcBuildRegions(&nav.context, *nav.compact, 0, NAV_MIN_REGION_AREA, NAV_MERGE_REGION_AREA)) {
+		return false;
+	}
+
+	nav.contours = rcAllocContourSet();
+	nav.mesh = rcAllocPolyMesh();
+	nav.detail = rcAllocPolyMeshDetail();
+	if (nav.contours == nullptr || nav.mesh == nullptr || nav.detail == nullptr
+		|| !rcBuildContours(&nav.context, *nav.compact, NAV_MAX_CONTOUR_ERROR, 0, *nav.contours)
+		|| !rcBuildPolyMesh(&nav.context, *nav.contours, NAV_VERTS_PER_POLY, *nav.mesh)
+		|| !rcBuildPolyMeshDetail(&nav.context, *nav.mesh, *nav.compact, NAV_DETAIL_SAMPLE_DISTANCE, NAV_CELL_HEIGHT, *nav.detail)
+		|| nav.mesh->npolys == 0) {
+		return false;
+	}
+	for (int ii = 0; ii < nav.mesh->npolys; ii++) {
+		nav.mesh->flags[ii] = nav.mesh->areas[ii] == RC_WALKABLE_AREA ? NAV_FLAG_WALK : 0;
+	}
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = nav.mesh->verts;
+	params.vertCount = nav.mesh->nverts;
+	params.polys = nav.mesh->polys;
+	params.polyAreas = nav.mesh->areas;
+	params.polyFlags = nav.mesh->flags;
+	params.polyCount = nav.mesh->npolys;
+	params.nvp = nav.mesh->nvp;
+	params.detailMeshes = nav.detail->meshes;
+	params.detailVerts = nav.detail->verts;
+	params.detailVertsCount = nav.detail->nverts;
+	params.detailTris = nav.detail->tris;
+	params.detailTriCount = nav.detail->ntris;
+	params.walkableHeight = walkableHeight * NAV_CELL_HEIGHT;
+	params.walkableRadius = radius;
+	params.walkableClimb = walkableClimb * NAV_CELL_HEIGHT;
+	rcVcopy(params.bmin, nav.mesh->bmin);
+	rcVcopy(params.bmax, nav.mesh->bmax);
+	params.cs = NAV_CELL_SIZE;
+	params.ch = NAV_CELL_HEIGHT;
+	params.buildBvTree = true;
+
+	unsigned char* data = nullptr;
+	int dataSize = 0;
+	if (!dtCreateNavMeshData(&params, &data, &dataSize)) {
+		return false;
+	}
+	_navMesh = dtAllocNavMesh();
+	if (_navMesh == nullptr || dtStatusFailed(_navMesh->init(data, dataSize, DT_TILE_FREE_DATA))) {
+		dtFree(data);
+		dtFreeNavMesh(_navMesh);
+		_navMesh = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void LevelNavMesh::dispose() {
+	if (_navMesh != nullptr) {
+		dtFreeNavMesh(_navMesh);
+		_navMesh = nullptr;
+	}
+	_obstacles.clear();
+	_size = Size::ZERO;
+}
@@ -0,0 +1,79 @@
+#ifndef __LEVEL_NAV_MESH_H__
+#define __LEVEL_NAV_MESH_H__
+
+#include <vector>
+#include <cocos2d.h>
+#include "recast/Detour/DetourNavMesh.h"
+
+/** The side of one voxel of the navmesh build, in Box2D units */
+#define NAV_CELL_SIZE 0.2f
+/** The clearance kept between an agent's center and a building, in Box2D units */
+#define NAV_AGENT_RADIUS 0.4f
+/** The maximum number of vertices in one navmesh polygon */
+#define NAV_VERTS_PER_POLY 6
+/** The flag set on every walkable navmesh polygon */
+#define NAV_FLAG_WALK 0x01
+
+using namespace cocos2d;
+
+/**
+ * Walkable area of a level, as a Detour navigation mesh.
+ *
+ * The level is flat, so Recast is given a single ground quad the size of
+ * the level and every building footprint is cut out of it. The cut-outs
+ * are grown by the agent radius, so a path along the mesh keeps a mover's
+ * center that far from any wall.
+ *
+ * Mesh coordinates are Recast's y-up convention: Box2D (x, y) maps to
+ * mesh (x, 0, y). The mesh is stored with the level, so it is built on
+ * first population and reused on every reset, like the ShadowField.
+ */
+class LevelNavMesh {
+private:
+	/** The building footprints, as (minx, miny, maxx, maxy) in Box2D units */
+	std::vector<float> _obstacles;
+	/** The navigation mesh, or nullptr until built */
+	dtNavMesh* _navMesh;
+	/** The level dimensions, in Box2D units */
+	Size _size;
+
+public:
+	LevelNavMesh() : _navMesh(nullptr) {}
+
+	~LevelNavMesh() { dispose(); }
+
+	/**
+	 * Adds a box that agents cannot walk through.
+	 *
+	 * Obstacles added after build() are ignored until the mesh is disposed
+	 * and built again.
+	 *
+	 * @param  center  The center of the box, in Box2D units
+	 * @param  size    The dimensions of the box, in Box2D units
+	 */
+	void addBox(const Vec2& center, const Size& size);
+
+	/**
+	 * Builds the mesh of a level of the given size around every obstacle.
+	 *
+	 * @param  size    The level dimensions, in Box2D units
+	 * @param  radius  The clearance kept around every obstacle, in Box2D units
+	 *
+	 * @return true if a non-empty mesh was built
+	 */
+	bool build(const Size& size, float radius = NAV_AGENT_RADIUS);
+
+	/** Releases the mesh and forgets every obstacle. */
+	void dispose();
+
+	/** Returns whether the mesh has been built */
+	bool isBuilt() const { return _navMesh != nullptr; }
+
+	/** Returns the Detour mesh, or nullptr if it has not been built */
+	const dtNavMesh* getNavMesh() const { return _navMesh; }
+
+	/** Returns the level dimensions the mesh was built for */
+	const Size& getSize() const { return _size; }
+};
+
+#endif /* __LEVEL_NAV_MESH_H__ */
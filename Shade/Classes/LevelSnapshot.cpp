@@ -0,0 +1,65 @@
+#include <Box2D/Dynamics/b2Body.h>
+#include "LevelSnapshot.h"
+
+/** Returns whether two filters are the same */
+static inline bool sameFilter(const b2Filter& a, const b2Filter& b) {
+	return a.categoryBits == b.categoryBits && a.maskBits == b.maskBits && a.groupIndex == b.groupIndex;
+}
+
+void LevelSnapshot::capture(WorldController* world) {
+	clear();
+	for (Obstacle* obstacle : world->getObstacles()) {
+		b2Body* body = obstacle->getBody();
+		if (body == nullptr) {
+			continue;
+		}
+
+		BodyState state;
+		state.obstacle = obstacle;
+		state.position = body->GetPosition();
+		state.angle = body->GetAngle();
+		state.linearVelocity = body->GetLinearVelocity();
+		state.angularVelocity = body->GetAngularVelocity();
+		state.awake = body->IsAwake();
+		state.active = body->IsActive();
+		state.visible = obstacle->getSceneNode() == nullptr || obstacle->getSceneNode()->isVisible();
+		state.firstFilter = (int)_filters.size();
+		for (b2Fixture* fixture = body->GetFixtureList(); fixture != nullptr; fixture = fixture->GetNext()) {
+			_filters.push_back(fixture->GetFilterData());
+		}
+		state.filterCount = (int)_filters.size() - state.firstFilter;
+		_bodies.push_back(state);
+	}
+}
+
+void LevelSnapshot::restore() const {
+	for (const BodyState& state : _bodies) {
+		b2Body* body = state.obstacle->getBody();
+		if (body == nullptr) {
+			continue;
+		}
+
+		if (body->IsActive() != state.active) {
+			body->SetActive(state.active);
+		}
+		body->SetTransform(state.position, state.angle);
+		body->SetLinearVelocity(state.linearVelocity);
+		body->SetAngularVelocity(state.angularVelocity);
+		body->SetAwake(state.awake);
+
+		// Refiltering flags every contact of the fixture, so only do it on a change
+		const b2Filter* filter = &_filters[state.firstFilter];
+		const b2Filter* end = filter + state.filterCount;
+		for (b2Fixture* fixture = body->GetFixtureList(); fixture != nullptr && filter != end; fixture = fixture->GetNext(), filter++) {
+			if (!sameFilter(fixture->GetFilterData(), *filter)) {
+				fixture->SetFilterData(*filter);
+			}
+		}
+
+		if (state.obstacle->getSceneNode() != nullptr) {
+			state.obstacle->getSceneNode()->setVisible(state.visible);
+		}
+		state.obstacle->storePreviousTransform();
+		state.obstacle->update(0.0f);
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef __LEVEL_SNAPSHOT_H__
+#define __LEVEL_SNAPSHOT_H__
+
+#include <vector>
+#include <cornell.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+
+using namespace cocos2d;
+
+/**
+ * Saved physical state of every obstacle in a world.
+ *
+ * The snapshot is captured once the level is populated. Restoring it puts
+ * every body back where it started, with its starting velocities, sleep
+ * state and fixture filters, and shows or hides each scene node as it was.
+ * Nothing is created or destroyed, so resetting a level costs one pass over
+ * its bodies instead of a full repopulation.
+ *
+ * Box2D updates its contacts for the moved bodies on the next step, so the
+ * contact callbacks see the reset like any other motion.
+ */
+class LevelSnapshot {
+private:
+	/** The saved state of a single obstacle */
+	struct BodyState {
+		/** The obstacle, retained by the world */
+		Obstacle* obstacle;
+		/** The body position, in Box2D units */
+		b2Vec2 position;
+		/** The body angle, in radians */
+		float angle;
+		/** The body linear velocity */
+		b2Vec2 linearVelocity;
+		/** The body angular velocity */
+		float angularVelocity;
+		/** Whether the body was awake */
+		bool awake;
+		/** Whether the body was active */
+		bool active;
+		/** Whether the scene node was visible */
+		bool visible;
+		/** The index of the first fixture filter in _filters */
+		int firstFilter;
+		/** The number of fixture filters saved for this body */
+		int filterCount;
+	};
+
+	/** The saved obstacles, in world order */
+	std::vector<BodyState> _bodies;
+	/** The saved filters of every fixture, body by body */
+	std::vector<b2Filter> _filters;
+
+public:
+	LevelSnapshot() {}
+
+	/**
+	 * Saves the state of every obstacle in the world.
+	 *
+	 * Any previous snapshot is replaced.
+	 *
+	 * @param  world  The world to save
+	 */
+	void capture(WorldController* world);
+
+	/**
+	 * Puts every saved obstacle back in its saved state.
+	 *
+	 * Obstacles added to the world after the capture are not touched.
+	 * Scene nodes and debug nodes are repositioned immediately.
+	 */
+	void restore() const;
+
+	/** Returns whether nothing has been captured */
+	bool isEmpty() const { return _bodies.empty(); }
+
+	/** Forgets the saved state. */
+	void clear() {
+		_bodies.clear();
+		_filters.clear();
+	}
+};
+
+#endif /* __LEVEL_SNAPSHOT_H__ */
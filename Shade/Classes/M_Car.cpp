@@ -8,7 +8,7 @@
 
 using namespace cocos2d;
 
-void Car::act(Car::ActionType action, int actionLength, int actionCounter, BoxObstacle * object, BoxObstacle * shadow) {
+void Car::act(Car::ActionType action, int actionLength, int actionCounter, float bearing, BoxObstacle * object, BoxObstacle * shadow) {
 	b2Vec2 moveVector;
 	b2Body* obody;
 	b2Body* sbody;
@@ -20,7 +20,7 @@ void Car::act(Car::ActionType action, int actionLength, int actionCounter, BoxOb
 	switch (action) {
 		case GO: // Go forward in the current direction
 			//CCLOG("%s", "GO");
-			if (actionCounter % CAR_ANIMATION_SPEED == CAR_ANIMATION_SPEED - 1)
+			if (object->getSceneNode() != nullptr && actionCounter % CAR_ANIMATION_SPEED == CAR_ANIMATION_SPEED - 1)
 				((AnimationNode*)(object->getSceneNode()))->setFrame((((AnimationNode*)(object->getSceneNode()))->getFrame() + 1) % ((AnimationNode*)(object->getSceneNode()))->getSize());
 			moveVector = b2Vec2(CAR_SPEED*cos(angle), CAR_SPEED*sin(angle));
 			obody = object->getBody();
@@ -30,7 +30,8 @@ void Car::act(Car::ActionType action, int actionLength, int actionCounter, BoxOb
 			break;
 		case STOP: // Stop moving
 			//CCLOG("%s", "STOP");
-			((AnimationNode*)(object->getSceneNode()))->setFrame(0);
+			if (object->getSceneNode() != nullptr)
+				((AnimationNode*)(object->getSceneNode()))->setFrame(0);
 			moveVector = b2Vec2(0.0f, 0.0f);
 			obody = object->getBody();
 			obody->SetLinearVelocity(moveVector);
@@ -52,6 +53,26 @@ void Car::act(Car::ActionType action, int actionLength, int actionCounter, BoxOb
 	}
 }
 
+void Car::step(Car::ActionType action, float& angle, b2Vec2& velocity) {
+	switch (action) {
+		case GO:
+			velocity.Set(CAR_SPEED*cos(angle), CAR_SPEED*sin(angle));
+			break;
+		case STOP:
+			velocity.SetZero();
+			break;
+		case TURN_LEFT:
+			// A turn leaves the body moving as it was
+			angle -= M_PI_2;
+			break;
+		case TURN_RIGHT:
+			angle += M_PI_2;
+			break;
+		default:
+			break;
+	}
+}
+
 const map<std::string, Car::ActionType> Car::actionMap = {
 	{ "stop", ActionType::STOP },
 	{ "go", ActionType::GO },
@@ -26,7 +26,15 @@ struct Car {
 
 	static const std::string name;
 
-	static void act(ActionType action, int actionLength, int actionCounter, BoxObstacle* object, BoxObstacle* shadow);
+	static void act(ActionType action, int actionLength, int actionCounter, float bearing, BoxObstacle* object, BoxObstacle* shadow);
+
+	/**
+	 * Applies one frame of an action to a body angle and velocity, as act() does.
+	 *
+	 * Used to compile action programs into trajectories, so it must be kept
+	 * in step with act().
+	 */
+	static void step(ActionType action, float& angle, b2Vec2& velocity);
 };
 
 #endif /* __M_CAR_H__ */
\ No newline at end of file
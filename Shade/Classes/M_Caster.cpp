@@ -0,0 +1,26 @@
+#include <math.h>
+#include <cocos2d.h>
+#include "M_Caster.h"
+
+using namespace cocos2d;
+
+void Caster::act(Caster::ActionType action, int actionLength, int actionCounter, float bearing, BoxObstacle * object, BoxObstacle * shadow) {
+	b2Body* obody = object->getBody();
+	// The body is kept upright, so the heading comes from the action itself
+	float angle = bearing - M_PI;
+
+	switch (action) {
+	case WALK: // Go forward along the bearing
+		obody->SetLinearVelocity(b2Vec2(CASTER_SPEED*cos(angle), CASTER_SPEED*sin(angle)));
+		break;
+	case STAND: // Stop moving
+		obody->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
+		break;
+	default:
+		CCLOG("%s", "BAD");
+		break;
+	}
+	if (object->getAngle() != 0.0f) {
+		object->setAngle(0.0f);
+	}
+}
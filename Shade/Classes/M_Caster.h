@@ -6,10 +6,21 @@
 #define WIN_SCALE_DOWN 2.0f
 #define CASTER_ROWS 1
 #define CASTER_COLS 10
+/** Speed of a walking caster, in Box2D units per second */
+#define CASTER_SPEED 1.5f
 
 class Caster : public Shadow {
 public:
-	typedef enum ActionType {} ActionType;  // TODO fill this
+	typedef enum ActionType { STAND, WALK } ActionType;
+
+	/**
+	 * Moves the caster for one frame of an action.
+	 *
+	 * The caster walks along the bearing of the action, but it is drawn
+	 * upright, so the body is turned back whenever an action turns it.
+	 * The caster has no shadow body, so shadow is ignored.
+	 */
+	static void act(ActionType action, int actionLength, int actionCounter, float bearing, BoxObstacle* object, BoxObstacle* shadow);
 };
 
 #endif /*__M_CASTER_H__*/
@@ -1,9 +1,14 @@
+#include <map>
+#include <cstdio>
+#include <cstring>
 #include "M_LevelInstance.h"
+#include "MappedFile.h"
+#include "LevelFormat_generated.h"
 
 #define BUILDING_FRICTION 20.0f
 #define BUILDING_RESTITUTION 0.0f
 
-LevelInstance::LevelInstance(void) : Asset() {}
+LevelInstance::LevelInstance(void) : Asset(), _headless(false) {}
 
 LevelInstance::~LevelInstance(void) { unload(); }
 
@@ -62,13 +67,18 @@ LevelInstance* LevelInstance::create(std::string file) {
 */
 bool LevelInstance::initializeMetadata() {
 
+	if (isCompiledFile(_file)) {
+		return initializeCompiledMetadata();
+	}
+
+	/* The level file, read in place */
+	MappedFile file;
+
 	/* The JSON reader to be used for reading the level file */
 	JSONReader reader;
 
-	reader.initWithFile(_file);
-
 	/* Try beginning parsing */
-	if (!reader.startJSON()) {
+	if (!file.open(_file) || !reader.startJSON((const char*)file.getBytes(), file.getSize())) {
 		failToLoad("Failed to load level file");
 		return false;
 	}
@@ -81,6 +91,7 @@ bool LevelInstance::initializeMetadata() {
 	}
 
 	_name = reader.getString("name");
+	_imageFormat = reader.getString("imageFormat");
 
 	// Set the level width and height values
 	if (reader.startObject(SIZE_FIELD)) {
@@ -223,14 +234,217 @@ bool LevelInstance::initializeMetadata() {
 	return true;
 }
 
+bool LevelInstance::isCompiledFile(const string& file) {
+	size_t length = strlen(COMPILED_LEVEL_EXTENSION);
+	return file.size() > length && file.compare(file.size() - length, length, COMPILED_LEVEL_EXTENSION) == 0;
+}
+
+bool LevelInstance::readBackground(const string& file, string& name, string& imageFormat) {
+	MappedFile mapped;
+	if (!mapped.open(file)) {
+		return false;
+	}
+	if (!isCompiledFile(file)) {
+		JSONReader reader;
+		if (!reader.startJSON((const char*)mapped.getBytes(), mapped.getSize())) {
+			return false;
+		}
+		name = reader.getString("name");
+		imageFormat = reader.getString("imageFormat");
+		reader.endJSON();
+		return true;
+	}
+	flatbuffers::Verifier verifier(mapped.getBytes(), mapped.getSize());
+	if (!ShadeLevel::VerifyLevelBuffer(verifier) || !ShadeLevel::LevelBufferHasIdentifier(mapped.getBytes())) {
+		return false;
+	}
+	const ShadeLevel::Level* level = ShadeLevel::GetLevel(mapped.getBytes());
+	if (level->version() != LEVEL_FORMAT_VERSION || level->name() == nullptr || level->imageFormat() == nullptr) {
+		return false;
+	}
+	name.assign(level->name()->c_str(), level->name()->size());
+	imageFormat.assign(level->imageFormat()->c_str(), level->imageFormat()->size());
+	return true;
+}
+
+template <class T>
+bool LevelInstance::loadCompiledMover(const ShadeLevel::Mover* mover, int index, vector<MovingObjectMetadata<T>>& vec) {
+	if (mover->position() == nullptr) {
+		failToLoad("Failed to assign " + T::name + " " + std::to_string(index + 1) + " position");
+		return false;
+	}
+	MovingObjectMetadata<T> data;
+	data.position.set(mover->position()->x(), mover->position()->y());
+	data.heading = mover->heading();
+	data.actions = ActionQueue<T>::create();
+	data.actions->retain();
+	// Push before checking anything else, so that failToLoad releases the queue
+	vec.push_back(data);
+	// The compiler only writes what the JSON loader accepted, so anything else is a bad file
+	auto* actions = mover->actions();
+	int actionCount = (actions != nullptr ? (int)actions->size() : 0);
+	for (int ii = 0; ii < actionCount; ii++) {
+		const ShadeLevel::Action* action = actions->Get(ii);
+		bool knownType = false;
+		for (const auto& entry : T::actionMap) {
+			knownType = knownType || (int)entry.second == action->type();
+		}
+		if (!knownType) {
+			failToLoad("Failed to assign " + T::name + " " + std::to_string(index + 1) + " action " + std::to_string(ii + 1) + " type");
+			return false;
+		}
+		if (action->length() <= 0) {
+			failToLoad("Failed to assign " + T::name + " " + std::to_string(index + 1) + " action " + std::to_string(ii + 1) + " length");
+			return false;
+		}
+		if (action->counter() <= 0 || action->counter() > action->length()) {
+			failToLoad("Failed to assign " + T::name + " " + std::to_string(index + 1) + " action " + std::to_string(ii + 1) + " counter");
+			return false;
+		}
+		data.actions->push(action->bearing(), (typename T::ActionType)action->type(), action->length(),
+			action->counter(), Vec2(action->target().x(), action->target().y()));
+	}
+	if (mover->cycleStart() >= actionCount) {
+		failToLoad("Failed to assign " + T::name + " " + std::to_string(index + 1) + " cycle start");
+		return false;
+	}
+	if (mover->cycleStart() >= 0) {
+		data.actions->setCycleStart(mover->cycleStart());
+	}
+	return true;
+}
+
+bool LevelInstance::initializeCompiledMetadata() {
+	MappedFile file;
+	if (!file.open(_file)) {
+		failToLoad("Failed to load level file");
+		return false;
+	}
+
+	// Checks the offsets and sizes only, so this is one pass with no allocation
+	flatbuffers::Verifier verifier(file.getBytes(), file.getSize());
+	if (!ShadeLevel::VerifyLevelBuffer(verifier) || !ShadeLevel::LevelBufferHasIdentifier(file.getBytes())) {
+		failToLoad("Failed to verify compiled level file");
+		return false;
+	}
+	const ShadeLevel::Level* level = ShadeLevel::GetLevel(file.getBytes());
+	if (level->version() != LEVEL_FORMAT_VERSION) {
+		failToLoad("Compiled level file is version " + std::to_string(level->version()) +
+			", expected " + std::to_string(LEVEL_FORMAT_VERSION) + "; recompile it with ShadeLevelc");
+		return false;
+	}
+	if (level->size() == nullptr || level->player() == nullptr || level->caster() == nullptr ||
+		level->types() == nullptr || level->staticObjects() == nullptr ||
+		level->pedestrians() == nullptr || level->cars() == nullptr) {
+		failToLoad("Compiled level file is missing fields");
+		return false;
+	}
+
+	_levelIndex = level->index();
+	_name = (level->name() != nullptr ? string(level->name()->c_str(), level->name()->size()) : "");
+	_imageFormat = (level->imageFormat() != nullptr ? string(level->imageFormat()->c_str(), level->imageFormat()->size()) : "");
+	_size.setSize(level->size()->x(), level->size()->y());
+	_playerPos.position.set(level->player()->x(), level->player()->y());
+	_casterPos.position.set(level->caster()->x(), level->caster()->y());
+	_casterPos.heading = level->casterHeading();
+
+	auto* types = level->types();
+	auto* staticObjects = level->staticObjects();
+	_staticObjects.reserve(_staticObjects.size() + staticObjects->size());
+	for (flatbuffers::uoffset_t ii = 0; ii < staticObjects->size(); ii++) {
+		const ShadeLevel::StaticObject* object = staticObjects->Get(ii);
+		if (object->type() < 0 || (flatbuffers::uoffset_t)object->type() >= types->size()) {
+			failToLoad("Failed to assign static object " + std::to_string(ii + 1) + " type");
+			return false;
+		}
+		StaticObjectMetadata data;
+		data.position.set(object->position().x(), object->position().y());
+		const flatbuffers::String* type = types->Get(object->type());
+		data.type.assign(type->c_str(), type->size());
+		_staticObjects.push_back(data);
+	}
+
+	auto* pedestrians = level->pedestrians();
+	_pedestrians.reserve(_pedestrians.size() + pedestrians->size());
+	for (flatbuffers::uoffset_t ii = 0; ii < pedestrians->size(); ii++) {
+		if (!loadCompiledMover<Pedestrian>(pedestrians->Get(ii), (int)ii, _pedestrians)) return false;
+	}
+	auto* cars = level->cars();
+	_cars.reserve(_cars.size() + cars->size());
+	for (flatbuffers::uoffset_t ii = 0; ii < cars->size(); ii++) {
+		if (!loadCompiledMover<Car>(cars->Get(ii), (int)ii, _cars)) return false;
+	}
+	return true;
+}
+
+template <class T>
+unsigned int LevelInstance::compileMover(const MovingObjectMetadata<T>& data, flatbuffers::FlatBufferBuilder& builder) const {
+	const ActionQueue<T>* queue = data.actions;
+	vector<ShadeLevel::Action> actions;
+	actions.reserve(queue->_programEnd);
+	for (int ii = 0; ii < queue->_programEnd; ii++) {
+		const auto& action = queue->_actions[ii];
+		actions.push_back(ShadeLevel::Action((int)action._type, action._length, action._counter, action._bearing,
+			ShadeLevel::Point(action._target.x, action._target.y)));
+	}
+	auto program = builder.CreateVectorOfStructs(actions);
+	ShadeLevel::Point position(data.position.x, data.position.y);
+	return ShadeLevel::CreateMover(builder, &position, data.heading, queue->_cycleStart, program).o;
+}
+
+bool LevelInstance::writeCompiled(const string& file) const {
+	flatbuffers::FlatBufferBuilder builder;
+
+	// Most levels reuse a few building types, so each name is stored once
+	map<string, int> typeIndex;
+	vector<flatbuffers::Offset<flatbuffers::String>> types;
+	vector<ShadeLevel::StaticObject> staticObjects;
+	staticObjects.reserve(_staticObjects.size());
+	for (const StaticObjectMetadata &data : _staticObjects) {
+		auto found = typeIndex.find(data.type);
+		if (found == typeIndex.end()) {
+			found = typeIndex.insert(std::make_pair(data.type, (int)types.size())).first;
+			types.push_back(builder.CreateString(data.type));
+		}
+		staticObjects.push_back(ShadeLevel::StaticObject(ShadeLevel::Point(data.position.x, data.position.y), found->second));
+	}
+
+	vector<flatbuffers::Offset<ShadeLevel::Mover>> pedestrians;
+	pedestrians.reserve(_pedestrians.size());
+	for (const PedestrianMetadata &data : _pedestrians) {
+		pedestrians.push_back(flatbuffers::Offset<ShadeLevel::Mover>(compileMover<Pedestrian>(data, builder)));
+	}
+	vector<flatbuffers::Offset<ShadeLevel::Mover>> cars;
+	cars.reserve(_cars.size());
+	for (const CarMetadata &data : _cars) {
+		cars.push_back(flatbuffers::Offset<ShadeLevel::Mover>(compileMover<Car>(data, builder)));
+	}
+
+	ShadeLevel::Point size(_size.width, _size.height);
+	ShadeLevel::Point player(_playerPos.position.x, _playerPos.position.y);
+	ShadeLevel::Point caster(_casterPos.position.x, _casterPos.position.y);
+	auto level = ShadeLevel::CreateLevel(builder, LEVEL_FORMAT_VERSION, _levelIndex, builder.CreateString(_name),
+		&size, &player, &caster, _casterPos.heading, builder.CreateVector(types),
+		builder.CreateVectorOfStructs(staticObjects), builder.CreateVector(pedestrians), builder.CreateVector(cars),
+		builder.CreateString(_imageFormat));
+	ShadeLevel::FinishLevelBuffer(builder, level);
+
+	FILE* out = fopen(file.c_str(), "wb");
+	if (out == nullptr) {
+		return false;
+	}
+	bool written = fwrite(builder.GetBufferPointer(), 1, builder.GetSize(), out) == builder.GetSize();
+	return fclose(out) == 0 && written;
+}
+
 void LevelInstance::failToLoad(const char* errorMessage) {
-	for (PedestrianMetadata pData : _pedestrians) {
+	for (PedestrianMetadata &pData : _pedestrians) {
 		if (pData.actions != nullptr) {
 			pData.actions->release();
 			pData.actions = nullptr;
 		}
 	}
-	for (CarMetadata cData : _cars) {
+	for (CarMetadata &cData : _cars) {
 		if (cData.actions != nullptr) {
 			cData.actions->release();
 			cData.actions = nullptr;
@@ -244,6 +458,8 @@ void LevelInstance::failToLoad(const char* errorMessage) {
 * a reference to every object created until they are added to the physics
 * world.
 *
+* If the level is headless, no scene graph nodes are created.
+*
 * @param	reset	Whether the level is being reset
 *
 * @retain	every object created
@@ -259,7 +475,7 @@ void LevelInstance::populateLevel(bool reset) {
 	// Initialize the main character
 	_playerPos.object = Shadow::create(); // Initialize in GameController
 	_playerPos.object->retain();
-	_playerPos.object->setSceneNode(AnimationNode::create());
+	if (!_headless) _playerPos.object->setSceneNode(AnimationNode::create());
 
 	// Initialize the caster
 	auto* casterObject = BoxObstacle::create();
@@ -269,7 +485,7 @@ void LevelInstance::populateLevel(bool reset) {
 	casterObject->setFriction(PEDESTRIAN_FRICTION);
 	casterObject->setRestitution(PEDESTRIAN_RESTITUTION);
 	casterObject->setFixedRotation(true);
-	casterObject->setSceneNode(AnimationNode::create());
+	if (!_headless) casterObject->setSceneNode(AnimationNode::create());
 
 	// The caster is initialized with an empty action queue, actions will be added by AIController
 	// The following line implicitly retains casterObject
@@ -286,23 +502,26 @@ void LevelInstance::populateLevel(bool reset) {
 			data.object->setFriction(BUILDING_FRICTION);
 			data.object->setRestitution(BUILDING_RESTITUTION);
 			data.object->setFixedRotation(true);
-			data.object->setSceneNode(PolygonNode::create());
+			if (!_headless) data.object->setSceneNode(PolygonNode::create());
 			data.object->retain();
 
 			//data.shadow = BoxObstacle::create(data.position, Size::ZERO, &objectFilter);
+			// Static object shadows never move, so they are baked into _shadowField
 			data.shadow = BoxObstacle::create();	
-			data.shadow->setBodyType(b2_dynamicBody);
+			data.shadow->setBodyType(b2_staticBody);
 			data.shadow->setDensity(0);
 			data.shadow->setFriction(0);
 			data.shadow->setRestitution(0);
 			data.shadow->setFixedRotation(true);
-			data.shadow->setSceneNode(PolygonNode::create());
+			if (!_headless) data.shadow->setSceneNode(PolygonNode::create());
 			data.shadow->retain();
 
 		}
 	}
 
 	// Initialize the pedestrians
+	_movers.clear();
+	_pedestrianIndex.init(_size);
 	for (PedestrianMetadata &data : _pedestrians) {
 		auto* pedestrianShadow = BoxObstacle::create();
 		pedestrianShadow->setBodyType(b2_dynamicBody);
@@ -311,7 +530,7 @@ void LevelInstance::populateLevel(bool reset) {
 		pedestrianShadow->setRestitution(0);
 		pedestrianShadow->setFixedRotation(true);
 		pedestrianShadow->setSensor(true);
-		pedestrianShadow->setSceneNode(AnimationNode::create());
+		if (!_headless) pedestrianShadow->setSceneNode(AnimationNode::create());
 
 		auto* pedestrianObject = BoxObstacle::create();
 		pedestrianObject->setBodyType(b2_dynamicBody);
@@ -319,7 +538,7 @@ void LevelInstance::populateLevel(bool reset) {
 		pedestrianObject->setFriction(PEDESTRIAN_FRICTION);
 		pedestrianObject->setRestitution(PEDESTRIAN_RESTITUTION);
 		pedestrianObject->setFixedRotation(true);
-		pedestrianObject->setSceneNode(AnimationNode::create());
+		if (!_headless) pedestrianObject->setSceneNode(AnimationNode::create());
 
 		// The following line implicitly retains pedestrianObject and pedestrianShadow
 		// It also creates a copy of the initial action queue so that the initial
@@ -328,6 +547,7 @@ void LevelInstance::populateLevel(bool reset) {
 			ActionQueue<Pedestrian>::create(*(data.actions)),
 			pedestrianObject, pedestrianShadow);
 		data.object->retain();
+		_movers.pedestrians.add(data.object);
 
 	}
 
@@ -340,7 +560,7 @@ void LevelInstance::populateLevel(bool reset) {
 		carShadow->setRestitution(0);
 		carShadow->setFixedRotation(true);
 		carShadow->setSensor(true);
-		carShadow->setSceneNode(AnimationNode::create());
+		if (!_headless) carShadow->setSceneNode(AnimationNode::create());
 
 		auto* carObject = BoxObstacle::create();
 		carObject->setBodyType(b2_dynamicBody);
@@ -348,17 +568,56 @@ void LevelInstance::populateLevel(bool reset) {
 		carObject->setFriction(CAR_FRICTION);
 		carObject->setRestitution(CAR_RESTITUTION);
 		carObject->setFixedRotation(true);
-		carObject->setSceneNode(PolygonNode::create());
+		if (!_headless) carObject->setSceneNode(PolygonNode::create());
 
 		// The following line implicitly retains carObject and carShadow
 		data.object = OurMovingObject<Car>::create(
 			ActionQueue<Car>::create(*(data.actions)),
 			carObject, carShadow);
 		data.object->retain();
+		_movers.cars.add(data.object);
 
 	}
 }
 
+void LevelInstance::bakeShadowField() {
+	if (_shadowField.isBaked() || !_shadowField.init(_size)) {
+		return;
+	}
+	for (StaticObjectMetadata &data : _staticObjects) {
+		if (data.shadow != nullptr) {
+			_shadowField.addBox(data.shadow->getPosition(), data.shadow->getDimension());
+		}
+	}
+	_shadowField.bake();
+}
+
+void LevelInstance::buildNavMesh() {
+	if (_navMesh.isBuilt()) {
+		return;
+	}
+	for (StaticObjectMetadata &data : _staticObjects) {
+		if (data.object != nullptr) {
+			_navMesh.addBox(data.object->getPosition(), data.object->getDimension());
+		}
+	}
+	if (!_navMesh.build(_size)) {
+		printWarning("Attention: failed to build the navigation mesh for " + _name);
+	}
+}
+
+void LevelInstance::buildOccluders() {
+	if (_occluders.size() > 0) {
+		return;
+	}
+	for (StaticObjectMetadata &data : _staticObjects) {
+		if (data.object != nullptr) {
+			_occluders.addBox(data.object->getPosition(), data.object->getDimension());
+		}
+	}
+	_occluders.build();
+}
+
 bool LevelInstance::load() {
 	if (initializeMetadata()) {
 		populateLevel(false);
@@ -369,10 +628,25 @@ bool LevelInstance::load() {
 
 
 void LevelInstance::unload() {
-	for (PedestrianMetadata p : _pedestrians) {
-		p.actions->release();
+	_shadowField.dispose();
+	_navMesh.dispose();
+	_occluders.dispose();
+	_movers.clear();
+	_pedestrianIndex.dispose();
+	// The loader unloads a level and then releases it, so this may run twice
+	for (PedestrianMetadata &p : _pedestrians) {
+		if (p.actions != nullptr) {
+			p.actions->release();
+			p.actions = nullptr;
+		}
 	}
-	for (CarMetadata c : _cars) {
-		c.actions->release();
+	for (CarMetadata &c : _cars) {
+		if (c.actions != nullptr) {
+			c.actions->release();
+			c.actions = nullptr;
+		}
 	}
+	_pedestrians.clear();
+	_cars.clear();
+	_staticObjects.clear();
 }
\ No newline at end of file
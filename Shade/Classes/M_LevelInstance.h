@@ -13,6 +13,11 @@
 #include <ActionQueue.h>
 #include <M_Shadow.h>
 #include <M_Caster.h>
+#include <ShadowField.h>
+#include <M_MoverRegistry.h>
+#include <MoverGrid.h>
+#include <LevelNavMesh.h>
+#include <OccluderBVH.h>
 
 // No category bit should have value 0x01 since that's Box2D default
 /** Category bit for solid level objects */
@@ -33,6 +38,10 @@
 #define LATCH_BIT 0x0100
 /** Category bit for the car */
 #define CAR_BIT 0x0200
+/** Category bit for shadows baked into the level's ShadowField */
+#define STATIC_SHADOW_BIT 0x0400
+/** Category bit for the shadow of a killed pedestrian, which only ends its contacts */
+#define DEAD_SHADOW_BIT 0x0800
 
 /** Default scale from Box2D to intended pixel coordinates */
 #define BOX2D_SCALE 50.0f
@@ -103,11 +112,18 @@
 */
 #define CYCLIC_FIELD "cycleStart"
 
+/** The extension of compiled level files, whose layout is LevelFormat.fbs */
+#define COMPILED_LEVEL_EXTENSION ".shadb"
+/** The version of the compiled level format; raise it whenever LevelFormat.fbs changes */
+#define LEVEL_FORMAT_VERSION 2
+
 using namespace std;
 using namespace cocos2d;
 
-// Forward declaration
+// Forward declarations
 class LevelInstance;
+namespace flatbuffers { class FlatBufferBuilder; }
+namespace ShadeLevel { struct Mover; }
 
 template <class T>
 class LevelObjectMetadata {
@@ -176,12 +192,26 @@ public:
 
 	int _levelIndex;
 	string _name;
+	/** The extension of the background image, which is named after the level */
+	string _imageFormat;
 	Size _size;
 	ShadowMetadata _playerPos;
 	CasterMetadata _casterPos;
 	vector<StaticObjectMetadata> _staticObjects;
 	vector<PedestrianMetadata> _pedestrians;
 	vector<CarMetadata> _cars;
+	/** Dense arrays of the pedestrians and cars, filled by populateLevel() */
+	MoverRegistry _movers;
+	/** Spatial index of the pedestrians, refreshed by updateMoverIndex() */
+	MoverGrid _pedestrianIndex;
+	/** The static object shadows, rasterized by bakeShadowField() */
+	ShadowField _shadowField;
+	/** The walkable area around the static objects, built by buildNavMesh() */
+	LevelNavMesh _navMesh;
+	/** The static object footprints that block sight, built by buildOccluders() */
+	OccluderBVH _occluders;
+	/** Whether objects are created without scene graph nodes */
+	bool _headless;
 
 	/**
 	* Creates a new game level with no source file.
@@ -211,10 +241,57 @@ public:
 	* counter fields), we fail to load the level from the JSON file. Otherwise,
 	* we succeed.
 	*
+	* A compiled level file is read by initializeCompiledMetadata() instead.
+	*
 	* @return true if loading succeeds, false otherwise
 	*/
 	bool initializeMetadata();
 
+	/**
+	* Initializes the metadata from a compiled level file, written by
+	* writeCompiled(). The file is memory-mapped and its fields are copied
+	* out in place. Its values were validated when it was compiled, so the
+	* only checks are that the file is well-formed and of this version.
+	*
+	* @return true if loading succeeds, false otherwise
+	*/
+	bool initializeCompiledMetadata();
+
+	/**
+	* Returns whether a level file is in the compiled format, by its extension.
+	*
+	* @param	file	The level file
+	*
+	* @return true if the file is a compiled level
+	*/
+	static bool isCompiledFile(const string& file);
+
+	/**
+	* Reads only the name and background image format of a level file.
+	*
+	* This works on both formats, and is cheap enough to find the background
+	* of a level before the level itself is loaded.
+	*
+	* @param	file		The level file
+	* @param	name		Set to the level name
+	* @param	imageFormat	Set to the extension of the background image
+	*
+	* @return true if the file was read
+	*/
+	static bool readBackground(const string& file, string& name, string& imageFormat);
+
+	/**
+	* Writes the metadata to a compiled level file.
+	*
+	* The metadata must have been initialized and not yet populated, so that
+	* every action queue still holds its whole program.
+	*
+	* @param	file	The file to write, which is replaced if it exists
+	*
+	* @return true if the file was written
+	*/
+	bool writeCompiled(const string& file) const;
+
 	inline void failToLoad(const string& errorMessage) {
 		failToLoad(errorMessage.c_str());
 	}
@@ -365,13 +442,7 @@ public:
 				}
 				if (reader.isArray(ACTIONS_FIELD)) {
 					int actionCount = reader.startArray(ACTIONS_FIELD);
-					if (queueIsCyclic) {
-						for (int count = 0; count < actionStartIndex; count++) {
-							reader.advance();
-						}
-					}
-
-					for (int actionIndex = actionStartIndex; actionIndex < actionCount; actionIndex++) {
+					for (int actionIndex = 0; actionIndex < actionCount; actionIndex++) {
 						if (reader.startObject()) {
 							if (!deserializeAction(reader, pedestrianIndex, actionIndex, data.actions)) return false;
 							reader.endObject();
@@ -385,18 +456,9 @@ public:
 						}
 					}
 					reader.endArray();
-					data.actions->setCycling(queueIsCyclic);
+					// The actions before the cyclic one run once, the rest repeat
 					if (queueIsCyclic) {
-						ActionQueue<T> additionalQueue;
-						reader.startArray(ACTIONS_FIELD);
-						for (int count = 0; count < actionStartIndex; count++) {
-							reader.startObject();
-							if (!deserializeAction(reader, pedestrianIndex, count, data.actions)) return false;
-							reader.endObject();
-							reader.advance();
-						}
-						reader.endArray();
-						data.actions->force(additionalQueue, true);
+						data.actions->setCycleStart(actionStartIndex);
 					}
 				}
 				vec.push_back(data);
@@ -413,10 +475,66 @@ public:
 		return true;
 	}
 
+	/**
+	* Reads one mover of a compiled level file into vec. Defined in the
+	* implementation file, which is the only place it is used.
+	*/
+	template <class T>
+	bool loadCompiledMover(const ShadeLevel::Mover* mover, int index, vector<MovingObjectMetadata<T>>& vec);
+
+	/**
+	* Writes one mover to a compiled level file, returning its offset in the
+	* buffer. Defined in the implementation file.
+	*/
+	template <class T>
+	unsigned int compileMover(const MovingObjectMetadata<T>& data, flatbuffers::FlatBufferBuilder& builder) const;
+
 public:
 
+	/**
+	* Sets whether objects are created without scene graph nodes.
+	*
+	* A headless level can be populated and simulated without a GL context.
+	* This must be set before the level is loaded.
+	*
+	* @param	value	Whether objects are created without scene graph nodes
+	*/
+	void setHeadless(bool value) { _headless = value; }
+
 	void populateLevel(bool reset);
 
+	/**
+	* Rasterizes the shadows of every static object into _shadowField.
+	*
+	* The shadows must already be initialized with their final position and
+	* size. The field is only baked once; later calls do nothing.
+	*/
+	void bakeShadowField();
+
+	/**
+	* Builds _navMesh around the footprint of every static object.
+	*
+	* The static objects must already be initialized with their final
+	* position and size. The mesh is only built once; later calls do nothing.
+	*/
+	void buildNavMesh();
+
+	/**
+	* Builds _occluders from the footprint of every static object.
+	*
+	* The static objects must already be initialized with their final
+	* position and size. The tree is only built once; later calls do nothing.
+	*/
+	void buildOccluders();
+
+	/**
+	* Sorts the pedestrians into _pedestrianIndex by their current position.
+	*
+	* The mover bodies must already be bound. Call this once per frame,
+	* after the physics step and before any proximity queries.
+	*/
+	void updateMoverIndex() { _pedestrianIndex.rebuild(_movers.pedestrians.getBodies()); }
+
 	virtual bool load() override;
 
 	virtual void unload() override;
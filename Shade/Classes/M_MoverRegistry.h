@@ -0,0 +1,356 @@
+#ifndef __M_MOVER_REGISTRY_H__
+#define __M_MOVER_REGISTRY_H__
+
+#include <vector>
+#include <algorithm>
+#include <Box2D/Dynamics/b2Body.h>
+#include <M_MovingObject.h>
+#include <M_Pedestrian.h>
+#include <M_Car.h>
+#include <Trajectory.h>
+
+using namespace std;
+
+/**
+ * Dense arrays of every mover of one kind in a level.
+ *
+ * Entry i of each array belongs to the same mover. The handles are filled
+ * in when the level creates its movers, and the bodies once the movers are
+ * added to a physics world. The gameplay, AI and physics passes walk these
+ * arrays in place rather than the level metadata, so no per-frame pass
+ * copies a metadata struct.
+ */
+template <class T>
+class MoverArray {
+private:
+	/** The movers, which are retained by the level metadata */
+	vector<OurMovingObject<T>*> _movers;
+	/** The body of each mover's object, or nullptr until bound */
+	vector<b2Body*> _bodies;
+	/** The body of each mover's shadow, or nullptr until bound */
+	vector<b2Body*> _shadowBodies;
+	/** Non-zero for each mover steered by the AI instead of its action queue */
+	vector<unsigned char> _steered;
+	/** Non-zero for each mover out of the physics world, see park() */
+	vector<unsigned char> _parked;
+	/** The compiled action program of each kinematic or parked mover */
+	vector<Trajectory> _trajectories;
+	/** The clock value at frame 0 of each mover's trajectory */
+	vector<float> _origins;
+	/** The offset of each mover's shadow body from its object body */
+	vector<b2Vec2> _shadowOffsets;
+	/** The number of act() calls so far */
+	float _clock;
+	/** The number of parked movers */
+	int _parkedCount;
+	/** Whether the movers run along their trajectories instead of their queues */
+	bool _kinematic;
+
+	/** Compiles a mover's action queue from where its body is now */
+	void compile(int index, float frameTime) {
+		Trajectory::Sample start;
+		start.position = _bodies[index]->GetPosition();
+		start.velocity = _bodies[index]->GetLinearVelocity();
+		start.angle = _bodies[index]->GetAngle();
+		_trajectories[index].compile<T>(*(_movers[index]->_actionQueue), start, frameTime);
+		_origins[index] = _clock;
+		_shadowOffsets[index].SetZero();
+		if (_shadowBodies[index] != nullptr) {
+			_shadowOffsets[index] = _shadowBodies[index]->GetPosition() - start.position;
+		}
+	}
+
+	/** Adds or removes the bodies of a mover from the physics world, and shows or hides it */
+	void setPresent(int index, bool value) {
+		_bodies[index]->SetActive(value);
+		if (_shadowBodies[index] != nullptr) {
+			_shadowBodies[index]->SetActive(value);
+		}
+		BoxObstacle* object = _movers[index]->getObject();
+		if (object->getSceneNode() != nullptr) {
+			object->getSceneNode()->setVisible(value);
+		}
+		BoxObstacle* shadow = _movers[index]->getShadow();
+		if (shadow != nullptr && shadow->getSceneNode() != nullptr) {
+			shadow->getSceneNode()->setVisible(value);
+		}
+	}
+
+	/** Puts the bodies of a mover at a frame of its trajectory */
+	void place(int index, float frame) {
+		setState(index, _trajectories[index].evaluate(frame));
+	}
+
+	/** Sets the position, heading and velocity of the bodies of a mover */
+	void setState(int index, const Trajectory::Sample& sample) {
+		_bodies[index]->SetTransform(sample.position, sample.angle);
+		_bodies[index]->SetLinearVelocity(sample.velocity);
+		if (_shadowBodies[index] != nullptr) {
+			_shadowBodies[index]->SetTransform(sample.position + _shadowOffsets[index], sample.angle);
+			_shadowBodies[index]->SetLinearVelocity(sample.velocity);
+		}
+	}
+
+public:
+	MoverArray() : _clock(0.0f), _parkedCount(0), _kinematic(false) {}
+
+	/** Returns the number of movers */
+	int size() const { return (int)_movers.size(); }
+
+	/** Returns the mover at the given index */
+	OurMovingObject<T>* get(int index) const { return _movers[index]; }
+
+	/** Returns the object body of the mover at the given index */
+	b2Body* getBody(int index) const { return _bodies[index]; }
+
+	/** Returns the shadow body of the mover at the given index */
+	b2Body* getShadowBody(int index) const { return _shadowBodies[index]; }
+
+	/** Returns every mover, in registration order */
+	const vector<OurMovingObject<T>*>& getMovers() const { return _movers; }
+
+	/** Returns the object body of every mover, in registration order */
+	const vector<b2Body*>& getBodies() const { return _bodies; }
+
+	/** Returns whether the mover at the given index is steered by the AI */
+	bool isSteered(int index) const { return _steered[index] != 0; }
+
+	/**
+	 * Sets whether the mover at the given index is steered by the AI.
+	 *
+	 * A steered mover is skipped by act(), so its action queue holds its
+	 * place until the AI releases it.
+	 */
+	void setSteered(int index, bool value) { _steered[index] = value ? 1 : 0; }
+
+	/** Adds a mover. Its bodies are looked up by bindBodies(). */
+	void add(OurMovingObject<T>* mover) {
+		_movers.push_back(mover);
+		_bodies.push_back(nullptr);
+		_shadowBodies.push_back(nullptr);
+		_steered.push_back(0);
+		_parked.push_back(0);
+		_trajectories.push_back(Trajectory());
+		_origins.push_back(0.0f);
+		_shadowOffsets.push_back(b2Vec2(0.0f, 0.0f));
+	}
+
+	/** Looks up the bodies of every mover, once they are in a physics world. */
+	void bindBodies() {
+		for (size_t ii = 0; ii < _movers.size(); ii++) {
+			_bodies[ii] = _movers[ii]->getObject()->getBody();
+			BoxObstacle* shadow = _movers[ii]->getShadow();
+			_shadowBodies[ii] = shadow != nullptr ? shadow->getBody() : nullptr;
+		}
+	}
+
+	/**
+	 * Runs the current action of every mover not steered by the AI.
+	 *
+	 * Kinematic and parked movers are instead put where their trajectory is
+	 * at the current frame, moving at its velocity for the coming physics step.
+	 *
+	 * This must be called once before every physics step, not once per
+	 * render frame, so that the awake movers, which the steps move, and the
+	 * parked ones, which the clock moves, keep the same pace. One frame of a
+	 * trajectory is TRAJECTORY_FRAME_TIME, the default world step.
+	 */
+	void act() {
+		for (size_t ii = 0; ii < _movers.size(); ii++) {
+			if (_steered[ii]) {
+				continue;
+			}
+			if (_kinematic || _parked[ii]) {
+				place((int)ii, _clock - _origins[ii]);
+			}
+			else {
+				_movers[ii]->act();
+			}
+		}
+		_clock += 1.0f;
+	}
+
+	/** Returns whether the movers run along compiled trajectories */
+	bool isKinematic() const { return _kinematic; }
+
+	/** Returns the frame of the trajectories the next act() runs */
+	float getClock() const { return _clock; }
+
+	/**
+	 * Compiles each mover's action queue and makes its bodies kinematic.
+	 *
+	 * The bodies must be bound. From then on act() moves each mover along
+	 * its trajectory, starting from where it is now, and its action queue
+	 * is left as it was. Kinematic bodies are not pushed around by
+	 * collisions, and since the AI would move a steered mover off its
+	 * trajectory, only movers the AI never steers should be made kinematic.
+	 *
+	 * @param  frameTime  The duration of one act(), in seconds
+	 */
+	void makeKinematic(float frameTime = TRAJECTORY_FRAME_TIME) {
+		_clock = 0.0f;
+		for (size_t ii = 0; ii < _movers.size(); ii++) {
+			compile((int)ii, frameTime);
+			_bodies[ii]->SetType(b2_kinematicBody);
+			if (_shadowBodies[ii] != nullptr) {
+				_shadowBodies[ii]->SetType(b2_kinematicBody);
+			}
+		}
+		_kinematic = true;
+	}
+
+	/**
+	 * Moves every kinematic mover to a frame of its trajectory at once.
+	 *
+	 * This costs O(log n) per mover however far the frame is, so a level can
+	 * be reset, rewound or skipped ahead without running the frames between.
+	 *
+	 * @param  frame  The number of frames since makeKinematic()
+	 */
+	void seek(float frame) {
+		if (!_kinematic) {
+			return;
+		}
+		_clock = frame;
+		for (size_t ii = 0; ii < _movers.size(); ii++) {
+			if (!_steered[ii]) {
+				place((int)ii, _clock);
+			}
+		}
+	}
+
+	/** Returns whether the mover at the given index is out of the physics world */
+	bool isParked(int index) const { return _parked[index] != 0; }
+
+	/** Returns the number of parked movers */
+	int getParkedCount() const { return _parkedCount; }
+
+	/**
+	 * Takes a mover out of the physics world and advances it analytically.
+	 *
+	 * The bodies are deactivated, which drops them from the broadphase and
+	 * ends their contacts, and the scene nodes are hidden. From then on
+	 * act() moves the bodies along the mover's compiled action program, so
+	 * their positions stay current for the spatial index at the cost of a
+	 * binary search. A mover steered by the AI is never parked.
+	 *
+	 * @param  index      The mover to park
+	 * @param  frameTime  The duration of one act(), in seconds
+	 */
+	void park(int index, float frameTime = TRAJECTORY_FRAME_TIME) {
+		if (_parked[index] || _steered[index]) {
+			return;
+		}
+		// A kinematic mover already has a trajectory that runs on the clock
+		if (!_kinematic) {
+			compile(index, frameTime);
+		}
+		setPresent(index, false);
+		_parked[index] = 1;
+		_parkedCount++;
+	}
+
+	/**
+	 * Puts a parked mover back in the physics world.
+	 *
+	 * The bodies get the position, heading and velocity of the trajectory
+	 * at the current frame, and the action queue is advanced by the frames
+	 * the mover spent parked, so the next act() carries on from the same
+	 * action as if the mover had never left.
+	 */
+	void wake(int index) {
+		if (!_parked[index]) {
+			return;
+		}
+		float frames = _clock - _origins[index];
+		if (frames >= 1.0f) {
+			// The next act() runs this frame, so the body is left as the last one ended
+			Trajectory::Sample sample = _trajectories[index].evaluate(frames - 1.0f);
+			sample.position = _trajectories[index].evaluate(frames).position;
+			setState(index, sample);
+		}
+		if (!_kinematic) {
+			_movers[index]->_actionQueue->skip((int)frames);
+		}
+		setPresent(index, true);
+		_parked[index] = 0;
+		_parkedCount--;
+	}
+
+	/**
+	 * Forgets that any mover is parked, putting its bodies back.
+	 *
+	 * Unlike wake(), this does not move the bodies or their queues, so it
+	 * is for resets that put both back themselves.
+	 */
+	void unparkAll() {
+		for (size_t ii = 0; ii < _movers.size(); ii++) {
+			if (_parked[ii]) {
+				setPresent((int)ii, true);
+				_parked[ii] = 0;
+			}
+		}
+		_parkedCount = 0;
+	}
+
+	/** Returns every mover to its action queue. */
+	void releaseSteering() {
+		std::fill(_steered.begin(), _steered.end(), 0);
+	}
+
+	/** Removes every mover. */
+	void clear() {
+		_movers.clear();
+		_bodies.clear();
+		_shadowBodies.clear();
+		_steered.clear();
+		_parked.clear();
+		_trajectories.clear();
+		_origins.clear();
+		_shadowOffsets.clear();
+		_clock = 0.0f;
+		_parkedCount = 0;
+		_kinematic = false;
+	}
+};
+
+/**
+ * The movers of a level, grouped by kind.
+ *
+ * The registry belongs to LevelInstance, which fills it when it creates
+ * the moving objects. Controllers keep a reference to it instead of
+ * copying the metadata vectors.
+ */
+class MoverRegistry {
+public:
+	/** Every car in the level */
+	MoverArray<Car> cars;
+	/** Every pedestrian in the level */
+	MoverArray<Pedestrian> pedestrians;
+
+	/** Looks up the bodies of every mover, once they are in a physics world. */
+	void bindBodies() {
+		cars.bindBodies();
+		pedestrians.bindBodies();
+	}
+
+	/** Runs the current action of every car and pedestrian, in one pass. */
+	void act() {
+		cars.act();
+		pedestrians.act();
+	}
+
+	/** Forgets every parked mover, for a reset that puts the bodies back itself. */
+	void unparkAll() {
+		cars.unparkAll();
+		pedestrians.unparkAll();
+	}
+
+	/** Removes every mover. */
+	void clear() {
+		cars.clear();
+		pedestrians.clear();
+	}
+};
+
+#endif /* __M_MOVER_REGISTRY_H__ */
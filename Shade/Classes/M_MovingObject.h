@@ -102,25 +102,25 @@ public:
 	*/
 	void act() {
 		if (!_actionQueue->isEmpty()) {
-			while (!_actionQueue->isEmpty() && _actionQueue->_head->_counter <= 0) {
-				assert(_actionQueue->_head->_length > 0);
-				if (_actionQueue->tailHasNext()) {
-					_actionQueue->_head->_counter = _actionQueue->_head->_length;
+			while (!_actionQueue->isEmpty() && _actionQueue->front()._counter <= 0) {
+				assert(_actionQueue->front()._length > 0);
+				if (_actionQueue->isCycling()) {
+					_actionQueue->front()._counter = _actionQueue->front()._length;
 				}
-				_actionQueue->next(); // The head of the queue gets popped if not cyclic
+				_actionQueue->next(); // The current action is dropped if not cyclic
 			}
 			// Check to see if we are left with an empty queue
 			if (!_actionQueue->isEmpty()) {
-				/* The head of the queue */
-				shared_ptr<typename ActionQueue<T>::ActionNode> action(_actionQueue->_head);
+				/* The current action of the queue */
+				typename ActionQueue<T>::Action& action = _actionQueue->front();
 				// TODO the act() method of action types take the current and remaining
 				// number of frames as arguments
-				if (action->_counter == action->_length) {
-					object->setAngle(action->_bearing);
-					shadow->setAngle(action->_bearing);
+				if (action._counter == action._length) {
+					object->setAngle(action._bearing);
+					if (shadow != nullptr) shadow->setAngle(action._bearing);
 				}
-				T::act(action->_type, action->_length, action->_counter, object, shadow);
-				action->_counter--;
+				T::act(action._type, action._length, action._counter, action._bearing, object, shadow);
+				action._counter--;
 			}
 		}
 	}
@@ -194,8 +194,9 @@ public:
 		b2Vec2 moveVector = b2Vec2(getHorizontalMovement(), getVerticalMovement());
 		b2Body* obody = object->getBody();
 		obody->SetLinearVelocity(moveVector);
-		b2Body* sbody = shadow->getBody();
-		sbody->SetLinearVelocity(moveVector);
+		if (shadow != nullptr) {
+			shadow->getBody()->SetLinearVelocity(moveVector);
+		}
 		
 		//shadow->setBodyState(*sbody);
 	}
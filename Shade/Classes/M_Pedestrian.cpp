@@ -4,14 +4,14 @@
 
 using namespace cocos2d;
 
-void Pedestrian::act(Pedestrian::ActionType action, int actionLength, int actionCounter, BoxObstacle * object, BoxObstacle * shadow) {
+void Pedestrian::act(Pedestrian::ActionType action, int actionLength, int actionCounter, float bearing, BoxObstacle * object, BoxObstacle * shadow) {
 	b2Vec2 moveVector;
 	b2Body* obody;
 	b2Body* sbody;
 	Vec2 pos = object->getPosition();	
 
 	float angle = object->getAngle() - M_PI;
-	float speed = 2.0f; // Speed should be pulled out and made a parameter
+	float speed = PEDESTRIAN_SPEED;
 
 						//CCLOG("%f", angle);
 	switch (action) {
@@ -48,6 +48,21 @@ void Pedestrian::act(Pedestrian::ActionType action, int actionLength, int action
 	}
 }
 
+void Pedestrian::step(Pedestrian::ActionType action, float& angle, b2Vec2& velocity) {
+	float heading = angle - M_PI;
+	float speed = PEDESTRIAN_SPEED;
+	switch (action) {
+	case WALK_SLOW:
+		velocity.Set(speed*cos(heading), speed*sin(heading));
+		break;
+	case STAND:
+		velocity.SetZero();
+		break;
+	default:
+		break;
+	}
+}
+
 const map<std::string, Pedestrian::ActionType> Pedestrian::actionMap = {
 	{ "stand", ActionType::STAND },
 	{ "walk_slow", ActionType::WALK_SLOW },
@@ -7,6 +7,8 @@
 #include <cornell.h>
 
 #define PEDESTRIAN_SCALE_DOWN 8.0f
+/** Speed of a walking pedestrian, in Box2D units per second */
+#define PEDESTRIAN_SPEED 2.0f
 
 #define PEDESTRIAN_DENSITY 1.0f
 #define PEDESTRIAN_RESTITUTION 0.0f // TODO increase this when latching is implemented
@@ -21,7 +23,15 @@ struct Pedestrian {
 
 	static const map<std::string, ActionType> actionMap;
 
-	static void act(ActionType action, int actionLength, int actionCounter, BoxObstacle* object, BoxObstacle* shadow); // TODO define this
+	static void act(ActionType action, int actionLength, int actionCounter, float bearing, BoxObstacle* object, BoxObstacle* shadow); // TODO define this
+
+	/**
+	 * Applies one frame of an action to a body angle and velocity, as act() does.
+	 *
+	 * Used to compile action programs into trajectories, so it must be kept
+	 * in step with act().
+	 */
+	static void step(ActionType action, float& angle, b2Vec2& velocity);
 };
 
 #endif /* __M_PEDESTRIAN_H__ */
@@ -26,7 +26,7 @@
 #include <cornell/CUAssetManager.h>
 #include <cornell/CUSceneManager.h>
 #include <math.h>
-#include <ShadowCount.h>
+#include "M_LevelInstance.h"
 
 #define SIGNUM(x)  ((x > 0) - (x < 0))
 
@@ -178,12 +178,26 @@ Shadow* Shadow::create(const Vec2& pos, const Vec2& scale, const b2Filter* const
  * @return  true if the obstacle is initialized properly, false otherwise.
  */
 bool Shadow::init(const Vec2& pos, const Vec2& scale, const b2Filter* const characterFilter, const b2Filter* const sensorFilter) {
-    SceneManager* scene = AssetManager::getInstance()->getCurrent();
-    
     // Multiply by the scaling factor so we can be resolution independent
     float cscale = Director::getInstance()->getContentScaleFactor();
     Size nsize = ((AnimationNode*)getSceneNode())->getContentSize()*cscale;
-    
+    return initWithFrame(pos, nsize, scale, characterFilter, sensorFilter);
+}
+
+/**
+ * Initializes a new dude at the given position, with no scene graph node.
+ *
+ * The dude is sized as if its scene node showed one frame of the given
+ * pixel size.  This allows the dude to be simulated without textures.
+ *
+ * @param  pos      Initial position in world coordinates
+ * @param  frame    The size of one animation frame, in pixels
+ * @param  scale    The drawing scale
+ *
+ * @return  true if the obstacle is initialized properly, false otherwise.
+ */
+bool Shadow::initWithFrame(const Vec2& pos, const Size& frame, const Vec2& scale, const b2Filter* const characterFilter, const b2Filter* const sensorFilter) {
+    Size nsize = frame;
     nsize.width  *= DUDE_HSHRINK/scale.x;
     nsize.height *= DUDE_VSHRINK/scale.y;
 
@@ -200,6 +214,11 @@ bool Shadow::init(const Vec2& pos, const Vec2& scale, const b2Filter* const char
 		// The number of sensors vertically across the character's body
 		_sensorsDown = (int)((getHeight() / SENSOR_INTERVAL) - 0.5f);
 		CCLOG("%i", sensorCount());
+		// Without the grid, a single sensor reports the caster and pedestrians
+		_bodySensorFilter = (sensorFilter != nullptr ? *sensorFilter : b2Filter());
+		_bodySensorFilter.maskBits &= ~SHADOW_BIT;
+		_coverage.init(getDimension(), SHADOW_BIT);
+		_shadowCounts.init(sensorCount());
 		_sensorFixtures = new b2Fixture*[sensorCount()];
 		if (_sensorFixtures != nullptr) {
 			for (int index = 0; index < sensorCount(); index++) {
@@ -244,13 +263,11 @@ void Shadow::setVerticalMovement(float value) {
 }
 
 float Shadow::getCoverRatio() const {
+	if (!_sensorGrid) {
+		return _coverage.getRatio();
+	}
 	if (sensorCount() > 0) {
-		int coveredSensors = 0;
-		for (int sensorIndex = 0; sensorIndex < sensorCount(); sensorIndex++) {
-			if (((ShadowCount*)(_sensorFixtures[sensorIndex]->GetUserData()))->count() > 0)
-				coveredSensors++;
-		}
-		return ((float)coveredSensors) / ((float)sensorCount());
+		return ((float)_shadowCounts.coveredCount()) / ((float)sensorCount());
 	}
 	return 0.0f;
 }
@@ -274,27 +291,34 @@ void Shadow::createFixtures() {
     sensorDef.density = DUDE_DENSITY;
     sensorDef.isSensor = true;
 
+	if (!_sensorGrid) {
+		// Cover is computed by _coverage, so only contacts matter here
+		b2PolygonShape sensorShape;
+		sensorShape.SetAsBox(getWidth() * 0.5f, getHeight() * 0.5f);
+		sensorDef.shape = &sensorShape;
+		sensorDef.filter = _bodySensorFilter;
+		_bodySensor = _body->CreateFixture(&sensorDef);
+		return;
+	}
+
 	if (_sensorFilter != nullptr) {
 		sensorDef.filter = *_sensorFilter;
 	}
 	//_unorderedSets = new usp*[_sensorCount];
 
+	// The new fixtures start outside of every shadow
+	_shadowCounts.reset();
 	for (int acrossIndex = 0; acrossIndex < _sensorsAcross; acrossIndex++) {
 		for (int downIndex = 0; downIndex < _sensorsDown; downIndex++) {
+			int overallindex = acrossIndex * _sensorsDown + downIndex;
 			b2CircleShape sensorShape;
 			sensorShape.m_radius = SENSOR_RADIUS;
-			sensorShape.m_p.Set(SENSOR_INTERVAL * (acrossIndex + 0.5f) - getWidth() * 0.5f,
-				SENSOR_INTERVAL * (downIndex + 0.5f) - getHeight() * 0.5f);
+			sensorShape.m_p = getSensorOffset(overallindex);
 			sensorDef.shape = &sensorShape;
-			_sensorFixtures[acrossIndex * _sensorsDown + downIndex]
-				= _body->CreateFixture(&sensorDef);
-
-			// The user data will hold the set of overlapping shadows
-			register int overallindex = acrossIndex * _sensorsDown + downIndex;
-			/*_unorderedSets[overallindex] = new usp();
-			_sensorFixtures[overallindex]
-				->SetUserData(_unorderedSets[overallindex]); */
-			_sensorFixtures[overallindex]->SetUserData(new ShadowCount());
+			_sensorFixtures[overallindex] = _body->CreateFixture(&sensorDef);
+
+			// The user data holds the index into _shadowCounts
+			_sensorFixtures[overallindex]->SetUserData((void*)(intptr_t)overallindex);
 		}
 	}
 }
@@ -310,12 +334,12 @@ void Shadow::releaseFixtures() {
 	}
 
 	CapsuleObstacle::releaseFixtures();
+	if (_bodySensor != nullptr) {
+		_body->DestroyFixture(_bodySensor);
+		_bodySensor = nullptr;
+	}
 	for (int index = 0; index < sensorCount(); index++) {
 		if (_sensorFixtures[index] != nullptr) {
-			if (_sensorFixtures[index]->GetUserData() != nullptr) {
-				delete _sensorFixtures[index]->GetUserData();
-				_sensorFixtures[index]->SetUserData(nullptr);
-			}
 			_body->DestroyFixture(_sensorFixtures[index]);
 			_sensorFixtures[index] = nullptr;
 			/* delete _unorderedSets[index];
@@ -362,6 +386,22 @@ void Shadow::stopMovement() {
 void Shadow::update(float dt) {
 	// Add stuff here if needed
     CapsuleObstacle::update(dt);
+	if (!_sensorGrid) {
+		_coverage.update(_body);
+	}
+	else if (_shadowField != nullptr && _body != nullptr) {
+		for (int index = 0; index < sensorCount(); index++) {
+			b2Vec2 p = _body->GetWorldPoint(getSensorOffset(index));
+			_shadowCounts.setStatic(index, _shadowField->isShaded(p.x, p.y));
+		}
+	}
+}
+
+b2Vec2 Shadow::getSensorOffset(int index) const {
+	int acrossIndex = index / _sensorsDown;
+	int downIndex = index % _sensorsDown;
+	return b2Vec2(SENSOR_INTERVAL * (acrossIndex + 0.5f) - getWidth() * 0.5f,
+		SENSOR_INTERVAL * (downIndex + 0.5f) - getHeight() * 0.5f);
 }
 
 void Shadow::updateAnimation(bool unlatched) {
@@ -422,13 +462,11 @@ void Shadow::resetDebugNode() {
 }
 
 Shadow::~Shadow() {
+	_coverage.dispose();
+	_shadowCounts.dispose();
 	if (_sensorFixtures != nullptr) {
 		for (int index = 0; index < sensorCount(); index++) {
 			if (_sensorFixtures[index] != nullptr) {
-				if (_sensorFixtures[index]->GetUserData() != nullptr) {
-					delete _sensorFixtures[index]->GetUserData();
-					_sensorFixtures[index]->SetUserData(nullptr);
-				}
 				delete _sensorFixtures[index];
 				_sensorFixtures[index] = nullptr;
 			}
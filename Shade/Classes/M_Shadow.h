@@ -28,6 +28,8 @@
 #include <cornell/CUCapsuleObstacle.h>
 #include <cornell/CUWireNode.h>
 #include <unordered_set>
+#include "ShadowCoverage.h"
+#include "ShadowCount.h"
 
 using namespace cocos2d;
  
@@ -51,6 +53,11 @@ using namespace cocos2d;
 #define DUDE_MAXSPEED   5.0f
 /** The key for the running sound effect */
 #define RUN_SOUND "rnr"
+/**
+ * Whether new characters measure cover with the legacy grid of sensor
+ * fixtures (true) or with the analytic ShadowCoverage engine (false)
+ */
+#define DEFAULT_SENSOR_GRID false
 
 /** The player animation filmstrip attributes */
 #define PLAYER_ROWS 1
@@ -66,6 +73,9 @@ using namespace cocos2d;
  * on a platform.  The round shapes on the end caps lead to smoother movement.
  */
 class Shadow : public CapsuleObstacle {  // TODO change this to PolygonObstacle instead
+	/** Updates _shadowCounts from the sensor contacts */
+	friend class PhysicsController;
+
 private:
     /** This macro disables the copy constructor (not allowed on physics objects) */
     CC_DISALLOW_COPY_AND_ASSIGN(Shadow);
@@ -83,6 +93,8 @@ protected:
 	int _sensorsDown;
 	/** Array holding pointers to the character's sensor fixtures */
 	b2Fixture** _sensorFixtures;
+	/** Shadow counters and covered mask, indexed like _sensorFixtures */
+	ShadowCounts _shadowCounts;
 	/** Array holding pointers to the sets containing the shadow fixtures
 	 * overlapping with the sensor fixture at the respective index of _sensorFixtures */
 	//usp** _unorderedSets;
@@ -92,6 +104,19 @@ protected:
     WireNode* _sensorNode;
 	/** Pointer to the collision filter for the sensor fixtures */
 	const b2Filter* _sensorFilter;
+	/** Whether cover is measured with the grid of sensor fixtures */
+	bool _sensorGrid;
+	/** Single body-sized sensor used for caster and pedestrian contacts when there is no grid */
+	b2Fixture* _bodySensor;
+	/** Collision filter for _bodySensor; the sensor filter without shadows */
+	b2Filter _bodySensorFilter;
+	/** Analytic coverage engine, used when there is no sensor grid */
+	ShadowCoverage _coverage;
+	/** The baked static shadows of the level, or nullptr if there are none */
+	const ShadowField* _shadowField;
+
+	/** Returns the center of the sensor at index, in body coordinates */
+	b2Vec2 getSensorOffset(int index) const;
     
     /**
      * Redraws the outline of the physics fixtures to the debug node
@@ -249,6 +274,48 @@ public:
 
 	/** Returns the portion of the character covered by shadows. */
 	float getCoverRatio() const;
+
+	/**
+	 * Returns the shadow counters and covered mask of the sensor grid.
+	 *
+	 * Sensor (across, down) has index across * getSensorsDown() + down. The
+	 * mask is empty if the character does not use the sensor grid.
+	 *
+	 * @return the shadow counters and covered mask of the sensor grid
+	 */
+	const ShadowCounts& getShadowCounts() const { return _shadowCounts; }
+
+	/** Returns the number of sensor fixtures horizontally */
+	int getSensorsAcross() const { return _sensorsAcross; }
+
+	/** Returns the number of sensor fixtures vertically */
+	int getSensorsDown() const { return _sensorsDown; }
+
+	/** Returns whether cover is measured with the grid of sensor fixtures. */
+	bool hasSensorGrid() const { return _sensorGrid; }
+
+	/**
+	 * Sets whether cover is measured with the grid of sensor fixtures.
+	 *
+	 * If false, the ratio is computed analytically by intersecting the
+	 * capsule with the shadow polygons once per physics step, and the
+	 * character only gets one sensor fixture (for the caster and pedestrians).
+	 * The fixtures are rebuilt on the next update.
+	 *
+	 * @param value whether to use the sensor grid
+	 */
+	void setSensorGrid(bool value) { _sensorGrid = value; markDirty(true); }
+
+	/**
+	 * Sets the baked static shadows of the level.
+	 *
+	 * Static shadows have no fixtures the sensors can touch, so cover from
+	 * them is looked up in the field each update and combined with the
+	 * dynamic shadows found by the sensors (or by the coverage engine).
+	 *
+	 * @param field the baked static shadows, or nullptr for none
+	 */
+	void setShadowField(const ShadowField* field) { _shadowField = field; _coverage.setField(field); }
     
     
 #pragma mark Physics Methods
@@ -303,7 +370,8 @@ CC_CONSTRUCTOR_ACCESS:
      * the defaults.  To use a DudeModel, you must call init().
      */
 	Shadow() : CapsuleObstacle(), _sensorName(SENSOR_NAME),
-		_sensorsAcross(0), _sensorsDown(0), _sensorFixtures(nullptr) { }
+		_sensorsAcross(0), _sensorsDown(0), _sensorFixtures(nullptr),
+		_sensorGrid(DEFAULT_SENSOR_GRID), _bodySensor(nullptr), _shadowField(nullptr) { }
 
 	~Shadow();
 
@@ -373,6 +441,20 @@ CC_CONSTRUCTOR_ACCESS:
 	*/
 	virtual bool init(const Vec2& pos, const Vec2& scale, const b2Filter* const characterFilter, const b2Filter* const sensorFilter);
 
+	/**
+	* Initializes a new dude at the given position, with no scene graph node.
+	*
+	* The dude is sized as if its scene node showed one frame of the given
+	* pixel size.  This allows the dude to be simulated without textures.
+	*
+	* @param  pos      Initial position in world coordinates
+	* @param  frame    The size of one animation frame, in pixels
+	* @param  scale    The drawing scale
+	*
+	* @return  true if the obstacle is initialized properly, false otherwise.
+	*/
+	bool initWithFrame(const Vec2& pos, const Size& frame, const Vec2& scale, const b2Filter* const characterFilter, const b2Filter* const sensorFilter);
+
 	/** The number of sensor fixtures the character has */
 	inline int sensorCount() const { return _sensorsAcross * _sensorsDown; }
 };
@@ -0,0 +1,115 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile() : _bytes(nullptr), _size(0), _mapped(false)
+#if defined(_WIN32)
+	, _mapping(nullptr)
+#endif
+{}
+
+/**
+ * Maps a plain file on disk.
+ *
+ * @return the first byte of the mapping, or nullptr if it failed
+ */
+#if defined(_WIN32)
+static const unsigned char* mapFile(const std::string& path, size_t& size, void*& mapping) {
+	int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+	if (length <= 0) {
+		return nullptr;
+	}
+	std::wstring wide(length, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide[0], length);
+	HANDLE file = CreateFileW(wide.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	LARGE_INTEGER bytes;
+	const unsigned char* view = nullptr;
+	if (GetFileSizeEx(file, &bytes) && bytes.QuadPart > 0) {
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr) {
+			view = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (view == nullptr) {
+				CloseHandle(mapping);
+				mapping = nullptr;
+			}
+			else {
+				size = (size_t)bytes.QuadPart;
+			}
+		}
+	}
+	// The mapping keeps the file open on its own
+	CloseHandle(file);
+	return view;
+}
+#else
+static const unsigned char* mapFile(const std::string& path, size_t& size) {
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return nullptr;
+	}
+	struct stat info;
+	void* view = MAP_FAILED;
+	if (fstat(file, &info) == 0 && info.st_size > 0) {
+		view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED) {
+			size = (size_t)info.st_size;
+		}
+	}
+	// The mapping keeps the file open on its own
+	::close(file);
+	return view == MAP_FAILED ? nullptr : (const unsigned char*)view;
+}
+#endif
+
+bool MappedFile::open(const std::string& file) {
+	close();
+	std::string path = FileUtils::getInstance()->fullPathForFilename(file);
+	if (path.empty()) {
+		return false;
+	}
+
+#if defined(_WIN32)
+	_bytes = mapFile(path, _size, _mapping);
+#else
+	_bytes = mapFile(path, _size);
+#endif
+	if (_bytes != nullptr) {
+		_mapped = true;
+		return true;
+	}
+
+	_copy = FileUtils::getInstance()->getDataFromFile(path);
+	if (_copy.isNull() || _copy.getSize() == 0) {
+		_copy.clear();
+		return false;
+	}
+	_bytes = _copy.getBytes();
+	_size = (size_t)_copy.getSize();
+	return true;
+}
+
+void MappedFile::close() {
+	if (_mapped) {
+#if defined(_WIN32)
+		UnmapViewOfFile(_bytes);
+		CloseHandle(_mapping);
+		_mapping = nullptr;
+#else
+		munmap((void*)_bytes, _size);
+#endif
+	}
+	_copy.clear();
+	_bytes = nullptr;
+	_size = 0;
+	_mapped = false;
+}
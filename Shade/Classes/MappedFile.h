@@ -0,0 +1,66 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <string>
+#include <stddef.h>
+#include <cocos2d.h>
+
+using namespace cocos2d;
+
+/**
+ * Read-only view of the whole contents of a file.
+ *
+ * Where the file is a plain file on disk, it is memory-mapped, so opening
+ * it costs no copy and the pages are only read as they are touched. Where
+ * it cannot be mapped, such as a file inside an Android APK, it is read
+ * into memory with FileUtils instead. Either way the bytes stay valid
+ * until the file is closed.
+ *
+ * The file is closed when the object is destroyed, so it can be held by
+ * value.
+ */
+class MappedFile {
+private:
+	/** The first byte of the file, or nullptr if none is open */
+	const unsigned char* _bytes;
+	/** The size of the file, in bytes */
+	size_t _size;
+	/** The copy of the file, if it could not be mapped */
+	Data _copy;
+	/** Whether _bytes is a mapping rather than _copy */
+	bool _mapped;
+#if defined(_WIN32)
+	/** The file mapping object */
+	void* _mapping;
+#endif
+
+	CC_DISALLOW_COPY_AND_ASSIGN(MappedFile);
+
+public:
+	MappedFile();
+
+	~MappedFile() { close(); }
+
+	/**
+	 * Opens a file, closing any file already open.
+	 *
+	 * @param  file  The file, relative to the resource directory or absolute
+	 *
+	 * @return true if the file exists and is not empty
+	 */
+	bool open(const std::string& file);
+
+	/** Closes the file, invalidating its bytes. */
+	void close();
+
+	/** Returns the bytes of the file, or nullptr if none is open */
+	const unsigned char* getBytes() const { return _bytes; }
+
+	/** Returns the size of the file, in bytes */
+	size_t getSize() const { return _size; }
+
+	/** Returns whether the file was mapped rather than copied */
+	bool isMapped() const { return _mapped; }
+};
+
+#endif /* __MAPPED_FILE_H__ */
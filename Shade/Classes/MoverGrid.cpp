@@ -0,0 +1,83 @@
+#include <math.h>
+#include <algorithm>
+#include "MoverGrid.h"
+
+bool MoverGrid::init(const Size& size, float cellSize) {
+	dispose();
+	if (size.width <= 0.0f || size.height <= 0.0f || cellSize <= 0.0f) {
+		return false;
+	}
+	_cellSize = cellSize;
+	_cols = std::max(1, (int)ceilf(size.width / cellSize));
+	_rows = std::max(1, (int)ceilf(size.height / cellSize));
+	_cellStart.assign(_cols * _rows + 1, 0);
+	return true;
+}
+
+void MoverGrid::dispose() {
+	_cellStart.clear();
+	_entries.clear();
+	_cells.clear();
+	_positions.clear();
+	_cols = _rows = 0;
+	_cellSize = 0.0f;
+}
+
+void MoverGrid::rebuild(const std::vector<b2Body*>& bodies) {
+	_entries.clear();
+	if (_cellStart.empty()) {
+		return;
+	}
+
+	// Count the movers in each cell, offset by one for the prefix sum
+	int count = (int)bodies.size();
+	_cells.resize(count);
+	_positions.resize(count);
+	std::fill(_cellStart.begin(), _cellStart.end(), 0);
+	int placed = 0;
+	for (int ii = 0; ii < count; ii++) {
+		if (bodies[ii] == nullptr) {
+			_cells[ii] = -1;
+			continue;
+		}
+		_positions[ii] = bodies[ii]->GetPosition();
+		_cells[ii] = row(_positions[ii].y) * _cols + column(_positions[ii].x);
+		_cellStart[_cells[ii] + 1]++;
+		placed++;
+	}
+	for (size_t cell = 1; cell < _cellStart.size(); cell++) {
+		_cellStart[cell] += _cellStart[cell - 1];
+	}
+
+	// Scatter, advancing each cell start; then shift the starts back
+	_entries.resize(placed);
+	for (int ii = 0; ii < count; ii++) {
+		if (_cells[ii] >= 0) {
+			_entries[_cellStart[_cells[ii]]++] = ii;
+		}
+	}
+	for (size_t cell = _cellStart.size() - 1; cell > 0; cell--) {
+		_cellStart[cell] = _cellStart[cell - 1];
+	}
+	_cellStart[0] = 0;
+}
+
+void MoverGrid::query(const b2Vec2& center, float radius, std::vector<int>& result) const {
+	if (_entries.empty()) {
+		return;
+	}
+	int col0 = column(center.x - radius);
+	int col1 = column(center.x + radius);
+	int row0 = row(center.y - radius);
+	int row1 = row(center.y + radius);
+	float radius2 = radius * radius;
+	for (int r = row0; r <= row1; r++) {
+		const int* begin = _entries.data() + _cellStart[r * _cols + col0];
+		const int* end = _entries.data() + _cellStart[r * _cols + col1 + 1];
+		for (const int* entry = begin; entry != end; entry++) {
+			if ((_positions[*entry] - center).LengthSquared() <= radius2) {
+				result.push_back(*entry);
+			}
+		}
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef __MOVER_GRID_H__
+#define __MOVER_GRID_H__
+
+#include <vector>
+#include <cocos2d.h>
+#include <Box2D/Dynamics/b2Body.h>
+
+/** The side of one cell of a mover grid, in Box2D units */
+#define MOVER_GRID_CELL 4.0f
+
+using namespace cocos2d;
+
+/**
+ * Uniform grid over the positions of a set of movers.
+ *
+ * The grid is rebuilt from the mover bodies once per frame with a counting
+ * sort, so each cell's movers are contiguous and nothing is allocated once
+ * the arrays have grown to the mover count. A radius query visits only the
+ * cells overlapping the query circle, so its cost is proportional to the
+ * number of movers near the center rather than to the size of the level.
+ *
+ * Movers are identified by their index in the body array given to rebuild().
+ */
+class MoverGrid {
+private:
+	/** The index of the first entry of each cell; one extra at the end */
+	std::vector<int> _cellStart;
+	/** Mover indices, sorted by cell */
+	std::vector<int> _entries;
+	/** The cell of every mover at the last rebuild */
+	std::vector<int> _cells;
+	/** The position of every mover at the last rebuild */
+	std::vector<b2Vec2> _positions;
+	/** The number of columns */
+	int _cols;
+	/** The number of rows */
+	int _rows;
+	/** The side of one cell, in Box2D units */
+	float _cellSize;
+
+	/** Returns the column holding x, clamped to the grid */
+	int column(float x) const {
+		int col = (int)(x / _cellSize);
+		return col < 0 ? 0 : (col >= _cols ? _cols - 1 : col);
+	}
+
+	/** Returns the row holding y, clamped to the grid */
+	int row(float y) const {
+		int row = (int)(y / _cellSize);
+		return row < 0 ? 0 : (row >= _rows ? _rows - 1 : row);
+	}
+
+public:
+	MoverGrid() : _cols(0), _rows(0), _cellSize(0.0f) {}
+
+	/**
+	 * Allocates an empty grid covering a level of the given size.
+	 *
+	 * Movers outside of the level are kept in the nearest border cell.
+	 *
+	 * @param  size      The level dimensions, in Box2D units
+	 * @param  cellSize  The side of one cell, in Box2D units
+	 *
+	 * @return true if the grid is non-empty
+	 */
+	bool init(const Size& size, float cellSize = MOVER_GRID_CELL);
+
+	/** Releases the grid. */
+	void dispose();
+
+	/**
+	 * Sorts the given bodies into the grid by their current position.
+	 *
+	 * A null body is kept out of the grid.
+	 *
+	 * @param  bodies  The body of every mover
+	 */
+	void rebuild(const std::vector<b2Body*>& bodies);
+
+	/**
+	 * Appends the index of every mover within a radius of a point.
+	 *
+	 * The indices are appended in no particular order.
+	 *
+	 * @param  center  The center of the query, in Box2D units
+	 * @param  radius  The query radius, in Box2D units
+	 * @param  result  The vector to append to
+	 */
+	void query(const b2Vec2& center, float radius, std::vector<int>& result) const;
+
+	/** Returns the position of a mover at the last rebuild */
+	const b2Vec2& getPosition(int index) const { return _positions[index]; }
+
+	/** Returns the number of movers in the grid */
+	int size() const { return (int)_entries.size(); }
+};
+
+#endif /* __MOVER_GRID_H__ */
@@ -0,0 +1,13 @@
+#include "MoverLOD.h"
+#include "C_AI.h"
+
+static_assert(LOD_WAKE_RADIUS > PEDESTRIAN_LOSE_RADIUS, "A pedestrian the AI may steer must be awake");
+static_assert(LOD_PARK_RADIUS > LOD_WAKE_RADIUS, "Movers must wake closer than they park");
+
+void MoverLOD::update(MoverRegistry& movers, const b2Vec2& focus, const Rect& view) {
+	if (!_enabled && getParked(movers) == 0) {
+		return;
+	}
+	update(movers.cars, focus, view);
+	update(movers.pedestrians, focus, view);
+}
@@ -0,0 +1,97 @@
+#ifndef __MOVER_LOD_H__
+#define __MOVER_LOD_H__
+
+#include <cocos2d.h>
+#include <Box2D/Common/b2Math.h>
+#include <M_MoverRegistry.h>
+
+/** Distance from the focus within which a parked mover is put back, in Box2D units */
+#define LOD_WAKE_RADIUS 16.0f
+/** Distance from the focus beyond which a mover may be parked, in Box2D units */
+#define LOD_PARK_RADIUS 20.0f
+/** How far around the view a parked mover is put back, in Box2D units */
+#define LOD_VIEW_MARGIN 2.0f
+
+using namespace cocos2d;
+
+/**
+ * Distance-based level of detail for the movers of a level.
+ *
+ * Each frame, a mover far from the focus (the character) and outside the
+ * view is parked: its bodies leave the Box2D broadphase and it is moved
+ * along its compiled action program instead (see MoverArray::park). A
+ * parked mover that comes back within range is woken with the exact state
+ * it would have had. The wake distance is below the park distance, so a
+ * mover at the boundary does not toggle every frame.
+ *
+ * Only a mover touching the character can shade it, and the wake radius is
+ * far larger than any mover shadow, so parking never changes the cover.
+ * It is also larger than the pedestrian lose radius, so every pedestrian
+ * the AI might steer is awake.
+ */
+class MoverLOD {
+private:
+	/** Whether movers are parked at all */
+	bool _enabled;
+
+	/** Returns whether a point is within a radius of the focus or near the view */
+	static bool isNear(const b2Vec2& pos, const b2Vec2& focus, float radius, const Rect& view, float margin) {
+		if ((pos - focus).LengthSquared() <= radius * radius) {
+			return true;
+		}
+		return view.size.width > 0.0f
+			&& pos.x >= view.getMinX() - margin && pos.x <= view.getMaxX() + margin
+			&& pos.y >= view.getMinY() - margin && pos.y <= view.getMaxY() + margin;
+	}
+
+	/** Parks and wakes the movers of one kind, or only wakes them if disabled */
+	template <class T>
+	void update(MoverArray<T>& movers, const b2Vec2& focus, const Rect& view) {
+		for (int ii = 0; ii < movers.size(); ii++) {
+			if (movers.isSteered(ii)) {
+				continue;
+			}
+			const b2Vec2& pos = movers.getBody(ii)->GetPosition();
+			if (movers.isParked(ii)) {
+				if (!_enabled || isNear(pos, focus, LOD_WAKE_RADIUS, view, LOD_VIEW_MARGIN)) {
+					movers.wake(ii);
+				}
+			}
+			else if (_enabled && !isNear(pos, focus, LOD_PARK_RADIUS, view, 2.0f * LOD_VIEW_MARGIN)) {
+				movers.park(ii);
+			}
+		}
+	}
+
+public:
+	MoverLOD() : _enabled(true) {}
+
+	/** Returns whether movers are parked at all */
+	bool isEnabled() const { return _enabled; }
+
+	/**
+	 * Sets whether movers are parked at all.
+	 *
+	 * Turning this off wakes every parked mover at the next update.
+	 */
+	void setEnabled(bool value) { _enabled = value; }
+
+	/**
+	 * Parks the movers out of range and wakes the ones back in range.
+	 *
+	 * Call this once per frame, before the movers act.
+	 *
+	 * @param  movers  The movers of the level
+	 * @param  focus   The position of the character, in Box2D units
+	 * @param  view    The visible part of the level, in Box2D units, or an
+	 *                 empty rectangle if nothing is drawn
+	 */
+	void update(MoverRegistry& movers, const b2Vec2& focus, const Rect& view);
+
+	/** Returns the number of movers parked now */
+	static int getParked(const MoverRegistry& movers) {
+		return movers.cars.getParkedCount() + movers.pedestrians.getParkedCount();
+	}
+};
+
+#endif /* __MOVER_LOD_H__ */
@@ -0,0 +1,185 @@
+#include <math.h>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+#include "OccluderBVH.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OCCLUDER_SSE 1
+#endif
+
+/** The child of an unused slot */
+#define OCCLUDER_EMPTY INT_MIN
+/** Stands in for the reciprocal of a zero direction, and for no bounds */
+#define OCCLUDER_HUGE 1e30f
+
+/**
+ * Returns a bit mask of the slots of a node that a segment touches.
+ *
+ * This is the slab test: the segment p + t * d, t in [0, 1], is clipped
+ * to the x and y extents of each box in turn. An empty slot has bounds
+ * far out of reach, so it is never hit. The reciprocal of a zero
+ * component is a large finite number instead of infinity, so no product
+ * here can be 0 * inf and the comparisons never see a NaN.
+ */
+static inline int slabTest(const float* minx, const float* miny, const float* maxx, const float* maxy,
+						   float px, float py, float ix, float iy) {
+#ifdef OCCLUDER_SSE
+	__m128 vpx = _mm_set1_ps(px);
+	__m128 vpy = _mm_set1_ps(py);
+	__m128 vix = _mm_set1_ps(ix);
+	__m128 viy = _mm_set1_ps(iy);
+	__m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(minx), vpx), vix);
+	__m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(maxx), vpx), vix);
+	__m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(miny), vpy), viy);
+	__m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(maxy), vpy), viy);
+	__m128 tmin = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_setzero_ps());
+	__m128 tmax = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_set1_ps(1.0f));
+	return _mm_movemask_ps(_mm_cmple_ps(tmin, tmax));
+#else
+	// Written lane by lane so the compiler can vectorize it where it knows how
+	int mask = 0;
+	for (int ii = 0; ii < OCCLUDER_WIDTH; ii++) {
+		float tx1 = (minx[ii] - px) * ix;
+		float tx2 = (maxx[ii] - px) * ix;
+		float ty1 = (miny[ii] - py) * iy;
+		float ty2 = (maxy[ii] - py) * iy;
+		float tmin = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), 0.0f);
+		float tmax = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), 1.0f);
+		mask |= (tmin <= tmax ? 1 : 0) << ii;
+	}
+	return mask;
+#endif
+}
+
+/** Returns the reciprocal of a direction component, finite even for zero */
+static inline float safeInverse(float d) {
+	if (fabsf(d) < 1.0f / OCCLUDER_HUGE) {
+		return d < 0.0f ? -OCCLUDER_HUGE : OCCLUDER_HUGE;
+	}
+	return 1.0f / d;
+}
+
+void OccluderBVH::addBox(const Vec2& center, const Size& size) {
+	Box box;
+	box.minx = center.x - size.width * 0.5f;
+	box.miny = center.y - size.height * 0.5f;
+	box.maxx = center.x + size.width * 0.5f;
+	box.maxy = center.y + size.height * 0.5f;
+	_boxes.push_back(box);
+}
+
+void OccluderBVH::build() {
+	_nodes.clear();
+	if (_boxes.empty()) {
+		return;
+	}
+	std::vector<int> order(_boxes.size());
+	for (int ii = 0; ii < (int)order.size(); ii++) {
+		order[ii] = ii;
+	}
+	_nodes.reserve(_boxes.size() / 2 + 1);
+	buildNode(order, 0, (int)order.size());
+}
+
+void OccluderBVH::dispose() {
+	_boxes.clear();
+	_nodes.clear();
+}
+
+int OccluderBVH::buildNode(std::vector<int>& order, int begin, int end) {
+	int index = (int)_nodes.size();
+	Node node;
+	for (int ii = 0; ii < OCCLUDER_WIDTH; ii++) {
+		node.minx[ii] = node.miny[ii] = node.maxx[ii] = node.maxy[ii] = OCCLUDER_HUGE;
+		node.child[ii] = OCCLUDER_EMPTY;
+	}
+	_nodes.push_back(node);
+
+	// Sort along the longest axis of the centroids, so the quarters are compact
+	int count = end - begin;
+	if (count > OCCLUDER_WIDTH) {
+		float cx0 = OCCLUDER_HUGE, cy0 = OCCLUDER_HUGE, cx1 = -OCCLUDER_HUGE, cy1 = -OCCLUDER_HUGE;
+		for (int ii = begin; ii < end; ii++) {
+			const Box& box = _boxes[order[ii]];
+			float cx = box.minx + box.maxx;
+			float cy = box.miny + box.maxy;
+			cx0 = std::min(cx0, cx); cx1 = std::max(cx1, cx);
+			cy0 = std::min(cy0, cy); cy1 = std::max(cy1, cy);
+		}
+		const std::vector<Box>& boxes = _boxes;
+		if (cx1 - cx0 >= cy1 - cy0) {
+			std::sort(order.begin() + begin, order.begin() + end, [&boxes](int a, int b) {
+				return boxes[a].minx + boxes[a].maxx < boxes[b].minx + boxes[b].maxx;
+			});
+		} else {
+			std::sort(order.begin() + begin, order.begin() + end, [&boxes](int a, int b) {
+				return boxes[a].miny + boxes[a].maxy < boxes[b].miny + boxes[b].maxy;
+			});
+		}
+	}
+
+	int slots = std::min(count, OCCLUDER_WIDTH);
+	for (int ii = 0; ii < slots; ii++) {
+		int first = begin + count * ii / slots;
+		int last = begin + count * (ii + 1) / slots;
+		float minx = OCCLUDER_HUGE, miny = OCCLUDER_HUGE, maxx = -OCCLUDER_HUGE, maxy = -OCCLUDER_HUGE;
+		for (int jj = first; jj < last; jj++) {
+			const Box& box = _boxes[order[jj]];
+			minx = std::min(minx, box.minx); maxx = std::max(maxx, box.maxx);
+			miny = std::min(miny, box.miny); maxy = std::max(maxy, box.maxy);
+		}
+		int child = (last - first == 1 ? -1 - order[first] : buildNode(order, first, last));
+
+		// The recursion may have moved the node, so write it by index
+		Node& slot = _nodes[index];
+		slot.minx[ii] = minx;
+		slot.miny[ii] = miny;
+		slot.maxx[ii] = maxx;
+		slot.maxy[ii] = maxy;
+		slot.child[ii] = child;
+	}
+	return index;
+}
+
+bool OccluderBVH::isOccluded(const b2Vec2& from, const b2Vec2& to) const {
+	if (_nodes.empty()) {
+		return false;
+	}
+	float ix = safeInverse(to.x - from.x);
+	float iy = safeInverse(to.y - from.y);
+
+	int stack[OCCLUDER_STACK];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = _nodes[stack[--top]];
+		int mask = slabTest(node.minx, node.miny, node.maxx, node.maxy, from.x, from.y, ix, iy);
+		for (int ii = 0; mask != 0; ii++, mask >>= 1) {
+			if ((mask & 1) == 0) {
+				continue;
+			}
+			int child = node.child[ii];
+			if (child < 0) {
+				// A leaf slot is bounded by its occluder, so the hit is exact
+				return true;
+			}
+			CCASSERT(top < OCCLUDER_STACK, "Occluder tree too deep");
+			stack[top++] = child;
+		}
+	}
+	return false;
+}
+
+void OccluderBVH::test(const SightLine* lines, int count, uint32_t* bits) const {
+	memset(bits, 0, sizeof(uint32_t) * ((count + 31) / 32));
+	if (_nodes.empty()) {
+		return;
+	}
+	for (int ii = 0; ii < count; ii++) {
+		if (isOccluded(lines[ii].from, lines[ii].to)) {
+			bits[ii >> 5] |= 1u << (ii & 31);
+		}
+	}
+}
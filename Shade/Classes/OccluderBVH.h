@@ -0,0 +1,110 @@
+#ifndef __OCCLUDER_BVH_H__
+#define __OCCLUDER_BVH_H__
+
+#include <vector>
+#include <stdint.h>
+#include <cocos2d.h>
+#include <Box2D/Common/b2Math.h>
+
+/** The number of children of each tree node, tested together */
+#define OCCLUDER_WIDTH 4
+/** The deepest a query may descend; far more than any level needs */
+#define OCCLUDER_STACK 64
+
+using namespace cocos2d;
+
+/** A line of sight, from a viewer to what it looks at */
+struct SightLine {
+	/** The viewer, in Box2D units */
+	b2Vec2 from;
+	/** The target, in Box2D units */
+	b2Vec2 to;
+};
+
+/**
+ * Bounding volume hierarchy over the static occluders of a level.
+ *
+ * The occluders are the building footprints, which are axis-aligned boxes
+ * that never move, so the tree is built once when the level is populated.
+ * Each node holds the bounds of its four children side by side, so one
+ * segment is tested against all four with a handful of SIMD instructions.
+ * A leaf slot holds a single footprint, whose bounds are the footprint
+ * itself, so reaching a leaf answers the query exactly.
+ *
+ * Queries only read the tree and allocate nothing, so any number of
+ * threads may run them at once once the tree is built.
+ */
+class OccluderBVH {
+private:
+	/** An axis-aligned occluder, in Box2D units */
+	struct Box {
+		float minx, miny, maxx, maxy;
+	};
+
+	/** The bounds of four child slots, side by side for SIMD loads */
+	struct Node {
+		float minx[OCCLUDER_WIDTH];
+		float miny[OCCLUDER_WIDTH];
+		float maxx[OCCLUDER_WIDTH];
+		float maxy[OCCLUDER_WIDTH];
+		/** A node index, a leaf as -1 - box, or OCCLUDER_EMPTY */
+		int child[OCCLUDER_WIDTH];
+	};
+
+	/** The occluders */
+	std::vector<Box> _boxes;
+	/** The tree, root first; empty if there are no occluders */
+	std::vector<Node> _nodes;
+
+	/** Builds the subtree over order[begin, end) and returns its node index */
+	int buildNode(std::vector<int>& order, int begin, int end);
+
+public:
+	OccluderBVH() {}
+
+	/**
+	 * Adds a box that blocks sight.
+	 *
+	 * All boxes must be added before the tree is built.
+	 *
+	 * @param  center  The center of the box, in Box2D units
+	 * @param  size    The dimensions of the box, in Box2D units
+	 */
+	void addBox(const Vec2& center, const Size& size);
+
+	/** Builds the tree over every box added so far. */
+	void build();
+
+	/** Forgets the tree and the boxes. */
+	void dispose();
+
+	/** Returns the number of occluders */
+	int size() const { return (int)_boxes.size(); }
+
+	/**
+	 * Returns whether a segment touches any occluder.
+	 *
+	 * @param  from  One end of the segment, in Box2D units
+	 * @param  to    The other end of the segment, in Box2D units
+	 */
+	bool isOccluded(const b2Vec2& from, const b2Vec2& to) const;
+
+	/**
+	 * Tests a batch of lines of sight.
+	 *
+	 * Bit i of the result is set if line i is blocked, with 32 lines per
+	 * word, least significant bit first.
+	 *
+	 * @param  lines  The lines to test
+	 * @param  count  The number of lines
+	 * @param  bits   The (count + 31) / 32 words to write
+	 */
+	void test(const SightLine* lines, int count, uint32_t* bits) const;
+
+	/** Returns bit i of a result written by test() */
+	static bool isSet(const uint32_t* bits, int index) {
+		return ((bits[index >> 5] >> (index & 31)) & 1u) != 0;
+	}
+};
+
+#endif /* __OCCLUDER_BVH_H__ */
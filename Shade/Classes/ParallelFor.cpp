@@ -0,0 +1,77 @@
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include "ParallelFor.h"
+
+/** The shared state of one run, which lives on the caller's stack */
+struct ParallelRun {
+	/** The first index not yet claimed */
+	std::atomic<int> next;
+	/** The helpers that have not finished */
+	int pending;
+	/** Guards pending */
+	std::mutex mutex;
+	/** Signalled when the last helper finishes */
+	std::condition_variable done;
+
+	ParallelRun(int helpers) : next(0), pending(helpers) {}
+
+	/** Claims and runs chunks until none are left */
+	void work(int count, int grain, const std::function<void(int, int)>& body) {
+		for (int begin = next.fetch_add(grain); begin < count; begin = next.fetch_add(grain)) {
+			body(begin, std::min(count, begin + grain));
+		}
+	}
+};
+
+bool ParallelFor::init(int helpers) {
+	dispose();
+	if (helpers < 0) {
+		helpers = (int)std::thread::hardware_concurrency() - 1;
+	}
+	if (helpers <= 0) {
+		return false;
+	}
+	_pool = ThreadPool::create(helpers);
+	_pool->retain();
+	_helpers = helpers;
+	return true;
+}
+
+void ParallelFor::dispose() {
+	if (_pool != nullptr) {
+		_pool->stop();
+		_pool->release();
+		_pool = nullptr;
+	}
+	_helpers = 0;
+}
+
+void ParallelFor::run(int count, int grain, const std::function<void(int, int)>& body) {
+	if (count <= 0) {
+		return;
+	}
+	grain = std::max(1, grain);
+	int chunks = (count + grain - 1) / grain;
+	int helpers = std::min(_helpers, chunks - 1);
+	if (_pool == nullptr || helpers <= 0) {
+		body(0, count);
+		return;
+	}
+
+	ParallelRun state(helpers);
+	for (int ii = 0; ii < helpers; ii++) {
+		_pool->addTask([&state, count, grain, &body] {
+			state.work(count, grain, body);
+			std::unique_lock<std::mutex> lock(state.mutex);
+			if (--state.pending == 0) {
+				state.done.notify_one();
+			}
+		});
+	}
+	state.work(count, grain, body);
+
+	// The state is on this stack, so wait for every helper to let go of it
+	std::unique_lock<std::mutex> lock(state.mutex);
+	state.done.wait(lock, [&state] { return state.pending == 0; });
+}
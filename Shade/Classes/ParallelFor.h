@@ -0,0 +1,64 @@
+#ifndef __PARALLEL_FOR_H__
+#define __PARALLEL_FOR_H__
+
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+#include <cornell.h>
+
+using namespace cocos2d;
+
+/**
+ * Blocking parallel loop over an index range, on a ThreadPool.
+ *
+ * The range is cut into chunks of a fixed grain, which the helper threads
+ * and the calling thread claim in turn until none are left. run() returns
+ * only once every chunk is done, so the body may write to per-index
+ * buffers owned by the caller. Which thread runs a chunk varies from run
+ * to run, so a body must not depend on it: each index should only read
+ * shared state and write its own output.
+ *
+ * A loop too short for two chunks runs inline on the calling thread.
+ */
+class ParallelFor {
+private:
+	/** The helper threads, or nullptr if the loop runs inline */
+	ThreadPool* _pool;
+	/** The number of helper threads */
+	int _helpers;
+
+public:
+	ParallelFor() : _pool(nullptr), _helpers(0) {}
+
+	~ParallelFor() { dispose(); }
+
+	/**
+	 * Starts the helper threads.
+	 *
+	 * @param  helpers  The number of helper threads, or a negative number
+	 *                  for one less than the hardware threads
+	 *
+	 * @return true if there is at least one helper
+	 */
+	bool init(int helpers = -1);
+
+	/** Stops the helper threads. Later loops run inline. */
+	void dispose();
+
+	/** Returns whether there are helper threads */
+	bool isActive() const { return _pool != nullptr; }
+
+	/** Returns the number of helper threads */
+	int getHelpers() const { return _helpers; }
+
+	/**
+	 * Runs body over [0, count) in chunks, and waits for all of them.
+	 *
+	 * @param  count  The number of indices
+	 * @param  grain  The number of indices in each chunk
+	 * @param  body   The loop body, called with the [begin, end) of a chunk
+	 */
+	void run(int count, int grain, const std::function<void(int, int)>& body);
+};
+
+#endif /* __PARALLEL_FOR_H__ */
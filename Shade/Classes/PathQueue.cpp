@@ -0,0 +1,174 @@
+#include "PathQueue.h"
+
+bool PathQueue::init(const LevelNavMesh* mesh, int agents) {
+	dispose();
+	if (mesh == nullptr || !mesh->isBuilt() || agents <= 0) {
+		return false;
+	}
+	_query = dtAllocNavMeshQuery();
+	if (_query == nullptr || dtStatusFailed(_query->init(mesh->getNavMesh(), PATH_MAX_NODES))) {
+		dtFreeNavMeshQuery(_query);
+		_query = nullptr;
+		return false;
+	}
+	_filter.setIncludeFlags(NAV_FLAG_WALK);
+	_filter.setExcludeFlags(0);
+	_mesh = mesh;
+	_tickets.assign(agents, 0);
+	_pending.assign(agents, 0);
+
+	_worker = ThreadPool::create(1);
+	_worker->retain();
+	return true;
+}
+
+void PathQueue::dispose() {
+	if (_worker != nullptr) {
+		// Joins the worker, so nothing touches the query after this, even if
+		// the pool outlives the release; stopping it again when it is freed is safe
+		_worker->stop();
+		_worker->release();
+		_worker = nullptr;
+	}
+	if (_query != nullptr) {
+		dtFreeNavMeshQuery(_query);
+		_query = nullptr;
+	}
+	_requests.clear();
+	_results.clear();
+	_tickets.clear();
+	_pending.clear();
+	_mesh = nullptr;
+}
+
+unsigned int PathQueue::request(int agent, const b2Vec2& start, const b2Vec2& goal) {
+	if (_worker == nullptr || agent < 0 || agent >= (int)_tickets.size()) {
+		return 0;
+	}
+	// Zero is never a ticket
+	if (++_nextTicket == 0) {
+		++_nextTicket;
+	}
+	_tickets[agent] = _nextTicket;
+	_pending[agent] = 1;
+
+	PathRequest req;
+	req.agent = agent;
+	req.ticket = _nextTicket;
+	req.start = start;
+	req.goal = goal;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		for (PathRequest& waiting : _requests) {
+			if (waiting.agent == agent) {
+				waiting = req;
+				return req.ticket;
+			}
+		}
+		_requests.push_back(req);
+	}
+	_worker->addTask([this] { service(); });
+	return req.ticket;
+}
+
+void PathQueue::cancel(int agent) {
+	if (agent < 0 || agent >= (int)_tickets.size()) {
+		return;
+	}
+	// Results are matched against the latest ticket, so a fresh one orphans them
+	if (++_nextTicket == 0) {
+		++_nextTicket;
+	}
+	_tickets[agent] = _nextTicket;
+	_pending[agent] = 0;
+}
+
+void PathQueue::clear() {
+	for (int agent = 0; agent < (int)_tickets.size(); agent++) {
+		cancel(agent);
+	}
+	std::unique_lock<std::mutex> lock(_mutex);
+	_requests.clear();
+	_results.clear();
+}
+
+void PathQueue::poll(std::vector<PathResult>& out) {
+	out.clear();
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		out.swap(_results);
+	}
+	size_t kept = 0;
+	for (size_t ii = 0; ii < out.size(); ii++) {
+		PathResult& result = out[ii];
+		if (result.agent < 0 || result.agent >= (int)_tickets.size() || _tickets[result.agent] != result.ticket) {
+			continue;
+		}
+		_pending[result.agent] = 0;
+		if (kept != ii) {
+			std::swap(out[kept], result);
+		}
+		kept++;
+	}
+	out.resize(kept);
+}
+
+void PathQueue::service() {
+	PathRequest req;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_requests.empty()) {
+			return;
+		}
+		req = _requests.front();
+		_requests.pop_front();
+	}
+
+	PathResult result;
+	search(req, result);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_results.push_back(std::move(result));
+}
+
+void PathQueue::search(const PathRequest& request, PathResult& result) {
+	result.agent = request.agent;
+	result.ticket = request.ticket;
+	result.found = false;
+	result.points.clear();
+
+	// Box2D (x, y) is mesh (x, 0, y)
+	const float extents[3] = { PATH_SNAP_DISTANCE, 1.0f, PATH_SNAP_DISTANCE };
+	const float start[3] = { request.start.x, 0.0f, request.start.y };
+	const float goal[3] = { request.goal.x, 0.0f, request.goal.y };
+	float spos[3];
+	float gpos[3];
+	dtPolyRef startRef = 0;
+	dtPolyRef goalRef = 0;
+	_query->findNearestPoly(start, extents, &_filter, &startRef, spos);
+	_query->findNearestPoly(goal, extents, &_filter, &goalRef, gpos);
+	if (startRef == 0 || goalRef == 0) {
+		return;
+	}
+
+	dtPolyRef corridor[PATH_MAX_POLYS];
+	int polys = 0;
+	if (dtStatusFailed(_query->findPath(startRef, goalRef, spos, gpos, &_filter, corridor, &polys, PATH_MAX_POLYS)) || polys == 0) {
+		return;
+	}
+	// A partial path ends at the reachable point nearest the goal
+	if (corridor[polys - 1] != goalRef) {
+		_query->closestPointOnPoly(corridor[polys - 1], gpos, gpos, nullptr);
+	}
+
+	float straight[PATH_MAX_POINTS * 3];
+	int points = 0;
+	if (dtStatusFailed(_query->findStraightPath(spos, gpos, corridor, polys, straight, nullptr, nullptr, &points, PATH_MAX_POINTS))) {
+		return;
+	}
+	// The first point is the start itself
+	for (int ii = 1; ii < points; ii++) {
+		result.points.push_back(b2Vec2(straight[ii * 3], straight[ii * 3 + 2]));
+	}
+	result.found = true;
+}
@@ -0,0 +1,148 @@
+#ifndef __PATH_QUEUE_H__
+#define __PATH_QUEUE_H__
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <cornell.h>
+#include <Box2D/Common/b2Math.h>
+#include "recast/Detour/DetourNavMeshQuery.h"
+#include "LevelNavMesh.h"
+
+/** The most polygons a path corridor may cross */
+#define PATH_MAX_POLYS 256
+/** The most waypoints in one path */
+#define PATH_MAX_POINTS 32
+/** The most search nodes the worker query may use */
+#define PATH_MAX_NODES 2048
+/** How far from the mesh a path end may be snapped, in Box2D units */
+#define PATH_SNAP_DISTANCE 2.0f
+
+using namespace cocos2d;
+
+/** A path found by the PathQueue worker */
+struct PathResult {
+	/** The agent that asked for the path */
+	int agent;
+	/** The ticket returned by the request */
+	unsigned int ticket;
+	/** Whether any path was found; a partial path still counts */
+	bool found;
+	/** The waypoints after the start, ending at the goal, in Box2D units */
+	std::vector<b2Vec2> points;
+};
+
+/**
+ * Asynchronous path requests against a LevelNavMesh.
+ *
+ * Paths are found on a single worker thread of a ThreadPool, which owns
+ * the only Detour query object, so no path search ever runs on the game
+ * thread. Agents are small integers chosen by the caller. Each agent has
+ * at most one request waiting: asking again before the worker gets to it
+ * replaces the waiting request, and a result is only delivered if it
+ * answers the agent's latest request. So a mover can re-plan every frame
+ * without flooding the worker or acting on a stale path.
+ *
+ * request(), cancel() and poll() must all be called from the game thread.
+ */
+class PathQueue {
+private:
+	/** A path search waiting for the worker */
+	struct PathRequest {
+		int agent;
+		unsigned int ticket;
+		b2Vec2 start;
+		b2Vec2 goal;
+	};
+
+	/** The worker thread */
+	ThreadPool* _worker;
+	/** The mesh being searched, owned by the level */
+	const LevelNavMesh* _mesh;
+	/** The query object, used only by the worker */
+	dtNavMeshQuery* _query;
+	/** The polygon filter, used only by the worker */
+	dtQueryFilter _filter;
+
+	/** Guards _requests and _results */
+	std::mutex _mutex;
+	/** The requests the worker has not started */
+	std::deque<PathRequest> _requests;
+	/** The results the game thread has not polled */
+	std::vector<PathResult> _results;
+
+	/** The latest ticket of each agent; game thread only */
+	std::vector<unsigned int> _tickets;
+	/** Non-zero for each agent whose latest request is unanswered; game thread only */
+	std::vector<unsigned char> _pending;
+	/** The last ticket handed out; game thread only */
+	unsigned int _nextTicket;
+
+	/** Takes the oldest request and searches for its path. Runs on the worker. */
+	void service();
+
+	/** Searches the mesh between two points, filling the result. Runs on the worker. */
+	void search(const PathRequest& request, PathResult& result);
+
+public:
+	PathQueue() : _worker(nullptr), _mesh(nullptr), _query(nullptr), _nextTicket(0) {}
+
+	~PathQueue() { dispose(); }
+
+	/**
+	 * Starts the worker on a built mesh.
+	 *
+	 * @param  mesh    The mesh to search, which must outlive the queue
+	 * @param  agents  The number of agents, which are numbered from 0
+	 *
+	 * @return true if the mesh is built and the worker started
+	 */
+	bool init(const LevelNavMesh* mesh, int agents);
+
+	/**
+	 * Stops the worker and drops every request and result.
+	 *
+	 * This blocks until any search in progress is done.
+	 */
+	void dispose();
+
+	/** Returns whether the worker is running */
+	bool isActive() const { return _worker != nullptr; }
+
+	/**
+	 * Asks for a path for an agent, replacing any request it has waiting.
+	 *
+	 * @param  agent  The agent to find a path for
+	 * @param  start  Where the agent is, in Box2D units
+	 * @param  goal   Where the agent wants to be, in Box2D units
+	 *
+	 * @return the ticket of the request, or 0 if the queue is not running
+	 */
+	unsigned int request(int agent, const b2Vec2& start, const b2Vec2& goal);
+
+	/** Drops the agent's request, so no result is delivered for it. */
+	void cancel(int agent);
+
+	/**
+	 * Drops the request of every agent, keeping the worker.
+	 *
+	 * A search in progress still finishes, but its result is never delivered.
+	 */
+	void clear();
+
+	/** Returns whether the agent has a request with no result yet */
+	bool isPending(int agent) const { return agent >= 0 && agent < (int)_pending.size() && _pending[agent] != 0; }
+
+	/**
+	 * Moves every finished, current result into out.
+	 *
+	 * Results for cancelled or replaced requests are dropped. The vector is
+	 * cleared first, then swapped with the queue's, so the lock is only held
+	 * for the swap.
+	 *
+	 * @param  out  The vector to receive the results
+	 */
+	void poll(std::vector<PathResult>& out);
+};
+
+#endif /* __PATH_QUEUE_H__ */
@@ -0,0 +1,220 @@
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+#include <cornell/CUTimestamp.h>
+#include "PlaytestBot.h"
+#include "C_Gameplay.h"
+
+/** Serializes level loading, since the autorelease pool is not thread safe */
+static std::mutex loadMutex;
+
+#pragma mark -
+#pragma mark Playtest Bot
+
+void PlaytestBot::init(unsigned int seed) {
+	_rng.seed(seed);
+	_route.clear();
+	_frame = 0;
+	_resting = false;
+	// Each seed plays a little differently, from careful to reckless
+	_restAt = uniform(0.4f, 0.9f) * EXPOSURE_LIMIT;
+	_latchChance = uniform(0.0f, 1.0f);
+	_jitter = uniform(0.0f, BOT_MAX_JITTER);
+}
+
+float PlaytestBot::uniform(float lo, float hi) {
+	return std::uniform_real_distribution<float>(lo, hi)(_rng);
+}
+
+bool PlaytestBot::findRide(SimulationController& sim, Vec2& out) const {
+	LevelInstance* level = sim.getLevel();
+	Vec2 player = level->_playerPos.object->getPosition();
+	Vec2 toCaster = level->_casterPos.object->getObject()->getPosition() - player;
+	float best = LATCH_LIMIT_SQUARED;
+	bool found = false;
+
+	MoverArray<Car>& cars = level->_movers.cars;
+	for (int ii = 0; ii < cars.size(); ii++) {
+		BoxObstacle* shadow = cars.get(ii)->getShadow();
+		if (shadow == nullptr || cars.isParked(ii) || shadow->getLinearVelocity().dot(toCaster) <= 0.0f) {
+			continue;
+		}
+		float dist = (shadow->getPosition() - player).lengthSquared();
+		if (dist < best) {
+			best = dist;
+			out = shadow->getPosition();
+			found = true;
+		}
+	}
+	MoverArray<Pedestrian>& pedestrians = level->_movers.pedestrians;
+	for (int ii = 0; ii < pedestrians.size(); ii++) {
+		BoxObstacle* shadow = pedestrians.get(ii)->getShadow();
+		if (shadow == nullptr || pedestrians.isParked(ii) || shadow->getLinearVelocity().dot(toCaster) <= 0.0f) {
+			continue;
+		}
+		float dist = (shadow->getPosition() - player).lengthSquared();
+		if (dist < best) {
+			best = dist;
+			out = shadow->getPosition();
+			found = true;
+		}
+	}
+	return found;
+}
+
+bool PlaytestBot::keepRiding(SimulationController& sim) const {
+	// A riding character moves with the shadow, so its own velocity will do
+	LevelInstance* level = sim.getLevel();
+	Shadow* player = level->_playerPos.object;
+	Vec2 toCaster = level->_casterPos.object->getObject()->getPosition() - player->getPosition();
+	return player->getLinearVelocity().dot(toCaster) > 0.0f;
+}
+
+void PlaytestBot::act(SimulationController& sim) {
+	int frame = _frame++;
+	if (frame % BOT_REPLAN_FRAMES == 0) {
+		sim.planRoute(_route);
+	}
+	if (frame % BOT_DECIDE_FRAMES != 0) {
+		return;
+	}
+
+	Shadow* player = sim.getLevel()->_playerPos.object;
+	Vec2 pos = player->getPosition();
+	bool shaded = player->getCoverRatio() >= BOT_SHADE_COVER;
+
+	// Wait in shade until the exposure cools, or the shade moves off
+	if (_resting && (!shaded || sim.getExposure() <= 0.5f * _restAt)) {
+		_resting = false;
+	}
+	else if (!_resting && shaded && sim.getExposure() >= _restAt) {
+		_resting = true;
+	}
+	if (_resting) {
+		sim.tap(pos);
+		return;
+	}
+
+	if (sim.isLatched()) {
+		if (keepRiding(sim)) {
+			return;
+		}
+	}
+	else {
+		Vec2 ride;
+		if (findRide(sim, ride) && uniform(0.0f, 1.0f) < _latchChance) {
+			sim.tap(ride, true);
+			return;
+		}
+	}
+
+	// Head for the first turn of the route that is not right beside the character
+	if (_route.empty()) {
+		return;
+	}
+	Vec2 next(_route.back().x, _route.back().y);
+	for (size_t ii = 0; ii < _route.size(); ii++) {
+		Vec2 turn(_route[ii].x, _route[ii].y);
+		if ((turn - pos).lengthSquared() > BOT_TAP_DISTANCE * BOT_TAP_DISTANCE) {
+			next = turn;
+			break;
+		}
+	}
+	if (_jitter > 0.0f) {
+		next += Vec2(uniform(-_jitter, _jitter), uniform(-_jitter, _jitter));
+	}
+	sim.tap(next);
+}
+
+#pragma mark -
+#pragma mark Playtester
+
+void Playtester::init(int threads) {
+	_jobs.init(threads < 0 ? -1 : threads - 1);
+}
+
+void Playtester::dispose() {
+	_jobs.dispose();
+	_runs.clear();
+}
+
+bool Playtester::run(const std::string& level, int runs, unsigned int seed, int frameLimit, PlaytestReport& report) {
+	report = PlaytestReport();
+	report.level = level;
+	_runs.assign(std::max(0, runs), PlaytestRun());
+	if (runs <= 0) {
+		return true;
+	}
+
+	// One chunk per thread, so that each thread loads the level only once
+	int threads = _jobs.getHelpers() + 1;
+	int grain = (runs + threads - 1) / threads;
+	std::atomic<bool> loaded(true);
+	timestamp_t start = current_time();
+	_jobs.run(runs, grain, [&](int begin, int end) {
+		SimulationController sim;
+		bool ready;
+		{
+			std::lock_guard<std::mutex> lock(loadMutex);
+			ready = sim.init(level);
+		}
+		if (!ready) {
+			loaded = false;
+		}
+		else {
+			sim.setParallel(false);
+			PlaytestBot bot;
+			for (int ii = begin; ii < end; ii++) {
+				// A reset creates no engine object, so unlike init it needs no lock
+				if (ii > begin) {
+					sim.reset();
+				}
+				PlaytestRun& result = _runs[ii];
+				result.seed = seed + (unsigned int)ii;
+				result.peakExposure = 0.0f;
+				bot.init(result.seed);
+				int frame = 0;
+				while (frame < frameLimit && !sim.isComplete() && !sim.isFailed()) {
+					bot.act(sim);
+					sim.update(DEFAULT_WORLD_STEP);
+					result.peakExposure = std::max(result.peakExposure, sim.getExposure());
+					frame++;
+				}
+				result.frames = frame;
+				result.won = sim.isComplete();
+				result.caught = !result.won && sim.isCaught();
+				result.overexposed = !result.won && !result.caught && sim.isFailed();
+			}
+		}
+		std::lock_guard<std::mutex> lock(loadMutex);
+		sim.dispose();
+	});
+	report.seconds = elapsed_micros(start, current_time()) / 1000000.0;
+	if (!loaded) {
+		return false;
+	}
+
+	report.runs = runs;
+	float timeSum = 0.0f, marginSum = 0.0f;
+	for (const PlaytestRun& result : _runs) {
+		report.frames += result.frames;
+		if (result.caught) report.caught++;
+		if (result.overexposed) report.overexposed++;
+		if (!result.won) {
+			continue;
+		}
+		float time = result.frames * DEFAULT_WORLD_STEP;
+		float margin = EXPOSURE_LIMIT - result.peakExposure;
+		if (report.wins == 0 || time < report.bestTime) report.bestTime = time;
+		if (report.wins == 0 || margin < report.minMargin) report.minMargin = margin;
+		timeSum += time;
+		marginSum += margin;
+		report.wins++;
+	}
+	if (report.wins > 0) {
+		report.meanTime = timeSum / report.wins;
+		report.meanMargin = marginSum / report.wins;
+	}
+	return true;
+}
@@ -0,0 +1,192 @@
+#ifndef __PLAYTEST_BOT_H__
+#define __PLAYTEST_BOT_H__
+
+#include <random>
+#include <string>
+#include <vector>
+#include "C_Simulation.h"
+#include "ParallelFor.h"
+
+/** Frames between two decisions of a bot, about a fifth of a second */
+#define BOT_DECIDE_FRAMES 12
+/** Frames between two route replans of a bot */
+#define BOT_REPLAN_FRAMES 30
+/** How far ahead along the route a bot taps, in Box2D units */
+#define BOT_TAP_DISTANCE 1.5f
+/** The most a bot strays from the route when it taps, in Box2D units */
+#define BOT_MAX_JITTER 1.0f
+/** The cover ratio at which a bot counts itself in shade */
+#define BOT_SHADE_COVER 0.5f
+/** The most frames one playtest may run, three minutes */
+#define BOT_FRAME_LIMIT (60 * 180)
+
+/** The outcome of one playtest */
+struct PlaytestRun {
+	/** The seed of the bot */
+	unsigned int seed;
+	/** Whether the bot reached the caster */
+	bool won;
+	/** Whether a pedestrian caught the bot */
+	bool caught;
+	/** Whether the bot burned up in the sun */
+	bool overexposed;
+	/** The frames the run took */
+	int frames;
+	/** The most exposure the bot built up, in seconds */
+	float peakExposure;
+};
+
+/** The playtests of one level, summed up */
+struct PlaytestReport {
+	/** The level file */
+	std::string level;
+	/** The number of runs */
+	int runs;
+	/** The runs that reached the caster */
+	int wins;
+	/** The runs that ended with the bot caught */
+	int caught;
+	/** The runs that ended with the bot burned up */
+	int overexposed;
+	/** The fastest win, in seconds, or 0 if there was none */
+	float bestTime;
+	/** The mean time of the wins, in seconds */
+	float meanTime;
+	/** The least headroom any win kept below EXPOSURE_LIMIT, in seconds */
+	float minMargin;
+	/** The mean headroom the wins kept below EXPOSURE_LIMIT, in seconds */
+	float meanMargin;
+	/** The frames simulated across every run */
+	long frames;
+	/** The wall-clock time of the playtests, in seconds */
+	double seconds;
+
+	PlaytestReport() : runs(0), wins(0), caught(0), overexposed(0), bestTime(0), meanTime(0),
+		minMargin(0), meanMargin(0), frames(0), seconds(0) {}
+
+	/** Returns the runs that ran out of frames */
+	int getTimeouts() const { return runs - wins - caught - overexposed; }
+
+	/** Returns the share of the runs that reached the caster */
+	float getWinRate() const { return runs > 0 ? (float)wins / runs : 0.0f; }
+
+	/** Returns the frames simulated per second of wall-clock time, across every thread */
+	double getThroughput() const { return seconds > 0 ? frames / seconds : 0.0; }
+};
+
+/**
+ * A scripted player that tries to get the character to the caster.
+ *
+ * The bot plays through SimulationController::tap(), so it gives the same
+ * commands as a touch: it taps points to walk to, and double taps shadows
+ * to ride them. It walks the shadiest route from the planner, waits in
+ * shade when its exposure gets high, and rides any nearby shadow that is
+ * heading for the caster.
+ *
+ * How far a bot strays from the route, how much exposure it risks and how
+ * keen it is to ride shadows all come from its seed, so many bots with
+ * different seeds search the level between them.
+ */
+class PlaytestBot {
+private:
+	/** The random source of every choice */
+	std::mt19937 _rng;
+	/** The shadiest route at the last replan */
+	std::vector<b2Vec2> _route;
+	/** The frames since the run started */
+	int _frame;
+	/** The exposure at which the bot stops in shade to cool down */
+	float _restAt;
+	/** The chance the bot rides a shadow it could reach */
+	float _latchChance;
+	/** How far the bot strays from the route */
+	float _jitter;
+	/** Whether the bot is cooling down */
+	bool _resting;
+
+	/** Returns a number in [lo, hi) */
+	float uniform(float lo, float hi);
+
+	/**
+	 * Looks for a shadow within reach that moves toward the caster.
+	 *
+	 * @param  sim  The simulation to search
+	 * @param  out  The position of the shadow, in Box2D units
+	 *
+	 * @return true if there is such a shadow
+	 */
+	bool findRide(SimulationController& sim, Vec2& out) const;
+
+	/** Returns whether the mover shadow the character rides still heads for the caster */
+	bool keepRiding(SimulationController& sim) const;
+
+public:
+	PlaytestBot() : _frame(0), _restAt(0), _latchChance(0), _jitter(0), _resting(false) {}
+
+	/**
+	 * Starts a new run with the given seed.
+	 *
+	 * @param  seed  The seed of every choice the bot makes
+	 */
+	void init(unsigned int seed);
+
+	/**
+	 * Gives the commands of the coming frame.
+	 *
+	 * This must be called once before each SimulationController::update().
+	 *
+	 * @param  sim  The simulation to play
+	 */
+	void act(SimulationController& sim);
+};
+
+/**
+ * Runs many playtest bots over a level, one simulation per core.
+ *
+ * Each thread loads the level once and plays a share of the seeds on it,
+ * resetting the simulation between runs. Loading is done one level at a
+ * time, since the engine's autorelease pool is not thread safe, but the
+ * runs themselves share nothing.
+ *
+ * Path searches finish on their own worker threads, so a seed is not
+ * exactly repeatable; the report is meant for the rates and the extremes.
+ */
+class Playtester {
+private:
+	/** The threads the simulations run on */
+	ParallelFor _jobs;
+	/** The outcome of each run of the last playtest */
+	std::vector<PlaytestRun> _runs;
+
+public:
+	Playtester() {}
+
+	/**
+	 * Starts the threads.
+	 *
+	 * @param  threads  The number of simulations at once, or a negative
+	 *                  number for one per hardware thread
+	 */
+	void init(int threads = -1);
+
+	/** Stops the threads. */
+	void dispose();
+
+	/**
+	 * Plays a level with bots of seeds seed, seed + 1, ... seed + runs - 1.
+	 *
+	 * @param  level       The level file
+	 * @param  runs        The number of bots
+	 * @param  seed        The seed of the first bot
+	 * @param  frameLimit  The frames after which a run counts as lost
+	 * @param  report      The summary to fill
+	 *
+	 * @return false if the level failed to load
+	 */
+	bool run(const std::string& level, int runs, unsigned int seed, int frameLimit, PlaytestReport& report);
+
+	/** Returns the outcome of each run of the last playtest, by seed */
+	const std::vector<PlaytestRun>& getRuns() const { return _runs; }
+};
+
+#endif /* __PLAYTEST_BOT_H__ */
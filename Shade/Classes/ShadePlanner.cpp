@@ -0,0 +1,407 @@
+#include <math.h>
+#include <stdlib.h>
+#include <limits>
+#include <algorithm>
+#include "ShadePlanner.h"
+#include "M_LevelInstance.h"
+
+/** The share of the cheapest possible cost the heuristic claims */
+#define PLANNER_HEURISTIC_SLACK 0.99f
+/** The cost of a cell that cannot be entered */
+#define PLANNER_BLOCKED std::numeric_limits<float>::infinity()
+
+/** The column offset of each direction, counterclockwise from east */
+static const int PLANNER_DX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+/** The row offset of each direction, counterclockwise from east */
+static const int PLANNER_DY[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+bool ShadePlanner::init(LevelInstance* level, bool threaded) {
+	dispose();
+	const Size& size = level->_size;
+	if (size.width <= 0.0f || size.height <= 0.0f) {
+		return false;
+	}
+	_cols = std::max(1, (int)ceilf(size.width / PLANNER_CELL));
+	_rows = std::max(1, (int)ceilf(size.height / PLANNER_CELL));
+	int cells = _cols * _rows;
+
+	_baseCost.resize(cells);
+	for (int cell = 0; cell < cells; cell++) {
+		b2Vec2 center = centerOf(cell);
+		_baseCost[cell] = level->_shadowField.isShaded(center.x, center.y) ? PLANNER_SHADE_COST : PLANNER_SUN_COST;
+	}
+	// Block the buildings as FlowField does, so the route keeps clear of their corners
+	for (LevelInstance::StaticObjectMetadata &data : level->_staticObjects) {
+		const Vec2& center = data.object->getPosition();
+		const Size& box = data.object->getDimension();
+		float halfw = box.width * 0.5f + NAV_AGENT_RADIUS;
+		float halfh = box.height * 0.5f + NAV_AGENT_RADIUS;
+		int col0 = std::max(0, (int)ceilf((center.x - halfw) / PLANNER_CELL - 0.5f));
+		int col1 = std::min(_cols - 1, (int)floorf((center.x + halfw) / PLANNER_CELL - 0.5f));
+		int row0 = std::max(0, (int)ceilf((center.y - halfh) / PLANNER_CELL - 0.5f));
+		int row1 = std::min(_rows - 1, (int)floorf((center.y + halfh) / PLANNER_CELL - 0.5f));
+		for (int row = row0; row <= row1; row++) {
+			std::fill(_baseCost.begin() + row * _cols + col0, _baseCost.begin() + row * _cols + col1 + 1, PLANNER_BLOCKED);
+		}
+	}
+	_cost = _baseCost;
+	_moverShade.assign(cells, 0);
+	_nextShade.assign(cells, 0);
+	_g.assign(cells, PLANNER_BLOCKED);
+	_rhs.assign(cells, PLANNER_BLOCKED);
+
+	if (threaded) {
+		_worker = ThreadPool::create(1);
+		_worker->retain();
+	}
+	return true;
+}
+
+void ShadePlanner::dispose() {
+	if (_worker != nullptr) {
+		// Joins the worker, so no route is written after this
+		_worker->stop();
+		_worker->release();
+		_worker = nullptr;
+	}
+	_baseCost.clear();
+	_cost.clear();
+	_moverShade.clear();
+	_nextShade.clear();
+	_g.clear();
+	_rhs.clear();
+	_open.clear();
+	_request.shade.clear();
+	_routes[0].clear();
+	_routes[1].clear();
+	_km = 0.0f;
+	_start = _last = _goal = -1;
+	_cols = _rows = 0;
+	_front.store(-1, std::memory_order_release);
+	_busy.store(false, std::memory_order_release);
+}
+
+void ShadePlanner::update(const b2Vec2& start, const b2Vec2& goal, const MoverRegistry& movers) {
+	if (_baseCost.empty() || _busy.load(std::memory_order_acquire)) {
+		return;
+	}
+	_request.start = start;
+	_request.goal = goal;
+	_request.shade.clear();
+	const MoverArray<Car>& cars = movers.cars;
+	const MoverArray<Pedestrian>& peds = movers.pedestrians;
+	for (int pass = 0; pass < 2; pass++) {
+		int count = (pass == 0 ? cars.size() : peds.size());
+		for (int ii = 0; ii < count; ii++) {
+			b2Body* body = (pass == 0 ? cars.getShadowBody(ii) : peds.getShadowBody(ii));
+			if (body == nullptr || (pass == 0 ? cars.isParked(ii) : peds.isParked(ii))) {
+				continue;
+			}
+			BoxObstacle* shadow = (pass == 0 ? (BoxObstacle*)cars.get(ii)->getShadow() : (BoxObstacle*)peds.get(ii)->getShadow());
+			const Size& dimen = shadow->getDimension();
+			float c = fabsf(cosf(body->GetAngle()));
+			float s = fabsf(sinf(body->GetAngle()));
+			b2Vec2 half(0.5f * (dimen.width * c + dimen.height * s), 0.5f * (dimen.width * s + dimen.height * c));
+			b2Vec2 now = body->GetPosition();
+			b2Vec2 then = now + PLANNER_LOOKAHEAD * body->GetLinearVelocity();
+			b2AABB box;
+			box.lowerBound = b2Min(now, then) - half;
+			box.upperBound = b2Max(now, then) + half;
+			_request.shade.push_back(box);
+		}
+	}
+
+	int front = _front.load(std::memory_order_acquire);
+	int back = front < 0 ? 0 : 1 - front;
+	if (_worker == nullptr) {
+		replan(back);
+		return;
+	}
+	_busy.store(true, std::memory_order_release);
+	_worker->addTask([this, back] { replan(back); });
+}
+
+const std::vector<b2Vec2>& ShadePlanner::getRoute() const {
+	int front = _front.load(std::memory_order_acquire);
+	return _routes[front < 0 ? 0 : front];
+}
+
+float ShadePlanner::getCost() const {
+	int front = _front.load(std::memory_order_acquire);
+	return front < 0 ? PLANNER_BLOCKED : _costs[front];
+}
+
+bool ShadePlanner::getWaypoint(const b2Vec2& pos, b2Vec2& out) const {
+	int front = _front.load(std::memory_order_acquire);
+	if (front < 0 || _routes[front].empty()) {
+		return false;
+	}
+	const std::vector<b2Vec2>& route = _routes[front];
+	int last = (int)route.size() - 1;
+
+	// Find the stretch of the route the position is closest to
+	int next = last;
+	float best = std::numeric_limits<float>::max();
+	for (int ii = 0; ii < last; ii++) {
+		b2Vec2 d = route[ii + 1] - route[ii];
+		float t = b2Dot(pos - route[ii], d) / std::max(b2Dot(d, d), b2_epsilon);
+		t = std::min(std::max(t, 0.0f), 1.0f);
+		float dist = (route[ii] + t * d - pos).LengthSquared();
+		if (dist < best) {
+			best = dist;
+			next = ii + 1;
+		}
+	}
+	while (next < last && (route[next] - pos).Length() < PLANNER_WAYPOINT_DISTANCE) {
+		next++;
+	}
+	out = route[next];
+	return true;
+}
+
+
+#pragma mark -
+#pragma mark D* Lite
+
+int ShadePlanner::nearestOpen(int cell) const {
+	if (_baseCost[cell] != PLANNER_BLOCKED) {
+		return cell;
+	}
+	int col = cell % _cols;
+	int row = cell / _cols;
+	for (int ring = 1; ring <= PLANNER_SNAP_CELLS; ring++) {
+		for (int dy = -ring; dy <= ring; dy++) {
+			for (int dx = -ring; dx <= ring; dx++) {
+				if (std::max(abs(dx), abs(dy)) != ring) {
+					continue;
+				}
+				int c = col + dx;
+				int r = row + dy;
+				if (c >= 0 && c < _cols && r >= 0 && r < _rows && _baseCost[r * _cols + c] != PLANNER_BLOCKED) {
+					return r * _cols + c;
+				}
+			}
+		}
+	}
+	return -1;
+}
+
+float ShadePlanner::edge(int cell, int dir, int& next) const {
+	int col = cell % _cols + PLANNER_DX[dir];
+	int row = cell / _cols + PLANNER_DY[dir];
+	if (col < 0 || col >= _cols || row < 0 || row >= _rows) {
+		return PLANNER_BLOCKED;
+	}
+	next = row * _cols + col;
+	if (dir & 1) {
+		// Do not cut the corner of a blocked cell
+		if (_cost[cell - cell % _cols + col] == PLANNER_BLOCKED || _cost[row * _cols + cell % _cols] == PLANNER_BLOCKED) {
+			return PLANNER_BLOCKED;
+		}
+		return (float)M_SQRT2 * PLANNER_CELL * 0.5f * (_cost[cell] + _cost[next]);
+	}
+	return PLANNER_CELL * 0.5f * (_cost[cell] + _cost[next]);
+}
+
+float ShadePlanner::heuristic(int a, int b) const {
+	int dx = abs(a % _cols - b % _cols);
+	int dy = abs(a / _cols - b / _cols);
+	// Octile distance over the cheapest cells, so it never overestimates. It is kept
+	// a little under that, or rounding could order a cell on the route after the start.
+	float steps = (float)std::max(dx, dy) + ((float)M_SQRT2 - 1.0f) * std::min(dx, dy);
+	return steps * PLANNER_CELL * std::min(PLANNER_SHADE_COST, PLANNER_MOVER_COST) * PLANNER_HEURISTIC_SLACK;
+}
+
+ShadePlanner::Key ShadePlanner::keyOf(int cell) const {
+	float best = std::min(_g[cell], _rhs[cell]);
+	Key key = { best + heuristic(_start, cell) + _km, best };
+	return key;
+}
+
+void ShadePlanner::push(int cell, const Key& key) {
+	Entry entry = { key, cell };
+	_open.push_back(entry);
+	std::push_heap(_open.begin(), _open.end(), EntryOrder());
+}
+
+void ShadePlanner::updateCell(int cell) {
+	if (cell != _goal) {
+		float best = PLANNER_BLOCKED;
+		if (_cost[cell] != PLANNER_BLOCKED) {
+			for (int dir = 0; dir < 8; dir++) {
+				int next = -1;
+				float step = edge(cell, dir, next);
+				if (step != PLANNER_BLOCKED) {
+					best = std::min(best, step + _g[next]);
+				}
+			}
+		}
+		_rhs[cell] = best;
+	}
+	if (_g[cell] != _rhs[cell]) {
+		push(cell, keyOf(cell));
+	}
+}
+
+void ShadePlanner::computeRoute() {
+	while (!_open.empty()) {
+		Entry top = _open.front();
+		if (!(top.key < keyOf(_start)) && _rhs[_start] == _g[_start]) {
+			break;
+		}
+		std::pop_heap(_open.begin(), _open.end(), EntryOrder());
+		_open.pop_back();
+
+		int cell = top.cell;
+		if (_g[cell] == _rhs[cell]) {
+			continue;
+		}
+		// Keys only grow as the start moves, so an entry below its key is requeued
+		Key key = keyOf(cell);
+		if (top.key < key) {
+			push(cell, key);
+			continue;
+		}
+
+		if (_g[cell] > _rhs[cell]) {
+			_g[cell] = _rhs[cell];
+		}
+		else {
+			_g[cell] = PLANNER_BLOCKED;
+			updateCell(cell);
+		}
+		for (int dir = 0; dir < 8; dir++) {
+			int next = cell % _cols + PLANNER_DX[dir];
+			int row = cell / _cols + PLANNER_DY[dir];
+			if (next >= 0 && next < _cols && row >= 0 && row < _rows) {
+				updateCell(row * _cols + next);
+			}
+		}
+	}
+	if (_open.size() > PLANNER_QUEUE_SLACK * _cost.size()) {
+		compact();
+	}
+}
+
+void ShadePlanner::restart(int goal) {
+	std::fill(_g.begin(), _g.end(), PLANNER_BLOCKED);
+	std::fill(_rhs.begin(), _rhs.end(), PLANNER_BLOCKED);
+	_open.clear();
+	_km = 0.0f;
+	_goal = goal;
+	_last = _start;
+	_rhs[goal] = 0.0f;
+	push(goal, keyOf(goal));
+}
+
+void ShadePlanner::compact() {
+	_open.clear();
+	for (int cell = 0; cell < (int)_g.size(); cell++) {
+		if (_g[cell] != _rhs[cell]) {
+			Entry entry = { keyOf(cell), cell };
+			_open.push_back(entry);
+		}
+	}
+	std::make_heap(_open.begin(), _open.end(), EntryOrder());
+}
+
+void ShadePlanner::applyShade(bool search) {
+	std::fill(_nextShade.begin(), _nextShade.end(), 0);
+	for (const b2AABB& box : _request.shade) {
+		int col0 = std::max(0, (int)(box.lowerBound.x / PLANNER_CELL));
+		int col1 = std::min(_cols - 1, (int)(box.upperBound.x / PLANNER_CELL));
+		int row0 = std::max(0, (int)(box.lowerBound.y / PLANNER_CELL));
+		int row1 = std::min(_rows - 1, (int)(box.upperBound.y / PLANNER_CELL));
+		for (int row = row0; row <= row1; row++) {
+			if (col0 <= col1) {
+				std::fill(_nextShade.begin() + row * _cols + col0, _nextShade.begin() + row * _cols + col1 + 1, 1);
+			}
+		}
+	}
+
+	for (int cell = 0; cell < (int)_cost.size(); cell++) {
+		if (_nextShade[cell] == _moverShade[cell]) {
+			continue;
+		}
+		_moverShade[cell] = _nextShade[cell];
+		float base = _baseCost[cell];
+		_cost[cell] = (_moverShade[cell] && base == PLANNER_SUN_COST) ? PLANNER_MOVER_COST : base;
+		if (!search || base == PLANNER_BLOCKED) {
+			continue;
+		}
+		// Every edge into or out of the cell changed
+		updateCell(cell);
+		for (int dir = 0; dir < 8; dir++) {
+			int col = cell % _cols + PLANNER_DX[dir];
+			int row = cell / _cols + PLANNER_DY[dir];
+			if (col >= 0 && col < _cols && row >= 0 && row < _rows) {
+				updateCell(row * _cols + col);
+			}
+		}
+	}
+}
+
+void ShadePlanner::extractRoute(int back) {
+	std::vector<b2Vec2>& route = _routes[back];
+	route.clear();
+	_costs[back] = _g[_start];
+	if (_g[_start] == PLANNER_BLOCKED) {
+		return;
+	}
+
+	// Follow the cheapest step, keeping only the cells where the route turns
+	int cell = _start;
+	int heading = -1;
+	route.push_back(centerOf(cell));
+	for (int steps = 0; cell != _goal && steps < (int)_cost.size(); steps++) {
+		int bestDir = -1, bestNext = -1;
+		float best = PLANNER_BLOCKED;
+		for (int dir = 0; dir < 8; dir++) {
+			int next = -1;
+			float step = edge(cell, dir, next);
+			if (step != PLANNER_BLOCKED && step + _g[next] < best) {
+				best = step + _g[next];
+				bestDir = dir;
+				bestNext = next;
+			}
+		}
+		if (bestDir < 0) {
+			break;
+		}
+		if (bestDir != heading && heading >= 0) {
+			route.push_back(centerOf(cell));
+		}
+		heading = bestDir;
+		cell = bestNext;
+	}
+	route.push_back(_request.goal);
+}
+
+void ShadePlanner::replan(int back) {
+	int goal = nearestOpen(cellOf(_request.goal));
+	int start = nearestOpen(cellOf(_request.start));
+	if (goal < 0 || start < 0) {
+		_routes[back].clear();
+		_costs[back] = PLANNER_BLOCKED;
+	}
+	else {
+		if (goal != _goal) {
+			// The old costs are all relative to the old goal
+			applyShade(false);
+			_start = start;
+			restart(goal);
+		}
+		else {
+			if (start != _start) {
+				_start = start;
+				_km += heuristic(_last, start);
+				_last = start;
+			}
+			applyShade(true);
+		}
+		computeRoute();
+		extractRoute(back);
+	}
+	_front.store(back, std::memory_order_release);
+	_busy.store(false, std::memory_order_release);
+}
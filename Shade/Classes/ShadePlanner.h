@@ -0,0 +1,259 @@
+#ifndef __SHADE_PLANNER_H__
+#define __SHADE_PLANNER_H__
+
+#include <atomic>
+#include <vector>
+#include <cornell.h>
+#include <Box2D/Common/b2Math.h>
+#include <Box2D/Collision/b2Collision.h>
+#include "M_MoverRegistry.h"
+
+class LevelInstance;
+
+/** The side of one planner cell, in Box2D units */
+#define PLANNER_CELL 0.5f
+/** The cost of crossing one Box2D unit in the sun */
+#define PLANNER_SUN_COST 1.0f
+/** The cost of crossing one Box2D unit in a static shadow */
+#define PLANNER_SHADE_COST 0.1f
+/** The cost of crossing one Box2D unit where a mover's shadow is predicted */
+#define PLANNER_MOVER_COST 0.4f
+/** How far ahead mover shadows are predicted, in seconds */
+#define PLANNER_LOOKAHEAD 1.0f
+/** How far a blocked start or goal is moved to an open cell, in cells */
+#define PLANNER_SNAP_CELLS 4
+/** Stale queue entries per cell at which the queue is rebuilt */
+#define PLANNER_QUEUE_SLACK 4
+/** How far ahead of the character the indicator looks along the route, in Box2D units */
+#define PLANNER_WAYPOINT_DISTANCE 1.0f
+
+using namespace cocos2d;
+
+/**
+ * Finds the route from the character to the caster that spends least time in the sun.
+ *
+ * The level is covered by a grid of cells, each of which costs more to
+ * cross in the sun than in shade, and some of which are blocked by
+ * buildings. The static shadows come from the level's ShadowField and
+ * never change. The mover shadows are predicted by sweeping each shadow
+ * along its velocity for a short lookahead, and are laid over the grid
+ * again at every replan, so the cost of the grid changes with time.
+ *
+ * The search is D* Lite, which searches back from the caster and keeps
+ * its results between replans. When the character moves or the mover
+ * shadows change, only the cells whose cost changed and the cells whose
+ * route ran through them are searched again, which is a small fraction of
+ * a full search. A full search only happens when the caster moves to
+ * another cell.
+ *
+ * As with FlowField, the search runs on a ThreadPool worker and the route
+ * is double-buffered: the game thread reads the last route while the
+ * worker writes the next, and a replan is only started once the last one
+ * is done, so the game thread never waits. A planner can instead be made
+ * without a worker, so that update() replans in place, which is how the
+ * headless simulator uses it as a safest-route oracle.
+ *
+ * Every method must be called from the game thread.
+ */
+class ShadePlanner {
+private:
+	/** A priority of D* Lite, compared lexicographically */
+	struct Key {
+		float first;
+		float second;
+
+		bool operator<(const Key& other) const {
+			return first < other.first || (first == other.first && second < other.second);
+		}
+	};
+
+	/** A queue entry; stale entries are skipped when popped */
+	struct Entry {
+		Key key;
+		int cell;
+	};
+
+	/** Orders the queue as a min-heap */
+	struct EntryOrder {
+		bool operator()(const Entry& a, const Entry& b) const { return b.key < a.key; }
+	};
+
+	/** The input of one replan, written by the game thread while the worker is idle */
+	struct Request {
+		/** The character position, in Box2D units */
+		b2Vec2 start;
+		/** The caster position, in Box2D units */
+		b2Vec2 goal;
+		/** The swept bounds of every mover shadow */
+		std::vector<b2AABB> shade;
+	};
+
+	/** The cost of crossing one unit of each cell without mover shade; infinite if blocked */
+	std::vector<float> _baseCost;
+	/** The cost of crossing one unit of each cell now */
+	std::vector<float> _cost;
+	/** Non-zero for each cell under a predicted mover shadow */
+	std::vector<unsigned char> _moverShade;
+	/** Scratch for the next mover shade layer */
+	std::vector<unsigned char> _nextShade;
+	/** The D* Lite cost-to-goal estimate of each cell */
+	std::vector<float> _g;
+	/** The D* Lite one-step lookahead cost of each cell */
+	std::vector<float> _rhs;
+	/** The open queue, as a heap ordered by EntryOrder */
+	std::vector<Entry> _open;
+	/** The offset added to keys as the start moves */
+	float _km;
+	/** The cell of the character at the last replan, or -1 */
+	int _start;
+	/** The start cell when _km was last raised, or -1 */
+	int _last;
+	/** The cell of the caster, or -1 before the first replan */
+	int _goal;
+	/** The number of columns */
+	int _cols;
+	/** The number of rows */
+	int _rows;
+
+	/** The replan being set up or run */
+	Request _request;
+	/** The routes, double-buffered */
+	std::vector<b2Vec2> _routes[2];
+	/** The cost of each route, or infinity if there is none */
+	float _costs[2];
+	/** The route buffer to read, or -1 until the first replan is done */
+	std::atomic<int> _front;
+	/** Whether a replan is running */
+	std::atomic<bool> _busy;
+	/** The worker, or nullptr if update() replans in place */
+	ThreadPool* _worker;
+
+	/** Returns the cell holding a point, clamped to the grid */
+	int cellOf(const b2Vec2& pos) const {
+		int col = (int)(pos.x / PLANNER_CELL);
+		int row = (int)(pos.y / PLANNER_CELL);
+		col = col < 0 ? 0 : (col >= _cols ? _cols - 1 : col);
+		row = row < 0 ? 0 : (row >= _rows ? _rows - 1 : row);
+		return row * _cols + col;
+	}
+
+	/** Returns the center of a cell, in Box2D units */
+	b2Vec2 centerOf(int cell) const {
+		return b2Vec2(((cell % _cols) + 0.5f) * PLANNER_CELL, ((cell / _cols) + 0.5f) * PLANNER_CELL);
+	}
+
+	/** Returns the open cell nearest a cell, or -1 if none is within PLANNER_SNAP_CELLS */
+	int nearestOpen(int cell) const;
+
+	/** Returns the cost of the step from a cell in a direction, with the neighbour in next */
+	float edge(int cell, int dir, int& next) const;
+
+	/** Returns a lower bound on the cost between two cells */
+	float heuristic(int a, int b) const;
+
+	/** Returns the queue priority of a cell */
+	Key keyOf(int cell) const;
+
+	/** Recomputes the lookahead cost of a cell and queues it if it is inconsistent */
+	void updateCell(int cell);
+
+	/** Adds a cell to the queue */
+	void push(int cell, const Key& key);
+
+	/** Searches until the start cell is consistent */
+	void computeRoute();
+
+	/** Starts the search over for a new goal cell */
+	void restart(int goal);
+
+	/** Rebuilds the queue from the inconsistent cells, dropping stale entries */
+	void compact();
+
+	/** Lays the mover shadows of the request over the grid, updating the cells that changed */
+	void applyShade(bool search);
+
+	/** Walks down the costs from the start, writing the route and its cost into a buffer */
+	void extractRoute(int back);
+
+	/** Runs one replan of the request into a buffer and publishes it. Runs on the worker. */
+	void replan(int back);
+
+public:
+	ShadePlanner() : _km(0.0f), _start(-1), _last(-1), _goal(-1), _cols(0), _rows(0),
+		_front(-1), _busy(false), _worker(nullptr) {
+		_costs[0] = _costs[1] = 0.0f;
+	}
+
+	~ShadePlanner() { dispose(); }
+
+	/**
+	 * Builds the static cost grid of a populated level.
+	 *
+	 * The level's shadow field must be baked and its static objects placed.
+	 *
+	 * @param  level     The level to plan over, which must outlive the planner
+	 * @param  threaded  Whether to replan on a worker instead of in update()
+	 *
+	 * @return true if the grid is non-empty
+	 */
+	bool init(LevelInstance* level, bool threaded = true);
+
+	/**
+	 * Stops the worker and releases the grid.
+	 *
+	 * This blocks until any replan in progress is done.
+	 */
+	void dispose();
+
+	/** Returns whether the grid is built */
+	bool isActive() const { return !_baseCost.empty(); }
+
+	/**
+	 * Starts a replan from the character to the caster, unless one is running.
+	 *
+	 * The mover shadows are read from the registry now. Parked movers are
+	 * out of the physics world, so they give no shade and are skipped.
+	 *
+	 * @param  start   The character position, in Box2D units
+	 * @param  goal    The caster position, in Box2D units
+	 * @param  movers  The movers whose shadows to predict
+	 */
+	void update(const b2Vec2& start, const b2Vec2& goal, const MoverRegistry& movers);
+
+	/** Returns whether a route has been published */
+	bool isReady() const { return _front.load(std::memory_order_acquire) >= 0; }
+
+	/**
+	 * Returns the last published route, which may be empty.
+	 *
+	 * The route is the cell centers where it turns, from the character's
+	 * cell at the time of the replan to the caster. It stays valid until
+	 * the next call to update().
+	 */
+	const std::vector<b2Vec2>& getRoute() const;
+
+	/**
+	 * Returns the cost of the last published route.
+	 *
+	 * This is the length of the route in Box2D units, with each stretch
+	 * weighted by the cost of its shade, or infinity if the caster cannot
+	 * be reached.
+	 */
+	float getCost() const;
+
+	/**
+	 * Returns the point on the last route a mover at a position should head for.
+	 *
+	 * This is the end of the stretch of the route nearest the position,
+	 * skipping any turns closer than PLANNER_WAYPOINT_DISTANCE, so the mover
+	 * keeps heading on even where the route turns right beside it.
+	 *
+	 * @param  pos  The position of the mover, in Box2D units
+	 * @param  out  The point to head for, in Box2D units
+	 *
+	 * @return false if there is no route
+	 */
+	bool getWaypoint(const b2Vec2& pos, b2Vec2& out) const;
+};
+
+#endif /* __SHADE_PLANNER_H__ */
@@ -1,16 +1,112 @@
 #ifndef __SHADOWCOUNT_H__
 #define __SHADOWCOUNT_H__
 
-/** Wrapper class for the integer used to count the shadows a sensor fixture of
- * the character is currently in. */
-class ShadowCount {
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+/** The number of sensor cells tracked by each word of the covered mask */
+#define SHADOW_MASK_BITS 64
+
+/** Contiguous per-character record of the shadows each sensor fixture of the
+ * character is currently in. There is one counter per sensor, plus a bitmask
+ * with a bit set for every sensor whose counter is non-zero. Sensors are
+ * addressed by index, which is stored in the user data of the fixture.
+ *
+ * Static shadows have no fixtures, so a second mask records which sensors
+ * lie in the baked ShadowField. A sensor is covered if either bit is set. */
+class ShadowCounts {
 private:
-	int scount;
+	/** The number of shadows overlapping each sensor */
+	std::vector<uint16_t> _counts;
+	/** Bit i is set if and only if _counts[i] > 0 */
+	std::vector<uint64_t> _mask;
+	/** Bit i is set if and only if sensor i lies in a static shadow */
+	std::vector<uint64_t> _static;
+
+	/** Returns the number of set bits in word */
+	static inline int popcount(uint64_t word) {
+		word = word - ((word >> 1) & 0x5555555555555555ULL);
+		word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+		word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		return (int)((word * 0x0101010101010101ULL) >> 56);
+	}
+
 public:
-	ShadowCount() : scount(0) {}
-	inline void inc() { scount++; }
-	inline void dec() { scount--; }
-	int count() const { return scount; }
+	ShadowCounts() {}
+
+	/** Allocates zeroed counters and mask for the given number of sensors */
+	void init(int size) {
+		_counts.assign(size, 0);
+		_mask.assign((size + SHADOW_MASK_BITS - 1) / SHADOW_MASK_BITS, 0);
+		_static.assign(_mask.size(), 0);
+	}
+
+	/** Zeroes every counter without reallocating */
+	void reset() {
+		std::fill(_counts.begin(), _counts.end(), 0);
+		std::fill(_mask.begin(), _mask.end(), 0);
+		std::fill(_static.begin(), _static.end(), 0);
+	}
+
+	/** Releases the counters and mask */
+	void dispose() {
+		_counts.clear();
+		_mask.clear();
+		_static.clear();
+	}
+
+	/** Records that the sensor at index entered a shadow */
+	inline void inc(int index) {
+		if (_counts[index]++ == 0) {
+			_mask[index / SHADOW_MASK_BITS] |= (1ULL << (index % SHADOW_MASK_BITS));
+		}
+	}
+
+	/** Records that the sensor at index left a shadow */
+	inline void dec(int index) {
+		if (_counts[index] > 0 && --_counts[index] == 0) {
+			_mask[index / SHADOW_MASK_BITS] &= ~(1ULL << (index % SHADOW_MASK_BITS));
+		}
+	}
+
+	/** Records whether the sensor at index lies in a static shadow */
+	inline void setStatic(int index, bool shaded) {
+		uint64_t bit = 1ULL << (index % SHADOW_MASK_BITS);
+		if (shaded) {
+			_static[index / SHADOW_MASK_BITS] |= bit;
+		}
+		else {
+			_static[index / SHADOW_MASK_BITS] &= ~bit;
+		}
+	}
+
+	/** Returns the number of dynamic shadows the sensor at index is in */
+	int count(int index) const { return _counts[index]; }
+
+	/** Returns whether the sensor at index is in at least one shadow */
+	bool isCovered(int index) const {
+		return ((_mask[index / SHADOW_MASK_BITS] | _static[index / SHADOW_MASK_BITS])
+			>> (index % SHADOW_MASK_BITS)) & 1ULL;
+	}
+
+	/** Returns the number of sensors */
+	int size() const { return (int)_counts.size(); }
+
+	/** Returns the number of sensors in at least one shadow */
+	int coveredCount() const {
+		int covered = 0;
+		for (size_t ii = 0; ii < _mask.size(); ii++) {
+			covered += popcount(_mask[ii] | _static[ii]);
+		}
+		return covered;
+	}
+
+	/** Returns the dynamic covered mask, SHADOW_MASK_BITS sensors per word */
+	const uint64_t* getMask() const { return _mask.data(); }
+
+	/** Returns the number of words in the covered mask */
+	int getMaskWords() const { return (int)_mask.size(); }
 };
 
-#endif /** __SHADOWCOUNT_H__ */
\ No newline at end of file
+#endif /** __SHADOWCOUNT_H__ */
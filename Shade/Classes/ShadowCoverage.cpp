@@ -0,0 +1,147 @@
+#include <math.h>
+#include "ShadowCoverage.h"
+#include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
+#include <Box2D/Collision/Shapes/b2CircleShape.h>
+
+/** How many line segments to use when a shadow fixture is a circle */
+#define COVERAGE_CIRCLE_SEGMENTS 12
+
+/** Converts a world space Box2D point into a Clipper point */
+static inline ClipperLib::IntPoint toClipper(const b2Vec2& p) {
+	return ClipperLib::IntPoint((ClipperLib::cInt)(p.x * COVERAGE_PRECISION),
+		(ClipperLib::cInt)(p.y * COVERAGE_PRECISION));
+}
+
+bool ShadowCoverage::init(const Size& size, uint16 category) {
+	dispose();
+	_category = category;
+	if (size.width <= 0.0f || size.height <= 0.0f) {
+		return false;
+	}
+
+	// Mirror the capsule built by CapsuleObstacle: a box with a semicircle on
+	// both ends of the major axis. The outline is counterclockwise.
+	bool horizontal = size.width > size.height;
+	float r = (horizontal ? size.height : size.width) * 0.5f;
+	float half = (horizontal ? size.width : size.height) * 0.5f - r;
+	for (int end = 0; end < 2; end++) {
+		float sign = (end == 0 ? 1.0f : -1.0f);
+		for (int seg = 0; seg <= COVERAGE_CAP_SEGMENTS; seg++) {
+			float rads = (float)M_PI * ((float)seg / COVERAGE_CAP_SEGMENTS + end);
+			if (horizontal) {
+				// Right cap sweeps from bottom to top, left cap from top to bottom
+				_outline.push_back(b2Vec2(sign * half + r * sinf(rads), -r * cosf(rads)));
+			}
+			else {
+				// Top cap sweeps from right to left, bottom cap from left to right
+				_outline.push_back(b2Vec2(r * cosf(rads), sign * half + r * sinf(rads)));
+			}
+		}
+	}
+	_subject.resize(_outline.size());
+
+	// The area in Clipper units, so that ratios need no further scaling
+	for (size_t ii = 0; ii < _outline.size(); ii++) {
+		_subject[ii] = toClipper(_outline[ii]);
+	}
+	_area = fabs(ClipperLib::Area(_subject));
+	return _area > 0.0;
+}
+
+void ShadowCoverage::dispose() {
+	_outline.clear();
+	_subject.clear();
+	_shadows.clear();
+	_solution.clear();
+	_clipper.Clear();
+	_shadowCount = 0;
+	_area = 0.0;
+	_ratio = 0.0f;
+}
+
+float ShadowCoverage::update(const b2Body* body) {
+	_ratio = 0.0f;
+	if (body == nullptr || _outline.empty()) {
+		return _ratio;
+	}
+
+	// Transform the outline into world space and find its bounding box
+	const b2Transform& xf = body->GetTransform();
+	b2AABB aabb;
+	aabb.lowerBound = aabb.upperBound = b2Mul(xf, _outline[0]);
+	for (size_t ii = 0; ii < _outline.size(); ii++) {
+		b2Vec2 p = b2Mul(xf, _outline[ii]);
+		aabb.lowerBound = b2Min(aabb.lowerBound, p);
+		aabb.upperBound = b2Max(aabb.upperBound, p);
+		_subject[ii] = toClipper(p);
+	}
+
+	// Gather every shadow that could overlap the capsule
+	_shadowCount = 0;
+	body->GetWorld()->QueryAABB(this, aabb);
+	if (_field != nullptr) {
+		_field->appendRuns(aabb, COVERAGE_PRECISION, _shadows, _shadowCount);
+	}
+	if (_shadowCount == 0) {
+		return _ratio;
+	}
+
+	_clipper.Clear();
+	_clipper.AddPath(_subject, ClipperLib::ptSubject, true);
+	for (size_t ii = 0; ii < _shadowCount; ii++) {
+		_clipper.AddPath(_shadows[ii], ClipperLib::ptClip, true);
+	}
+	_solution.clear();
+	_clipper.Execute(ClipperLib::ctIntersection, _solution,
+		ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+
+	// Holes have negative area, so the signed sum is the covered area
+	double covered = 0.0;
+	for (const ClipperLib::Path& path : _solution) {
+		covered += ClipperLib::Area(path);
+	}
+	_ratio = (float)(fabs(covered) / _area);
+	if (_ratio > 1.0f) _ratio = 1.0f;
+	return _ratio;
+}
+
+bool ShadowCoverage::ReportFixture(b2Fixture* fixture) {
+	if ((fixture->GetFilterData().categoryBits & _category) != 0) {
+		addShape(fixture->GetShape(), fixture->GetBody()->GetTransform());
+	}
+	return true; // Keep looking
+}
+
+void ShadowCoverage::addShape(const b2Shape* shape, const b2Transform& xf) {
+	if (_shadowCount == _shadows.size()) {
+		_shadows.push_back(ClipperLib::Path());
+	}
+	ClipperLib::Path& path = _shadows[_shadowCount];
+	path.clear();
+
+	switch (shape->GetType()) {
+	case b2Shape::e_polygon:
+	{
+		const b2PolygonShape* poly = (const b2PolygonShape*)shape;
+		for (int ii = 0; ii < poly->m_count; ii++) {
+			path.push_back(toClipper(b2Mul(xf, poly->m_vertices[ii])));
+		}
+		break;
+	}
+	case b2Shape::e_circle:
+	{
+		const b2CircleShape* circle = (const b2CircleShape*)shape;
+		b2Vec2 center = b2Mul(xf, circle->m_p);
+		for (int ii = 0; ii < COVERAGE_CIRCLE_SEGMENTS; ii++) {
+			float rads = 2.0f * (float)M_PI * ii / COVERAGE_CIRCLE_SEGMENTS;
+			path.push_back(toClipper(center + circle->m_radius * b2Vec2(cosf(rads), sinf(rads))));
+		}
+		break;
+	}
+	default:
+		// Edges and chains have no area, so they cannot shade anything
+		return;
+	}
+	_shadowCount++;
+}
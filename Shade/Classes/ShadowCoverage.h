@@ -0,0 +1,108 @@
+#ifndef __SHADOW_COVERAGE_H__
+#define __SHADOW_COVERAGE_H__
+
+#include <vector>
+#include <cocos2d.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2WorldCallbacks.h>
+#include "clipper/clipper.hpp"
+#include "ShadowField.h"
+
+/** How many line segments to use for each rounded end of the capsule outline */
+#define COVERAGE_CAP_SEGMENTS 8
+/** Fixed point scale from Box2D units to Clipper integer coordinates */
+#define COVERAGE_PRECISION 10000.0f
+
+using namespace cocos2d;
+
+/**
+ * Analytic coverage engine for the character capsule.
+ *
+ * Instead of sampling a grid of sensor fixtures, this class intersects the
+ * outline of the character with the polygons of every shadow fixture that
+ * overlaps its bounding box, and returns the exact fraction of the outline
+ * area that lies in shade. Overlapping shadows are unioned by the clipper,
+ * so they are never counted twice.
+ *
+ * Like the controllers, this class does not allocate anything in its
+ * constructor, so it can be held by value. All scratch buffers are reused
+ * from frame to frame.
+ */
+class ShadowCoverage : public b2QueryCallback {
+private:
+	/** The outline of the capsule in body coordinates */
+	std::vector<b2Vec2> _outline;
+	/** Area of the capsule outline, in Clipper units */
+	double _area;
+	/** The category bits of the fixtures that count as shade */
+	uint16 _category;
+	/** The most recently computed coverage ratio */
+	float _ratio;
+	/** The baked static shadows, or nullptr if every shadow is a fixture */
+	const ShadowField* _field;
+
+	/** The capsule outline in world coordinates (scratch) */
+	ClipperLib::Path _subject;
+	/** The shadow outlines overlapping the capsule (scratch) */
+	ClipperLib::Paths _shadows;
+	/** How many entries of _shadows are in use this frame */
+	size_t _shadowCount;
+	/** The intersection of the capsule and the shadows (scratch) */
+	ClipperLib::Paths _solution;
+	/** The clipper, reused to keep its internal buffers */
+	ClipperLib::Clipper _clipper;
+
+	/** Appends the given shape, transformed to world space, to _shadows */
+	void addShape(const b2Shape* shape, const b2Transform& xf);
+
+public:
+	ShadowCoverage() : _area(0.0), _category(0), _ratio(0.0f), _field(nullptr), _shadowCount(0) {}
+
+	/**
+	 * Builds the capsule outline for a character of the given size.
+	 *
+	 * The capsule is oriented along its longer axis, matching the default
+	 * orientation chosen by CapsuleObstacle.
+	 *
+	 * @param  size      The dimensions of the capsule, in Box2D units
+	 * @param  category  The category bits of fixtures that cast shade
+	 *
+	 * @return true if the outline is non-degenerate
+	 */
+	bool init(const Size& size, uint16 category);
+
+	/** Clears the outline and all scratch buffers. */
+	void dispose();
+
+	/**
+	 * Recomputes the coverage ratio for the given body.
+	 *
+	 * This queries the broadphase of the body's world once, and then runs a
+	 * single clipping operation. No contacts are created.
+	 *
+	 * @param  body  The body of the character
+	 *
+	 * @return the fraction of the capsule covered by shade
+	 */
+	float update(const b2Body* body);
+
+	/**
+	 * Sets the baked field of static shadows to combine with the fixtures.
+	 *
+	 * Shaded cells of the field under the capsule are unioned with the shadow
+	 * fixtures found by the query, so static shadows need no fixtures of the
+	 * queried category at all.
+	 *
+	 * @param  field  The baked static shadows, or nullptr for none
+	 */
+	void setField(const ShadowField* field) { _field = field; }
+
+	/** Returns the fraction of the capsule covered by shade, as of the last update. */
+	float getRatio() const { return _ratio; }
+
+	/** Collects candidate shadow fixtures during update(). Do not call directly. */
+	bool ReportFixture(b2Fixture* fixture) override;
+};
+
+#endif /* __SHADOW_COVERAGE_H__ */
@@ -0,0 +1,76 @@
+#include <math.h>
+#include <algorithm>
+#include "ShadowField.h"
+
+bool ShadowField::init(const Size& size, float resolution) {
+	dispose();
+	if (size.width <= 0.0f || size.height <= 0.0f || resolution <= 0.0f) {
+		return false;
+	}
+	_cellSize = 1.0f / resolution;
+	_cols = (int)ceilf(size.width * resolution);
+	_rows = (int)ceilf(size.height * resolution);
+	_rowWords = (_cols + SHADOW_FIELD_WORD_BITS - 1) / SHADOW_FIELD_WORD_BITS;
+	_bits.assign(_rowWords * _rows, 0);
+	return true;
+}
+
+void ShadowField::dispose() {
+	_bits.clear();
+	_cols = _rows = _rowWords = 0;
+	_cellSize = 0.0f;
+	_baked = false;
+}
+
+void ShadowField::addBox(const Vec2& center, const Size& size) {
+	if (_bits.empty()) {
+		return;
+	}
+
+	// Cover every cell whose center lies inside the box
+	int col0 = std::max(0, (int)ceilf((center.x - size.width * 0.5f) / _cellSize - 0.5f));
+	int col1 = std::min(_cols - 1, (int)floorf((center.x + size.width * 0.5f) / _cellSize - 0.5f));
+	int row0 = std::max(0, (int)ceilf((center.y - size.height * 0.5f) / _cellSize - 0.5f));
+	int row1 = std::min(_rows - 1, (int)floorf((center.y + size.height * 0.5f) / _cellSize - 0.5f));
+	for (int row = row0; row <= row1; row++) {
+		uint64_t* line = &_bits[row * _rowWords];
+		for (int col = col0; col <= col1; col++) {
+			line[col / SHADOW_FIELD_WORD_BITS] |= (1ULL << (col % SHADOW_FIELD_WORD_BITS));
+		}
+	}
+}
+
+void ShadowField::appendRuns(const b2AABB& aabb, float scale, ClipperLib::Paths& paths, size_t& count) const {
+	if (_bits.empty()) {
+		return;
+	}
+
+	int col0 = std::max(0, (int)floorf(aabb.lowerBound.x / _cellSize));
+	int col1 = std::min(_cols - 1, (int)floorf(aabb.upperBound.x / _cellSize));
+	int row0 = std::max(0, (int)floorf(aabb.lowerBound.y / _cellSize));
+	int row1 = std::min(_rows - 1, (int)floorf(aabb.upperBound.y / _cellSize));
+	ClipperLib::cInt step = (ClipperLib::cInt)(_cellSize * scale);
+	for (int row = row0; row <= row1; row++) {
+		int col = col0;
+		while (col <= col1) {
+			if (!cell(col, row)) {
+				col++;
+				continue;
+			}
+			int start = col;
+			while (col <= col1 && cell(col, row)) {
+				col++;
+			}
+
+			if (count == paths.size()) {
+				paths.push_back(ClipperLib::Path());
+			}
+			ClipperLib::Path& path = paths[count++];
+			path.resize(4);
+			path[0] = ClipperLib::IntPoint(start * step, row * step);
+			path[1] = ClipperLib::IntPoint(col * step, row * step);
+			path[2] = ClipperLib::IntPoint(col * step, (row + 1) * step);
+			path[3] = ClipperLib::IntPoint(start * step, (row + 1) * step);
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#ifndef __SHADOW_FIELD_H__
+#define __SHADOW_FIELD_H__
+
+#include <vector>
+#include <stdint.h>
+#include <cocos2d.h>
+#include <Box2D/Collision/b2Collision.h>
+#include "clipper/clipper.hpp"
+
+/** How many field cells there are per Box2D unit, along each axis */
+#define SHADOW_FIELD_RESOLUTION 8.0f
+/** The number of cells packed into each word of a field row */
+#define SHADOW_FIELD_WORD_BITS 64
+
+using namespace cocos2d;
+
+/**
+ * Baked coverage grid of the static shadows in a level.
+ *
+ * Building shadows never move once the level is populated, so rather than
+ * have the character sensors collide with them through Box2D every step,
+ * their footprints are rasterized once into a bit-packed grid covering the
+ * whole level. A cell is set if its center lies inside some static shadow.
+ *
+ * Lookups are O(1). The grid is stored with the level, so it is baked on
+ * first population and reused on every reset.
+ */
+class ShadowField {
+private:
+	/** One bit per cell, row-major, each row padded to whole words */
+	std::vector<uint64_t> _bits;
+	/** The number of cells in each row */
+	int _cols;
+	/** The number of rows */
+	int _rows;
+	/** The number of words in each row */
+	int _rowWords;
+	/** The size of one (square) cell, in Box2D units */
+	float _cellSize;
+	/** Whether every static shadow has been rasterized */
+	bool _baked;
+
+	/** Returns whether the cell at (col, row) is set. Does no bounds checks */
+	bool cell(int col, int row) const {
+		return (_bits[row * _rowWords + col / SHADOW_FIELD_WORD_BITS] >> (col % SHADOW_FIELD_WORD_BITS)) & 1ULL;
+	}
+
+public:
+	ShadowField() : _cols(0), _rows(0), _rowWords(0), _cellSize(0.0f), _baked(false) {}
+
+	/**
+	 * Allocates an empty field covering a level of the given size.
+	 *
+	 * @param  size        The level dimensions, in Box2D units
+	 * @param  resolution  The number of cells per Box2D unit
+	 *
+	 * @return true if the field is non-empty
+	 */
+	bool init(const Size& size, float resolution = SHADOW_FIELD_RESOLUTION);
+
+	/** Releases the field and marks it unbaked. */
+	void dispose();
+
+	/**
+	 * Rasterizes an axis-aligned shadow footprint into the field.
+	 *
+	 * @param  center  The center of the footprint, in Box2D units
+	 * @param  size    The dimensions of the footprint, in Box2D units
+	 */
+	void addBox(const Vec2& center, const Size& size);
+
+	/** Marks the field as complete. Lookups are valid before this, but partial. */
+	void bake() { _baked = true; }
+
+	/** Returns whether every static shadow has been rasterized */
+	bool isBaked() const { return _baked; }
+
+	/** Returns the size of one cell, in Box2D units */
+	float getCellSize() const { return _cellSize; }
+
+	/**
+	 * Returns whether the given point lies in a static shadow.
+	 *
+	 * Points outside of the level are never in shade.
+	 *
+	 * @param  x  The x-coordinate, in Box2D units
+	 * @param  y  The y-coordinate, in Box2D units
+	 */
+	bool isShaded(float x, float y) const {
+		if (x < 0.0f || y < 0.0f) return false;
+		int col = (int)(x / _cellSize);
+		int row = (int)(y / _cellSize);
+		return col < _cols && row < _rows && cell(col, row);
+	}
+
+	/**
+	 * Appends the shaded cells overlapping a box to a set of clip paths.
+	 *
+	 * Each horizontal run of shaded cells becomes one rectangle. Entries of
+	 * paths past count are reused before any new ones are allocated.
+	 *
+	 * @param  aabb   The region of interest, in Box2D units
+	 * @param  scale  The scale from Box2D units to Clipper coordinates
+	 * @param  paths  The clip paths to append to
+	 * @param  count  The number of paths in use, updated on return
+	 */
+	void appendRuns(const b2AABB& aabb, float scale, ClipperLib::Paths& paths, size_t& count) const;
+};
+
+#endif /* __SHADOW_FIELD_H__ */
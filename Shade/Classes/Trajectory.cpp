@@ -0,0 +1,40 @@
+#include <math.h>
+#include <algorithm>
+#include "Trajectory.h"
+
+void Trajectory::addFrame(Builder& build) {
+	bool changed = _segments.empty() || build.split
+		|| _segments.back().state.angle != build.state.angle
+		|| !(_segments.back().state.velocity == build.state.velocity);
+	if (changed) {
+		Segment segment;
+		segment.start = build.frame;
+		segment.state = build.state;
+		segment.state.position = position(build);
+		_segments.push_back(segment);
+		build.split = false;
+	}
+	build.frame += 1.0f;
+}
+
+Trajectory::Sample Trajectory::evaluate(float frame) const {
+	CCASSERT(!_segments.empty(), "Trajectory has not been compiled");
+	frame = std::max(frame, 0.0f);
+
+	// Fold a later pass of the cycle back onto the compiled one
+	b2Vec2 shift(0.0f, 0.0f);
+	if (_cycleFirst >= 0 && frame >= _cycleStart + _cycleLength) {
+		float passes = floorf((frame - _cycleStart) / _cycleLength);
+		frame -= passes * _cycleLength;
+		shift = passes * _cycleShift;
+	}
+
+	// The last segment starting at or before the frame
+	auto after = std::upper_bound(_segments.begin(), _segments.end(), frame,
+		[](float value, const Segment& segment) { return value < segment.start; });
+	const Segment& segment = *(after - 1);
+
+	Sample result = segment.state;
+	result.position += ((frame - segment.start) * _frameTime) * segment.state.velocity + shift;
+	return result;
+}
@@ -0,0 +1,196 @@
+#ifndef __TRAJECTORY_H__
+#define __TRAJECTORY_H__
+
+#include <vector>
+#include <Box2D/Common/b2Math.h>
+#include <ActionQueue.h>
+
+/** The duration of one act() call, which turns action lengths into time */
+#define TRAJECTORY_FRAME_TIME (1.0f / 60.0f)
+
+using namespace std;
+
+/**
+ * A mover's action program compiled into a piecewise-linear timeline.
+ *
+ * The program is run once, frame by frame, through the mover type's step()
+ * method, which applies one frame of an action to a heading and a velocity
+ * exactly as act() does to the body. Frames with the same heading and
+ * velocity are merged, so a "go" action of any length is one segment, and
+ * the segments are kept sorted by their start frame. The position, heading
+ * and velocity at any frame are then found by binary search, in O(log n)
+ * of the program length, without running the frames before it.
+ *
+ * A cycling program is compiled as a run-in, followed by one pass of its
+ * cycle that repeats forever, shifted by how far one pass moves the mover.
+ * A program that ends leaves the mover coasting with its last velocity,
+ * as a body does once its queue is empty.
+ *
+ * Time is counted in frames, so a position is exact at whole frames and
+ * interpolated in between.
+ */
+class Trajectory {
+public:
+	/** The state of a mover at one point in time */
+	struct Sample {
+		/** The body position, in Box2D units */
+		b2Vec2 position;
+		/** The body velocity, in Box2D units per second */
+		b2Vec2 velocity;
+		/** The body angle, in radians */
+		float angle;
+	};
+
+private:
+	/** A stretch of constant heading and velocity */
+	struct Segment {
+		/** The first frame of the segment */
+		float start;
+		/** The body state at the first frame */
+		Sample state;
+	};
+
+	/** The segments, by start frame; the first starts at frame 0 */
+	vector<Segment> _segments;
+	/** The index of the first segment of the cycle, or -1 if there is none */
+	int _cycleFirst;
+	/** The frame the cycle starts at */
+	float _cycleStart;
+	/** The number of frames in one pass of the cycle */
+	float _cycleLength;
+	/** How far one pass of the cycle moves the mover */
+	b2Vec2 _cycleShift;
+	/** The duration of one frame, in seconds */
+	float _frameTime;
+
+	/** The state of a compile in progress */
+	struct Builder {
+		/** The heading and velocity of the current frame */
+		Sample state;
+		/** The current frame */
+		float frame;
+		/** The position at frame 0 */
+		b2Vec2 origin;
+		/** Whether the next frame must start a new segment */
+		bool split;
+	};
+
+	/** Adds one frame with the given state, merging it into the last segment if it matches */
+	void addFrame(Builder& build);
+
+	/**
+	 * Runs actions [first, last) of a program through T::step().
+	 *
+	 * @param  fresh  Whether every action starts from its full length, as
+	 *                on a later pass of a cycle, instead of its counter
+	 */
+	template <class T>
+	void addActions(const vector<typename ActionQueue<T>::Action>& program, int first, int last,
+		bool fresh, Builder& build) {
+		for (int ii = first; ii < last; ii++) {
+			const typename ActionQueue<T>::Action& action = program[ii];
+			int frames = fresh ? action._length : action._counter;
+			if (frames <= 0) {
+				continue;
+			}
+			// act() turns the body to the bearing when an action starts afresh
+			if (fresh || action._counter == action._length) {
+				build.state.angle = action._bearing;
+			}
+			for (int jj = 0; jj < frames; jj++) {
+				T::step(action._type, build.state.angle, build.state.velocity);
+				addFrame(build);
+			}
+		}
+	}
+
+public:
+	Trajectory() : _cycleFirst(-1), _cycleStart(0.0f), _cycleLength(0.0f), _frameTime(TRAJECTORY_FRAME_TIME) {}
+
+	/**
+	 * Compiles what is left of an action queue.
+	 *
+	 * The queue is not changed. Any forced actions run first, as in act().
+	 *
+	 * @param  queue      The action program
+	 * @param  start      The body state when the next action starts
+	 * @param  frameTime  The duration of one frame, in seconds
+	 */
+	template <class T>
+	void compile(const ActionQueue<T>& queue, const Sample& start, float frameTime = TRAJECTORY_FRAME_TIME) {
+		clear();
+		_frameTime = frameTime;
+		vector<typename ActionQueue<T>::Action> program;
+		int cycle = ActionQueue<T>::appendPending(queue, program);
+
+		Builder build;
+		build.state = start;
+		build.frame = 0.0f;
+		build.origin = start.position;
+		build.split = true;
+		addActions<T>(program, 0, (int)program.size(), false, build);
+		if (cycle == NO_ACTION) {
+			if (_segments.empty()) {
+				Segment rest = { 0.0f, start };
+				_segments.push_back(rest);
+			}
+			return;
+		}
+
+		// A pass that keeps an incoming velocity is only periodic after a pass that set it
+		for (int pass = 0; pass < 2; pass++) {
+			Sample entry = build.state;
+			int first = (int)_segments.size();
+			float startFrame = build.frame;
+			build.split = true;
+			addActions<T>(program, cycle, (int)program.size(), true, build);
+			if (pass == 1 || build.state.velocity == entry.velocity) {
+				_cycleFirst = first;
+				_cycleStart = startFrame;
+				_cycleLength = build.frame - startFrame;
+				_cycleShift = position(build) - _segments[first].state.position;
+				return;
+			}
+		}
+	}
+
+	/** Forgets the timeline. */
+	void clear() {
+		_segments.clear();
+		_cycleFirst = -1;
+		_cycleStart = _cycleLength = 0.0f;
+		_cycleShift.SetZero();
+	}
+
+	/** Returns whether nothing has been compiled */
+	bool isEmpty() const { return _segments.empty(); }
+
+	/** Returns whether the timeline repeats forever */
+	bool isCycling() const { return _cycleFirst >= 0; }
+
+	/** Returns the number of segments, for profiling */
+	int size() const { return (int)_segments.size(); }
+
+	/**
+	 * Returns the state of the mover at a given frame.
+	 *
+	 * The position is where the frame starts, and the heading and velocity
+	 * are the ones act() gives the body for that frame, so frame 0 starts at
+	 * the position passed to compile(). The timeline must not be empty.
+	 *
+	 * @param  frame  The number of frames since the start, which may be fractional
+	 */
+	Sample evaluate(float frame) const;
+
+private:
+	/** Returns the position at the builder's current frame */
+	b2Vec2 position(const Builder& build) const {
+		if (_segments.empty()) {
+			return build.origin;
+		}
+		const Segment& last = _segments.back();
+		return last.state.position + ((build.frame - last.start) * _frameTime) * last.state.velocity;
+	}
+};
+
+#endif /* __TRAJECTORY_H__ */
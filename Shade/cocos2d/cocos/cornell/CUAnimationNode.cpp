@@ -94,6 +94,35 @@ AnimationNode* AnimationNode::create(Texture2D* texture, int rows, int cols, int
     return nullptr;
 }
 
+/**
+ * Creates a new filmstrip node from a region of the given texture.
+ *
+ * This is for a filmstrip packed into a texture atlas.  The region is
+ * given as in TexturedNode::setTextureRegion(), and the frames are laid
+ * out within it.
+ *
+ * The size of the node is equal to the size of a single frame in the filmstrip.
+ * To resize the node, scale it up or down.  Do NOT change the polygon, as that
+ * will interfere with the animation.
+ *
+ * @param texture   The texture image to use
+ * @param region    The texture region of the filmstrip, or Rect::ZERO for all of it
+ * @param rows      The number of rows in the filmstrip
+ * @param cols      The number of columns in the filmstrip
+ *
+ * @retain  a reference to this texture
+ * @return The allocated filmstrip as an autorelease object
+ */
+AnimationNode* AnimationNode::create(Texture2D* texture, const Rect& region, int rows, int cols) {
+    AnimationNode *filmStrip = new (std::nothrow) AnimationNode();
+    if (filmStrip && filmStrip->initWithFilmstrip(texture, region, rows, cols)) {
+        filmStrip->autorelease();
+        return filmStrip;
+    }
+    CC_SAFE_DELETE(filmStrip);
+    return nullptr;
+}
+
 
 #pragma mark -
 #pragma mark Internal Constructors
@@ -149,11 +178,53 @@ bool AnimationNode::initWithFilmstrip(Texture2D* texture, int rows, int cols) {
  * @return True if initialization was successful; false otherwise.
  */
 bool AnimationNode::initWithFilmstrip(Texture2D* texture, int rows, int cols, int size) {
+    return initWithFilmstrip(texture, Rect::ZERO, rows, cols, size);
+}
+
+/**
+ * Initializes the film strip with a region of the given texture.
+ *
+ * This is for a filmstrip packed into a texture atlas.  The region is
+ * given as in TexturedNode::setTextureRegion(), and the frames are laid
+ * out within it.
+ *
+ * @param texture   The texture image to use
+ * @param region    The texture region of the filmstrip, or Rect::ZERO for all of it
+ * @param rows      The number of rows in the filmstrip
+ * @param cols      The number of columns in the filmstrip
+ *
+ * @retain  a reference to this texture
+ * @return True if initialization was successful; false otherwise.
+ */
+bool AnimationNode::initWithFilmstrip(Texture2D* texture, const Rect& region, int rows, int cols) {
+    return initWithFilmstrip(texture, region, rows, cols, rows * cols);
+}
+
+/**
+ * Initializes the film strip with a region of the given texture.
+ *
+ * This is for a filmstrip packed into a texture atlas.  The region is
+ * given as in TexturedNode::setTextureRegion(), and the frames are laid
+ * out within it.  The parameter size is to indicate that there are unused
+ * frames in the filmstrip.  The value size must be less than or equal to
+ * rows*cols, or this constructor will raise an error.
+ *
+ * @param texture   The texture image to use
+ * @param region    The texture region of the filmstrip, or Rect::ZERO for all of it
+ * @param rows      The number of rows in the filmstrip
+ * @param cols      The number of columns in the filmstrip
+ * @param size      The number of frames in the filmstrip
+ *
+ * @retain  a reference to this texture
+ * @return True if initialization was successful; false otherwise.
+ */
+bool AnimationNode::initWithFilmstrip(Texture2D* texture, const Rect& region, int rows, int cols, int size) {
     CCASSERT(size <= rows*cols, "ERROR: Invalid strip size");
     
     this->_cols = cols;
     this->_size = size;
-    _bounds.size = texture->getContentSize();
+    _region = region;
+    _bounds.size = (region.equals(Rect::ZERO) ? texture->getContentSize() : region.size);
     _bounds.size.width /= cols;
     _bounds.size.height /= rows;
     return this->initWithTexture(texture, _bounds);
@@ -175,7 +246,7 @@ void AnimationNode::setFrame(int frame) {
 
     _frame = frame;
     float x = (frame % _cols)*_bounds.size.width;
-    float y = _texture->getContentSize().height - (1+frame/_cols)*_bounds.size.height;
+    float y = getImageSize().height - (1+frame/_cols)*_bounds.size.height;
     shiftPolygon(x-_bounds.origin.x, y-_bounds.origin.y);
     _bounds.origin.set(x,y);
 }
@@ -105,6 +105,27 @@ public:
      */
     static AnimationNode* create(Texture2D* texture, int rows, int cols, int size);
 
+    /**
+     * Creates a new filmstrip node from a region of the given texture.
+     *
+     * This is for a filmstrip packed into a texture atlas.  The region is
+     * given as in TexturedNode::setTextureRegion(), and the frames are laid
+     * out within it.
+     *
+     * The size of the node is equal to the size of a single frame in the filmstrip.
+     * To resize the node, scale it up or down.  Do NOT change the polygon, as that
+     * will interfere with the animation.
+     *
+     * @param texture   The texture image to use
+     * @param region    The texture region of the filmstrip, or Rect::ZERO for all of it
+     * @param rows      The number of rows in the filmstrip
+     * @param cols      The number of columns in the filmstrip
+     *
+     * @retain  a reference to this texture
+     * @return The allocated filmstrip as an autorelease object
+     */
+    static AnimationNode* create(Texture2D* texture, const Rect& region, int rows, int cols);
+
     
 #pragma mark Attribute Accessors
     /**
@@ -183,6 +204,47 @@ CC_CONSTRUCTOR_ACCESS:
      */
     bool initWithFilmstrip(Texture2D* texture, int rows, int cols, int size);
 
+    /**
+     * Initializes the film strip with a region of the given texture.
+     *
+     * This is for a filmstrip packed into a texture atlas.  The region is
+     * given as in TexturedNode::setTextureRegion(), and the frames are laid
+     * out within it.
+     *
+     * The size of the node is equal to the size of a single frame in the filmstrip.
+     * To resize the node, scale it up or down.  Do NOT change the polygon, as that
+     * will interfere with the animation.
+     *
+     * @param texture   The texture image to use
+     * @param region    The texture region of the filmstrip, or Rect::ZERO for all of it
+     * @param rows      The number of rows in the filmstrip
+     * @param cols      The number of columns in the filmstrip
+     *
+     * @retain  a reference to this texture
+     * @return True if initialization was successful; false otherwise.
+     */
+    bool initWithFilmstrip(Texture2D* texture, const Rect& region, int rows, int cols);
+
+    /**
+     * Initializes the film strip with a region of the given texture.
+     *
+     * This is for a filmstrip packed into a texture atlas.  The region is
+     * given as in TexturedNode::setTextureRegion(), and the frames are laid
+     * out within it.  The parameter size is to indicate that there are unused
+     * frames in the filmstrip.  The value size must be less than or equal to
+     * rows*cols, or this constructor will raise an error.
+     *
+     * @param texture   The texture image to use
+     * @param region    The texture region of the filmstrip, or Rect::ZERO for all of it
+     * @param rows      The number of rows in the filmstrip
+     * @param cols      The number of columns in the filmstrip
+     * @param size      The number of frames in the filmstrip
+     *
+     * @retain  a reference to this texture
+     * @return True if initialization was successful; false otherwise.
+     */
+    bool initWithFilmstrip(Texture2D* texture, const Rect& region, int rows, int cols, int size);
+
 };
 
 NS_CC_END
@@ -229,16 +229,16 @@ void ComplexObstacle::update(float delta) {
     // Update the scene graph if appropriate
     if (_tracking) {
         if (_node != nullptr) {
-            Vec2 pos = getPosition();
+            Vec2 pos = getInterpolatedPosition();
             pos.scale(_drawScale);
             _node->setPosition(pos);
-            _node->setRotation(-getAngle()*180.0f/M_PI);
+            _node->setRotation(-getInterpolatedAngle()*180.0f/M_PI);
         }
         if (_debug != nullptr) {
-            Vec2 pos = getPosition();
+            Vec2 pos = getInterpolatedPosition();
             pos.scale(_drawScale);
             _debug->setPosition(pos);
-            _debug->setRotation(-getAngle()*180.0f/M_PI);
+            _debug->setRotation(-getInterpolatedAngle()*180.0f/M_PI);
         }
     }
     
@@ -299,6 +299,32 @@ void ComplexObstacle::positionDebugNode() {
     }
 }
 
+/**
+ * Records the current transform as the start of the next fixed step.
+ *
+ * This method records the transform of every child body as well.
+ */
+void ComplexObstacle::storePreviousTransform() {
+    Obstacle::storePreviousTransform();
+    for(auto it = _bodies.begin(); it!= _bodies.end(); ++it) {
+        (*it)->storePreviousTransform();
+    }
+}
+
+/**
+ * Sets how far the scene node is between the previous and current transform.
+ *
+ * The factor is passed on to every child body.
+ *
+ * @param alpha the interpolation factor in [0,1]
+ */
+void ComplexObstacle::setInterpolation(float alpha) {
+    Obstacle::setInterpolation(alpha);
+    for(auto it = _bodies.begin(); it!= _bodies.end(); ++it) {
+        (*it)->setInterpolation(alpha);
+    }
+}
+
 
 #pragma mark -
 #pragma mark Memory Management
@@ -1090,6 +1090,22 @@ public:
      */
     virtual void positionDebugNode() override;
     
+    /**
+     * Records the current transform as the start of the next fixed step.
+     *
+     * This method records the transform of every child body as well.
+     */
+    virtual void storePreviousTransform() override;
+    
+    /**
+     * Sets how far the scene node is between the previous and current transform.
+     *
+     * The factor is passed on to every child body.
+     *
+     * @param alpha the interpolation factor in [0,1]
+     */
+    virtual void setInterpolation(float alpha) override;
+    
     
 #pragma mark -
 #pragma mark Initializers
@@ -22,6 +22,7 @@
 //
 #include "CUJSONReader.h"
 #include "CUStrings.h"
+#include <climits>
 
 
 NS_CC_BEGIN
@@ -74,6 +75,230 @@ static int stdstrcasecmp(const char* s1, const char* s2) {
 }
 
 
+/**
+* Returns the first position in [in, end) that is not whitespace
+*
+* This is the bounded version of skipSpace, for sources that need not be
+* null-terminated.
+*
+* @param in  the input to parse
+* @param end the end of the input
+*
+* @return the first position in [in, end) that is not whitespace, or end
+*/
+static const char* skipSpace(const char* in, const char* end) {
+	while (in < end && (unsigned char)*in <= 32) {
+		in++;
+	}
+	return in;
+}
+
+/** The powers of ten that a double holds exactly */
+static const double exactPowers[23] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+* Reads a JSON number, advancing the input past it
+*
+* The number is decoded by hand rather than with strtod, so that it does not depend
+* on the locale.  The first 19 significant digits are kept exactly, which is far more
+* than a float can hold.
+*
+* @param in    the input to parse, at the start of the number
+* @param end   the end of the input
+* @param value the number read
+*
+* @return true if there was a number at the start of the input
+*/
+static bool readNumber(const char*& in, const char* end, float& value) {
+	const char* p = in;
+	bool negative = (p < end && *p == '-');
+	if (negative) p++;
+
+	unsigned long long mantissa = 0;
+	int digits = 0, exponent = 0;
+	bool any = false;
+	for (; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += (mantissa != 0);
+		} else {
+			exponent++;
+		}
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += (mantissa != 0);
+				exponent--;
+			}
+		}
+	}
+	if (!any) {
+		return false;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool minus = (p < end && *p == '-');
+		if (p < end && (*p == '-' || *p == '+')) p++;
+		if (p == end || *p < '0' || *p > '9') {
+			return false;
+		}
+		int power = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++) {
+			if (power < 10000) power = power * 10 + (*p - '0');
+		}
+		exponent += (minus ? -power : power);
+	}
+
+	double result = (double)mantissa;
+	if (mantissa != 0) {
+		int scale = (exponent < 0 ? -exponent : exponent);
+		scale = (scale > 400 ? 400 : scale);
+		double factor = 1.0;
+		for (; scale > 22; scale -= 22) {
+			factor *= exactPowers[22];
+		}
+		factor *= exactPowers[scale];
+		result = (exponent < 0 ? result / factor : result * factor);
+	}
+	value = (float)(negative ? -result : result);
+	in = p;
+	return true;
+}
+
+/**
+* Scans a JSON string, advancing the input past its closing quote
+*
+* @param in      the input to parse, at the opening quote
+* @param end     the end of the input
+* @param escaped set to true if the string has escapes
+*
+* @return true if the string is terminated
+*/
+static bool scanString(const char*& in, const char* end, bool& escaped) {
+	const char* p = in + 1;
+	while (p < end && *p != '\"') {
+		if (*p == '\\') {
+			escaped = true;
+			p++;
+		}
+		p++;
+	}
+	if (p >= end) {
+		return false;
+	}
+	in = p + 1;
+	return true;
+}
+
+/**
+* Returns the value of up to four hex digits, or 0 if they are malformed
+*
+* @param in  the digits
+* @param end the end of the input
+*
+* @return the value of the hex digits
+*/
+static unsigned int readHex(const char* in, const char* end) {
+	unsigned int value = 0;
+	for (int ii = 0; ii < 4; ii++) {
+		if (in + ii >= end) return 0;
+		char c = in[ii];
+		unsigned int digit;
+		if (c >= '0' && c <= '9') digit = c - '0';
+		else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+		else return 0;
+		value = (value << 4) | digit;
+	}
+	return value;
+}
+
+/**
+* Returns the decoded text of a JSON string
+*
+* This decodes the escapes the same way as JSONValue, transcoding \u escapes
+* from UTF-16 to UTF-8.
+*
+* @param in     the string, just past its opening quote
+* @param length the length of the string before decoding
+*
+* @return the decoded text of a JSON string
+*/
+static std::string unescape(const char* in, size_t length) {
+	const char* end = in + length;
+	std::string out;
+	out.reserve(length);
+	for (const char* ptr = in; ptr < end; ptr++) {
+		if (*ptr != '\\') {
+			out += *ptr;
+			continue;
+		}
+		if (++ptr == end) break;
+		switch (*ptr) {
+		case 'b': out += '\b'; break;
+		case 'f': out += '\f'; break;
+		case 'n': out += '\n'; break;
+		case 'r': out += '\r'; break;
+		case 't': out += '\t'; break;
+		case 'u': {
+			unsigned int uc = readHex(ptr + 1, end);
+			ptr += 4;
+			if ((uc >= 0xDC00 && uc <= 0xDFFF) || uc == 0) break;
+
+			// UTF16 surrogate pairs
+			if (uc >= 0xD800 && uc <= 0xDBFF) {
+				if (ptr + 2 >= end || ptr[1] != '\\' || ptr[2] != 'u') break;
+				unsigned int uc2 = readHex(ptr + 3, end);
+				ptr += 6;
+				if (uc2 < 0xDC00 || uc2 > 0xDFFF) break;
+				uc = 0x10000 + (((uc & 0x3FF) << 10) | (uc2 & 0x3FF));
+			}
+
+			int len = (uc < 0x80 ? 1 : (uc < 0x800 ? 2 : (uc < 0x10000 ? 3 : 4)));
+			char bytes[4];
+			for (int ii = len - 1; ii > 0; ii--) {
+				bytes[ii] = (char)((uc | 0x80) & 0xBF);
+				uc >>= 6;
+			}
+			bytes[0] = (char)(uc | byteMark[len]);
+			out.append(bytes, len);
+			break;
+		}
+		default:
+			out += *ptr;
+			break;
+		}
+	}
+	return out;
+}
+
+/**
+* Returns whether a name in the source matches a string, without regard to case
+*
+* @param name   the name in the source
+* @param length the length of the name
+* @param other  the string to compare
+*
+* @return whether the name matches the string
+*/
+static bool sameName(const char* name, size_t length, const std::string& other) {
+	if (length != other.size()) {
+		return false;
+	}
+	for (size_t ii = 0; ii < length; ii++) {
+		if (tolower((unsigned char)name[ii]) != tolower((unsigned char)other[ii])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
 #pragma mark -
 #pragma mark JSONValue
 
@@ -813,13 +1038,16 @@ bool JSONReader::initWithFile(std::string file) {
 * @return true if the file is a well-formed JSON file.
 */
 bool JSONReader::startJSON() {
-	CCASSERT(!_root, "JSON is already in progress");
-
-	std::string contents = FileUtils::getInstance()->getStringFromFile(_file);
-	_root = JSONValue::createWithString(contents.c_str());
-	_json = _root;
-
-	return _json != nullptr;
+	CCASSERT(_source == nullptr, "JSON is already in progress");
+	_text = FileUtils::getInstance()->getStringFromFile(_file);
+	_source = _text.data();
+	_length = _text.size();
+	if (!parse()) {
+		endJSON();
+		return false;
+	}
+	reset();
+	return true;
 }
 
 /**
@@ -837,12 +1065,36 @@ bool JSONReader::startJSON() {
 * @return true if the file is a well-formed JSON file.
 */
 bool JSONReader::startJSON(std::string source) {
-	CCASSERT(!_root, "JSON is already in progress");
-
-	_root = JSONValue::createWithString(source.c_str());
-	_json = _root;
+	CCASSERT(_source == nullptr, "JSON is already in progress");
+	_text.swap(source);
+	return startJSON(_text.data(), _text.size());
+}
 
-	return _json != nullptr;
+/**
+* Starts a JSON parser for the given buffer, without copying it.
+*
+* This method will ignore the associated file, and parse the provided buffer instead.
+* The buffer need not be null-terminated, and it is borrowed: it must stay valid and
+* unchanged until endJSON() is called.
+*
+* The parser will fail if the JSON is not well-formed.  In that case, the method will
+* return false.
+*
+* @param  source   the JSON source
+* @param  length   the length of the source, in bytes
+*
+* @return true if the buffer is well-formed JSON.
+*/
+bool JSONReader::startJSON(const char* source, size_t length) {
+	CCASSERT(_source == nullptr, "JSON is already in progress");
+	_source = source;
+	_length = length;
+	if (_source == nullptr || !parse()) {
+		endJSON();
+		return false;
+	}
+	reset();
+	return true;
 }
 
 /**
@@ -852,14 +1104,276 @@ bool JSONReader::startJSON(std::string source) {
 * version -- is called again.
 */
 void JSONReader::endJSON() {
-	if (_root != nullptr) {
-		delete _root;
-		_root = nullptr;
-	}
+	_tape.clear();
+	_text.clear();
+	_source = nullptr;
+	_length = 0;
+	_hintParent = _hint = -1;
 	reset();
 }
 
 
+#pragma mark Tape Parsing
+/**
+* Reads the source onto the tape, replacing its contents.
+*
+* The parse is iterative, with an explicit stack of the open arrays and objects,
+* so deep documents cannot overflow the call stack.  Each value is linked to its
+* previous sibling, and counted in its parent, as soon as it is read.  Anything
+* after the root value is ignored, as with JSONValue.
+*
+* @return true if the source is well-formed JSON
+*/
+bool JSONReader::parse() {
+	_tape.clear();
+	_tape.reserve(_length / 8 + 1);
+	_hintParent = _hint = -1;
+	if (_length >= UINT_MAX) {
+		return false;
+	}
+
+	const char* begin = _source;
+	const char* end = _source + _length;
+	const char* p = skipSpace(begin, end);
+
+	// The open arrays and objects, and the last child read of each (0 if none)
+	std::vector<int> open;
+	std::vector<int> last;
+	Token token;
+	token.key = token.keyLength = 0;
+	token.escaped = 0;
+	while (true) {
+		if (p == end) {
+			return false;
+		}
+		token.start = (unsigned int)(p - begin);
+		token.length = 0;
+		token.next = 0;
+		token.number = 0.0f;
+		bool container = false;
+		switch (*p) {
+		case '{':
+			token.type = JSON_TYPE_OBJECT;
+			container = true;
+			p++;
+			break;
+		case '[':
+			token.type = JSON_TYPE_ARRAY;
+			container = true;
+			p++;
+			break;
+		case '\"': {
+			bool escaped = false;
+			const char* quote = p;
+			if (!scanString(p, end, escaped)) {
+				return false;
+			}
+			token.type = JSON_TYPE_STRING;
+			token.start = (unsigned int)(quote + 1 - begin);
+			token.length = (unsigned int)(p - quote - 2);
+			token.escaped |= (escaped ? 1 : 0);
+			break;
+		}
+		case 'n':
+			if (end - p < 4 || strncmp(p, "null", 4) != 0) return false;
+			token.type = JSON_TYPE_NULL;
+			p += 4;
+			break;
+		case 't':
+			if (end - p < 4 || strncmp(p, "true", 4) != 0) return false;
+			token.type = JSON_TYPE_BOOL;
+			token.number = 1.0f;
+			p += 4;
+			break;
+		case 'f':
+			if (end - p < 5 || strncmp(p, "false", 5) != 0) return false;
+			token.type = JSON_TYPE_BOOL;
+			p += 5;
+			break;
+		default:
+			if (!readNumber(p, end, token.number)) return false;
+			token.type = JSON_TYPE_FLOAT;
+			break;
+		}
+
+		int index = (int)_tape.size();
+		if (!open.empty()) {
+			if (last.back() != 0) {
+				_tape[last.back()].next = index;
+			}
+			last.back() = index;
+			_tape[open.back()].length++;
+		}
+		_tape.push_back(token);
+
+		// Close any containers that end here
+		bool first = container;
+		if (container) {
+			open.push_back(index);
+			last.push_back(0);
+		}
+		while (true) {
+			if (open.empty()) {
+				return true;
+			}
+			p = skipSpace(p, end);
+			if (p == end) {
+				return false;
+			}
+			bool object = (_tape[open.back()].type == JSON_TYPE_OBJECT);
+			if (*p == (object ? '}' : ']')) {
+				p++;
+				open.pop_back();
+				last.pop_back();
+				first = false;
+			} else if (first) {
+				break;
+			} else if (*p == ',') {
+				p = skipSpace(p + 1, end);
+				break;
+			} else {
+				return false;
+			}
+		}
+
+		// Read the name of the next field
+		token.key = token.keyLength = 0;
+		token.escaped = 0;
+		if (_tape[open.back()].type == JSON_TYPE_OBJECT) {
+			if (p == end || *p != '\"') {
+				return false;
+			}
+			bool escaped = false;
+			const char* quote = p;
+			if (!scanString(p, end, escaped)) {
+				return false;
+			}
+			token.key = (unsigned int)(quote + 1 - begin);
+			token.keyLength = (unsigned int)(p - quote - 2);
+			token.escaped = (escaped ? 1 : 0);
+			p = skipSpace(p, end);
+			if (p == end || *p != ':') {
+				return false;
+			}
+			p = skipSpace(p + 1, end);
+		}
+	}
+}
+
+/**
+* Returns the position on the tape of the field of the cursor with the given name
+*
+* The search starts just after the last field found, if that was in the same object,
+* and wraps around to the first field.  So reading the fields of an object in file
+* order finds each one at the first step.
+*
+* @param  name  the name for the child to access
+*
+* @return the position on the tape of the field, or -1
+*/
+int JSONReader::find(const std::string& name) const {
+	if (typeOf(_cursor) != JSON_TYPE_OBJECT || _tape[_cursor].length == 0) {
+		return -1;
+	}
+
+	int first = _cursor + 1;
+	int start = first;
+	if (_hintParent == _cursor && _tape[_hint].next != 0) {
+		start = _tape[_hint].next;
+	}
+	int token = start;
+	do {
+		const Token& field = _tape[token];
+		bool match;
+		if (field.escaped) {
+			std::string key = unescape(_source + field.key, field.keyLength);
+			match = (stdstrcasecmp(key.c_str(), name.c_str()) == 0);
+		} else {
+			match = sameName(_source + field.key, field.keyLength, name);
+		}
+		if (match) {
+			_hintParent = _cursor;
+			_hint = token;
+			return token;
+		}
+		token = (field.next != 0 ? (int)field.next : first);
+	} while (token != start);
+	return -1;
+}
+
+/**
+* Returns the decoded text of a string in the source
+*
+* @param  start    the offset of the string, just past its opening quote
+* @param  length   the length of the string before decoding
+* @param  escaped  whether the string has escapes
+*
+* @return the decoded string
+*/
+std::string JSONReader::decode(unsigned int start, unsigned int length, bool escaped) const {
+	if (!escaped) {
+		return std::string(_source + start, length);
+	}
+	return unescape(_source + start, length);
+}
+
+/**
+* Returns whether the value at a position is an array whose elements are all numbers
+*
+* @param  token  the position on the tape
+*
+* @return whether the value is an array of numbers
+*/
+bool JSONReader::isNumberArray(int token) const {
+	if (typeOf(token) != JSON_TYPE_ARRAY) {
+		return false;
+	}
+	int child = token + 1;
+	for (unsigned int ii = 0; ii < _tape[token].length; ii++) {
+		if (_tape[child].type != JSON_TYPE_FLOAT) {
+			return false;
+		}
+		child = _tape[child].next;
+	}
+	return true;
+}
+
+/**
+* Copies the elements of an array of numbers to a buffer
+*
+* @param  token   the position on the tape
+* @param  buffer  the buffer to store the float values
+*
+* @return number of elements written to the buffer, or 0 if the value is not an array of numbers
+*/
+int JSONReader::readFloatArray(int token, float* buffer) const {
+	if (!isNumberArray(token)) {
+		return 0;
+	}
+	int size = (int)_tape[token].length;
+	int child = token + 1;
+	for (int ii = 0; ii < size; ii++) {
+		buffer[ii] = _tape[child].number;
+		child = _tape[child].next;
+	}
+	return size;
+}
+
+/**
+* Returns the key for the current cursor position in the DOM.
+*
+* @return the key for the current cursor position in the DOM.
+*/
+std::string JSONReader::getKey() const {
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+	const Token& token = _tape[_cursor];
+	if (token.key == 0) {
+		return "";
+	}
+	return decode(token.key, token.keyLength, token.escaped != 0);
+}
+
+
 #pragma mark Type Checking
 /**
 * Returns true if there is an entry for the given key.
@@ -869,10 +1383,9 @@ void JSONReader::endJSON() {
 * @return true if there is an entry for the given key.
 */
 bool JSONReader::exists(std::string key) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(key);
-	return j != nullptr;
+	return find(key) >= 0;
 }
 
 /**
@@ -883,10 +1396,10 @@ bool JSONReader::exists(std::string key) const {
 * @return true if the entry for key exists and has a nullptr value.
 */
 bool JSONReader::isNull(std::string key) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(key);
-	return j != nullptr && j->getType() == JSON_TYPE_NULL;
+	int type = typeOf(find(key));
+	return type == JSON_TYPE_NULL;
 }
 
 /**
@@ -897,10 +1410,10 @@ bool JSONReader::isNull(std::string key) const {
 * @return true if the entry for key exists and represents an object.
 */
 bool JSONReader::isObject(std::string key) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(key);
-	return j != nullptr && (j->getType() == JSON_TYPE_OBJECT || j->getType() == JSON_TYPE_NULL);
+	int type = typeOf(find(key));
+	return type == JSON_TYPE_OBJECT || type == JSON_TYPE_NULL;
 }
 
 /**
@@ -911,10 +1424,10 @@ bool JSONReader::isObject(std::string key) const {
 * @return true if the entry for key exists and represents an array.
 */
 bool JSONReader::isArray(std::string key) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(key);
-	return j != nullptr && (j->getType() == JSON_TYPE_ARRAY || j->getType() == JSON_TYPE_NULL);
+	int type = typeOf(find(key));
+	return type == JSON_TYPE_ARRAY || type == JSON_TYPE_NULL;
 }
 
 /**
@@ -925,10 +1438,10 @@ bool JSONReader::isArray(std::string key) const {
 * @return true if the entry for key exists and represents a boolean value
 */
 bool JSONReader::isBool(std::string key) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(key);
-	return j != nullptr && j->getType() == JSON_TYPE_BOOL;
+	int type = typeOf(find(key));
+	return type == JSON_TYPE_BOOL;
 }
 
 /**
@@ -941,10 +1454,10 @@ bool JSONReader::isBool(std::string key) const {
 * @return true if the entry for key exists and represents a number
 */
 bool JSONReader::isNumber(std::string key) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(key);
-	return j != nullptr && j->getType() == JSON_TYPE_FLOAT;
+	int type = typeOf(find(key));
+	return type == JSON_TYPE_FLOAT;
 }
 
 /**
@@ -955,10 +1468,10 @@ bool JSONReader::isNumber(std::string key) const {
 * @return true if the entry for key exists and represents a string
 */
 bool JSONReader::isString(std::string key) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(key);
-	return j != nullptr && j->getType() == JSON_TYPE_STRING;
+	int type = typeOf(find(key));
+	return type == JSON_TYPE_STRING;
 }
 
 /**
@@ -971,14 +1484,10 @@ bool JSONReader::isString(std::string key) const {
 * @return true if the entry for key exists and represents a Vec2 value
 */
 bool JSONReader::isVec2(std::string key) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(key);
-	if (j == nullptr || j->getType() != JSON_TYPE_ARRAY || j->getSize() != 2) {
-		return false;
-	}
-	JSONValue* child = j->getChild();
-	return (child->getType() == JSON_TYPE_FLOAT && child->getNext()->getType() == JSON_TYPE_FLOAT);
+	int token = find(key);
+	return typeOf(token) == JSON_TYPE_ARRAY && _tape[token].length == 2 && isNumberArray(token);
 }
 
 /**
@@ -991,20 +1500,9 @@ bool JSONReader::isVec2(std::string key) const {
 * @return true if the entry for key exists and represents an array of floats
 */
 bool JSONReader::isFloatArray(std::string key) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(key);
-	if (j == nullptr || j->getType() != JSON_TYPE_ARRAY) {
-		return false;
-	}
-	JSONValue* child = j->getChild();
-	for (int ii = 0; ii < j->getSize(); ii++) {
-		if (child->getType() != JSON_TYPE_FLOAT) {
-			return false;
-		}
-		child = child->getNext();
-	}
-	return true;
+	return isNumberArray(find(key));
 }
 
 /**
@@ -1015,13 +1513,8 @@ bool JSONReader::isFloatArray(std::string key) const {
 * @return true if the current cursor position represents a Vec2 value
 */
 bool JSONReader::isVec2() const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
-	if (_json == nullptr || _json->getType() != JSON_TYPE_ARRAY || _json->getSize() != 2) {
-		return false;
-	}
-	JSONValue* child = _json->getChild();
-	return (child->getType() == JSON_TYPE_FLOAT && child->getNext()->getType() == JSON_TYPE_FLOAT);
-
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+	return typeOf(_cursor) == JSON_TYPE_ARRAY && _tape[_cursor].length == 2 && isNumberArray(_cursor);
 }
 
 /**
@@ -1032,18 +1525,8 @@ bool JSONReader::isVec2() const {
 * @return true if the current cursor position represents an array of floats
 */
 bool JSONReader::isFloatArray() const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
-	if (_json == nullptr || _json->getType() != JSON_TYPE_ARRAY) {
-		return false;
-	}
-	JSONValue* child = _json->getChild();
-	for (int ii = 0; ii < _json->getSize(); ii++) {
-		if (child->getType() != JSON_TYPE_FLOAT) {
-			return false;
-		}
-		child = child->getNext();
-	}
-	return true;
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+	return isNumberArray(_cursor);
 }
 
 
@@ -1061,14 +1544,14 @@ bool JSONReader::isFloatArray() const {
 * @return the boolean value for the given name.
 */
 bool JSONReader::getBool(std::string name, bool defaultValue) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(name);
-	if (j == nullptr) {
+	int token = find(name);
+	if (token < 0) {
 		return false;
 	}
 	// Return the actual value
-	return j->asBool(defaultValue);
+	return _tape[token].type == JSON_TYPE_BOOL ? _tape[token].number != 0.0f : defaultValue;
 }
 
 /**
@@ -1084,15 +1567,15 @@ bool JSONReader::getBool(std::string name, bool defaultValue) const {
 * @return the number for the given name.
 */
 float JSONReader::getNumber(std::string name, float defaultValue) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(name);
-	if (j == nullptr) {
+	int token = find(name);
+	if (token < 0) {
 		return 0.0f;
 	}
 
 	// Return the actual value
-	return j->asFloat(defaultValue);
+	return _tape[token].type == JSON_TYPE_FLOAT ? _tape[token].number : defaultValue;
 }
 
 /**
@@ -1108,15 +1591,16 @@ float JSONReader::getNumber(std::string name, float defaultValue) const {
 * @return the string for the given name.
 */
 std::string JSONReader::getString(std::string name, std::string defaultValue) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(name);
-	if (j == nullptr) {
+	int token = find(name);
+	if (token < 0) {
 		return "";
 	}
 
 	// Return the actual value
-	return j->asString(defaultValue);
+	const Token& value = _tape[token];
+	return value.type == JSON_TYPE_STRING ? decode(value.start, value.length, value.escaped != 0) : defaultValue;
 }
 
 /**
@@ -1131,14 +1615,15 @@ std::string JSONReader::getString(std::string name, std::string defaultValue) co
 * @return the Vec2 value for the current cursor position.
 */
 Vec2 JSONReader::asVec2(const Vec2& defaultValue) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
-	JSONValue* child = _json->getChild();
-	if (child == nullptr || child->getNext() == nullptr) {
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+	int type = typeOf(_cursor);
+	if ((type != JSON_TYPE_ARRAY && type != JSON_TYPE_OBJECT) || _tape[_cursor].length < 2) {
 		return Vec2(defaultValue);
 	}
-	float x = child->asFloat(defaultValue.x);
-	float y = child->getNext()->asFloat(defaultValue.y);
-	return Vec2(x, y);
+	const Token& x = _tape[_cursor + 1];
+	const Token& y = _tape[x.next];
+	return Vec2(x.type == JSON_TYPE_FLOAT ? x.number : defaultValue.x,
+		y.type == JSON_TYPE_FLOAT ? y.number : defaultValue.y);
 }
 
 /**
@@ -1158,27 +1643,8 @@ Vec2 JSONReader::asVec2(const Vec2& defaultValue) const {
 * @return number of elements written to the buffer
 */
 int JSONReader::asFloatArray(float* buffer) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
-	int size = _json->getSize();
-	JSONValue* child = _json->getChild();
-	if (child == nullptr || _json->getType() != JSON_TYPE_ARRAY) {
-		return 0;
-	}
-
-	// First pass to check array of floats assumption
-	for (int ii = 0; ii < size; ii++) {
-		if (child->getType() != JSON_TYPE_FLOAT) {
-			return 0;
-		}
-		child = child->getNext();
-	}
-	// Reset child pointer and write to buffer
-	child = _json->getChild();
-	for (int ii = 0; ii < size; ii++) {
-		buffer[ii] = child->asFloat(0.0f);
-		child = child->getNext();
-	}
-	return size;
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+	return readFloatArray(_cursor, buffer);
 }
 
 /**
@@ -1194,16 +1660,16 @@ int JSONReader::asFloatArray(float* buffer) const {
 * @return the Vec2 value for the given name.
 */
 Vec2 JSONReader::getVec2(std::string name, const Vec2& defaultValue) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(name);
-	if (j == nullptr || j->getType() != JSON_TYPE_ARRAY || j->getSize() != 2) {
+	int token = find(name);
+	if (typeOf(token) != JSON_TYPE_ARRAY || _tape[token].length != 2) {
 		return Vec2(defaultValue);
 	}
-	JSONValue* child = j->getChild();
-	float x = child->asFloat(defaultValue.x);
-	float y = child->getNext()->asFloat(defaultValue.y);
-	return Vec2(x, y);
+	const Token& x = _tape[token + 1];
+	const Token& y = _tape[x.next];
+	return Vec2(x.type == JSON_TYPE_FLOAT ? x.number : defaultValue.x,
+		y.type == JSON_TYPE_FLOAT ? y.number : defaultValue.y);
 }
 
 /**
@@ -1225,29 +1691,9 @@ Vec2 JSONReader::getVec2(std::string name, const Vec2& defaultValue) const {
 * @return number of elements written to the buffer
 */
 int  JSONReader::getFloatArray(std::string name, float* buffer) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* j = _json->getItem(name);
-	if (j == nullptr || j->getType() != JSON_TYPE_ARRAY) {
-		return 0;
-	}
-	int size = j->getSize();
-	JSONValue* child = j->getChild();
-
-	// First pass to check array of floats assumption
-	for (int ii = 0; ii < size; ii++) {
-		if (child->getType() != JSON_TYPE_FLOAT) {
-			return 0;
-		}
-		child = child->getNext();
-	}
-	// Reset child pointer and write to buffer
-	child = j->getChild();
-	for (int ii = 0; ii < size; ii++) {
-		buffer[ii] = child->asFloat(0.0f);
-		child = child->getNext();
-	}
-	return size;
+	return readFloatArray(find(name), buffer);
 }
 
 
@@ -1264,13 +1710,13 @@ int  JSONReader::getFloatArray(std::string name, float* buffer) const {
 * @return true if the associated value is an object
 */
 bool JSONReader::startObject(std::string key) {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	_stack.push_back(_json);
+	_stack.push_back(_cursor);
 	_states.push_back(_arraymode);
 	_arraymode = false;
-	_json = _json->getItem(key);
-	return _json != nullptr && (_json->getType() == JSON_TYPE_OBJECT || _json->getType() == JSON_TYPE_NULL);
+	_cursor = find(key);
+	return _cursor >= 0 && (_tape[_cursor].type == JSON_TYPE_OBJECT || _tape[_cursor].type == JSON_TYPE_NULL);
 }
 
 /**
@@ -1287,11 +1733,11 @@ bool JSONReader::startObject(std::string key) {
 * @return true if the cursor position is an object
 */
 bool JSONReader::startObject() {
-	CCASSERT(_json, "DOM cursor is currently undefined");
-	_stack.push_back(_json);
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+	_stack.push_back(_cursor);
 	_states.push_back(_arraymode);
 	_arraymode = false;
-	return _json != nullptr && (_json->getType() == JSON_TYPE_OBJECT || _json->getType() == JSON_TYPE_NULL);
+	return _cursor >= 0 && (_tape[_cursor].type == JSON_TYPE_OBJECT || _tape[_cursor].type == JSON_TYPE_NULL);
 }
 
 /**
@@ -1299,7 +1745,7 @@ bool JSONReader::startObject() {
 */
 void JSONReader::endObject() {
 	CCASSERT(!_arraymode, "Attempting to end object while in array mode");
-	_json = _stack.back();
+	_cursor = _stack.back();
 	_stack.pop_back();
 	_arraymode = _states.back();
 	_states.pop_back();
@@ -1319,10 +1765,11 @@ void JSONReader::endObject() {
 * @return the number of children for the given key
 */
 int JSONReader::getSize(std::string key) const {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	JSONValue* child = _json->getItem(key);
-	return (child == nullptr ? 0 : child->getSize());
+	int token = find(key);
+	int type = typeOf(token);
+	return (type == JSON_TYPE_ARRAY || type == JSON_TYPE_OBJECT ? (int)_tape[token].length : 0);
 }
 
 /**
@@ -1338,18 +1785,20 @@ int JSONReader::getSize(std::string key) const {
 * @return the number of elements in the array
 */
 int JSONReader::startArray(std::string key) {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(!_arraymode, "Key checking is undefined in array mode");
-	_stack.push_back(_json);
+	_stack.push_back(_cursor);
 	_states.push_back(_arraymode);
-	_json = _json->getItem(key);
+	_cursor = find(key);
 	_arraymode = true;
-	if (_json == nullptr) {
+	if (_cursor < 0) {
 		return 0;
 	}
 
-	int size = _json->getSize();
-	_json = _json->getChild();
+	// The children of a value follow it on the tape
+	int type = _tape[_cursor].type;
+	int size = (type == JSON_TYPE_ARRAY || type == JSON_TYPE_OBJECT ? (int)_tape[_cursor].length : 0);
+	_cursor = (size > 0 ? _cursor + 1 : -1);
 	return size;
 }
 
@@ -1364,12 +1813,13 @@ int JSONReader::startArray(std::string key) {
 * @return the number of elements in the array
 */
 int JSONReader::startArray() {
-	CCASSERT(_json, "DOM cursor is currently undefined");
-	_stack.push_back(_json);
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+	_stack.push_back(_cursor);
 	_states.push_back(_arraymode);
 	_arraymode = true;
-	int size = _json->getSize();
-	_json = _json->getChild();
+	int type = typeOf(_cursor);
+	int size = (type == JSON_TYPE_ARRAY || type == JSON_TYPE_OBJECT ? (int)_tape[_cursor].length : 0);
+	_cursor = (size > 0 ? _cursor + 1 : -1);
 	return size;
 }
 
@@ -1378,7 +1828,7 @@ int JSONReader::startArray() {
 */
 void JSONReader::endArray() {
 	CCASSERT(_arraymode, "Attempting to end array while in object mode");
-	_json = _stack.back();
+	_cursor = _stack.back();
 	_stack.pop_back();
 	_arraymode = _states.back();
 	_states.pop_back();
@@ -1393,10 +1843,10 @@ void JSONReader::endArray() {
 * @return true if there was an element to advance to
 */
 bool JSONReader::advance() {
-	CCASSERT(_json, "DOM cursor is currently undefined");
+	CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
 	CCASSERT(_arraymode, "Attempting to advance position while in object mode");
-	_json = _json->getNext();
-	return (_json == nullptr);
+	_cursor = (_tape[_cursor].next != 0 ? (int)_tape[_cursor].next : -1);
+	return (_cursor < 0);
 }
 
 
@@ -6,6 +6,9 @@
 //  parser provided with the Spine editor (built-into Cocos2d).  It provides a DOM-type interface
 //  for parsing the data in a structured way.
 //
+//  JSONValue builds a tree of heap nodes.  JSONReader does not: it reads the source in a single
+//  pass into a flat array of fixed-size tokens, and only decodes a string when it is asked for.
+//
 //  Previously, we had used the Spine JSON loader directly.  However, there appear to be some
 //  linker errors when we try to pull Spine into Cocos (as opposed to into the application) within
 //  Android.  So we were forced to reimplement the functionality.  When the code is the same, we
@@ -488,21 +491,119 @@ CC_CONSTRUCTOR_ACCESS:
 * This reader tries to fail as little as possible.  If a field or current position is treated as the
 * wrong type, it will return a default value instead.  This makes it easier to process missing data.
 * If you really care about whether data is there or not, use the type-checking methods.
+*
+* Unlike JSONValue, this reader does not build a tree.  The source is read in a single pass into
+* a tape: one fixed-size token per value, in document order, with the children of an array or
+* object right after it.  The tape is one array, so parsing does no allocation per value.  Strings
+* stay in the source and are only decoded when asked for, and numbers are decoded without strtod,
+* so they do not depend on the locale.  The source may be borrowed from the caller, such as a
+* memory-mapped file, in which case the reader copies nothing at all.
+*
+* Field lookups start just after the last field found in the same object, so reading the fields
+* of an object in file order costs one step each.  Any order still works, only slower.  If an
+* object repeats a name, a lookup may find any of its fields, where JSONValue found the first.
 */
 class CC_DLL JSONReader : public Ref {
 protected:
-	/** The root of the JSON DOM tree */
-	JSONValue* _root;
-	/** The current position in the DOM tree */
-	JSONValue* _json;
+	/** One value of the document */
+	struct Token {
+		/** The offset of the value in the source; for a string, just past its opening quote */
+		unsigned int start;
+		/** The undecoded length of a string, or the number of children of an array or object */
+		unsigned int length;
+		/** The offset of the name of an object field, just past its opening quote */
+		unsigned int key;
+		/** The undecoded length of the name of an object field; 0 if not a field */
+		unsigned int keyLength;
+		/** The index of the next sibling, or 0 if this is the last (0 is the root, never a sibling) */
+		unsigned int next;
+		/** The value of a number, or 1 or 0 for a boolean */
+		float number;
+		/** The type of the value */
+		unsigned char type;
+		/** Whether the name or the string has escapes, and must be decoded */
+		unsigned char escaped;
+	};
+
+	/** The source, if this reader owns it */
+	std::string _text;
+	/** The source being read, owned or borrowed */
+	const char* _source;
+	/** The length of the source, in bytes */
+	size_t _length;
+	/** Every value of the document, in document order */
+	std::vector<Token> _tape;
+	/** The current position on the tape, or -1 if it is undefined */
+	int _cursor;
 	/** The file with the JSON source (may be empty) */
 	std::string _file;
 	/** A stack to allow us to traverse the tree*/
-	std::vector<JSONValue*> _stack;
+	std::vector<int> _stack;
 	/** Whether we are in object mode or array mode */
 	bool _arraymode;
 	/** A stack to allow us to tracks states as we traverse the tree */
 	std::vector<bool> _states;
+	/** The object of the last field found, where the next lookup starts */
+	mutable int _hintParent;
+	/** The last field found */
+	mutable int _hint;
+
+	/**
+	* Reads the source onto the tape, replacing its contents.
+	*
+	* @return true if the source is well-formed JSON
+	*/
+	bool parse();
+
+	/**
+	* Returns the position on the tape of the field of the cursor with the given name
+	*
+	* Names are compared without regard to case.  If the name does not exist, this returns -1.
+	*
+	* @param  name  the name for the child to access
+	*
+	* @return the position on the tape of the field, or -1
+	*/
+	int find(const std::string& name) const;
+
+	/**
+	* Returns the type of the value at a position on the tape, or -1 if it is undefined
+	*
+	* @param  token  the position on the tape
+	*
+	* @return the type of the value at the position
+	*/
+	int typeOf(int token) const { return token < 0 ? -1 : _tape[token].type; }
+
+	/**
+	* Returns whether the value at a position is an array whose elements are all numbers
+	*
+	* @param  token  the position on the tape
+	*
+	* @return whether the value is an array of numbers
+	*/
+	bool isNumberArray(int token) const;
+
+	/**
+	* Copies the elements of an array of numbers to a buffer
+	*
+	* @param  token   the position on the tape
+	* @param  buffer  the buffer to store the float values
+	*
+	* @return number of elements written to the buffer, or 0 if the value is not an array of numbers
+	*/
+	int readFloatArray(int token, float* buffer) const;
+
+	/**
+	* Returns the decoded text of a string in the source
+	*
+	* @param  start    the offset of the string, just past its opening quote
+	* @param  length   the length of the string before decoding
+	* @param  escaped  whether the string has escapes
+	*
+	* @return the decoded string
+	*/
+	std::string decode(unsigned int start, unsigned int length, bool escaped) const;
 
 public:
 #pragma mark Static Constructors
@@ -585,6 +686,24 @@ public:
 	*/
 	bool startJSON(std::string source);
 
+	/**
+	* Starts a JSON parser for the given buffer, without copying it.
+	*
+	* This method will ignore the associated file, and parse the provided buffer instead.
+	* The buffer need not be null-terminated, and it is borrowed: it must stay valid and
+	* unchanged until endJSON() is called.  This allows the reader to read a memory-mapped
+	* file in place.
+	*
+	* The parser will fail if the JSON is not well-formed.  In that case, the method will
+	* return false.
+	*
+	* @param  source   the JSON source
+	* @param  length   the length of the source, in bytes
+	*
+	* @return true if the buffer is well-formed JSON.
+	*/
+	bool startJSON(const char* source, size_t length);
+
 	/**
 	* Ends the current JSON parsing session, erasing the DOM tree.
 	*
@@ -598,14 +717,14 @@ public:
 	*
 	* No information about the JSON is lost.  This method simply resets the cursor position.
 	*/
-	void reset() { _stack.clear(); _states.clear(); _json = _root; _arraymode = false; }
+	void reset() { _stack.clear(); _states.clear(); _cursor = (_tape.empty() ? -1 : 0); _arraymode = false; }
 
 	/**
 	* Returns the key for the current cursor position in the DOM.
 	*
 	* @return the key for the current cursor position in the DOM.
 	*/
-	std::string getKey() const { return _json->getName(); }
+	std::string getKey() const;
 
 
 #pragma mark Type Checking
@@ -615,8 +734,8 @@ public:
 	* @return true if the current cursor position has a nullptr value.
 	*/
 	bool isNull() const {
-		CCASSERT(_json, "DOM cursor is currently undefined");
-		return _json->getType() == JSON_TYPE_NULL;
+		CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+		return typeOf(_cursor) == JSON_TYPE_NULL;
 	}
 
 	/**
@@ -625,8 +744,8 @@ public:
 	* @return true if the current cursor position represents an object.
 	*/
 	bool isObject() const {
-		CCASSERT(_json, "DOM cursor is currently undefined");
-		return _json->getType() == JSON_TYPE_OBJECT || _json->getType() == JSON_TYPE_NULL;
+		CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+		return typeOf(_cursor) == JSON_TYPE_OBJECT || typeOf(_cursor) == JSON_TYPE_NULL;
 	}
 
 	/**
@@ -635,8 +754,8 @@ public:
 	* @return true if the current cursor position represents an array.
 	*/
 	bool isArray() const {
-		CCASSERT(_json, "DOM cursor is currently undefined");
-		return _json->getType() == JSON_TYPE_ARRAY || _json->getType() == JSON_TYPE_NULL;
+		CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+		return typeOf(_cursor) == JSON_TYPE_ARRAY || typeOf(_cursor) == JSON_TYPE_NULL;
 	}
 
 	/**
@@ -645,8 +764,8 @@ public:
 	* @return true if the current cursor position represents a boolean value
 	*/
 	bool isBool() const {
-		CCASSERT(_json, "DOM cursor is currently undefined");
-		return _json->getType() == JSON_TYPE_BOOL;
+		CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+		return typeOf(_cursor) == JSON_TYPE_BOOL;
 	}
 
 	/**
@@ -657,8 +776,8 @@ public:
 	* @return true if the current cursor position represents a number
 	*/
 	bool isNumber() const {
-		CCASSERT(_json, "DOM cursor is currently undefined");
-		return _json->getType() == JSON_TYPE_FLOAT;
+		CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+		return typeOf(_cursor) == JSON_TYPE_FLOAT;
 	}
 
 	/**
@@ -667,8 +786,8 @@ public:
 	* @return true if the current cursor position represents a string
 	*/
 	bool isString() const {
-		CCASSERT(_json, "DOM cursor is currently undefined");
-		return _json->getType() == JSON_TYPE_STRING;
+		CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+		return typeOf(_cursor) == JSON_TYPE_STRING;
 	}
 
 	/**
@@ -789,8 +908,8 @@ public:
 	* @return the boolean value for the current cursor position.
 	*/
 	bool asBool(bool defaultValue = false) const {
-		CCASSERT(_json, "DOM cursor is currently undefined");
-		return _json->asBool(defaultValue);
+		CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+		return typeOf(_cursor) == JSON_TYPE_BOOL ? _tape[_cursor].number != 0.0f : defaultValue;
 	}
 
 	/**
@@ -805,8 +924,8 @@ public:
 	* @return the number for the current cursor position.
 	*/
 	float asNumber(float defaultValue = 0.0f) const {
-		CCASSERT(_json, "DOM cursor is currently undefined");
-		return _json->asFloat(defaultValue);
+		CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+		return typeOf(_cursor) == JSON_TYPE_FLOAT ? _tape[_cursor].number : defaultValue;
 	}
 
 	/**
@@ -821,8 +940,12 @@ public:
 	* @return the string for the current cursor position.
 	*/
 	std::string asString(std::string defaultValue = "") const {
-		CCASSERT(_json, "DOM cursor is currently undefined");
-		return _json->asString(defaultValue);
+		CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+		if (typeOf(_cursor) != JSON_TYPE_STRING) {
+			return defaultValue;
+		}
+		const Token& token = _tape[_cursor];
+		return decode(token.start, token.length, token.escaped != 0);
 	}
 
 	/**
@@ -978,8 +1101,9 @@ public:
 	* @return the number of children for the cursor node
 	*/
 	int  getSize() const {
-		CCASSERT(_json, "DOM cursor is currently undefined");
-		return _json->getSize();
+		CCASSERT(_cursor >= 0, "JSON cursor is currently undefined");
+		int type = typeOf(_cursor);
+		return type == JSON_TYPE_ARRAY || type == JSON_TYPE_OBJECT ? (int)_tape[_cursor].length : 0;
 	}
 
 	/**
@@ -1042,7 +1166,7 @@ CC_CONSTRUCTOR_ACCESS:
 	/**
 	* Creates a basic JSON reader with the default values
 	*/
-	JSONReader() : _root(nullptr), _json(nullptr), _arraymode(false) {}
+	JSONReader() : _source(nullptr), _length(0), _cursor(-1), _arraymode(false), _hintParent(-1), _hint(-1) {}
 
 	/**
 	* Deletes the JSON reader, releasing all resources
@@ -26,6 +26,8 @@ NS_CC_BEGIN
 Obstacle::Obstacle(void) {
     _debug = nullptr;
     _node  = nullptr;
+    _prevAngle = 0.0f;
+    _interpolation = 1.0f;
 }
 
 /**
@@ -241,9 +243,9 @@ void Obstacle::setDebugNode(WireNode* node) {
  */
 void Obstacle::positionSceneNode() {
     CCASSERT(_node, "Attempt to reposition a null scene node");
-    Vec2 pos = getPosition();
+    Vec2 pos = getInterpolatedPosition();
     pos.scale(_drawScale);
-    float angle = -getAngle()*180.0f/M_PI;
+    float angle = -getInterpolatedAngle()*180.0f/M_PI;
     _node->setPosition(pos);
     _node->setRotation(angle);
 }
@@ -258,13 +260,57 @@ void Obstacle::positionSceneNode() {
  */
 void Obstacle::positionDebugNode() {
     CCASSERT(_debug, "Attempt to reposition a null debug node");
-    Vec2 pos = getPosition();
+    Vec2 pos = getInterpolatedPosition();
     pos.scale(_drawScale);
-    float angle = -getAngle()*180.0f/M_PI;
+    float angle = -getInterpolatedAngle()*180.0f/M_PI;
     _debug->setPosition(pos);
     _debug->setRotation(angle);
 }
 
+/**
+ * Records the current transform as the start of the next fixed step.
+ *
+ * The world controller calls this before each fixed step, so that the
+ * scene node can be drawn between the last two simulated transforms.
+ */
+void Obstacle::storePreviousTransform() {
+    _prevPosition = getPosition();
+    _prevAngle = getAngle();
+}
+
+/**
+ * Returns the position at which to draw this object.
+ *
+ * This is the body position, interpolated by the factor given to
+ * setInterpolation() from the position at the start of the last step.
+ *
+ * @return the position at which to draw this object
+ */
+Vec2 Obstacle::getInterpolatedPosition() const {
+    Vec2 pos = getPosition();
+    if (_interpolation >= 1.0f) {
+        return pos;
+    }
+    return _prevPosition + (pos - _prevPosition) * _interpolation;
+}
+
+/**
+ * Returns the angle (in radians) at which to draw this object.
+ *
+ * This is the body angle, interpolated along the shortest arc by the
+ * factor given to setInterpolation().
+ *
+ * @return the angle at which to draw this object
+ */
+float Obstacle::getInterpolatedAngle() const {
+    float angle = getAngle();
+    if (_interpolation >= 1.0f) {
+        return angle;
+    }
+    float delta = remainderf(angle - _prevAngle, 2.0f*M_PI);
+    return _prevAngle + delta * _interpolation;
+}
+
 
 
 #pragma mark -
@@ -69,6 +69,13 @@ protected:
 	/** Used to set the frame number in animations */
 	float _animationCounter;
     
+    /** The position at the start of the most recent fixed world step */
+    Vec2 _prevPosition;
+    /** The angle at the start of the most recent fixed world step */
+    float _prevAngle;
+    /** How far (0 to 1) the scene node is from the previous to the current transform */
+    float _interpolation;
+    
 private:
     /// Track garbage collection status
     /** Whether the object should be removed from the world on next pass */
@@ -125,6 +132,44 @@ public:
 	*/
 	virtual void positionDebugNode();
 
+	/**
+	* Records the current transform as the start of the next fixed step.
+	*
+	* The world controller calls this before each fixed step, so that the
+	* scene node can be drawn between the last two simulated transforms.
+	*/
+	virtual void storePreviousTransform();
+
+	/**
+	* Sets how far the scene node is between the previous and current transform.
+	*
+	* A value of 1 (the default) draws the current transform.  Smaller values
+	* draw the state that far into the most recent fixed step.
+	*
+	* @param alpha the interpolation factor in [0,1]
+	*/
+	virtual void setInterpolation(float alpha) { _interpolation = alpha; }
+
+	/**
+	* Returns the position at which to draw this object.
+	*
+	* This is the body position, interpolated by the factor given to
+	* setInterpolation() from the position at the start of the last step.
+	*
+	* @return the position at which to draw this object
+	*/
+	Vec2 getInterpolatedPosition() const;
+
+	/**
+	* Returns the angle (in radians) at which to draw this object.
+	*
+	* This is the body angle, interpolated along the shortest arc by the
+	* factor given to setInterpolation().
+	*
+	* @return the angle at which to draw this object
+	*/
+	float getInterpolatedAngle() const;
+
 #pragma mark -
 #pragma mark BodyDef Methods
     
@@ -281,6 +281,30 @@ PolygonNode* PolygonNode::createWithTexture(Texture2D *texture, const Rect& rect
     return nullptr;
 }
 
+/**
+ * Creates a textured polygon from a region of a Texture2D object.
+ *
+ * This is for images packed into a texture atlas.  After creation, the
+ * polygon will be a rectangle.  The vertices of this polygon will be the
+ * corners of the region, which is given as in setTextureRegion().
+ *
+ * @param   texture  A pointer to an existing Texture2D object.
+ *                   You can use a Texture2D object for many sprites.
+ * @param   region   The texture region, or Rect::ZERO for the whole texture
+ *
+ * @retain  a reference to this texture
+ * @return  An autoreleased sprite object
+ */
+PolygonNode* PolygonNode::createWithRegion(Texture2D *texture, const Rect& region) {
+    PolygonNode *sprite = new (std::nothrow) PolygonNode();
+    if (sprite && sprite->initWithRegion(texture, region)) {
+        sprite->autorelease();
+        return sprite;
+    }
+    CC_SAFE_DELETE(sprite);
+    return nullptr;
+}
+
 
 #pragma mark -
 #pragma mark Allocator
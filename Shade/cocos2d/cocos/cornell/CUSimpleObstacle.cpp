@@ -134,9 +134,9 @@ void SimpleObstacle::setFilterData(b2Filter value) {
  */
 void SimpleObstacle::positionSceneNode() {
     CCASSERT(_node, "Attempt to reposition a null scene node");
-    Vec2 pos = getPosition();
+    Vec2 pos = getInterpolatedPosition();
     pos.scale(_drawScale);
-    float angle = -getAngle()*180.0f/M_PI;
+    float angle = -getInterpolatedAngle()*180.0f/M_PI;
     
     // Positional snap
     if (_posSnap >= 0) {
@@ -162,9 +162,9 @@ void SimpleObstacle::positionSceneNode() {
  */
 void SimpleObstacle::positionDebugNode() {
     CCASSERT(_debug, "Attempt to reposition a null debug node");
-    Vec2 pos = getPosition();
+    Vec2 pos = getInterpolatedPosition();
     pos.scale(_drawScale);
-    float angle = -getAngle()*180.0f/M_PI;
+    float angle = -getInterpolatedAngle()*180.0f/M_PI;
 
     // Positional snap
     if (_posSnap >= 0) {
@@ -19,10 +19,31 @@
 //  scenes.  This coordinate is shared across all loader instances.  It decides
 //  When an asset is truly ready to be unloaded.
 //
+//  Images are decoded by a pool of worker threads rather than the single loading
+//  thread of TextureCache, most urgent first.  The decoded images are handed back
+//  through a lock-free queue and uploaded to the GPU a few at a time, within a time
+//  budget each frame, so a burst of large textures never stalls a frame.
+//
+//  A loader may also read an atlas table, written by the offline packer, that says
+//  which images were packed into which atlas page.  An image in the table loads its
+//  page instead, and the loader remembers the region of the page that is the image.
+//  All of the images on one page share a single texture, and so a single batch.
+//
 //  Author: Walker White
 //  Version: 12/10/15
 //
+#include <algorithm>
+#include <thread>
 #include "CUTextureLoader.h"
+#include "CUJSONReader.h"
+#include "CUTimestamp.h"
+
+/** The most decoder threads to use when there is no explicit count */
+#define MAX_DECODE_THREADS      4
+/** The default time each frame may spend uploading textures, in milliseconds */
+#define DEFAULT_UPLOAD_BUDGET   4.0f
+/** The scheduler key of the upload callback */
+#define UPLOAD_SCHEDULE_KEY     "cu_texture_upload"
 
 NS_CC_BEGIN
 
@@ -31,13 +52,25 @@ NS_CC_BEGIN
 
 /** The static coordinator singleton */
 TextureLoader::Coordinator* TextureLoader::_gCoordinator = nullptr;
+/** The number of decoder threads, or -1 for one per spare core */
+int TextureLoader::_gDecodeThreads = -1;
+/** The time each frame may spend uploading textures, in milliseconds */
+float TextureLoader::_gUploadBudget = DEFAULT_UPLOAD_BUDGET;
 
 /**
  * Creates a new static coordinator
  *
  * The static coordinator is ready to go.  There is no start method.
  */
-TextureLoader::Coordinator::Coordinator() : instances(0) {}
+TextureLoader::Coordinator::Coordinator() : _decoders(nullptr), _order(0), _decoded(nullptr), _inflight(0), instances(0) {
+    int threads = _gDecodeThreads;
+    if (threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency() - 1;
+        threads = std::max(1, std::min(threads, MAX_DECODE_THREADS));
+    }
+    _decoders = ThreadPool::create(threads);
+    _decoders->retain();
+}
 
 /**
  * Destroys the static coordinator, releasing all resources
@@ -45,6 +78,28 @@ TextureLoader::Coordinator::Coordinator() : instances(0) {}
  * This will immediately orphan all loader instances and should not be called explicitly.
  */
 TextureLoader::Coordinator::~Coordinator() {
+    // Joins the decoders, so nothing is pushed after this.  The pool stops
+    // again when it is released, which does nothing once it has stopped.
+    {
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        _jobs.clear();
+    }
+    _decoders->stop();
+    _decoders->release();
+    _decoders = nullptr;
+    Director::getInstance()->getScheduler()->unschedule(UPLOAD_SCHEDULE_KEY, this);
+
+    Decoded* node = _decoded.exchange(nullptr, std::memory_order_acquire);
+    while (node != nullptr) {
+        _uploads.push_back(node);
+        node = node->next;
+    }
+    for (Decoded* done : _uploads) {
+        CC_SAFE_RELEASE(done->image);
+        delete done;
+    }
+    _uploads.clear();
+
     for(auto it = _refcnts.begin(); it != _refcnts.end(); ++it) {
         Texture2D* t = _objects[it->first];
         for(int ii = 0; ii < it->second; ii++) {
@@ -83,7 +138,12 @@ Texture2D* TextureLoader::Coordinator::load(std::string source) {
     }
     TextureCache* cache = Director::getInstance()->getTextureCache();
     Texture2D* texture = cache->addImage(source);
+    cancel(source);
     allocate(texture, source);
+    if (texture != nullptr) {
+        texture->retain();
+        _refcnts[source] += 1;
+    }
     return texture;
 }
 
@@ -92,33 +152,176 @@ Texture2D* TextureLoader::Coordinator::load(std::string source) {
  *
  * The texture will be loaded asynchronously.  When it is finished loading, it
  * will be added to this loader, and accessible to ALL loaders.  If the file
- * is still pending, the callback will be appended to the callback list.
+ * is still pending, the callback will be appended to the callback list, and the
+ * file is decoded only once.
  *
  * @param  source   the pathname to the texture file
  * @param  callback callback to invoke when loading is done.
+ * @param  priority the urgency of the texture
  *
  * @retain the texture asset upon loading
  */
-void TextureLoader::Coordinator::loadAsync(std::string source, std::function<void(Texture2D* t)> callback) {
+void TextureLoader::Coordinator::loadAsync(std::string source, std::function<void(Texture2D* t)> callback,
+                                           Priority priority) {
     // Check if already allocated to the central hub.
     if (isLoaded(source)) {
         _objects[source]->retain();
         _refcnts[source] += 1;
         callback(_objects[source]);
+        return;
     }
     
-    // Otherwise, add the callback to the queue.
-    if (_callbacks.find(source) == _callbacks.end()) {
-        std::vector<std::function<void(Texture2D* t)>> cvector;
-        cvector.push_back(callback);
-        _callbacks.emplace(source,cvector);
-    } else {
+    // Coalesce with a decode already under way
+    if (isPending(source)) {
         _callbacks[source].push_back(callback);
+        prioritize(source, priority);
+        return;
+    }
+    
+    std::vector<std::function<void(Texture2D* t)>> cvector;
+    cvector.push_back(callback);
+    _callbacks.emplace(source,cvector);
+    
+    std::string path = FileUtils::getInstance()->fullPathForFilename(source);
+    if (path.empty()) {
+        allocate(nullptr, source);
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        DecodeJob job;
+        job.source = source;
+        job.path = path;
+        job.priority = priority;
+        job.order = _order++;
+        _jobs.push_back(job);
+    }
+    // Each task decodes whichever job is most urgent when it runs
+    _decoders->addTask([this] { decode(); });
+    if (_inflight++ == 0) {
+        Director::getInstance()->getScheduler()->schedule([this](float dt) { upload(dt); },
+                                                          this, 0, false, UPLOAD_SCHEDULE_KEY);
+    }
+}
+
+/**
+ * Raises the urgency of a texture that is waiting for a decoder.
+ *
+ * This does nothing if the texture is not waiting, or is already at least as urgent.
+ *
+ * @param  source   the pathname to the texture file
+ * @param  priority the new urgency of the texture
+ */
+void TextureLoader::Coordinator::prioritize(std::string source, Priority priority) {
+    std::lock_guard<std::mutex> lock(_jobMutex);
+    for (DecodeJob& job : _jobs) {
+        if (job.source == source && priority < job.priority) {
+            job.priority = priority;
+        }
+    }
+}
+
+/**
+ * Removes a texture from the decode queue, if it has not yet started.
+ *
+ * @param  source   the pathname to the texture file
+ */
+void TextureLoader::Coordinator::cancel(std::string source) {
+    std::lock_guard<std::mutex> lock(_jobMutex);
+    for (auto it = _jobs.begin(); it != _jobs.end(); ++it) {
+        if (it->source == source) {
+            _jobs.erase(it);
+            _inflight--;
+            return;
+        }
+    }
+}
+
+/**
+ * Decodes the most urgent waiting image.  This runs on a decoder thread.
+ *
+ * The image is pushed onto the completion queue with a compare-and-swap, so a
+ * decoder never waits on the game thread.
+ */
+void TextureLoader::Coordinator::decode() {
+    DecodeJob job;
+    {
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        if (_jobs.empty()) {
+            return;
+        }
+        auto best = _jobs.begin();
+        for (auto it = _jobs.begin(); it != _jobs.end(); ++it) {
+            if (it->priority < best->priority || (it->priority == best->priority && it->order < best->order)) {
+                best = it;
+            }
+        }
+        job = *best;
+        _jobs.erase(best);
+    }
+    
+    // This is what Image::initWithImageFileThreadSafe does, which is only open to TextureCache
+    Image* image = new (std::nothrow) Image();
+    Data data = FileUtils::getInstance()->getDataFromFile(job.path);
+    if (image != nullptr && (data.isNull() || !image->initWithImageData(data.getBytes(), data.getSize()))) {
+        image->release();
+        image = nullptr;
+    }
+    
+    Decoded* done = new Decoded();
+    done->source = job.source;
+    done->path = job.path;
+    done->image = image;
+    done->next = _decoded.load(std::memory_order_relaxed);
+    while (!_decoded.compare_exchange_weak(done->next, done, std::memory_order_release, std::memory_order_relaxed));
+}
+
+/**
+ * Uploads decoded images until the frame budget is spent.
+ *
+ * At least one image is uploaded each frame that has any, so that loading always
+ * finishes.  This is scheduled every frame while any image is in flight.
+ *
+ * @param  dt   the time in seconds since last update
+ */
+void TextureLoader::Coordinator::upload(float dt) {
+    // Take everything decoded so far, and put it back in decode order
+    Decoded* node = _decoded.exchange(nullptr, std::memory_order_acquire);
+    size_t first = _uploads.size();
+    while (node != nullptr) {
+        _uploads.push_back(node);
+        node = node->next;
     }
+    std::reverse(_uploads.begin() + first, _uploads.end());
     
-    // C++11 closures are great
+    timestamp_t start = current_time();
+    long budget = (long)(_gUploadBudget * 1000.0f);
     TextureCache* cache = Director::getInstance()->getTextureCache();
-    cache->addImageAsync(source, [=](Texture2D* texture) { this->allocate(texture,source); });
+    while (!_uploads.empty()) {
+        Decoded* done = _uploads.front();
+        _uploads.pop_front();
+        _inflight--;
+        
+        // Skip an image that a synchronous load got to first
+        if (isPending(done->source)) {
+            Texture2D* texture = nullptr;
+            if (done->image != nullptr) {
+                texture = cache->addImage(done->image, done->path);
+            }
+            allocate(texture, done->source);
+        }
+        CC_SAFE_RELEASE(done->image);
+        delete done;
+        
+        if (elapsed_micros(start, current_time()) >= budget) {
+            break;
+        }
+    }
+    
+    if (_inflight == 0) {
+        Director::getInstance()->getScheduler()->unschedule(UPLOAD_SCHEDULE_KEY, this);
+    }
 }
 
 /**
@@ -144,11 +347,13 @@ void TextureLoader::Coordinator::allocate(Texture2D* texture, std::string source
             (*it)(nullptr);
         }
     } else {
-        texture->retain();
         _objects[source] = texture;
         _sources[texture->getName()] = source;
-        _refcnts[source] = 1;
+        _refcnts[source] = 0;
+        // Each waiting key holds its own reference, as atlas pages have many keys
         for (auto it = _callbacks[source].begin(); it != _callbacks[source].end(); ++it) {
+            texture->retain();
+            _refcnts[source] += 1;
             (*it)(texture);
         }
     }
@@ -275,10 +480,13 @@ Texture2D* TextureLoader::load(std::string key, std::string source, const Textur
     CCASSERT(_tqueue.find(key) == _tqueue.end(), "Asset key is pending on loader");
     CCASSERT(_gCoordinator, "This texture loader was orphaned by the coordinator");
     
-    Texture2D* texture = _gCoordinator->load(source);
+    Texture2D::TexParams actual = params;
+    Texture2D* texture = _gCoordinator->load(redirect(key, source, actual));
     if (texture != nullptr) {
-        texture->setTexParameters(params);
+        texture->setTexParameters(actual);
         _assets[key] = texture;
+    } else {
+        _regions.erase(key);
     }
     return texture;
 }
@@ -299,12 +507,43 @@ Texture2D* TextureLoader::load(std::string key, std::string source, const Textur
  * @retain the texture upon loading
  */
 void TextureLoader::loadAsync(std::string key, std::string source, const Texture2D::TexParams& params) {
+    loadAsync(key, source, params, Priority::UI);
+}
+
+/**
+ * Adds a new texture to the loading queue with the given urgency.
+ *
+ * @param  key      The key to access the texture after loading
+ * @param  source   The pathname to the texture image file
+ * @param  params   The texture parameters for initialization
+ * @param  priority The urgency of the texture
+ *
+ * @retain the texture upon loading
+ */
+void TextureLoader::loadAsync(std::string key, std::string source, const Texture2D::TexParams& params, Priority priority) {
     CCASSERT(!contains(key), "Asset key is already in use");
     CCASSERT(_tqueue.find(key) == _tqueue.end(), "Asset key is pending on loader");
     CCASSERT(_gCoordinator, "This texture loader was orphaned by the coordinator");
     
     _tqueue.insert(key);
-    _gCoordinator->loadAsync(source, [=](Texture2D* texture) { this->allocate(key, texture, params); });
+    Texture2D::TexParams actual = params;
+    std::string file = redirect(key, source, actual);
+    _gCoordinator->loadAsync(file, [=](Texture2D* texture) { this->allocate(key, texture, actual); }, priority);
+}
+
+/**
+ * Raises the urgency of a texture that is still waiting to be decoded.
+ *
+ * This is for a texture that was queued as a prefetch, and is now wanted.
+ * It does nothing if the texture is already decoded or at least as urgent.
+ *
+ * @param  source   The pathname to the texture image file
+ * @param  priority The new urgency of the texture
+ */
+void TextureLoader::prioritize(std::string source, Priority priority) {
+    CCASSERT(_gCoordinator, "This texture loader was orphaned by the coordinator");
+    auto it = _atlas.find(source);
+    _gCoordinator->prioritize(it == _atlas.end() ? source : it->second.page, priority);
 }
 
 /**
@@ -322,10 +561,35 @@ void TextureLoader::allocate(std::string key, Texture2D* texture, const Texture2
     if (texture != nullptr) {
         texture->setTexParameters(params);
         _assets[key] = texture;
+    } else {
+        _regions.erase(key);
     }
     _tqueue.erase(key);
 }
 
+/**
+ * Redirects a key to its atlas page if the source image was packed.
+ *
+ * The images on a page share one texture, so the parameters of the page
+ * replace the ones given for the key.  Otherwise the last key loaded
+ * would set them for every image on the page.
+ *
+ * @param  key      The key to access the texture after loading
+ * @param  source   The pathname to the texture image file
+ * @param  params   The texture parameters for the key, replaced by the page's
+ *
+ * @return the pathname of the file to load for the key
+ */
+std::string TextureLoader::redirect(const std::string& key, const std::string& source, Texture2D::TexParams& params) {
+    auto it = _atlas.find(source);
+    if (it == _atlas.end()) {
+        return source;
+    }
+    _regions[key] = it->second.region;
+    params = it->second.params;
+    return it->second.page;
+}
+
 /**
  * Unloads the texture for the given key.
  *
@@ -344,6 +608,7 @@ void TextureLoader::unload(std::string key) {
     _gCoordinator->release(_assets[key]);
     _tqueue.erase(key);
     _assets.erase(key);
+    _regions.erase(key);
 }
 
 /**
@@ -363,6 +628,95 @@ void TextureLoader::unloadAll() {
     }
     _tqueue.clear();
     _assets.clear();
+    _regions.clear();
+}
+
+
+#pragma mark -
+#pragma mark Texture Atlases
+/**
+ * Returns the GL filter named in an atlas table.
+ *
+ * @param  name     The filter name, "nearest" or "linear"
+ * @param  filter   The filter to use if the name is empty or unknown
+ *
+ * @return the GL filter named in an atlas table
+ */
+static GLuint atlasFilter(const std::string& name, GLuint filter) {
+    if (name == "nearest") {
+        return GL_NEAREST;
+    } else if (name == "linear") {
+        return GL_LINEAR;
+    } else if (name != "") {
+        CCLOG("Unknown atlas filter %s", name.c_str());
+    }
+    return filter;
+}
+
+/**
+ * Reads an atlas table, so that the images packed in it load from their atlas.
+ *
+ * The table is a JSON file written by the offline atlas packer. It lists
+ * the atlas pages, and the source pathname and region of each image on
+ * them.  Once it is read, loading one of those images under a key loads
+ * its page instead.  The key then holds the page texture, and getRegion()
+ * returns the part of the page that is the image.  Each page is decoded
+ * once however many of its images are loaded.
+ *
+ * Each page has its own filters in the table, which replace the texture
+ * parameters given when loading any of its images.  A filter missing
+ * from the table is the default one, and pages always clamp to the edge.
+ *
+ * A missing table is not an error; the images simply load on their own.
+ * The table only affects images loaded after this call.
+ *
+ * @param  table    The pathname to the atlas table
+ *
+ * @return true if the table was read
+ */
+bool TextureLoader::loadAtlas(std::string table) {
+    if (!FileUtils::getInstance()->isFileExist(table)) {
+        return false;
+    }
+    JSONReader reader;
+    reader.initWithFile(table);
+    if (!reader.startJSON()) {
+        CCLOG("Failed to read atlas table %s", table.c_str());
+        return false;
+    }
+    
+    // The table is in pixels, but regions are in points like the content size
+    float scale = Director::getInstance()->getContentScaleFactor();
+    int pages = reader.startArray("pages");
+    for (int ii = 0; ii < pages; ii++) {
+        reader.startObject();
+        std::string page = reader.getString("image");
+        Texture2D::TexParams params;
+        params.minFilter = atlasFilter(reader.getString("minFilter"), _default.minFilter);
+        params.magFilter = atlasFilter(reader.getString("magFilter"), _default.magFilter);
+        params.wrapS = GL_CLAMP_TO_EDGE;
+        params.wrapT = GL_CLAMP_TO_EDGE;
+        int count = reader.startArray("sprites");
+        for (int jj = 0; jj < count; jj++) {
+            reader.startObject();
+            float rect[4];
+            if (reader.getSize("region") == 4 && reader.getFloatArray("region", rect) == 4) {
+                AtlasEntry entry;
+                entry.page = page;
+                entry.params = params;
+                entry.region.setRect(rect[0] / scale, rect[1] / scale, rect[2] / scale, rect[3] / scale);
+                _atlas[reader.getString("source")] = entry;
+            }
+            reader.endObject();
+            reader.advance();
+        }
+        reader.endArray();
+        reader.endObject();
+        reader.advance();
+    }
+    reader.endArray();
+    reader.endJSON();
+    return true;
 }
 
 NS_CC_END
\ No newline at end of file
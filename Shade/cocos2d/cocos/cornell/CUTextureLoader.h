@@ -19,14 +19,30 @@
 //  scenes.  This coordinate is shared across all loader instances.  It decides
 //  When an asset is truly ready to be unloaded.
 //
+//  Images are decoded by a pool of worker threads rather than the single loading
+//  thread of TextureCache, most urgent first.  The decoded images are handed back
+//  through a lock-free queue and uploaded to the GPU a few at a time, within a time
+//  budget each frame, so a burst of large textures never stalls a frame.
+//
+//  A loader may also read an atlas table, written by the offline packer, that says
+//  which images were packed into which atlas page.  An image in the table loads its
+//  page instead, and the loader remembers the region of the page that is the image.
+//  All of the images on one page share a single texture, and so a single batch.
+//
 //  Author: Walker White
 //  Version: 12/10/15
 //
 #ifndef __CU_TEXTURE_LOADER__
 #define __CU_TEXTURE_LOADER__
 #include <unordered_set>
+#include <unordered_map>
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <renderer/CCTexture2D.h>
+#include <platform/CCImage.h>
 #include "CULoader.h"
+#include "CUThreadPool.h"
 
 NS_CC_BEGIN
 
@@ -55,12 +71,28 @@ NS_CC_BEGIN
  * Texture objects are uniquely identified by their image file.  Attempt to
  * load a image file a second time, even under a new key, will return a
  * reference to the same texture object, even if different parameters are used.
+ * Requests for a file that is still loading share its one decode.
+ *
+ * Asynchronous loads are decoded by a pool of worker threads in order of their
+ * Priority, and uploaded within a time budget each frame.  The pool size and the
+ * budget are shared by all loaders.
  */
 class CC_DLL TextureLoader : public Loader<Texture2D> {
 private:
     /** This macro disables the copy constructor (not allowed on assets) */
     CC_DISALLOW_COPY_AND_ASSIGN(TextureLoader);
     
+public:
+    /** The urgency of an asynchronous load; more urgent textures are decoded first */
+    enum class Priority {
+        /** Textures the player is waiting on, such as menus and the level being started */
+        UI = 0,
+        /** Textures of the level being played */
+        LEVEL = 1,
+        /** Textures that may be wanted later */
+        PREFETCH = 2
+    };
+
 protected:
 #pragma mark -
 #pragma mark Texture Coordinator
@@ -80,6 +112,57 @@ protected:
         std::unordered_map<std::string, int>   _refcnts;
         /** The callback functions registered to a texture for asynchronous loading */
         std::unordered_map<std::string,std::vector<std::function<void(Texture2D* s)>>> _callbacks;
+
+        /** An image waiting for a decoder */
+        struct DecodeJob {
+            /** The pathname of the texture, as given to loadAsync */
+            std::string source;
+            /** The full path of the image file */
+            std::string path;
+            /** The urgency of the image */
+            Priority priority;
+            /** The order of the request, so that equal priorities are first-come first-served */
+            unsigned long order;
+        };
+
+        /** A decoded image waiting for upload, linked into the completion queue */
+        struct Decoded {
+            /** The pathname of the texture, as given to loadAsync */
+            std::string source;
+            /** The full path of the image file */
+            std::string path;
+            /** The decoded image, or nullptr if decoding failed */
+            Image* image;
+            /** The image decoded before this one */
+            Decoded* next;
+        };
+
+        /** The decoder threads */
+        ThreadPool* _decoders;
+        /** The images waiting for a decoder; guarded by _jobMutex */
+        std::vector<DecodeJob> _jobs;
+        /** A mutex lock for the waiting images */
+        std::mutex _jobMutex;
+        /** The number of requests so far, to order the jobs */
+        unsigned long _order;
+        /** The images decoded since the last frame, newest first; pushed without locks */
+        std::atomic<Decoded*> _decoded;
+        /** The decoded images waiting for upload, oldest first; game thread only */
+        std::deque<Decoded*> _uploads;
+        /** The jobs queued or decoding whose images have not been uploaded */
+        size_t _inflight;
+
+        /** Decodes the most urgent waiting image.  This runs on a decoder thread. */
+        void decode();
+
+        /**
+         * Uploads decoded images until the frame budget is spent.
+         *
+         * This is scheduled every frame while any image is in flight.
+         *
+         * @param  dt   the time in seconds since last update
+         */
+        void upload(float dt);
         
     public:
         /** The number of active texture loader instances */
@@ -145,7 +228,18 @@ protected:
          *
          * @retain the texture asset upon loading
          */
-        void loadAsync(std::string source, std::function<void(Texture2D* s)> callback);
+        void loadAsync(std::string source, std::function<void(Texture2D* s)> callback,
+                       Priority priority = Priority::UI);
+
+        /**
+         * Raises the urgency of a texture that is waiting for a decoder.
+         *
+         * This does nothing if the texture is not waiting, or is already at least as urgent.
+         *
+         * @param  source   the pathname to the texture file
+         * @param  priority the new urgency of the texture
+         */
+        void prioritize(std::string source, Priority priority);
         
         /**
          * Creates a texture object and retains a reference to it.
@@ -159,6 +253,13 @@ protected:
          * @retain the texture asset
          */
         void allocate(Texture2D* texture, std::string source);
+
+        /**
+         * Removes a texture from the decode queue, if it has not yet started.
+         *
+         * @param  source   the pathname to the texture file
+         */
+        void cancel(std::string source);
         
         /**
          * Safely releases the texture for one loader
@@ -175,6 +276,10 @@ protected:
     
     /** The static coordinator singleton */
     static Coordinator* _gCoordinator;
+    /** The number of decoder threads, or -1 for one per spare core */
+    static int _gDecodeThreads;
+    /** The time each frame may spend uploading textures, in milliseconds */
+    static float _gUploadBudget;
     
     
 #pragma mark -
@@ -184,6 +289,35 @@ protected:
     
     /** The textures we are expecting that are not yet loaded */
     std::unordered_set<std::string> _tqueue;
+
+    /** Where an image was packed into a texture atlas */
+    struct AtlasEntry {
+        /** The pathname of the atlas page image */
+        std::string page;
+        /** The region of the page that is the image, with a top left origin */
+        Rect region;
+        /** The texture parameters of the page, shared by all of its images */
+        Texture2D::TexParams params;
+    };
+    /** The packed images of every atlas table read, by source pathname */
+    std::unordered_map<std::string, AtlasEntry> _atlas;
+    /** The atlas region of each key whose texture is an atlas page */
+    std::unordered_map<std::string, Rect> _regions;
+
+    /**
+     * Redirects a key to its atlas page if the source image was packed.
+     *
+     * The images on a page share one texture, so the parameters of the page
+     * replace the ones given for the key.  Otherwise the last key loaded
+     * would set them for every image on the page.
+     *
+     * @param  key      The key to access the texture after loading
+     * @param  source   The pathname to the texture image file
+     * @param  params   The texture parameters for the key, replaced by the page's
+     *
+     * @return the pathname of the file to load for the key
+     */
+    std::string redirect(const std::string& key, const std::string& source, Texture2D::TexParams& params);
     
     /**
      * A function to create a new texture from a filename.
@@ -319,6 +453,45 @@ public:
      */
     void loadAsync(std::string key, std::string source, const Texture2D::TexParams& params);
 
+    /**
+     * Adds a new texture to the loading queue with the given urgency.
+     *
+     * The texture will be loaded asynchronously, as with loadAsync(key,source),
+     * but it is decoded ahead of any less urgent texture.
+     *
+     * @param  key      The key to access the texture after loading
+     * @param  source   The pathname to the texture image file
+     * @param  priority The urgency of the texture
+     *
+     * @retain the texture upon loading
+     */
+    void loadAsync(std::string key, std::string source, Priority priority) {
+        loadAsync(key,source,_default,priority);
+    }
+
+    /**
+     * Adds a new texture to the loading queue with the given urgency.
+     *
+     * @param  key      The key to access the texture after loading
+     * @param  source   The pathname to the texture image file
+     * @param  params   The texture parameters for initialization
+     * @param  priority The urgency of the texture
+     *
+     * @retain the texture upon loading
+     */
+    void loadAsync(std::string key, std::string source, const Texture2D::TexParams& params, Priority priority);
+
+    /**
+     * Raises the urgency of a texture that is still waiting to be decoded.
+     *
+     * This is for a texture that was queued as a prefetch, and is now wanted.
+     * It does nothing if the texture is already decoded or at least as urgent.
+     *
+     * @param  source   The pathname to the texture image file
+     * @param  priority The new urgency of the texture
+     */
+    void prioritize(std::string source, Priority priority);
+
     /**
      * Unloads the texture for the given key.
      *
@@ -344,6 +517,47 @@ public:
     void unloadAll() override;
     
     
+#pragma mark Texture Atlases
+    /**
+     * Reads an atlas table, so that the images packed in it load from their atlas.
+     *
+     * The table is a JSON file written by the offline atlas packer. It lists
+     * the atlas pages, and the source pathname and region of each image on
+     * them.  Once it is read, loading one of those images under a key loads
+     * its page instead.  The key then holds the page texture, and getRegion()
+     * returns the part of the page that is the image.  Each page is decoded
+     * once however many of its images are loaded.
+     *
+     * Each page has its own filters in the table, which replace the texture
+     * parameters given when loading any of its images.  A filter missing
+     * from the table is the default one, and pages always clamp to the edge.
+     *
+     * A missing table is not an error; the images simply load on their own.
+     * The table only affects images loaded after this call.
+     *
+     * @param  table    The pathname to the atlas table
+     *
+     * @return true if the table was read
+     */
+    bool loadAtlas(std::string table);
+
+    /**
+     * Returns the region of the texture for the given key that is its image.
+     *
+     * This is Rect::ZERO unless the image was loaded from an atlas page.  The
+     * region has its origin at the top left corner of the page, as expected
+     * by TexturedNode::setTextureRegion().
+     *
+     * @param  key  the key referencing the texture
+     *
+     * @return the region of the texture for the given key that is its image
+     */
+    const Rect& getRegion(std::string key) const {
+        auto it = _regions.find(key);
+        return (it == _regions.end() ? Rect::ZERO : it->second);
+    }
+    
+    
 #pragma mark Defaults
     /**
      * Returns the default texture parameters
@@ -362,6 +576,33 @@ public:
      * @param  params   the default texture parameters
      */
     void setDefaultParameters(const Texture2D::TexParams& params)   { _default = params; }
+
+    /**
+     * Sets the number of threads that decode images, shared by all loaders
+     *
+     * This takes effect when the first loader starts, so it must be set before
+     * that.  A negative number uses one thread per spare core, up to four.
+     *
+     * @param  threads  the number of decoder threads
+     */
+    static void setDecodeThreads(int threads)   { _gDecodeThreads = threads; }
+
+    /**
+     * Sets the time each frame may spend uploading textures, shared by all loaders
+     *
+     * At least one texture is uploaded each frame that has any, however long it
+     * takes, so that loading always finishes.
+     *
+     * @param  millis   the upload budget in milliseconds
+     */
+    static void setUploadBudget(float millis)   { _gUploadBudget = millis; }
+
+    /**
+     * Returns the time each frame may spend uploading textures, in milliseconds
+     *
+     * @return the time each frame may spend uploading textures
+     */
+    static float getUploadBudget()              { return _gUploadBudget; }
     
     
 CC_CONSTRUCTOR_ACCESS:
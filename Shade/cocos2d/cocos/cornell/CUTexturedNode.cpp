@@ -65,7 +65,8 @@ TexturedNode::TexturedNode() :
 	_blendFunc(BlendFunc::DISABLE),
 	_opacityModifyRGB(true),
 	_flipHorizontal(false),
-	_flipVertical(false) {
+	_flipVertical(false),
+	_region(Rect::ZERO) {
 	_name = "TexturedNode";
 	_triangles.vertCount = 0;
 	_triangles.verts = nullptr;
@@ -224,7 +225,8 @@ bool TexturedNode::initWithFile(const std::string &filename, const Rect& rect) {
 * Initializes a textured polygon from a Texture2D object.
 *
 * After creation, the polygon will be a rectangle. The vertices of this
-* polygon will be the corners of the texture.
+* polygon will be the corners of the texture.  Any texture region is
+* cleared, so that the whole texture is used.
 *
 * @param texture   A pointer to a Texture2D object.
 *
@@ -232,11 +234,7 @@ bool TexturedNode::initWithFile(const std::string &filename, const Rect& rect) {
 * @return  true if the sprite is initialized properly, false otherwise.
 */
 bool TexturedNode::initWithTexture(Texture2D *texture) {
-	CCASSERT(texture != nullptr, "Invalid texture for sprite");
-
-	Rect bounds = Rect::ZERO;
-	bounds.size = texture->getContentSize();
-	return initWithTexture(texture, bounds);
+	return initWithRegion(texture, Rect::ZERO);
 }
 
 /**
@@ -329,6 +327,29 @@ bool TexturedNode::initWithTexture(Texture2D *texture, const Rect& rect) {
 	return result;
 }
 
+/**
+* Initializes a textured polygon from a region of a Texture2D object.
+*
+* This is for images packed into a texture atlas.  After creation, the
+* polygon will be a rectangle.  The vertices of this polygon will be the
+* corners of the region, which is given as in setTextureRegion().
+*
+* @param   texture  A pointer to an existing Texture2D object.
+*                   You can use a Texture2D object for many sprites.
+* @param   region   The texture region, or Rect::ZERO for the whole texture
+*
+* @retain  a reference to this texture
+* @return  true if the sprite is initialized properly, false otherwise.
+*/
+bool TexturedNode::initWithRegion(Texture2D *texture, const Rect& region) {
+	CCASSERT(texture != nullptr, "Invalid texture for sprite");
+
+	_region = region;
+	Rect bounds = Rect::ZERO;
+	bounds.size = (region.equals(Rect::ZERO) ? texture->getContentSize() : region.size);
+	return initWithTexture(texture, bounds);
+}
+
 /**
 * Releases all resources allocated with this sprite.
 *
@@ -549,26 +570,45 @@ void TexturedNode::updateBlendFunc(void) {
 *
 * The texture coordinates are computed assuming that the polygon is
 * defined in image space, with the origin in the bottom left corner
-* of the texture.
+* of the texture region.
 */
 void TexturedNode::updateTextureCoords() {
 	if (_triangles.vertCount == 0) {
 		return;
 	}
 
+	// Coordinates are relative to the region, then mapped into the texture
 	float w = _texture->getContentSize().width;
 	float h = _texture->getContentSize().height;
+	Rect region = _region;
+	if (region.equals(Rect::ZERO)) {
+		region.size.setSize(w, h);
+	}
 	Vec2 origin = _polygon.getBounds().origin;
 	for (int ii = 0; ii < _triangles.vertCount; ii++) {
-		_triangles.verts[ii].texCoords.u = (_triangles.verts[ii].vertices.x + origin.x) / w;
+		float u = (_triangles.verts[ii].vertices.x + origin.x) / region.size.width;
 		if (_flipHorizontal) {
-			_triangles.verts[ii].texCoords.u = 1 - _triangles.verts[ii].texCoords.u;
+			u = 1 - u;
 		}
-		_triangles.verts[ii].texCoords.v = (_triangles.verts[ii].vertices.y + origin.y) / h;
+		float v = (_triangles.verts[ii].vertices.y + origin.y) / region.size.height;
 		if (!_flipVertical) {
-			_triangles.verts[ii].texCoords.v = 1 - _triangles.verts[ii].texCoords.v;
+			v = 1 - v;
 		}
+		_triangles.verts[ii].texCoords.u = (region.origin.x + u * region.size.width) / w;
+		_triangles.verts[ii].texCoords.v = (region.origin.y + v * region.size.height) / h;
+	}
+}
+
+/**
+* Returns the size of the image, which is the region if there is one.
+*
+* @return the size of the image in image space
+*/
+Size TexturedNode::getImageSize() const {
+	if (!_region.equals(Rect::ZERO)) {
+		return _region.size;
 	}
+	return (_texture == nullptr ? Size::ZERO : _texture->getContentSize());
 }
 
 
@@ -96,6 +96,8 @@ protected:
     bool _flipHorizontal;
     /** Whether or not to flip the texture vertically */
     bool _flipVertical;
+    /** The part of the texture used as the image, or Rect::ZERO for all of it */
+    Rect _region;
     
     /**
      * Generates the triangles data to render a shape from the polygon.
@@ -130,7 +132,7 @@ protected:
      *
      * The texture coordinates are computed assuming that the polygon is
      * defined in image space, with the origin in the bottom left corner
-     * of the texture.
+     * of the texture region.
      */
     void updateTextureCoords();
 
@@ -323,6 +325,40 @@ public:
      * @return true if the texture coordinates are flipped vertically.
      */
     bool isFlipVertical() const { return _flipVertical; }
+
+    /**
+     * Sets the part of the texture to use as the image.
+     *
+     * This allows many nodes to share one texture atlas, so that they can be
+     * drawn in a single batch.  The region is a rectangle of the texture, with
+     * the origin at the top left corner as in the image file, measured in the
+     * units of the texture content size.  Image space is then the region, with
+     * its origin at the bottom left corner of the region, and flipping mirrors
+     * the region rather than the whole texture.
+     *
+     * A polygon that extends beyond the region will show the neighbouring
+     * images of the atlas, as the renderer cannot wrap part of a texture.
+     *
+     * This method has no effect on the polygon vertices.  The region is kept
+     * when the texture changes; set it to Rect::ZERO to use all of a texture.
+     *
+     * @param  region   the texture region, or Rect::ZERO for the whole texture
+     */
+    void setTextureRegion(const Rect& region) { _region = region; updateTextureCoords(); }
+
+    /**
+     * Returns the part of the texture used as the image.
+     *
+     * @return the texture region, or Rect::ZERO if the whole texture is used
+     */
+    const Rect& getTextureRegion() const { return _region; }
+
+    /**
+     * Returns the size of the image, which is the region if there is one.
+     *
+     * @return the size of the image in image space
+     */
+    Size getImageSize() const;
     
     
 CC_CONSTRUCTOR_ACCESS:
@@ -456,7 +492,8 @@ CC_CONSTRUCTOR_ACCESS:
      * Initializes a textured polygon from a Texture2D object.
      *
      * After creation, the polygon will be a rectangle. The vertices of this
-     * polygon will be the corners of the texture.
+     * polygon will be the corners of the texture.  Any texture region is
+     * cleared, so that the whole texture is used.
      *
      * @param texture   A pointer to a Texture2D object.
      *
@@ -509,6 +546,22 @@ CC_CONSTRUCTOR_ACCESS:
      */
     virtual bool initWithTexture(Texture2D *texture, const Rect& rect);
 
+    /**
+     * Initializes a textured polygon from a region of a Texture2D object.
+     *
+     * This is for images packed into a texture atlas.  After creation, the
+     * polygon will be a rectangle.  The vertices of this polygon will be the
+     * corners of the region, which is given as in setTextureRegion().
+     *
+     * @param   texture  A pointer to an existing Texture2D object.
+     *                   You can use a Texture2D object for many sprites.
+     * @param   region   The texture region, or Rect::ZERO for the whole texture
+     *
+     * @retain  a reference to this texture
+     * @return  true if the sprite is initialized properly, false otherwise.
+     */
+    virtual bool initWithRegion(Texture2D *texture, const Rect& region);
+
 };
 
 NS_CC_END
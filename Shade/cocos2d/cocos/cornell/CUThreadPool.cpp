@@ -133,6 +133,8 @@ void ThreadPool::addTask(const std::function<void()> &task){
  * A stopped thread pool is marked for shutdown, but it shutdown has not necessarily
  * completed.  Shutdown will be complete when the current child threads have
  * finished with their tasks.
+ *
+ * It is safe to stop a pool again, as the destructor does.
  */
 void ThreadPool::stop() {
     {
@@ -141,8 +143,11 @@ void ThreadPool::stop() {
         _taskCondition.notify_all();
     }
     
+    // A pool may be stopped more than once, and each thread is only joined once
     for (auto&& worker : _workers) {
-        worker.join();
+        if (worker.joinable()) {
+            worker.join();
+        }
     }
 }
 
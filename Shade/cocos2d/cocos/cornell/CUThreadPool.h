@@ -109,6 +109,8 @@ public:
      * A stopped thread pool is marked for shutdown, but it shutdown has not necessarily
      * completed.  Shutdown will be complete when the current child threads have
      * finished with their tasks.
+     *
+     * It is safe to stop a pool again, as the destructor does.
      */
     void stop();
     
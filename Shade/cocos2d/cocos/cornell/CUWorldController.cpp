@@ -187,8 +187,12 @@ _destroy(false) {
     _stepssize  = DEFAULT_WORLD_STEP;
     _itvelocity = DEFAULT_WORLD_VELOC;
     _itposition = DEFAULT_WORLD_POSIT;
+    _fixedstep  = false;
+    _maxsubsteps = DEFAULT_WORLD_SUBSTEPS;
+    _accumulator = 0.0f;
     _gravity = Vec2(0,DEFAULT_GRAVITY);
     
+    beforeStep     = nullptr;
     onBeginContact = nullptr;
     onEndContact   = nullptr;
     beforeSolve    = nullptr;
@@ -205,6 +209,7 @@ WorldController::~WorldController() {
     clear();
     delete _world;
     _world  = nullptr;
+    beforeStep     = nullptr;
     onBeginContact = nullptr;
     onEndContact   = nullptr;
     beforeSolve    = nullptr;
@@ -271,6 +276,7 @@ void WorldController::addObstacle(Obstacle* obj) {
     _objects.push_back(obj);
     obj->retain();
     obj->activatePhysics(*_world);
+    obj->storePreviousTransform();
 }
 
 /**
@@ -370,11 +376,43 @@ void WorldController::setGravity(const Vec2& gravity) {
  * physics.  The primary method is the step() method in world.  This implementation
  * works for all applications and should not need to be overwritten.
  *
+ * In fixed-step mode, this takes as many steps of the fixed size as fit in the
+ * elapsed time (up to the substep cap), and positions the scene nodes between
+ * the last two steps by the fraction of a step left over.
+ *
  * @param delta Number of seconds since last animation frame
  */
 void WorldController::update(float dt) {
-    // Turn the physics engine crank.
-    _world->Step((_lockstep ? _stepssize : dt),_itvelocity,_itposition);
+    if (_fixedstep) {
+        _accumulator += dt;
+        int steps = 0;
+        while (_accumulator >= _stepssize && steps < _maxsubsteps) {
+            for(auto it = _objects.begin() ; it != _objects.end(); ++it) {
+                (*it)->storePreviousTransform();
+            }
+            if (beforeStep != nullptr) {
+                beforeStep();
+            }
+            _world->Step(_stepssize,_itvelocity,_itposition);
+            _accumulator -= _stepssize;
+            steps++;
+        }
+        
+        // Drop any time we could not catch up on
+        if (_accumulator >= _stepssize) {
+            _accumulator = fmodf(_accumulator, _stepssize);
+        }
+        float alpha = _accumulator/_stepssize;
+        for(auto it = _objects.begin() ; it != _objects.end(); ++it) {
+            (*it)->setInterpolation(alpha);
+        }
+    } else {
+        // Turn the physics engine crank.
+        if (beforeStep != nullptr) {
+            beforeStep();
+        }
+        _world->Step((_lockstep ? _stepssize : dt),_itvelocity,_itposition);
+    }
     
     // Post process all objects after physics (this updates graphics)
     for(auto it = _objects.begin() ; it != _objects.end(); ++it) {
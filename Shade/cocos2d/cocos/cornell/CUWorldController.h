@@ -29,6 +29,8 @@ class Obstacle;
 #define DEFAULT_WORLD_VELOC 6
 /** Default number of position iterations for the constrain solvers */
 #define DEFAULT_WORLD_POSIT 2
+/** Default maximum number of fixed steps to take in a single update */
+#define DEFAULT_WORLD_SUBSTEPS 5
 
 
 #pragma mark -
@@ -57,6 +59,12 @@ protected:
     int _itvelocity;
     /** The number of position iterations for the constrain solvers */
     int _itposition;
+    /** Whether to step in fixed increments of elapsed time */
+    bool _fixedstep;
+    /** The maximum number of fixed steps to take in a single update */
+    int _maxsubsteps;
+    /** Elapsed time not yet simulated in fixed-step mode */
+    float _accumulator;
     /** The current gravitational value of the world */
     Vec2 _gravity;
     
@@ -159,6 +167,58 @@ public:
      * @param  step the amount of time for a single engine step.
      */
     void setStepsize(float step) { _stepssize = step; }
+    
+    /**
+     * Returns true if the physics advances in fixed steps of elapsed time.
+     *
+     * In fixed-step mode, update accumulates the elapsed time and simulates it
+     * in steps of exactly getStepsize(), carrying the remainder over to the next
+     * update.  Scene nodes are drawn between the last two simulated transforms.
+     * This takes precedence over isLockStep().
+     *
+     * @return true if the physics advances in fixed steps of elapsed time.
+     */
+    bool isFixedStep() const { return _fixedstep; }
+    
+    /**
+     * Sets whether the physics advances in fixed steps of elapsed time.
+     *
+     * In fixed-step mode, update accumulates the elapsed time and simulates it
+     * in steps of exactly getStepsize(), carrying the remainder over to the next
+     * update.  Scene nodes are drawn between the last two simulated transforms.
+     * This takes precedence over isLockStep().
+     *
+     * @param  flag whether the physics advances in fixed steps of elapsed time.
+     */
+    void setFixedStep(bool flag) { _fixedstep = flag; _accumulator = 0.0f; }
+
+    /**
+     * Drops any elapsed time not yet simulated in fixed-step mode.
+     *
+     * Call this after moving bodies by hand, so that the next update starts
+     * from a whole step.
+     */
+    void resetAccumulator() { _accumulator = 0.0f; }
+    
+    /**
+     * Returns the maximum number of fixed steps taken in a single update.
+     *
+     * If a frame takes longer than this many steps, the excess time is dropped
+     * so that a hitch cannot snowball into ever longer updates.
+     *
+     * @return the maximum number of fixed steps taken in a single update.
+     */
+    int getMaxSubsteps() const { return _maxsubsteps; }
+    
+    /**
+     * Sets the maximum number of fixed steps taken in a single update.
+     *
+     * If a frame takes longer than this many steps, the excess time is dropped
+     * so that a hitch cannot snowball into ever longer updates.
+     *
+     * @param  steps the maximum number of fixed steps taken in a single update.
+     */
+    void setMaxSubsteps(int steps) { _maxsubsteps = steps; }
 
     /** 
      * Returns number of velocity iterations for the constrain solvers 
@@ -322,6 +382,18 @@ public:
      */
     bool enabledCollisionCallbacks() const { return _collide; }
     
+    /**
+     * Called just before each step of the physics engine
+     *
+     * In fixed-step mode an update may take several steps or none at all, so
+     * anything that must advance with the simulation rather than with the
+     * frame, such as scripted movement, belongs here.
+     *
+     * This attribute is a dynamically assignable callback and may be changed at
+     * any given time.
+     */
+    std::function<void()> beforeStep;
+    
     /**
      * Called when two fixtures begin to touch
      *
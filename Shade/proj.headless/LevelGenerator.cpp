@@ -0,0 +1,157 @@
+//
+//  LevelGenerator.cpp
+//  Shade headless simulator
+//
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <algorithm>
+#include "LevelGenerator.h"
+
+/** The static object types that fit in one block */
+static const char* BUILDING_TYPES[] = { "b1", "b2", "b3", "b4", "b5" };
+/** The number of entries in BUILDING_TYPES */
+#define BUILDING_TYPE_COUNT (int)(sizeof(BUILDING_TYPES) / sizeof(BUILDING_TYPES[0]))
+
+/** Returns a number in [lo, hi), the same on every platform for a seed */
+static float uniform(std::mt19937& rng, float lo, float hi) {
+    return lo + (hi - lo) * (float)(rng() / 4294967296.0);
+}
+
+/** Returns a number formatted for the level file */
+static std::string number(float value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+}
+
+/** Writes one action of a mover's queue */
+static void writeAction(std::ostringstream& out, const char* type, float bearing, int length, int counter,
+                        float targetX, float targetY, bool cycleStart) {
+    out << "{\"type\":\"" << type << "\",\"bearing\":" << number(bearing)
+        << ",\"length\":" << length << ",\"counter\":" << counter
+        << ",\"targetPixelX\":" << number(targetX * LEVEL_PIXELS)
+        << ",\"targetPixelY\":" << number(targetY * LEVEL_PIXELS);
+    if (cycleStart) {
+        out << ",\"cycleStart\":true";
+    }
+    out << "}";
+}
+
+/**
+ * Writes a mover that patrols back and forth along one axis.
+ *
+ * The mover runs forward for part of its first action, waits, runs back
+ * the whole route and waits again, over and over. Starting at least one
+ * route from either end keeps the whole patrol inside [lo, hi].
+ *
+ * @param  vertical  Whether the mover patrols along y instead of x
+ * @param  lane      The coordinate on the other axis
+ * @param  lo        The lowest coordinate the patrol may reach
+ * @param  hi        The highest coordinate the patrol may reach
+ * @param  run       The action type that moves the mover
+ * @param  wait      The action type that stops the mover
+ * @param  forward   The bearing of the forward run, in degrees
+ * @param  back      The bearing of the run back, in degrees
+ */
+static void writeMover(std::ostringstream& out, std::mt19937& rng, bool vertical, float lane, float lo, float hi,
+                       const char* run, const char* wait, float forward, float back) {
+    float route = std::min(LEVEL_ROUTE, (hi - lo) * 0.5f);
+    int length = std::max(1, (int)(route / LEVEL_MOVER_SPEED * LEVEL_FRAME_RATE));
+    route = length * LEVEL_MOVER_SPEED / LEVEL_FRAME_RATE;
+    int counter = 1 + (int)uniform(rng, 0.0f, (float)length);
+    counter = std::min(counter, length);
+
+    float start = uniform(rng, lo + route, std::max(lo + route, hi - route));
+    float turn = start + counter * LEVEL_MOVER_SPEED / LEVEL_FRAME_RATE;
+    float end = turn - route;
+    float x = (vertical ? lane : start);
+    float y = (vertical ? start : lane);
+    float turnX = (vertical ? lane : turn), turnY = (vertical ? turn : lane);
+    float endX = (vertical ? lane : end), endY = (vertical ? end : lane);
+
+    out << "{\"x\":" << number(x) << ",\"y\":" << number(y) << ",\"bearing\":" << number(forward)
+        << ",\"actionQueue\":[";
+    writeAction(out, run, forward, length, counter, turnX, turnY, true);
+    out << ",";
+    writeAction(out, wait, forward, LEVEL_WAIT_FRAMES, LEVEL_WAIT_FRAMES, turnX, turnY, false);
+    out << ",";
+    writeAction(out, run, back, length, length, endX, endY, false);
+    out << ",";
+    writeAction(out, wait, back, LEVEL_WAIT_FRAMES, LEVEL_WAIT_FRAMES, endX, endY, false);
+    out << "]}";
+}
+
+std::string generateLevel(const LevelSpec& spec) {
+    std::mt19937 rng(spec.seed);
+
+    // The grid of blocks, and the level around it
+    int cols, rows;
+    if (spec.width > 0.0f && spec.height > 0.0f) {
+        cols = (int)(spec.width / LEVEL_BLOCK);
+        rows = (int)(spec.height / LEVEL_BLOCK);
+    } else {
+        int buildings = std::max(spec.buildings, 1);
+        cols = (int)std::ceil(std::sqrt((double)buildings));
+        rows = (buildings + cols - 1) / cols;
+    }
+    cols = std::max(cols, LEVEL_MIN_BLOCKS);
+    rows = std::max(rows, LEVEL_MIN_BLOCKS);
+    float width = std::max(spec.width, cols * LEVEL_BLOCK);
+    float height = std::max(spec.height, rows * LEVEL_BLOCK);
+
+    std::ostringstream out;
+    out << "{\"name\":\"" << spec.name << "\",\"index\":" << spec.index
+        << ",\"pixelSize\":{\"width\":" << number(width * LEVEL_PIXELS)
+        << ",\"height\":" << number(height * LEVEL_PIXELS) << "}";
+
+    // Both ends of the level are street corners, clear of every building
+    out << ",\"playerSite\":{\"x\":" << number(LEVEL_BLOCK) << ",\"y\":" << number(LEVEL_BLOCK) << "}";
+    out << ",\"casterSite\":{\"x\":" << number((cols - 1) * LEVEL_BLOCK)
+        << ",\"y\":" << number((rows - 1) * LEVEL_BLOCK) << ",\"bearing\":0}";
+
+    out << ",\"staticObjects\":[";
+    int blocks = cols * rows;
+    for (int ii = 0; ii < spec.buildings; ii++) {
+        int block = ii % blocks;
+        float x = ((block % cols) + 0.5f) * LEVEL_BLOCK + uniform(rng, -0.5f, 0.5f);
+        float y = ((block / cols) + 0.5f) * LEVEL_BLOCK + uniform(rng, -0.5f, 0.5f);
+        const char* type = BUILDING_TYPES[rng() % BUILDING_TYPE_COUNT];
+        out << (ii > 0 ? "," : "") << "{\"x\":" << number(x) << ",\"y\":" << number(y)
+            << ",\"type\":{\"name\":\"" << type << "\"}}";
+    }
+    out << "]";
+
+    // Cars drive the streets between columns, in one of two lanes
+    out << ",\"cars\":[";
+    for (int ii = 0; ii < spec.cars; ii++) {
+        int street = 1 + (int)(rng() % (cols - 1));
+        float lane = street * LEVEL_BLOCK + (rng() % 2 == 0 ? -0.75f : 0.75f);
+        out << (ii > 0 ? "," : "");
+        writeMover(out, rng, true, lane, LEVEL_EDGE, height - LEVEL_EDGE, "go", "stop", 90.0f, 270.0f);
+    }
+    out << "]";
+
+    // Pedestrians walk the streets between rows
+    out << ",\"pedestrians\":[";
+    for (int ii = 0; ii < spec.pedestrians; ii++) {
+        int street = 1 + (int)(rng() % (rows - 1));
+        float lane = street * LEVEL_BLOCK + uniform(rng, -1.0f, 1.0f);
+        out << (ii > 0 ? "," : "");
+        // A pedestrian walks opposite its bearing, so 180 heads east
+        writeMover(out, rng, false, lane, LEVEL_EDGE, width - LEVEL_EDGE, "walk_slow", "stand", 180.0f, 0.0f);
+    }
+    out << "]}";
+    return out.str();
+}
+
+bool writeLevel(const LevelSpec& spec, const std::string& path) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    std::string text = generateLevel(spec);
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+    return fclose(file) == 0 && written;
+}
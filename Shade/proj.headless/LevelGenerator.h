@@ -0,0 +1,84 @@
+//
+//  LevelGenerator.h
+//  Shade headless simulator
+//
+//  Writes procedural stress levels in the .shadl format read by
+//  LevelInstance.  This file has no cocos2d dependencies, so the level
+//  generator tool builds without the engine.
+//
+#ifndef __LEVEL_GENERATOR_H__
+#define __LEVEL_GENERATOR_H__
+
+#include <string>
+
+/** The side of one city block, in Box2D units; fits any block-sized building */
+#define LEVEL_BLOCK 10.0f
+/** Pixels per Box2D unit in a level file; must match BOX2D_SCALE */
+#define LEVEL_PIXELS 50.0f
+/** The fewest blocks along either side of a level */
+#define LEVEL_MIN_BLOCKS 3
+/** The longest stretch a mover patrols, in Box2D units */
+#define LEVEL_ROUTE 10.0f
+/** How far a mover keeps from the level edge, in Box2D units */
+#define LEVEL_EDGE 2.0f
+/** Speed of a car "go" and a pedestrian "walk_slow", in Box2D units per second */
+#define LEVEL_MOVER_SPEED 2.0f
+/** Frames a mover waits at each end of its route */
+#define LEVEL_WAIT_FRAMES 30
+/** Frames per second of the action lengths */
+#define LEVEL_FRAME_RATE 60.0f
+
+/** What to put in a generated level */
+struct LevelSpec {
+    /** The number of buildings */
+    int buildings;
+    /** The number of cars */
+    int cars;
+    /** The number of pedestrians */
+    int pedestrians;
+    /** The level width in Box2D units, or 0 to fit the buildings */
+    float width;
+    /** The level height in Box2D units, or 0 to fit the buildings */
+    float height;
+    /** The random seed; the same spec always gives the same level */
+    unsigned int seed;
+    /** The level index written to the file */
+    int index;
+    /** The level name written to the file */
+    std::string name;
+
+    LevelSpec() : buildings(0), cars(0), pedestrians(0), width(0), height(0),
+        seed(1), index(0), name("generated") {}
+};
+
+/**
+ * Returns the text of a level laid out as a grid of city blocks.
+ *
+ * Each block holds one building near its center, and when there are more
+ * buildings than blocks the extras share blocks, overlapping. Cars patrol
+ * up and down the streets between the columns of blocks and pedestrians
+ * walk back and forth along the streets between the rows, each on a
+ * cycling action queue that starts at a random point of its first action.
+ * The character starts at the first street corner and the caster waits at
+ * the last one, so every object is in a valid position for LevelInstance.
+ *
+ * A level with no size gets the fewest blocks, in a near-square grid, that
+ * give each building its own block.
+ *
+ * @param  spec  What to put in the level
+ *
+ * @return the level file contents
+ */
+std::string generateLevel(const LevelSpec& spec);
+
+/**
+ * Writes a generated level to a file.
+ *
+ * @param  spec  What to put in the level
+ * @param  path  The file to write
+ *
+ * @return true if the file was written
+ */
+bool writeLevel(const LevelSpec& spec, const std::string& path);
+
+#endif /* __LEVEL_GENERATOR_H__ */
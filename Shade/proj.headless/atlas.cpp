@@ -0,0 +1,343 @@
+//
+//  atlas.cpp
+//  Shade texture atlas packer
+//
+//  Packs the sprites of a level -- each static object and its shadow, and
+//  the pedestrian, car, player and caster sprites -- into a few atlas pages,
+//  and writes the atlas table that TextureLoader::loadAtlas() reads.  The
+//  game then binds a handful of page textures instead of two per object
+//  type, so the renderer batches the level into a handful of draw calls.
+//
+//  Usage: ShadeAtlas [-s size] [-o resources]
+//
+//  The table is written to ATLAS_TABLE and the pages beside it, under the
+//  given resource directory, or else the one the sprites are read from.
+//  Pages are size pixels wide and only as tall as they need to be.  Images
+//  are packed on shelves, tallest first, each with a border that repeats its
+//  edge pixels so that filtering never bleeds in a neighbour.  An image too
+//  large for a page is left out, and loads on its own.  The atlas must be
+//  rebuilt whenever a sprite changes.
+//
+//  Every image on a page shares the page texture, so the table gives each
+//  page its filters, and the game ignores the parameters it loads the
+//  images with.
+//
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "cocos2d.h"
+#include <cornell.h>
+#include "../Classes/C_Gameplay.h"
+
+USING_NS_CC;
+
+/** The width of a page if none is given, the largest texture most devices allow */
+#define DEFAULT_PAGE_SIZE 4096
+/** The border around each image, in pixels */
+#define ATLAS_PADDING 2
+/** The minification filter of every page, as TextureLoader defaults to */
+#define PAGE_MIN_FILTER "nearest"
+/** The magnification filter of every page, as TextureLoader defaults to */
+#define PAGE_MAG_FILTER "linear"
+/** The directory of the static object sprites */
+#define STATIC_SPRITES "textures/static_objects/"
+
+/** The mover, player and caster sprites; these must agree with MainMenuController::preload */
+static const char* MOVER_SPRITES[] = {
+    "textures/player_animation.png",
+    "textures/Pedestrian.png",
+    "textures/Pedestrian_S.png",
+    "textures/car_animation.png",
+    "textures/Car1_S.png",
+    "textures/caster_animation.png"
+};
+
+/** One image to pack */
+struct PackedImage {
+    /** The pathname the game loads the image from */
+    std::string source;
+    /** The pixels, as straight (not premultiplied) RGBA */
+    std::vector<unsigned char> pixels;
+    /** The width of the image in pixels */
+    int width;
+    /** The height of the image in pixels */
+    int height;
+    /** The page the image is packed on, or -1 if it is left out */
+    int page;
+    /** The left edge of the image on its page */
+    int x;
+    /** The top edge of the image on its page */
+    int y;
+};
+
+/** Reads the sprite of each static object type, and its shadow */
+static bool readStaticSources(std::vector<std::string>& sources)
+{
+    JSONReader reader;
+    reader.initWithFile(STATIC_OBJECTS);
+    if (!reader.startJSON()) {
+        return false;
+    }
+    int count = reader.startArray("types");
+    for (int index = 0; index < count; index++) {
+        reader.startObject();
+        std::string name = reader.getString("name");
+        std::string imageFormat = reader.getString("imageFormat");
+        std::string shadowImageFormat = reader.getString("shadowImageFormat");
+        if (shadowImageFormat == "") {
+            shadowImageFormat = imageFormat;
+        }
+        sources.push_back(STATIC_SPRITES + name + "." + imageFormat);
+        sources.push_back(STATIC_SPRITES + name + "_S." + shadowImageFormat);
+        reader.endObject();
+        reader.advance();
+    }
+    reader.endArray();
+    reader.endJSON();
+    return true;
+}
+
+/**
+ * Decodes an image to straight RGBA.
+ *
+ * The engine premultiplies the alpha of a PNG as it decodes it, and would
+ * do so again when it loads the page, so the alpha is divided back out.
+ */
+static bool readImage(const std::string& source, PackedImage& sprite)
+{
+    Image* image = new (std::nothrow) Image();
+    if (image == nullptr || !image->initWithImageFile(source)) {
+        CC_SAFE_RELEASE(image);
+        return false;
+    }
+    sprite.source = source;
+    sprite.width = image->getWidth();
+    sprite.height = image->getHeight();
+    sprite.page = -1;
+    sprite.x = sprite.y = 0;
+    sprite.pixels.resize((size_t)sprite.width * sprite.height * 4);
+
+    const unsigned char* data = image->getData();
+    size_t count = (size_t)sprite.width * sprite.height;
+    bool ok = true;
+    for (size_t ii = 0; ii < count && ok; ii++) {
+        unsigned char* out = &sprite.pixels[ii * 4];
+        switch (image->getRenderFormat()) {
+            case Texture2D::PixelFormat::RGBA8888:
+                out[0] = data[ii * 4];
+                out[1] = data[ii * 4 + 1];
+                out[2] = data[ii * 4 + 2];
+                out[3] = data[ii * 4 + 3];
+                if (image->hasPremultipliedAlpha() && out[3] > 0 && out[3] < 255) {
+                    for (int cc = 0; cc < 3; cc++) {
+                        out[cc] = (unsigned char)std::min(255, (out[cc] * 255 + out[3] / 2) / out[3]);
+                    }
+                }
+                break;
+            case Texture2D::PixelFormat::RGB888:
+                out[0] = data[ii * 3];
+                out[1] = data[ii * 3 + 1];
+                out[2] = data[ii * 3 + 2];
+                out[3] = 255;
+                break;
+            case Texture2D::PixelFormat::AI88:
+                out[0] = out[1] = out[2] = data[ii * 2];
+                out[3] = data[ii * 2 + 1];
+                break;
+            case Texture2D::PixelFormat::I8:
+                out[0] = out[1] = out[2] = data[ii];
+                out[3] = 255;
+                break;
+            default:
+                ok = false;
+                break;
+        }
+    }
+    image->release();
+    return ok;
+}
+
+/**
+ * Places the sprites on shelves, tallest first, opening pages as needed.
+ *
+ * @return the height of each page, in pixels
+ */
+static std::vector<int> pack(std::vector<PackedImage*>& sprites, int size)
+{
+    std::sort(sprites.begin(), sprites.end(), [](const PackedImage* a, const PackedImage* b) {
+        return a->height != b->height ? a->height > b->height : a->width > b->width;
+    });
+
+    // The sprites come tallest first, so a new shelf only ever opens below the last
+    std::vector<int> heights;
+    int shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (PackedImage* sprite : sprites) {
+        int w = sprite->width + 2 * ATLAS_PADDING;
+        int h = sprite->height + 2 * ATLAS_PADDING;
+        if (w > size || h > size) {
+            continue;
+        }
+        if (heights.empty() || shelfX + w > size) {
+            shelfY += shelfHeight;
+            shelfX = 0;
+            shelfHeight = h;
+        }
+        if (heights.empty() || shelfY + h > size) {
+            heights.push_back(0);
+            shelfX = shelfY = 0;
+            shelfHeight = h;
+        }
+        sprite->page = (int)heights.size() - 1;
+        sprite->x = shelfX + ATLAS_PADDING;
+        sprite->y = shelfY + ATLAS_PADDING;
+        shelfX += w;
+        heights.back() = std::max(heights.back(), shelfY + h);
+    }
+    return heights;
+}
+
+/** Copies a sprite onto its page, repeating its edge pixels into the border */
+static void blit(const PackedImage& sprite, std::vector<unsigned char>& page, int size, int height)
+{
+    for (int row = -ATLAS_PADDING; row < sprite.height + ATLAS_PADDING; row++) {
+        int y = sprite.y + row;
+        if (y < 0 || y >= height) {
+            continue;
+        }
+        int srcRow = std::min(std::max(row, 0), sprite.height - 1);
+        for (int col = -ATLAS_PADDING; col < sprite.width + ATLAS_PADDING; col++) {
+            int x = sprite.x + col;
+            if (x < 0 || x >= size) {
+                continue;
+            }
+            int srcCol = std::min(std::max(col, 0), sprite.width - 1);
+            memcpy(&page[((size_t)y * size + x) * 4], &sprite.pixels[((size_t)srcRow * sprite.width + srcCol) * 4], 4);
+        }
+    }
+}
+
+/** Returns the pathname of a page, relative to the resource directory */
+static std::string pageName(int page)
+{
+    std::string table = ATLAS_TABLE;
+    size_t dot = table.rfind('.');
+    return table.substr(0, dot) + "_" + std::to_string(page) + ".png";
+}
+
+int main(int argc, char **argv)
+{
+    int size = DEFAULT_PAGE_SIZE;
+    std::string root;
+    for (int ii = 1; ii < argc; ii++) {
+        if (strcmp(argv[ii], "-s") == 0 && ii + 1 < argc) {
+            size = atoi(argv[++ii]);
+        } else if (strcmp(argv[ii], "-o") == 0 && ii + 1 < argc) {
+            root = argv[++ii];
+        } else {
+            size = 0;
+        }
+    }
+    if (size <= 2 * ATLAS_PADDING) {
+        fprintf(stderr, "usage: %s [-s size] [-o resources]\n", argv[0]);
+        return 2;
+    }
+
+    // Without a directory, write where the static objects were found
+    if (root.empty()) {
+        std::string found = FileUtils::getInstance()->fullPathForFilename(STATIC_OBJECTS);
+        if (found.size() < strlen(STATIC_OBJECTS)) {
+            fprintf(stderr, "failed to find %s\n", STATIC_OBJECTS);
+            return 1;
+        }
+        root = found.substr(0, found.size() - strlen(STATIC_OBJECTS));
+    } else if (root.back() != '/') {
+        root += '/';
+    }
+
+    std::vector<std::string> sources;
+    if (!readStaticSources(sources)) {
+        fprintf(stderr, "failed to load %s\n", STATIC_OBJECTS);
+        return 1;
+    }
+    for (const char* source : MOVER_SPRITES) {
+        sources.push_back(source);
+    }
+
+    // Types may share an image, which only needs packing once
+    std::sort(sources.begin(), sources.end());
+    sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+    std::vector<PackedImage> sprites(sources.size());
+    std::vector<PackedImage*> order;
+    int failed = 0;
+    for (size_t ii = 0; ii < sources.size(); ii++) {
+        if (!readImage(sources[ii], sprites[ii])) {
+            fprintf(stderr, "%s: failed to read\n", sources[ii].c_str());
+            failed++;
+            continue;
+        }
+        order.push_back(&sprites[ii]);
+    }
+
+    std::vector<int> heights = pack(order, size);
+    std::string dir = root + ATLAS_TABLE;
+    FileUtils::getInstance()->createDirectory(dir.substr(0, dir.rfind('/')));
+    for (int page = 0; page < (int)heights.size(); page++) {
+        // Pad the height so that rows stay aligned for the upload
+        int height = (heights[page] + 3) & ~3;
+        std::vector<unsigned char> pixels((size_t)size * height * 4, 0);
+        for (const PackedImage* sprite : order) {
+            if (sprite->page == page) {
+                blit(*sprite, pixels, size, height);
+            }
+        }
+        Image* image = new (std::nothrow) Image();
+        std::string file = root + pageName(page);
+        bool saved = image->initWithRawData(pixels.data(), (ssize_t)pixels.size(), size, height, 8, false) &&
+                     image->saveToFile(file, false);
+        image->release();
+        if (!saved) {
+            fprintf(stderr, "%s: failed to write\n", file.c_str());
+            return 1;
+        }
+        printf("%s: %d x %d\n", pageName(page).c_str(), size, height);
+    }
+
+    std::ofstream out(root + ATLAS_TABLE);
+    out << "{\n    \"pages\": [";
+    for (int page = 0; page < (int)heights.size(); page++) {
+        out << (page > 0 ? "," : "") << "\n        {\n            \"image\": \"" << pageName(page)
+            << "\",\n            \"minFilter\": \"" << PAGE_MIN_FILTER
+            << "\",\n            \"magFilter\": \"" << PAGE_MAG_FILTER
+            << "\",\n            \"sprites\": [";
+        bool first = true;
+        for (const PackedImage* sprite : order) {
+            if (sprite->page != page) {
+                continue;
+            }
+            out << (first ? "" : ",") << "\n                {\"source\": \"" << sprite->source
+                << "\", \"region\": [" << sprite->x << ", " << sprite->y << ", "
+                << sprite->width << ", " << sprite->height << "]}";
+            first = false;
+        }
+        out << "\n            ]\n        }";
+    }
+    out << "\n    ]\n}\n";
+    out.close();
+    if (!out) {
+        fprintf(stderr, "%s: failed to write\n", (root + ATLAS_TABLE).c_str());
+        return 1;
+    }
+
+    for (const PackedImage* sprite : order) {
+        if (sprite->page < 0) {
+            printf("%s: %d x %d is too large for a page, left out\n",
+                   sprite->source.c_str(), sprite->width, sprite->height);
+        }
+    }
+    printf("%d sprites on %d pages -> %s\n", (int)order.size(), (int)heights.size(), (root + ATLAS_TABLE).c_str());
+    return failed == 0 ? 0 : 1;
+}
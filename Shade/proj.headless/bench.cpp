@@ -0,0 +1,128 @@
+//
+//  bench.cpp
+//  Shade scaling benchmark
+//
+//  Generates stress levels of 10 to 10,000 objects, runs each one headless
+//  for a fixed number of frames, and prints one CSV row per level: the
+//  object counts, the load and setup time, the memory the level took, the
+//  step-time statistics and the mean time of each phase of a step.  The
+//  rows chart how each subsystem scales with the size of a level.
+//
+//  Usage: ShadeBench [frames] [largest] [kinematic]
+//
+//  The object counts go up in steps of about 3x, to the largest count
+//  given.  Half the objects are buildings, a fifth are cars and the rest
+//  are pedestrians.  The levels are left in the writable path, so any of
+//  them can be profiled further with ShadeSim.
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "cocos2d.h"
+#include "../Classes/C_Simulation.h"
+#include "LevelGenerator.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+USING_NS_CC;
+
+/** The number of frames to simulate per level if none are given */
+#define DEFAULT_FRAMES 600
+/** The largest level to generate if none is given */
+#define DEFAULT_LARGEST 10000
+/** The smallest level to generate */
+#define SMALLEST_LEVEL 10
+
+/** Returns the resident memory of the process in megabytes, or 0 if unknown */
+static double residentMB()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.WorkingSetSize / (1024.0 * 1024.0);
+    }
+    return 0.0;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS) {
+        return info.resident_size / (1024.0 * 1024.0);
+    }
+    return 0.0;
+#else
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file == nullptr) {
+        return 0.0;
+    }
+    long pages = 0, resident = 0;
+    int read = fscanf(file, "%ld %ld", &pages, &resident);
+    fclose(file);
+    return read == 2 ? resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0) : 0.0;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    int frames = (argc > 1 ? atoi(argv[1]) : DEFAULT_FRAMES);
+    int largest = (argc > 2 ? atoi(argv[2]) : DEFAULT_LARGEST);
+    bool kinematic = (argc > 3 && strcmp(argv[3], "kinematic") == 0);
+    if (frames <= 0 || largest < SMALLEST_LEVEL) {
+        fprintf(stderr, "usage: %s [frames] [largest >= %d] [kinematic]\n", argv[0], SMALLEST_LEVEL);
+        return 2;
+    }
+
+    // 10, 30, 100, 300, ... so the points are evenly spaced on a log scale
+    std::vector<int> sizes;
+    for (int objects = SMALLEST_LEVEL; objects <= largest; objects = (objects % 3 == 0 ? objects * 10 / 3 : objects * 3)) {
+        sizes.push_back(objects);
+    }
+
+    printf("objects,buildings,cars,pedestrians,width,height,load_ms,setup_ms,level_mb,run_mb,"
+           "mean_ms,p95_ms,max_ms,movers_ms,physics_ms,ai_ms,exposure_ms\n");
+    std::string dir = FileUtils::getInstance()->getWritablePath();
+    for (int objects : sizes) {
+        LevelSpec spec;
+        spec.buildings = objects / 2;
+        spec.cars = objects / 5;
+        spec.pedestrians = objects - spec.buildings - spec.cars;
+        spec.seed = (unsigned int)objects;
+        spec.name = "bench_" + std::to_string(objects);
+        std::string file = dir + spec.name + ".shadl";
+        if (!writeLevel(spec, file)) {
+            fprintf(stderr, "failed to write %s\n", file.c_str());
+            return 1;
+        }
+
+        double before = residentMB();
+        SimulationController sim;
+        if (!sim.init(file, kinematic)) {
+            fprintf(stderr, "failed to load %s\n", file.c_str());
+            return 1;
+        }
+        double loaded = residentMB();
+        for (int frame = 0; frame < frames; frame++) {
+            sim.update(DEFAULT_WORLD_STEP);
+        }
+        double ran = residentMB();
+
+        SimulationStats stats = sim.getStats();
+        const Size& size = sim.getLevel()->_size;
+        printf("%d,%d,%d,%d,%.0f,%.0f,%.3f,%.3f,%.2f,%.2f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+               objects, spec.buildings, spec.cars, spec.pedestrians, size.width, size.height,
+               stats.load, stats.populate, loaded - before, ran - loaded,
+               stats.mean, stats.p95, stats.max,
+               stats.phases[FrameProfiler::MOVERS], stats.phases[FrameProfiler::PHYSICS],
+               stats.phases[FrameProfiler::AI], stats.phases[FrameProfiler::EXPOSURE]);
+        fflush(stdout);
+        sim.dispose();
+    }
+    return 0;
+}
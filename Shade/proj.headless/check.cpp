@@ -0,0 +1,607 @@
+//
+//  check.cpp
+//  Shade behaviour checks
+//
+//  Checks that the subsystems rewritten for speed still behave exactly as
+//  the code they replaced.  Each check prints one line, and the exit code
+//  is the number of checks that failed, so a build script can run them.
+//
+//  Usage: ShadeCheck [check...]
+//
+//  With no names every check runs.  The generated levels are left in the
+//  writable path, so a failing one can be run again with ShadeSim.
+//
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "cocos2d.h"
+#include "../Classes/C_Simulation.h"
+#include "../Classes/Trajectory.h"
+#include "LevelGenerator.h"
+
+USING_NS_CC;
+
+/** The number of steps the level checks simulate */
+#define CHECK_STEPS 600
+/** The number of random action queues driven by the queue check */
+#define ACTION_QUEUE_TRIALS 2000
+/** The number of operations on each of them */
+#define ACTION_QUEUE_OPS 200
+/** The number of random programs of each mover type the trajectory check runs */
+#define TRAJECTORY_TRIALS 200
+/** The number of frames each program is replayed for after it is compiled */
+#define TRAJECTORY_FRAMES 600
+/** How far a replayed body may be from its trajectory, in Box2D units or radians */
+#define TRAJECTORY_TOLERANCE 0.01f
+
+/** The shipped files the JSON check reads, besides a generated level */
+static const char* JSON_FILES[] = {
+    "constants/static_objects.shadc",
+    "levels/tutorial.shadl",
+    "levels/level1.shadl",
+    "levels/level2.shadl",
+    "levels/level3.shadl",
+    "levels/level4.shadl",
+    "levels/level5.shadl",
+    "levels/level6.shadl",
+    "levels/level7.shadl",
+    "levels/level8.shadl",
+    "levels/level9.shadl"
+};
+
+/** Returns "" if the check passed, or else what went wrong */
+typedef std::string (*CheckFunction)(const std::string& dir);
+
+/** Writes a generated level to the writable path */
+static bool writeCheckLevel(LevelSpec& spec, const std::string& dir, std::string& file)
+{
+    file = dir + spec.name + ".shadl";
+    return writeLevel(spec, file);
+}
+
+/**
+ * Walks the character through a crowd, cross-checking every parallel AI
+ * read phase against the serial one on the same state.
+ *
+ * Two separate runs could not be compared, as path searches and the flow
+ * field finish on worker threads at times that vary from run to run.
+ */
+static std::string checkParallelAI(const std::string& dir)
+{
+    LevelSpec spec;
+    spec.buildings = 16;
+    spec.pedestrians = 2000;
+    spec.seed = 14;
+    spec.name = "check_ai";
+    std::string file;
+    if (!writeCheckLevel(spec, dir, file)) {
+        return "failed to write " + file;
+    }
+    SimulationController sim;
+    if (!sim.init(file)) {
+        return "failed to load " + file;
+    }
+    if (!sim.hasParallelAI()) {
+        printf("  (no helper threads, so the read phase always runs serially)\n");
+        return "";
+    }
+    sim.setCrossCheckAI(true);
+    sim.tap(sim.getLevel()->_casterPos.position);
+    for (int step = 0; step < CHECK_STEPS && !sim.isComplete() && !sim.isFailed(); step++) {
+        sim.update(DEFAULT_WORLD_STEP);
+    }
+    if (sim.getCrossChecked() == 0) {
+        return "no read phase was large enough to run in parallel";
+    }
+    if (sim.getCrossMismatches() > 0) {
+        return std::to_string(sim.getCrossMismatches()) + " of " + std::to_string(sim.getCrossChecked()) +
+               " parallel decisions differ from the serial ones";
+    }
+    printf("  (%lu decisions compared)\n", sim.getCrossChecked());
+    return "";
+}
+
+/** One node of the reference queue */
+struct ListNode {
+    int label;
+    int next;
+    bool forced;
+};
+
+/** The nodes of every reference queue; a queue only holds indices into it */
+static std::vector<ListNode> gListNodes;
+
+/**
+ * The linked-list ActionQueue that the flat action program replaced, kept
+ * as the reference for its behaviour.  Each action is only a label, and
+ * the nodes live in one shared pool instead of behind shared pointers.
+ *
+ * Two behaviours changed on purpose, and this list has the new ones:
+ *
+ * - The list did not know where its cycle started, so the head of the
+ *   default cycle followed the current action around a cycle, and reset()
+ *   did nothing inside one.  It now stays at the cycle start.
+ * - Forcing actions in the middle of earlier forced ones, without
+ *   fromBeginning, made the rest of the earlier ones part of the default
+ *   cycle.  They now stay forced, so reset() still drops them.
+ *
+ * Pushing onto a cycling queue changed as well, so the check never does it.
+ */
+struct ListQueue {
+    int head;
+    int tail;
+    int initialHead;
+    int cycleStart;
+
+    ListQueue() : head(-1), tail(-1), initialHead(-1), cycleStart(-1) {}
+
+    bool isEmpty() const { return head < 0; }
+    int front() const { return gListNodes[head].label; }
+    bool tailLinksTo(int node) const { return tail >= 0 && gListNodes[tail].next == node; }
+    bool tailHasNext() const { return tail >= 0 && gListNodes[tail].next >= 0; }
+
+    void resetTail() {
+        if (tail >= 0) {
+            tail = head;
+        }
+        while (tailHasNext() && !tailLinksTo(head)) {
+            tail = gListNodes[tail].next;
+        }
+    }
+
+    void initialize(int node) {
+        head = tail = initialHead = node;
+        resetTail();
+    }
+
+    void setTailNext(int node) {
+        if (tail >= 0) {
+            gListNodes[tail].next = node;
+        } else {
+            initialize(node);
+        }
+    }
+
+    void pushNode(int node) {
+        if (isEmpty()) {
+            initialize(node);
+        } else {
+            setTailNext(node);
+            tail = gListNodes[tail].next;
+        }
+    }
+
+    void push(int label) {
+        ListNode node = { label, -1, false };
+        gListNodes.push_back(node);
+        pushNode((int)gListNodes.size() - 1);
+    }
+
+    void next() {
+        if (head < 0) {
+            return;
+        }
+        if (tailLinksTo(head)) {
+            tail = gListNodes[tail].next;
+        } else if (tail == head) {
+            tail = -1;
+        }
+        int popped = head;
+        head = gListNodes[head].next;
+        if (initialHead == popped && popped != cycleStart) {
+            initialHead = head;
+        }
+    }
+
+    void reset() {
+        head = initialHead;
+        resetTail();
+    }
+
+    void setCycling(bool cycle) {
+        setTailNext(cycle ? head : -1);
+        cycleStart = (cycle ? head : -1);
+    }
+
+    /** Copies another queue, with new nodes, as the old init(queue) did */
+    void copy(const ListQueue& queue) {
+        head = tail = initialHead = cycleStart = -1;
+        bool initialHeadSet = false;
+        for (int current = queue.head; current >= 0; current = gListNodes[current].next) {
+            if (!initialHeadSet) {
+                push(gListNodes[current].label);
+                if (current == queue.initialHead) {
+                    initialHead = tail;
+                    initialHeadSet = true;
+                }
+            } else if (current == queue.initialHead) {
+                setTailNext(initialHead);
+                cycleStart = initialHead;
+                return;
+            } else {
+                push(gListNodes[current].label);
+            }
+        }
+    }
+
+    void force(const ListQueue& queue, bool fromBeginning) {
+        ListQueue actions;
+        actions.copy(queue);
+        if (head < 0 || actions.tailHasNext()) {
+            *this = actions;
+            return;
+        }
+        for (int node = actions.head; node >= 0; node = gListNodes[node].next) {
+            gListNodes[node].forced = true;
+        }
+        if (!fromBeginning && gListNodes[head].forced) {
+            actions.setTailNext(head);
+            head = actions.head;
+            return;
+        }
+        if (!fromBeginning) {
+            initialHead = head;
+        }
+        actions.setTailNext(initialHead);
+        head = actions.head;
+        if (tail < 0) {
+            tail = actions.tail;
+        }
+    }
+};
+
+/** Pushes the same new labels onto a queue and its reference */
+static void pushLabels(ActionQueue<Car>& queue, ListQueue& list, int count, int& label)
+{
+    for (int ii = 0; ii < count; ii++, label++) {
+        queue.push(Car::GO, label);
+        list.push(label);
+    }
+}
+
+/**
+ * Drives the flat ActionQueue and the old linked list through the same
+ * random pushes, pops, resets and forced actions, and compares the current
+ * action after each one.
+ */
+static std::string checkActionQueue(const std::string& dir)
+{
+    std::mt19937 random(8);
+    int label = 1;
+    for (int trial = 0; trial < ACTION_QUEUE_TRIALS; trial++) {
+        ActionQueue<Car> queue;
+        ListQueue list;
+        pushLabels(queue, list, 1 + (int)(random() % 5), label);
+        if (random() % 2 == 0) {
+            queue.setCycling(true);
+            list.setCycling(true);
+        }
+        for (int op = 0; op < ACTION_QUEUE_OPS; op++) {
+            int kind = (int)(random() % 8);
+            const char* name = "next";
+            if (kind == 0) {
+                name = "reset";
+                queue.reset();
+                list.reset();
+            } else if (kind == 1 && !queue.isCycling()) {
+                // The list pushed into the middle of a cycle; see ListQueue
+                name = "push";
+                pushLabels(queue, list, 1, label);
+            } else if (kind == 2 || kind == 3) {
+                name = "force";
+                ActionQueue<Car> forced;
+                ListQueue forcedList;
+                pushLabels(forced, forcedList, 1 + (int)(random() % 3), label);
+                if (kind == 3) {
+                    forced.setCycling(true);
+                    forcedList.setCycling(true);
+                }
+                bool fromBeginning = random() % 2 == 0;
+                queue.force(forced, fromBeginning);
+                list.force(forcedList, fromBeginning);
+            } else {
+                queue.next();
+                list.next();
+            }
+            if (queue.isEmpty() != list.isEmpty() || (!queue.isEmpty() && queue.front()._length != list.front())) {
+                return "trial " + std::to_string(trial + 1) + " differs after " + name + " " + std::to_string(op + 1);
+            }
+        }
+        gListNodes.clear();
+    }
+    return "";
+}
+
+/** Builds a random action program out of the given action types */
+template <class T>
+static ActionQueue<T>* randomProgram(std::mt19937& random, const std::vector<typename T::ActionType>& types)
+{
+    ActionQueue<T>* queue = ActionQueue<T>::create();
+    int count = 1 + (int)(random() % 6);
+    for (int ii = 0; ii < count; ii++) {
+        float bearing = (float)(random() % 8) * (float)M_PI_4;
+        int length = 1 + (int)(random() % 60);
+        queue->push(bearing, types[random() % types.size()], length);
+    }
+    if (random() % 2 == 0) {
+        queue->setCycling(true);
+    }
+    return queue;
+}
+
+/** Returns whether a body matches a sample of its trajectory */
+static bool matchesSample(b2Body* body, const Trajectory::Sample& sample)
+{
+    return (body->GetPosition() - sample.position).Length() < TRAJECTORY_TOLERANCE &&
+           (body->GetLinearVelocity() - sample.velocity).Length() < TRAJECTORY_TOLERANCE &&
+           fabsf(body->GetAngle() - sample.angle) < TRAJECTORY_TOLERANCE;
+}
+
+/**
+ * Runs a mover partway through its program with act() and a physics world,
+ * compiles what is left, as park() does, and replays the rest frame by
+ * frame against the trajectory.
+ */
+template <class T>
+static std::string replayTrajectory(std::mt19937& random, const std::vector<typename T::ActionType>& types, int trial)
+{
+    b2World world(b2Vec2(0.0f, 0.0f));
+    BoxObstacle* object = BoxObstacle::create(Vec2::ZERO, Size(1.0f, 1.0f));
+    object->setFixedRotation(true);
+    BoxObstacle* shadow = BoxObstacle::create(Vec2::ZERO, Size(1.0f, 1.0f));
+    shadow->setDensity(0);
+    shadow->setFixedRotation(true);
+    shadow->setSensor(true);
+    object->activatePhysics(world);
+    shadow->activatePhysics(world);
+    OurMovingObject<T>* mover = OurMovingObject<T>::create(randomProgram<T>(random, types), object, shadow);
+
+    int warmup = (int)(random() % 120);
+    for (int frame = 0; frame < warmup; frame++) {
+        mover->act();
+        world.Step(TRAJECTORY_FRAME_TIME, DEFAULT_WORLD_VELOC, DEFAULT_WORLD_POSIT);
+    }
+
+    b2Body* body = object->getBody();
+    Trajectory::Sample start;
+    start.position = body->GetPosition();
+    start.velocity = body->GetLinearVelocity();
+    start.angle = body->GetAngle();
+    Trajectory trajectory;
+    trajectory.compile<T>(*(mover->_actionQueue), start);
+
+    std::string error;
+    for (int frame = 0; frame < TRAJECTORY_FRAMES && error.empty(); frame++) {
+        mover->act();
+        if (!matchesSample(body, trajectory.evaluate((float)frame))) {
+            error = T::name + " trial " + std::to_string(trial + 1) + " differs at frame " + std::to_string(frame);
+        }
+        world.Step(TRAJECTORY_FRAME_TIME, DEFAULT_WORLD_VELOC, DEFAULT_WORLD_POSIT);
+    }
+    object->deactivatePhysics(world);
+    shadow->deactivatePhysics(world);
+    return error;
+}
+
+/**
+ * Checks that a compiled trajectory puts a mover where act() and the
+ * physics world do, for random car and pedestrian programs.
+ *
+ * Each mover is alone in its world, as the trajectory does not know
+ * about collisions.
+ */
+static std::string checkTrajectories(const std::string& dir)
+{
+    // Pedestrian::act() has no case for the other pedestrian actions yet
+    std::vector<Car::ActionType> carTypes = { Car::GO, Car::STOP, Car::TURN_LEFT, Car::TURN_RIGHT };
+    std::vector<Pedestrian::ActionType> pedestrianTypes = { Pedestrian::WALK_SLOW, Pedestrian::STAND };
+    std::mt19937 random(16);
+    for (int trial = 0; trial < TRAJECTORY_TRIALS; trial++) {
+        std::string error = replayTrajectory<Car>(random, carTypes, trial);
+        if (error.empty()) {
+            error = replayTrajectory<Pedestrian>(random, pedestrianTypes, trial);
+        }
+        if (!error.empty()) {
+            return error;
+        }
+    }
+    return "";
+}
+
+/** Returns the type of the value at the cursor, as a JSON_TYPE constant */
+static int readerType(const JSONReader& reader)
+{
+    if (reader.isNull()) {
+        return JSON_TYPE_NULL;
+    } else if (reader.isBool()) {
+        return JSON_TYPE_BOOL;
+    } else if (reader.isNumber()) {
+        return JSON_TYPE_FLOAT;
+    } else if (reader.isString()) {
+        return JSON_TYPE_STRING;
+    }
+    return reader.isObject() ? JSON_TYPE_OBJECT : JSON_TYPE_ARRAY;
+}
+
+/** Returns whether two names of a list are the same, ignoring case as lookups do */
+static bool hasRepeatedName(std::vector<std::string> names)
+{
+    for (std::string& name : names) {
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    }
+    std::sort(names.begin(), names.end());
+    return std::adjacent_find(names.begin(), names.end()) != names.end();
+}
+
+/**
+ * Looks up every field of the object at the cursor by name, last to first
+ * and then first to last, so that lookups both with and against the hint
+ * of the last field found are compared with the tree.
+ *
+ * An object that repeats a name is skipped, as the tape may find any of
+ * its fields by that name.
+ */
+static std::string compareFields(JSONReader& reader, const JSONValue* value, const std::string& path)
+{
+    std::vector<std::string> names;
+    for (JSONValue* child = value->getChild(); child != nullptr; child = child->getNext()) {
+        names.push_back(child->getName());
+    }
+    if (hasRepeatedName(names)) {
+        return "";
+    }
+    std::vector<std::string> order(names.rbegin(), names.rend());
+    order.insert(order.end(), names.begin(), names.end());
+
+    std::string error;
+    reader.startObject();
+    for (size_t ii = 0; ii < order.size() && error.empty(); ii++) {
+        const JSONValue* field = value->getItem(order[ii]);
+        if (!reader.exists(order[ii]) || reader.getSize(order[ii]) != field->getSize() ||
+            reader.getBool(order[ii]) != field->asBool() || reader.getNumber(order[ii]) != field->asFloat() ||
+            reader.getString(order[ii]) != field->asString()) {
+            error = path + "." + order[ii] + ": looking it up by name gives a different value";
+        }
+    }
+    reader.endObject();
+    return error;
+}
+
+/**
+ * Walks the tape from the cursor alongside a JSONValue tree, comparing the
+ * type, key and value of every node.
+ *
+ * Numbers must match exactly, as the tape decodes them without strtod.
+ */
+static std::string compareJSON(JSONReader& reader, const JSONValue* value, const std::string& path)
+{
+    int type = readerType(reader);
+    if (type != value->getType()) {
+        return path + ": type " + std::to_string(type) + " instead of " + std::to_string(value->getType());
+    }
+    switch (type) {
+    case JSON_TYPE_BOOL:
+        return reader.asBool() == value->asBool() ? "" : path + ": booleans differ";
+    case JSON_TYPE_FLOAT:
+        if (reader.asNumber() != value->asFloat()) {
+            return path + ": " + std::to_string(reader.asNumber()) + " instead of " + std::to_string(value->asFloat());
+        }
+        return "";
+    case JSON_TYPE_STRING:
+        return reader.asString() == value->asString() ? "" : path + ": \"" + reader.asString() + "\" instead of \"" +
+               value->asString() + "\"";
+    case JSON_TYPE_NULL:
+        return "";
+    }
+
+    if (reader.getSize() != value->getSize()) {
+        return path + ": " + std::to_string(reader.getSize()) + " children instead of " + std::to_string(value->getSize());
+    }
+    std::string error = (type == JSON_TYPE_OBJECT ? compareFields(reader, value, path) : "");
+    if (!error.empty() || value->getSize() == 0) {
+        return error;
+    }
+    reader.startArray();
+    int index = 0;
+    for (JSONValue* child = value->getChild(); child != nullptr && error.empty(); child = child->getNext(), index++) {
+        std::string where = path + (type == JSON_TYPE_OBJECT ? "." + child->getName() : "[" + std::to_string(index) + "]");
+        if (type == JSON_TYPE_OBJECT && reader.getKey() != child->getName()) {
+            error = where + ": key \"" + reader.getKey() + "\"";
+        } else {
+            error = compareJSON(reader, child, where);
+        }
+        reader.advance();
+    }
+    reader.endArray();
+    return error;
+}
+
+/** Parses a file onto a tape and into a JSONValue tree, and compares the two */
+static std::string compareJSONFile(const std::string& file)
+{
+    std::string source = FileUtils::getInstance()->getStringFromFile(file);
+    if (source.empty()) {
+        return "failed to read " + file;
+    }
+    JSONValue* tree = JSONValue::createWithString(source);
+    JSONReader reader;
+    bool parsed = reader.startJSON(source);
+    std::string error;
+    if (tree == nullptr || !parsed) {
+        error = file + (tree == nullptr ? " is not JSON to the tree" : " is not JSON to the tape");
+    } else {
+        error = compareJSON(reader, tree, file);
+    }
+    reader.endJSON();
+    delete tree;
+    return error;
+}
+
+/**
+ * Checks that the token tape JSONReader reads matches the JSONValue tree
+ * it replaced, on every shipped level, the static object table and a
+ * generated level.
+ */
+static std::string checkJSON(const std::string& dir)
+{
+    LevelSpec spec;
+    spec.buildings = 16;
+    spec.pedestrians = 200;
+    spec.seed = 22;
+    spec.name = "check_json";
+    std::string generated;
+    if (!writeCheckLevel(spec, dir, generated)) {
+        return "failed to write " + generated;
+    }
+    std::vector<std::string> files(std::begin(JSON_FILES), std::end(JSON_FILES));
+    files.push_back(generated);
+    for (const std::string& file : files) {
+        std::string error = compareJSONFile(file);
+        if (!error.empty()) {
+            return error;
+        }
+    }
+    return "";
+}
+
+/** A check and the name it is run by */
+struct NamedCheck {
+    const char* name;
+    CheckFunction run;
+};
+
+static const NamedCheck CHECKS[] = {
+    { "ai", checkParallelAI },
+    { "queue", checkActionQueue },
+    { "trajectory", checkTrajectories },
+    { "json", checkJSON }
+};
+
+int main(int argc, char **argv)
+{
+    std::string dir = FileUtils::getInstance()->getWritablePath();
+    int failed = 0;
+    for (const NamedCheck& check : CHECKS) {
+        bool wanted = (argc < 2);
+        for (int ii = 1; ii < argc; ii++) {
+            wanted = wanted || strcmp(argv[ii], check.name) == 0;
+        }
+        if (!wanted) {
+            continue;
+        }
+        printf("%s\n", check.name);
+        std::string error = check.run(dir);
+        if (error.empty()) {
+            printf("  ok\n");
+        } else {
+            printf("  FAILED: %s\n", error.c_str());
+            failed++;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,211 @@
+//
+//  levelc.cpp
+//  Shade level compiler
+//
+//  Compiles .shadl level files into the binary .shadb format of
+//  Classes/LevelFormat.fbs, which LevelInstance maps and reads in place
+//  with no parsing.  Each level is read and validated by the same code the
+//  game uses for .shadl files, its static object types are checked against
+//  constants/static_objects.shadc, and the compiled file is read back and
+//  compared with the source before it is kept.
+//
+//  Usage: ShadeLevelc <level.shadl>... [-o out.shadb]
+//
+//  Each level is written beside its source with the .shadb extension,
+//  unless a single level is given with -o.  A compiled level must be
+//  rebuilt whenever its source changes.
+//
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+#include "cocos2d.h"
+#include <cornell.h>
+#include <cornell/CUTimestamp.h>
+#include "../Classes/C_Gameplay.h"
+#include "../Classes/M_LevelInstance.h"
+
+USING_NS_CC;
+
+/** The extension of level source files */
+#define SOURCE_EXTENSION ".shadl"
+
+/** Reads the names of every static object type */
+static bool readStaticTypes(std::set<std::string>& types)
+{
+    JSONReader reader;
+    reader.initWithFile(STATIC_OBJECTS);
+    if (!reader.startJSON()) {
+        return false;
+    }
+    int count = reader.startArray("types");
+    for (int index = 0; index < count; index++) {
+        reader.startObject();
+        types.insert(reader.getString("name"));
+        reader.endObject();
+        reader.advance();
+    }
+    reader.endArray();
+    reader.endJSON();
+    return true;
+}
+
+/** Returns the compiled file name for a source file */
+static std::string compiledName(const std::string& source)
+{
+    size_t length = strlen(SOURCE_EXTENSION);
+    if (source.size() > length && source.compare(source.size() - length, length, SOURCE_EXTENSION) == 0) {
+        return source.substr(0, source.size() - length) + COMPILED_LEVEL_EXTENSION;
+    }
+    return source + COMPILED_LEVEL_EXTENSION;
+}
+
+/**
+ * Loads the metadata of a level file, without populating it.
+ *
+ * @return the retained level, or nullptr if it failed to load
+ */
+static LevelInstance* loadLevel(const std::string& file, double& millis)
+{
+    timestamp_t start = current_time();
+    LevelInstance* level = LevelInstance::create(file);
+    if (level == nullptr) {
+        return nullptr;
+    }
+    level->retain();
+    level->setHeadless(true);
+    if (!level->initializeMetadata()) {
+        level->release();
+        return nullptr;
+    }
+    millis = elapsed_micros(start, current_time()) / 1000.0;
+    return level;
+}
+
+/** Returns a description of the first difference between two levels, or "" if they match */
+template <class T>
+static std::string compareMovers(const char* kind, const std::vector<LevelInstance::MovingObjectMetadata<T>>& a,
+                                 const std::vector<LevelInstance::MovingObjectMetadata<T>>& b)
+{
+    if (a.size() != b.size()) {
+        return std::string(kind) + " count";
+    }
+    for (size_t ii = 0; ii < a.size(); ii++) {
+        std::string mover = std::string(kind) + " " + std::to_string(ii + 1);
+        if (a[ii].position != b[ii].position || a[ii].heading != b[ii].heading) {
+            return mover;
+        }
+        int action = a[ii].actions->firstDifference(*b[ii].actions);
+        if (action != NO_ACTION) {
+            return mover + " actions, from action " + std::to_string(action + 1);
+        }
+    }
+    return "";
+}
+
+/** Returns a description of the first difference between two levels, or "" if they match */
+static std::string compareLevels(const LevelInstance* a, const LevelInstance* b)
+{
+    if (a->_levelIndex != b->_levelIndex) return "index";
+    if (a->_name != b->_name) return "name";
+    if (a->_imageFormat != b->_imageFormat) return "imageFormat";
+    if (!a->_size.equals(b->_size)) return "size";
+    if (a->_playerPos.position != b->_playerPos.position) return "player position";
+    if (a->_casterPos.position != b->_casterPos.position || a->_casterPos.heading != b->_casterPos.heading) {
+        return "caster";
+    }
+    if (a->_staticObjects.size() != b->_staticObjects.size()) return "static object count";
+    for (size_t ii = 0; ii < a->_staticObjects.size(); ii++) {
+        if (a->_staticObjects[ii].position != b->_staticObjects[ii].position ||
+            a->_staticObjects[ii].type != b->_staticObjects[ii].type) {
+            return "static object " + std::to_string(ii + 1);
+        }
+    }
+    std::string diff = compareMovers("pedestrian", a->_pedestrians, b->_pedestrians);
+    return diff.empty() ? compareMovers("car", a->_cars, b->_cars) : diff;
+}
+
+/** Compiles one level, returning false on any error */
+static bool compile(const std::string& source, const std::string& target, const std::set<std::string>& types)
+{
+    double sourceMillis = 0.0, targetMillis = 0.0;
+    LevelInstance* level = loadLevel(source, sourceMillis);
+    if (level == nullptr) {
+        fprintf(stderr, "%s: failed to load\n", source.c_str());
+        return false;
+    }
+    bool ok = true;
+    for (size_t ii = 0; ii < level->_staticObjects.size(); ii++) {
+        if (types.count(level->_staticObjects[ii].type) == 0) {
+            fprintf(stderr, "%s: static object %d has unknown type \"%s\"\n",
+                    source.c_str(), (int)ii + 1, level->_staticObjects[ii].type.c_str());
+            ok = false;
+        }
+    }
+    if (ok && !level->writeCompiled(target)) {
+        fprintf(stderr, "%s: failed to write\n", target.c_str());
+        ok = false;
+    }
+
+    LevelInstance* compiled = (ok ? loadLevel(target, targetMillis) : nullptr);
+    if (ok && compiled == nullptr) {
+        fprintf(stderr, "%s: failed to read back\n", target.c_str());
+        ok = false;
+    }
+    if (ok) {
+        std::string diff = compareLevels(level, compiled);
+        if (!diff.empty()) {
+            fprintf(stderr, "%s: %s differs from the source\n", target.c_str(), diff.c_str());
+            ok = false;
+        }
+    }
+    if (ok) {
+        printf("%s -> %s (%ld bytes), load %.3f ms -> %.3f ms\n", source.c_str(), target.c_str(),
+               (long)FileUtils::getInstance()->getFileSize(target), sourceMillis, targetMillis);
+    } else {
+        FileUtils::getInstance()->removeFile(target);
+    }
+    if (compiled != nullptr) {
+        compiled->release();
+    }
+    level->release();
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> sources;
+    std::string output;
+    for (int ii = 1; ii < argc; ii++) {
+        if (strcmp(argv[ii], "-o") == 0 && ii + 1 < argc) {
+            output = argv[++ii];
+        } else {
+            sources.push_back(argv[ii]);
+        }
+    }
+    if (sources.empty() || (!output.empty() && sources.size() > 1)) {
+        fprintf(stderr, "usage: %s <level.shadl>... [-o out.shadb]\n", argv[0]);
+        return 2;
+    }
+
+    std::set<std::string> types;
+    if (!readStaticTypes(types)) {
+        fprintf(stderr, "failed to load %s\n", STATIC_OBJECTS);
+        return 1;
+    }
+    int failed = 0;
+    for (const std::string& name : sources) {
+        // Sources are found on the resource path, so the level lands beside its source
+        std::string source = FileUtils::getInstance()->fullPathForFilename(name);
+        if (source.empty()) {
+            fprintf(stderr, "%s: not found\n", name.c_str());
+            failed++;
+            continue;
+        }
+        if (!compile(source, output.empty() ? compiledName(source) : output, types)) {
+            failed++;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+//
+//  levelgen.cpp
+//  Shade level generator
+//
+//  Writes a procedural stress level with the given numbers of buildings,
+//  cars and pedestrians, for profiling with ShadeSim or ShadeBench.  The
+//  level is a grid of city blocks, see generateLevel().
+//
+//  Usage: ShadeLevelGen <out.shadl> <buildings> <cars> <pedestrians> [width height] [seed]
+//
+//  The width and height are in Box2D units, and are rounded up to a whole
+//  number of blocks.  Without them the level is sized to fit the buildings.
+//
+#include <cstdio>
+#include <cstdlib>
+#include "LevelGenerator.h"
+
+int main(int argc, char **argv)
+{
+    if (argc < 5) {
+        fprintf(stderr, "usage: %s <out.shadl> <buildings> <cars> <pedestrians> [width height] [seed]\n", argv[0]);
+        return 2;
+    }
+    LevelSpec spec;
+    spec.buildings = atoi(argv[2]);
+    spec.cars = atoi(argv[3]);
+    spec.pedestrians = atoi(argv[4]);
+    if (argc > 6) {
+        spec.width = (float)atof(argv[5]);
+        spec.height = (float)atof(argv[6]);
+    }
+    if (argc > 7) {
+        spec.seed = (unsigned int)strtoul(argv[7], nullptr, 10);
+    }
+    if (spec.buildings < 0 || spec.cars < 0 || spec.pedestrians < 0) {
+        fprintf(stderr, "object counts must not be negative\n");
+        return 2;
+    }
+
+    if (!writeLevel(spec, argv[1])) {
+        fprintf(stderr, "failed to write %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
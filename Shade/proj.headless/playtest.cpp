@@ -0,0 +1,89 @@
+//
+//  playtest.cpp
+//  Shade playtest bots
+//
+//  Plays each level given with many scripted bots at once, one simulation
+//  per core, and prints for each level how often the bots won, how they
+//  lost, the fastest and mean completion times and how close the winners
+//  came to burning up.  Each bot has its own seed, which sets how it
+//  plays, so a level that only a few bots can beat is a hard level.  The
+//  last line gives the simulated frames per second across every core.
+//
+//  Usage: ShadePlaytest <runs> <level.shadl>... [-t threads] [-s seed] [-f frames]
+//
+//  The frame limit is in simulated frames; a bot still playing then counts
+//  as timed out.
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include "cocos2d.h"
+#include "../Classes/C_Gameplay.h"
+#include "../Classes/PlaytestBot.h"
+
+USING_NS_CC;
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <runs> <level.shadl>... [-t threads] [-s seed] [-f frames]\n", argv[0]);
+        return 2;
+    }
+    int runs = atoi(argv[1]);
+    int threads = -1;
+    unsigned int seed = 1;
+    int frames = BOT_FRAME_LIMIT;
+    std::vector<std::string> levels;
+    for (int ii = 2; ii < argc; ii++) {
+        if (strcmp(argv[ii], "-t") == 0 && ii + 1 < argc) {
+            threads = atoi(argv[++ii]);
+        } else if (strcmp(argv[ii], "-s") == 0 && ii + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++ii], nullptr, 10);
+        } else if (strcmp(argv[ii], "-f") == 0 && ii + 1 < argc) {
+            frames = atoi(argv[++ii]);
+        } else {
+            levels.push_back(argv[ii]);
+        }
+    }
+    if (runs <= 0 || frames <= 0 || threads == 0 || levels.empty()) {
+        fprintf(stderr, "runs, frames and threads must be positive\n");
+        return 2;
+    }
+
+    Playtester tester;
+    tester.init(threads);
+    long totalFrames = 0;
+    double totalSeconds = 0.0;
+    int status = 0;
+    for (const std::string& level : levels) {
+        PlaytestReport report;
+        if (!tester.run(level, runs, seed, frames, report)) {
+            fprintf(stderr, "failed to load %s\n", level.c_str());
+            status = 1;
+            continue;
+        }
+        printf("%s\n", level.c_str());
+        printf("  won:         %d/%d (%.1f%%)\n", report.wins, report.runs, 100.0f * report.getWinRate());
+        printf("  caught:      %d\n", report.caught);
+        printf("  overexposed: %d\n", report.overexposed);
+        printf("  timed out:   %d\n", report.getTimeouts());
+        if (report.wins > 0) {
+            printf("  best time:   %.2f s (mean %.2f s)\n", report.bestTime, report.meanTime);
+            printf("  margin:      %.2f s at least (mean %.2f s) of %.1f s\n",
+                   report.minMargin, report.meanMargin, EXPOSURE_LIMIT);
+        }
+        printf("  throughput:  %.0f frames/s (%ld frames in %.2f s)\n",
+               report.getThroughput(), report.frames, report.seconds);
+        fflush(stdout);
+        totalFrames += report.frames;
+        totalSeconds += report.seconds;
+    }
+    tester.dispose();
+
+    if (totalSeconds > 0.0) {
+        printf("total: %ld frames in %.2f s, %.0f frames/s\n", totalFrames, totalSeconds, totalFrames / totalSeconds);
+    }
+    return status;
+}